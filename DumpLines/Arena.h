@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+// Monotonic allocator: memory is carved from large blocks and only released all at
+// once when the arena is destroyed (or rewound to a previous mark for temporary data).
+// Nothing is constructed or destroyed: only use it for trivially destructible types.
+class Arena
+{
+public:
+    explicit Arena(size_t blockSize = 64 * 1024)
+        : _blockSize(blockSize)
+        , _current(nullptr)
+        , _end(nullptr)
+        , _allocatedSize(0)
+    {
+    }
+
+    void* Allocate(size_t size, size_t alignment = sizeof(void*))
+    {
+        uintptr_t aligned = (reinterpret_cast<uintptr_t>(_current) + alignment - 1) & ~(alignment - 1);
+        if ((_current == nullptr) || (aligned + size > reinterpret_cast<uintptr_t>(_end)))
+        {
+            AddBlock(size + alignment);
+            aligned = (reinterpret_cast<uintptr_t>(_current) + alignment - 1) & ~(alignment - 1);
+        }
+
+        _current = reinterpret_cast<uint8_t*>(aligned + size);
+        return reinterpret_cast<void*>(aligned);
+    }
+
+    template <typename T>
+    T* AllocateArray(size_t count)
+    {
+        return static_cast<T*>(Allocate(count * sizeof(T), alignof(T)));
+    }
+
+    // Temporary allocations: everything allocated after GetMark() is released by Rewind()
+    struct Mark
+    {
+        size_t block;
+        uint8_t* current;
+    };
+
+    Mark GetMark() const { return { _blocks.size(), _current }; }
+
+    void Rewind(const Mark& mark)
+    {
+        // a block added since the mark only contains temporary data: it is reused from its start
+        if (mark.block == _blocks.size())
+        {
+            _current = mark.current;
+        }
+        else
+        {
+            _current = _blocks.back().get();
+        }
+    }
+
+    size_t GetAllocatedSize() const { return _allocatedSize; }
+    size_t GetBlockCount() const { return _blocks.size(); }
+
+private:
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    void AddBlock(size_t minimumSize)
+    {
+        // blocks double in size up to 1 MB so that small PDBs don't waste memory
+        size_t size = (minimumSize > _blockSize) ? minimumSize : _blockSize;
+        if (_blockSize < 1024 * 1024)
+        {
+            _blockSize *= 2;
+        }
+
+        _blocks.emplace_back(new uint8_t[size]);
+        _current = _blocks.back().get();
+        _end = _current + size;
+        _allocatedSize += size;
+    }
+
+private:
+    size_t _blockSize;
+    uint8_t* _current;
+    uint8_t* _end;
+    size_t _allocatedSize;
+    std::vector<std::unique_ptr<uint8_t[]>> _blocks;
+};
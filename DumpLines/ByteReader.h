@@ -0,0 +1,221 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <string>
+
+// Bounds-checked little endian reader over an in-memory buffer.
+// Every Read method returns false (and leaves the position untouched) when
+// the buffer is too small so that parsers can bail out on corrupted files.
+class ByteReader
+{
+public:
+    ByteReader(const uint8_t* data, size_t size)
+        : _data(data)
+        , _size(size)
+        , _position(0)
+    {
+    }
+
+    size_t GetPosition() const { return _position; }
+    size_t GetSize() const { return _size; }
+    size_t GetRemaining() const { return _size - _position; }
+    const uint8_t* GetData() const { return _data; }
+    const uint8_t* GetCurrent() const { return _data + _position; }
+
+    bool Seek(size_t position)
+    {
+        if (position > _size)
+        {
+            return false;
+        }
+
+        _position = position;
+        return true;
+    }
+
+    bool Skip(size_t count)
+    {
+        if (count > GetRemaining())
+        {
+            return false;
+        }
+
+        _position += count;
+        return true;
+    }
+
+    bool Align(size_t alignment)
+    {
+        size_t aligned = (_position + alignment - 1) & ~(alignment - 1);
+        return Seek(aligned);
+    }
+
+    template <typename T>
+    bool Read(T& value)
+    {
+        if (sizeof(T) > GetRemaining())
+        {
+            return false;
+        }
+
+        memcpy(&value, _data + _position, sizeof(T));
+        _position += sizeof(T);
+        return true;
+    }
+
+    bool ReadBytes(void* buffer, size_t count)
+    {
+        if (count > GetRemaining())
+        {
+            return false;
+        }
+
+        memcpy(buffer, _data + _position, count);
+        _position += count;
+        return true;
+    }
+
+    // ECMA-335 II.23.2 compressed unsigned integer (1, 2 or 4 bytes, big endian)
+    bool ReadCompressedUInt(uint32_t& value)
+    {
+        if (GetRemaining() < 1)
+        {
+            return false;
+        }
+
+        const uint8_t* p = _data + _position;
+        if ((p[0] & 0x80) == 0)
+        {
+            value = p[0];
+            _position += 1;
+            return true;
+        }
+
+        if ((p[0] & 0xC0) == 0x80)
+        {
+            if (GetRemaining() < 2)
+            {
+                return false;
+            }
+
+            value = ((p[0] & 0x3F) << 8) | p[1];
+            _position += 2;
+            return true;
+        }
+
+        if ((p[0] & 0xE0) == 0xC0)
+        {
+            if (GetRemaining() < 4)
+            {
+                return false;
+            }
+
+            value = ((p[0] & 0x1F) << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+            _position += 4;
+            return true;
+        }
+
+        return false;
+    }
+
+    // ECMA-335 II.23.2 compressed signed integer (the sign is stored in the lowest bit)
+    bool ReadCompressedInt(int32_t& value)
+    {
+        size_t start = _position;
+        uint32_t encoded = 0;
+        if (!ReadCompressedUInt(encoded))
+        {
+            return false;
+        }
+
+        size_t length = _position - start;
+        value = static_cast<int32_t>(encoded >> 1);
+        if ((encoded & 1) != 0)
+        {
+            value -= (length == 1) ? 0x40 : ((length == 2) ? 0x2000 : 0x10000000);
+        }
+
+        return true;
+    }
+
+    // LEB128 (see ByteWriter::WriteVarUInt)
+    bool ReadVarUInt(uint64_t& value)
+    {
+        uint64_t result = 0;
+        for (size_t i = 0, shift = 0; (_position + i < _size) && (shift < 64); i++, shift += 7)
+        {
+            uint8_t byte = _data[_position + i];
+            result |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0)
+            {
+                value = result;
+                _position += i + 1;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    bool ReadVarUInt(uint32_t& value)
+    {
+        uint64_t result = 0;
+        if (!ReadVarUInt(result))
+        {
+            return false;
+        }
+
+        value = static_cast<uint32_t>(result);
+        return true;
+    }
+
+    // ZigZag (see ByteWriter::WriteVarInt)
+    bool ReadVarInt(int64_t& value)
+    {
+        uint64_t encoded = 0;
+        if (!ReadVarUInt(encoded))
+        {
+            return false;
+        }
+
+        value = static_cast<int64_t>(encoded >> 1) ^ -static_cast<int64_t>(encoded & 1);
+        return true;
+    }
+
+    // Return a pointer to the NUL terminated string at the current position
+    bool ReadCString(const char*& str)
+    {
+        const void* end = memchr(_data + _position, 0, GetRemaining());
+        if (end == nullptr)
+        {
+            return false;
+        }
+
+        str = reinterpret_cast<const char*>(_data + _position);
+        _position = static_cast<const uint8_t*>(end) - _data + 1;
+        return true;
+    }
+
+    // 16-bit length followed by the characters (see ByteWriter::WriteShortString)
+    bool ReadShortString(std::string& str)
+    {
+        size_t start = _position;
+        uint16_t length = 0;
+        if (!Read(length) || (length > GetRemaining()))
+        {
+            _position = start;
+            return false;
+        }
+
+        str.assign(reinterpret_cast<const char*>(_data + _position), length);
+        _position += length;
+        return true;
+    }
+
+private:
+    const uint8_t* _data;
+    size_t _size;
+    size_t _position;
+};
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+// Little endian writer appending to a growable buffer (counterpart of ByteReader)
+class ByteWriter
+{
+public:
+    ByteWriter(std::vector<uint8_t>& buffer)
+        : _buffer(buffer)
+    {
+    }
+
+    size_t GetPosition() const { return _buffer.size(); }
+
+    template <typename T>
+    void Write(const T& value)
+    {
+        WriteBytes(&value, sizeof(T));
+    }
+
+    void WriteBytes(const void* data, size_t count)
+    {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        _buffer.insert(_buffer.end(), bytes, bytes + count);
+    }
+
+    // LEB128: 7 bits per byte, lowest bits first
+    void WriteVarUInt(uint64_t value)
+    {
+        while (value >= 0x80)
+        {
+            _buffer.push_back(static_cast<uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        _buffer.push_back(static_cast<uint8_t>(value));
+    }
+
+    // ZigZag: small negative values are encoded as small unsigned values
+    void WriteVarInt(int64_t value)
+    {
+        WriteVarUInt((static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+    }
+
+    // 16-bit length followed by the characters: nothing is written for longer strings
+    bool WriteShortString(const char* str, size_t length)
+    {
+        if (length > 0xFFFF)
+        {
+            return false;
+        }
+
+        Write(static_cast<uint16_t>(length));
+        WriteBytes(str, length);
+        return true;
+    }
+
+    // Overwrite a value already written at the given position (used to patch sizes)
+    template <typename T>
+    void Patch(size_t position, const T& value)
+    {
+        memcpy(_buffer.data() + position, &value, sizeof(T));
+    }
+
+private:
+    std::vector<uint8_t>& _buffer;
+};
@@ -0,0 +1,316 @@
+#include "CompactMethodTable.h"
+#include "ByteReader.h"
+#include "ByteWriter.h"
+
+#include <algorithm>
+
+
+static size_t GetSharedPrefixLength(const std::string& a, const std::string& b)
+{
+    size_t length = (std::min)(a.size(), b.size());
+    size_t i = 0;
+    while ((i < length) && (a[i] == b[i]))
+    {
+        i++;
+    }
+    return i;
+}
+
+static void WritePrefixedString(ByteWriter& writer, const std::string& previous, const std::string& str)
+{
+    size_t shared = GetSharedPrefixLength(previous, str);
+    writer.WriteVarUInt(shared);
+    writer.WriteVarUInt(str.size() - shared);
+    writer.WriteBytes(str.data() + shared, str.size() - shared);
+}
+
+static bool ReadPrefixedString(ByteReader& reader, const std::string& previous, std::string& str)
+{
+    uint32_t shared = 0;
+    uint32_t suffixLength = 0;
+    if (!reader.ReadVarUInt(shared) || !reader.ReadVarUInt(suffixLength) ||
+        (shared > previous.size()) || (suffixLength > reader.GetRemaining()))
+    {
+        return false;
+    }
+
+    str.assign(previous, 0, shared);
+    str.append(reinterpret_cast<const char*>(reader.GetCurrent()), suffixLength);
+    return reader.Skip(suffixLength);
+}
+
+
+CompactMethodTable::CompactMethodTable()
+    :
+    _methodCount(0),
+    _blockCount(0),
+    _blocksSize(0),
+    _prefixSize(0)
+{
+}
+
+void CompactMethodTable::Encode(const std::vector<MethodInfo>& methods, std::vector<uint8_t>& buffer)
+{
+    std::vector<const MethodInfo*> sortedMethods;
+    sortedMethods.reserve(methods.size());
+    for (const MethodInfo& method : methods)
+    {
+        sortedMethods.push_back(&method);
+    }
+    std::stable_sort(sortedMethods.begin(), sortedMethods.end(),
+        [](const MethodInfo* a, const MethodInfo* b) { return a->rva < b->rva; });
+
+    // source files are stored once
+    std::vector<std::string> files;
+    for (const MethodInfo& method : methods)
+    {
+        if (!method.sourceFile.empty())
+        {
+            files.push_back(method.sourceFile);
+        }
+    }
+    std::sort(files.begin(), files.end());
+    files.erase(std::unique(files.begin(), files.end()), files.end());
+
+    std::vector<uint8_t> fileTable;
+    ByteWriter fileWriter(fileTable);
+    fileWriter.WriteVarUInt(files.size());
+    for (size_t i = 0; i < files.size(); i++)
+    {
+        WritePrefixedString(fileWriter, (i == 0) ? std::string() : files[i - 1], files[i]);
+    }
+
+    std::vector<BlockEntry> blockEntries;
+    std::vector<uint8_t> blocks;
+    ByteWriter blockWriter(blocks);
+    std::string previousName;
+    uint32_t previousRva = 0;
+    uint32_t previousIndex = 0;
+    uint32_t previousLine = 0;
+    for (size_t i = 0; i < sortedMethods.size(); i++)
+    {
+        const MethodInfo& method = *sortedMethods[i];
+        if ((i % MethodsPerBlock) == 0)
+        {
+            blockEntries.push_back({ method.rva, static_cast<uint32_t>(blocks.size()) });
+            previousName.clear();
+            previousRva = 0;
+            previousIndex = 0;
+            previousLine = 0;
+        }
+
+        uint32_t fileIndex = 0;
+        if (!method.sourceFile.empty())
+        {
+            fileIndex = static_cast<uint32_t>(std::lower_bound(files.begin(), files.end(), method.sourceFile) - files.begin()) + 1;
+        }
+
+        blockWriter.WriteVarUInt(method.rva - previousRva);
+        blockWriter.WriteVarUInt(method.size);
+        blockWriter.WriteVarInt(static_cast<int64_t>(method.index) - previousIndex);
+        blockWriter.WriteVarInt(static_cast<int64_t>(method.lineNumber) - previousLine);
+        blockWriter.WriteVarUInt(fileIndex);
+        WritePrefixedString(blockWriter, previousName, method.name);
+
+        previousName = method.name;
+        previousRva = method.rva;
+        previousIndex = method.index;
+        previousLine = method.lineNumber;
+    }
+
+    buffer.clear();
+    buffer.reserve(HeaderSize + blockEntries.size() * sizeof(BlockEntry) + fileTable.size() + blocks.size());
+    ByteWriter writer(buffer);
+    writer.Write(static_cast<uint32_t>(sortedMethods.size()));
+    writer.Write(static_cast<uint32_t>(blockEntries.size()));
+    writer.Write(static_cast<uint32_t>(fileTable.size()));
+    writer.Write(static_cast<uint32_t>(blocks.size()));
+    writer.Write(static_cast<uint32_t>(MethodsPerBlock));
+    for (const BlockEntry& entry : blockEntries)
+    {
+        writer.Write(entry.firstAddress);
+        writer.Write(entry.offset);
+    }
+    writer.WriteBytes(fileTable.data(), fileTable.size());
+    writer.WriteBytes(blocks.data(), blocks.size());
+}
+
+bool CompactMethodTable::GetPrefixSize(const uint8_t* header, size_t size, size_t& prefixSize)
+{
+    ByteReader reader(header, size);
+    uint32_t methodCount = 0;
+    uint32_t blockCount = 0;
+    uint32_t fileTableSize = 0;
+    if (!reader.Read(methodCount) || !reader.Read(blockCount) || !reader.Read(fileTableSize))
+    {
+        return false;
+    }
+
+    prefixSize = HeaderSize + static_cast<size_t>(blockCount) * sizeof(BlockEntry) + fileTableSize;
+    return true;
+}
+
+bool CompactMethodTable::Open(const uint8_t* prefix, size_t size)
+{
+    ByteReader reader(prefix, size);
+    uint32_t fileTableSize = 0;
+    uint32_t methodsPerBlock = 0;
+    if (!reader.Read(_methodCount) ||
+        !reader.Read(_blockCount) ||
+        !reader.Read(fileTableSize) ||
+        !reader.Read(_blocksSize) ||
+        !reader.Read(methodsPerBlock) ||
+        (_blockCount > reader.GetRemaining() / sizeof(BlockEntry)))
+    {
+        return false;
+    }
+
+    _blocks.resize(_blockCount);
+    for (BlockEntry& entry : _blocks)
+    {
+        reader.Read(entry.firstAddress);
+        reader.Read(entry.offset);
+    }
+
+    ByteReader fileReader(reader.GetCurrent(), (std::min)(static_cast<size_t>(fileTableSize), reader.GetRemaining()));
+    uint32_t fileCount = 0;
+    if (!fileReader.ReadVarUInt(fileCount) || (fileCount > fileReader.GetRemaining()))
+    {
+        return false;
+    }
+
+    _files.resize(fileCount);
+    for (uint32_t i = 0; i < fileCount; i++)
+    {
+        if (!ReadPrefixedString(fileReader, (i == 0) ? std::string() : _files[i - 1], _files[i]))
+        {
+            return false;
+        }
+    }
+
+    _prefixSize = reader.GetPosition() + fileTableSize;
+    return true;
+}
+
+bool CompactMethodTable::FindBlock(uint32_t address, size_t& offset, size_t& size) const
+{
+    // last block starting at or before the address
+    auto next = std::upper_bound(_blocks.begin(), _blocks.end(), address,
+        [](uint32_t value, const BlockEntry& entry) { return value < entry.firstAddress; });
+    if (next == _blocks.begin())
+    {
+        return false;
+    }
+
+    const BlockEntry& entry = *(next - 1);
+    uint32_t end = (next != _blocks.end()) ? next->offset : _blocksSize;
+    if (entry.offset > end)
+    {
+        return false;
+    }
+
+    offset = _prefixSize + entry.offset;
+    size = end - entry.offset;
+    return true;
+}
+
+bool CompactMethodTable::DecodeBlock(const uint8_t* block, size_t size, std::vector<MethodInfo>& methods) const
+{
+    ByteReader reader(block, size);
+    std::string previousName;
+    uint32_t previousRva = 0;
+    uint32_t previousIndex = 0;
+    uint32_t previousLine = 0;
+    while (reader.GetRemaining() > 0)
+    {
+        uint32_t deltaRva = 0;
+        int64_t deltaIndex = 0;
+        int64_t deltaLine = 0;
+        uint32_t fileIndex = 0;
+
+        MethodInfo method;
+        if (!reader.ReadVarUInt(deltaRva) ||
+            !reader.ReadVarUInt(method.size) ||
+            !reader.ReadVarInt(deltaIndex) ||
+            !reader.ReadVarInt(deltaLine) ||
+            !reader.ReadVarUInt(fileIndex) ||
+            !ReadPrefixedString(reader, previousName, method.name) ||
+            (fileIndex > _files.size()))
+        {
+            return false;
+        }
+
+        method.rva = previousRva + deltaRva;
+        method.index = static_cast<uint32_t>(previousIndex + deltaIndex);
+        method.lineNumber = static_cast<uint32_t>(previousLine + deltaLine);
+        method.modBase = 0;
+        method.address = method.rva;
+        if (fileIndex != 0)
+        {
+            method.sourceFile = _files[fileIndex - 1];
+        }
+
+        previousName = method.name;
+        previousRva = method.rva;
+        previousIndex = method.index;
+        previousLine = method.lineNumber;
+        methods.push_back(std::move(method));
+    }
+
+    return true;
+}
+
+bool CompactMethodTable::DecodeAll(const uint8_t* table, size_t size, std::vector<MethodInfo>& methods) const
+{
+    if (_prefixSize + _blocksSize > size)
+    {
+        return false;
+    }
+
+    // each block restarts from zero
+    methods.reserve(methods.size() + _methodCount);
+    for (size_t i = 0; i < _blocks.size(); i++)
+    {
+        uint32_t end = (i + 1 < _blocks.size()) ? _blocks[i + 1].offset : _blocksSize;
+        if ((_blocks[i].offset > end) ||
+            !DecodeBlock(table + _prefixSize + _blocks[i].offset, end - _blocks[i].offset, methods))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool CompactMethodTable::FindInBlock(const std::vector<MethodInfo>& methods, uint32_t address, MethodInfo& method)
+{
+    auto next = std::upper_bound(methods.begin(), methods.end(), address,
+        [](uint32_t value, const MethodInfo& info) { return value < info.rva; });
+    if (next == methods.begin())
+    {
+        return false;
+    }
+
+    const MethodInfo& found = *(next - 1);
+    if ((found.size != 0) && (address - found.rva >= found.size))
+    {
+        return false;
+    }
+
+    method = found;
+    return true;
+}
+
+bool CompactMethodTable::Find(const uint8_t* table, size_t size, uint32_t address, MethodInfo& method)
+{
+    CompactMethodTable reader;
+    size_t offset = 0;
+    size_t blockSize = 0;
+    if (!reader.Open(table, size) || !reader.FindBlock(address, offset, blockSize) || (offset + blockSize > size))
+    {
+        return false;
+    }
+
+    std::vector<MethodInfo> methods;
+    return reader.DecodeBlock(table + offset, blockSize, methods) && FindInBlock(methods, address, method);
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "PdbCommon.h"
+
+// Compact serialized form of a list of methods sorted by RVA (or token).
+//
+//   header       method count, block count, file table size, blocks size, methods per block
+//   skip index   block count x (first RVA, offset of the block)
+//   file table   sorted source files: shared prefix length with the previous path + suffix
+//   blocks       per method: RVA delta, size, index delta, line delta (zigzag), file index,
+//                name as shared prefix length with the previous name + suffix (all varints)
+//
+// Each block restarts from zero so that finding one method only decodes one block:
+// the header, skip index and file table (the "prefix") are read first, then a single block.
+// modBase is not stored and address = rva.
+class CompactMethodTable
+{
+public:
+    static const size_t HeaderSize = 5 * sizeof(uint32_t);
+    static const uint32_t MethodsPerBlock = 64;
+
+public:
+    CompactMethodTable();
+
+    static void Encode(const std::vector<MethodInfo>& methods, std::vector<uint8_t>& buffer);
+
+    // Size of the prefix given the header (HeaderSize bytes)
+    static bool GetPrefixSize(const uint8_t* header, size_t size, size_t& prefixSize);
+
+    // Only the prefix is needed: blocks are decoded on demand
+    bool Open(const uint8_t* prefix, size_t size);
+
+    uint32_t GetMethodCount() const { return _methodCount; }
+    size_t GetPrefixSize() const { return _prefixSize; }
+
+    // Offset (from the start of the table) and size of the block that may contain the address
+    bool FindBlock(uint32_t address, size_t& offset, size_t& size) const;
+
+    bool DecodeBlock(const uint8_t* block, size_t size, std::vector<MethodInfo>& methods) const;
+
+    // The whole table (prefix + blocks) is needed
+    bool DecodeAll(const uint8_t* table, size_t size, std::vector<MethodInfo>& methods) const;
+
+    // Find the method containing the address in an in-memory table
+    static bool Find(const uint8_t* table, size_t size, uint32_t address, MethodInfo& method);
+
+    // Last method of the list starting at or before the address (and covering it if the size is known)
+    static bool FindInBlock(const std::vector<MethodInfo>& methods, uint32_t address, MethodInfo& method);
+
+private:
+    struct BlockEntry
+    {
+        uint32_t firstAddress;
+        uint32_t offset;        // from the start of the blocks
+    };
+
+private:
+    uint32_t _methodCount;
+    uint32_t _blockCount;
+    uint32_t _blocksSize;
+    size_t _prefixSize;
+    std::vector<BlockEntry> _blocks;
+    std::vector<std::string> _files;
+};
@@ -1,6 +1,10 @@
 #include "DbgHelpParser.h"
+#include "MsfFile.h"
+#include "DbiParser.h"
 
 #include <algorithm>
+#include <atomic>
+#include <mutex>
 #include <sstream>
 #include <string>
 
@@ -8,11 +12,31 @@
 #pragma comment(lib, "dbghelp.lib")
 
 
+// "All DbgHelp functions are single threaded"
+static std::mutex& GetDbgHelpLock()
+{
+    static std::mutex lock;
+    return lock;
+}
+
+// SymInitialize only needs a unique non-zero value when the process is not invaded
+static HANDLE GetSessionHandle()
+{
+    static std::atomic<uintptr_t> nextHandle(0x1000);
+    return reinterpret_cast<HANDLE>(nextHandle.fetch_add(4));
+}
+
+
 DbgHelpParser::DbgHelpParser()
     :
     _baseAddress(0),
+    _methodsState(ComputeState::NotComputed),
+    _sourceFilesState(ComputeState::NotComputed),
+    _tokensState(ComputeState::NotComputed),
     _age(0)
 {
+    std::lock_guard<std::mutex> lock(GetDbgHelpLock());
+
     DWORD options = SymGetOptions();
     options |= SYMOPT_DEBUG;
     options |= SYMOPT_LOAD_LINES;           // Load line number information
@@ -22,7 +46,7 @@ DbgHelpParser::DbgHelpParser()
     options |= SYMOPT_FAIL_CRITICAL_ERRORS; // Don't show error dialogs
     SymSetOptions(options);
 
-    _hProcess = GetCurrentProcess();
+    _hProcess = GetSessionHandle();
     if (!SymInitialize(_hProcess, NULL, FALSE))
     {
         _hProcess = NULL;
@@ -31,6 +55,7 @@ DbgHelpParser::DbgHelpParser()
 
 DbgHelpParser::~DbgHelpParser()
 {
+    std::lock_guard<std::mutex> lock(GetDbgHelpLock());
     if (_hProcess != NULL)
     {
         if (_baseAddress != 0)
@@ -57,30 +82,30 @@ bool DbgHelpParser::LoadPdbFile(const std::string& pdbFilePath)
         return false;
     }
 
-    _baseAddress = SymLoadModuleEx(
-        _hProcess,
-        NULL,
-        pdbFilePath.c_str(),
-        NULL,
-        0x10000000, // arbitrary base address
-        0,
-        NULL,
-        0
-    );
-
-    if (_baseAddress == 0)
-    {
-        return false;
-    }
-
+    // only the Sym* calls (and the callbacks of the enumerations) run under the lock
     IMAGEHLP_MODULE64 moduleInfo = { 0 };
     moduleInfo.SizeOfStruct = sizeof(IMAGEHLP_MODULE64);
-    if (!SymGetModuleInfo64(_hProcess, _baseAddress, &moduleInfo))
     {
-        return false;
+        std::lock_guard<std::mutex> lock(GetDbgHelpLock());
+        _baseAddress = SymLoadModuleEx(
+            _hProcess,
+            NULL,
+            pdbFilePath.c_str(),
+            NULL,
+            0x10000000, // arbitrary base address
+            0,
+            NULL,
+            0
+        );
+
+        if ((_baseAddress == 0) || !SymGetModuleInfo64(_hProcess, _baseAddress, &moduleInfo))
+        {
+            return false;
+        }
     }
 
     _age = moduleInfo.PdbAge;
+    _methods.reserve(moduleInfo.NumSyms);
     GUID guid = moduleInfo.PdbSig70;
     char strGUID[80];
     sprintf_s(strGUID, 80, "%08x%04x%04x%02x%02x%02x%02x%02x%02x%02x%02x",
@@ -90,24 +115,11 @@ bool DbgHelpParser::LoadPdbFile(const std::string& pdbFilePath)
         );
     _guid = strGUID;
 
-    // Compute method info
-    if (!ComputeMethodsInfo())
-    {
-        return false;
-    }
-
-    // Compute source files
-    if (!ComputeSourceFiles())
-    {
-        return false;
-    }
-
-    // Compute tokens
-    if (!ComputeTokens())
-    {
-        return false;
-    }
+    // Read the line tables directly from the PDB instead of asking DbgHelp for each method
+    // (DbgHelp is still used as a fallback if the native parsing fails): no need for the lock
+    ComputeLineTable(pdbFilePath);
 
+    // method info, source files and tokens are computed by the first Get* (or Ensure*Computed) call
     return true;
 }
 
@@ -133,6 +145,13 @@ BOOL CALLBACK DbgHelpParser::EnumMethodSymbolsCallback(PSYMBOL_INFO pSymInfo, UL
         line.SizeOfStruct = sizeof(IMAGEHLP_LINE64);
         DWORD displacement = 0;
 
+        const LineEntry* entry = parser->_lineTable.Find(info.rva);
+        if (entry != nullptr)
+        {
+            info.sourceFile = parser->_lineTable.GetFileName(entry->fileNameOffset);
+            info.lineNumber = entry->lineNumber;
+        }
+        else
         if (SymGetLineFromAddr64(parser->_hProcess, pSymInfo->Address, &displacement, &line))
         {
             info.sourceFile = line.FileName ? line.FileName : "";
@@ -149,8 +168,26 @@ BOOL CALLBACK DbgHelpParser::EnumMethodSymbolsCallback(PSYMBOL_INFO pSymInfo, UL
     return TRUE; // Continue enumeration
 }
 
+bool DbgHelpParser::ComputeLineTable(const std::string& pdbFilePath)
+{
+    MsfFile msf;
+    if (!msf.Open(pdbFilePath))
+    {
+        return false;
+    }
+
+    DbiParser dbi(msf);
+    if (!dbi.Read())
+    {
+        return false;
+    }
+
+    return dbi.BuildLineTable(_lineTable);
+}
+
 bool DbgHelpParser::ComputeMethodsInfo()
 {
+    std::unique_lock<std::mutex> lock(GetDbgHelpLock());
     if (!SymEnumSymbols(
             _hProcess,
             _baseAddress,
@@ -161,6 +198,7 @@ bool DbgHelpParser::ComputeMethodsInfo()
     {
         return false;
     }
+    lock.unlock();
 
     // sort by address
     std::sort(_methods.begin(), _methods.end(),
@@ -174,6 +212,7 @@ bool DbgHelpParser::ComputeMethodsInfo()
 
 std::vector<MethodInfo> DbgHelpParser::GetMethods()
 {
+    EnsureMethodsComputed();
     return _methods;
 }
 
@@ -191,6 +230,7 @@ BOOL CALLBACK DbgHelpParser::EnumSourceFilesCallback(PSOURCEFILE pSourceFile, PV
 
 bool DbgHelpParser::ComputeSourceFiles()
 {
+    std::unique_lock<std::mutex> lock(GetDbgHelpLock());
     if (!SymEnumSourceFiles(
             _hProcess,
             _baseAddress,
@@ -201,6 +241,7 @@ bool DbgHelpParser::ComputeSourceFiles()
     {
         return false;
     }
+    lock.unlock();
 
     // Sort alphabetically
     std::sort(_sourceFiles.begin(), _sourceFiles.end());
@@ -210,6 +251,7 @@ bool DbgHelpParser::ComputeSourceFiles()
 
 std::vector<std::string> DbgHelpParser::GetSourceFiles()
 {
+    EnsureSourceFilesComputed();
     return _sourceFiles;
 }
 
@@ -228,11 +270,13 @@ bool DbgHelpParser::ComputeTokens()
         pSymInfo->SizeOfStruct = sizeof(SYMBOL_INFO);
         pSymInfo->MaxNameLen = MAX_SYM_NAME;
 
+        std::unique_lock<std::mutex> lock(GetDbgHelpLock());
         if (!SymFromToken(_hProcess, _baseAddress, token, pSymInfo))
         {
             // No more tokens
             break;
         }
+        lock.unlock();
 
         TokenInfo info;
         info.token = token;
@@ -252,5 +296,36 @@ bool DbgHelpParser::ComputeTokens()
 
 std::vector<TokenInfo> DbgHelpParser::GetTokens()
 {
+    EnsureTokensComputed();
     return _tokens;
 }
+
+bool DbgHelpParser::EnsureMethodsComputed()
+{
+    if (_methodsState == ComputeState::NotComputed)
+    {
+        _methodsState = ((_baseAddress != 0) && ComputeMethodsInfo()) ? ComputeState::Computed : ComputeState::Failed;
+    }
+
+    return _methodsState == ComputeState::Computed;
+}
+
+bool DbgHelpParser::EnsureSourceFilesComputed()
+{
+    if (_sourceFilesState == ComputeState::NotComputed)
+    {
+        _sourceFilesState = ((_baseAddress != 0) && ComputeSourceFiles()) ? ComputeState::Computed : ComputeState::Failed;
+    }
+
+    return _sourceFilesState == ComputeState::Computed;
+}
+
+bool DbgHelpParser::EnsureTokensComputed()
+{
+    if (_tokensState == ComputeState::NotComputed)
+    {
+        _tokensState = ((_baseAddress != 0) && ComputeTokens()) ? ComputeState::Computed : ComputeState::Failed;
+    }
+
+    return _tokensState == ComputeState::Computed;
+}
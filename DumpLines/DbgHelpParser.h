@@ -9,8 +9,14 @@
 #include <string>
 #include <vector>
 #include "PdbCommon.h"
+#include "LineTable.h"
 
 
+// DbgHelp is single threaded: all its calls are serialized by a process-wide lock and
+// each parser gets its own symbol handler session (unique handle instead of the current
+// process handle) so that parsers can be created and used from different threads.
+// Only the Sym* calls are serialized: the line table is parsed from the PDB outside of the lock
+// and the results are plain copies.
 class DbgHelpParser
 {
 public:
@@ -21,12 +27,26 @@ public:
     std::vector<MethodInfo> GetMethods();
     std::vector<std::string> GetSourceFiles();
     std::vector<TokenInfo> GetTokens();
+
+    // Enumerate now what the Get* calls would otherwise enumerate on first use:
+    // false if DbgHelp fails to enumerate them (the other backend can then be tried)
+    bool EnsureMethodsComputed();
+    bool EnsureSourceFilesComputed();
+    bool EnsureTokensComputed();
+
     std::string GetGuid() const { return _guid; }
     DWORD GetAge() const { return _age; }
 
+    // Empty if the line table could not be read from the PDB
+    const LineTable& GetLineTable() const { return _lineTable; }
+
 private:
+    DbgHelpParser(const DbgHelpParser&) = delete;
+    DbgHelpParser& operator=(const DbgHelpParser&) = delete;
+
     static BOOL CALLBACK EnumMethodSymbolsCallback(PSYMBOL_INFO pSymInfo, ULONG SymbolSize, PVOID UserContext);
     static BOOL CALLBACK EnumSourceFilesCallback(PSOURCEFILE pSourceFile, PVOID UserContext);
+    bool ComputeLineTable(const std::string& pdbFilePath);
     bool ComputeMethodsInfo();
     bool ComputeSourceFiles();
     bool ComputeTokens();
@@ -35,9 +55,15 @@ private:
     HANDLE _hProcess;
     uint64_t _baseAddress;
 
+    // address -> line table read directly from the PDB (empty if not available)
+    LineTable _lineTable;
+
     std::vector<MethodInfo> _methods;
     std::vector<std::string> _sourceFiles;
     std::vector<TokenInfo> _tokens;
+    ComputeState _methodsState;
+    ComputeState _sourceFilesState;
+    ComputeState _tokensState;
     std::string _guid;
     DWORD _age;
 
@@ -0,0 +1,390 @@
+#include "DbiParser.h"
+#include "ByteReader.h"
+#include "Parallel.h"
+#include "PdbInfoStream.h"
+
+#include <cstring>
+
+#pragma pack(push, 1)
+struct DbiStreamHeader
+{
+    int32_t VersionSignature;
+    uint32_t VersionHeader;
+    uint32_t Age;
+    uint16_t GlobalStreamIndex;
+    uint16_t BuildNumber;
+    uint16_t PublicStreamIndex;
+    uint16_t PdbDllVersion;
+    uint16_t SymRecordStream;
+    uint16_t PdbDllRbld;
+    int32_t ModInfoSize;
+    int32_t SectionContributionSize;
+    int32_t SectionMapSize;
+    int32_t SourceInfoSize;
+    int32_t TypeServerMapSize;
+    uint32_t MFCTypeServerIndex;
+    int32_t OptionalDbgHeaderSize;
+    int32_t ECSubstreamSize;
+    uint16_t Flags;
+    uint16_t Machine;
+    uint32_t Padding;
+};
+
+// fixed part of a module info record: followed by the module and object file names
+struct DbiModInfo
+{
+    uint32_t Unused1;
+    uint8_t SectionContribution[28];
+    uint16_t Flags;
+    uint16_t ModuleSymStream;
+    uint32_t SymByteSize;
+    uint32_t C11ByteSize;
+    uint32_t C13ByteSize;
+    uint16_t SourceFileCount;
+    uint16_t Padding;
+    uint32_t Unused2;
+    uint32_t SourceFileNameIndex;
+    uint32_t PdbFilePathNameIndex;
+};
+
+struct CvLinesHeader
+{
+    uint32_t offCon;
+    uint16_t segCon;
+    uint16_t flags;
+    uint32_t cbCon;
+};
+
+struct CvLineBlockHeader
+{
+    uint32_t fileid;    // offset of the file in the DEBUG_S_FILECHKSMS subsection
+    uint32_t nLines;
+    uint32_t cbBlock;
+};
+
+struct CvLine
+{
+    uint32_t offset;
+    uint32_t flags;     // linenumStart:24, deltaLineEnd:7, fStatement:1
+};
+
+struct CvFileChecksum
+{
+    uint32_t offstFileName;
+    uint8_t cbChecksum;
+    uint8_t ChecksumKind;
+};
+#pragma pack(pop)
+
+const uint16_t NoStream = 0xFFFF;
+const uint32_t SectionHeaderDbgStreamSlot = 5;
+const uint32_t SectionHeaderSize = 40;
+const uint32_t SectionHeaderVirtualAddressOffset = 12;
+
+const uint32_t DEBUG_S_IGNORE = 0x80000000;
+const uint32_t DEBUG_S_LINES = 0xF2;
+const uint32_t DEBUG_S_FILECHKSMS = 0xF4;
+
+const uint32_t NamesStreamSignature = 0xEFFEEFFE;
+
+
+DbiParser::DbiParser(const MsfFile& msf)
+    :
+    _msf(msf),
+    _globalStreamIndex(NoStream),
+    _publicStreamIndex(NoStream),
+    _symRecordStreamIndex(NoStream)
+{
+}
+
+bool DbiParser::Read()
+{
+    std::vector<uint8_t> stream;
+    if (!_msf.ReadStream(DbiStreamIndex, stream))
+    {
+        return false;
+    }
+
+    ByteReader reader(stream.data(), stream.size());
+    DbiStreamHeader header;
+    if (!reader.Read(header) || (header.VersionSignature != -1))
+    {
+        return false;
+    }
+
+    _globalStreamIndex = header.GlobalStreamIndex;
+    _publicStreamIndex = header.PublicStreamIndex;
+    _symRecordStreamIndex = header.SymRecordStream;
+
+    if ((header.ModInfoSize < 0) || (static_cast<size_t>(header.ModInfoSize) > reader.GetRemaining()))
+    {
+        return false;
+    }
+
+    if (!ReadModuleInfos(reader.GetCurrent(), header.ModInfoSize))
+    {
+        return false;
+    }
+
+    // the optional debug header is the last substream
+    size_t dbgHeaderOffset = sizeof(DbiStreamHeader) +
+        static_cast<size_t>(header.ModInfoSize) +
+        static_cast<size_t>(header.SectionContributionSize) +
+        static_cast<size_t>(header.SectionMapSize) +
+        static_cast<size_t>(header.SourceInfoSize) +
+        static_cast<size_t>(header.TypeServerMapSize) +
+        static_cast<size_t>(header.ECSubstreamSize);
+
+    uint16_t sectionHeaderStream = NoStream;
+    if ((header.OptionalDbgHeaderSize >= static_cast<int32_t>((SectionHeaderDbgStreamSlot + 1) * sizeof(uint16_t))) &&
+        reader.Seek(dbgHeaderOffset + SectionHeaderDbgStreamSlot * sizeof(uint16_t)))
+    {
+        reader.Read(sectionHeaderStream);
+    }
+
+    // without section headers, segment:offset addresses cannot be translated into RVAs
+    if (sectionHeaderStream != NoStream)
+    {
+        ReadSectionHeaders(sectionHeaderStream);
+    }
+
+    return true;
+}
+
+bool DbiParser::ReadModuleInfos(const uint8_t* data, size_t size)
+{
+    ByteReader reader(data, size);
+    while (reader.GetRemaining() >= sizeof(DbiModInfo))
+    {
+        DbiModInfo modInfo;
+        reader.Read(modInfo);
+
+        const char* moduleName = nullptr;
+        const char* objFileName = nullptr;
+        if (!reader.ReadCString(moduleName) || !reader.ReadCString(objFileName))
+        {
+            return false;
+        }
+
+        DbiModuleInfo module;
+        module.symStream = modInfo.ModuleSymStream;
+        module.symByteSize = modInfo.SymByteSize;
+        module.c11ByteSize = modInfo.C11ByteSize;
+        module.c13ByteSize = modInfo.C13ByteSize;
+        module.moduleName = moduleName;
+        _modules.push_back(module);
+
+        if (!reader.Align(4))
+        {
+            break;
+        }
+    }
+
+    return true;
+}
+
+bool DbiParser::ReadSectionHeaders(uint16_t stream)
+{
+    std::vector<uint8_t> headers;
+    if (!_msf.ReadStream(stream, headers))
+    {
+        return false;
+    }
+
+    size_t count = headers.size() / SectionHeaderSize;
+    _sectionRvas.resize(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        memcpy(&_sectionRvas[i], &headers[i * SectionHeaderSize + SectionHeaderVirtualAddressOffset], sizeof(uint32_t));
+    }
+
+    return true;
+}
+
+bool DbiParser::SectionOffsetToRva(uint16_t segment, uint32_t offset, uint32_t& rva) const
+{
+    // segments are 1-based
+    if ((segment == 0) || (segment > _sectionRvas.size()))
+    {
+        return false;
+    }
+
+    rva = _sectionRvas[segment - 1] + offset;
+    return true;
+}
+
+bool DbiParser::BuildLineTable(LineTable& table) const
+{
+    if (_sectionRvas.empty())
+    {
+        return false;
+    }
+
+    // file names are stored in the /names string table
+    PdbInfoStream info;
+    if (!info.Read(_msf))
+    {
+        return false;
+    }
+
+    uint32_t namesStream = info.FindNamedStream("/names");
+    if (namesStream == MsfFile::NilStreamSize)
+    {
+        return false;
+    }
+
+    std::vector<uint8_t> names;
+    if (!_msf.ReadStream(namesStream, names))
+    {
+        return false;
+    }
+
+    ByteReader namesReader(names.data(), names.size());
+    uint32_t signature = 0;
+    uint32_t hashVersion = 0;
+    uint32_t namesSize = 0;
+    if (!namesReader.Read(signature) || !namesReader.Read(hashVersion) || !namesReader.Read(namesSize) ||
+        (signature != NamesStreamSignature) || (namesSize > namesReader.GetRemaining()))
+    {
+        return false;
+    }
+
+    std::vector<char> fileNames(namesReader.GetCurrent(), namesReader.GetCurrent() + namesSize);
+    fileNames.push_back('\0');
+
+    // each module gets its own sorted table; they are merged at the end
+    std::vector<LineTable> moduleTables(_modules.size());
+    ParallelFor(_modules.size(),
+        [this, &moduleTables](size_t i)
+        {
+            if (ReadModuleLines(_modules[i], moduleTables[i]))
+            {
+                moduleTables[i].Sort();
+            }
+        });
+
+    table.Merge(moduleTables);
+    table.SetFileNames(std::move(fileNames));
+    return true;
+}
+
+bool DbiParser::ReadModuleLines(const DbiModuleInfo& module, LineTable& table) const
+{
+    if ((module.symStream == NoStream) || (module.c13ByteSize == 0))
+    {
+        return false;
+    }
+
+    // only read the C13 line information that follows the symbols and C11 lines, one subsection
+    // at a time: the memory used depends on the largest subsection, not on the size of the module
+    uint32_t c13Start = module.symByteSize + module.c11ByteSize;
+
+    // Each line block references its file by an offset in the checksums subsection that
+    // might come after the lines subsections: store this offset first and fix it up at the end
+    std::vector<LineEntry> entries;
+    std::vector<uint8_t> checksums;
+    std::vector<uint8_t> subsection;
+
+    uint32_t position = 0;
+    while (module.c13ByteSize - position >= 2 * sizeof(uint32_t))
+    {
+        uint32_t subsectionHeader[2];   // kind + length
+        if (!_msf.ReadStream(module.symStream, c13Start + position, sizeof(subsectionHeader), subsectionHeader))
+        {
+            return false;
+        }
+
+        uint32_t kind = subsectionHeader[0];
+        uint32_t length = subsectionHeader[1];
+        position += sizeof(subsectionHeader);
+        if (length > module.c13ByteSize - position)
+        {
+            return false;
+        }
+
+        if ((kind & DEBUG_S_IGNORE) != 0)
+        {
+            // skip ignored subsection
+        }
+        else
+        if (kind == DEBUG_S_FILECHKSMS)
+        {
+            checksums.resize(length);
+            if (!_msf.ReadStream(module.symStream, c13Start + position, length, checksums.data()))
+            {
+                return false;
+            }
+        }
+        else
+        if (kind == DEBUG_S_LINES)
+        {
+            subsection.resize(length);
+            if (!_msf.ReadStream(module.symStream, c13Start + position, length, subsection.data()))
+            {
+                return false;
+            }
+
+            ByteReader linesReader(subsection.data(), subsection.size());
+            CvLinesHeader header;
+            uint32_t rvaStart = 0;
+            if (linesReader.Read(header) && SectionOffsetToRva(header.segCon, header.offCon, rvaStart))
+            {
+                CvLineBlockHeader block;
+                while (linesReader.Read(block))
+                {
+                    size_t blockStart = linesReader.GetPosition();
+                    for (uint32_t i = 0; i < block.nLines; i++)
+                    {
+                        CvLine line;
+                        if (!linesReader.Read(line))
+                        {
+                            break;
+                        }
+
+                        entries.push_back({ rvaStart + line.offset, line.flags & 0x00FFFFFF, block.fileid });
+                    }
+
+                    // skip column information if any
+                    if ((block.cbBlock < sizeof(CvLineBlockHeader)) ||
+                        !linesReader.Seek(blockStart + block.cbBlock - sizeof(CvLineBlockHeader)))
+                    {
+                        break;
+                    }
+                }
+
+                entries.push_back({ rvaStart + header.cbCon, 0, LineTable::NoFile });
+            }
+        }
+
+        // subsections are 4 byte aligned
+        position += length;
+        if (module.c13ByteSize - position < 3)
+        {
+            break;
+        }
+        position = (position + 3) & ~3u;
+    }
+
+    if (checksums.empty())
+    {
+        return false;
+    }
+
+    // translate checksum offsets into /names offsets
+    table.Reserve(entries.size());
+    for (const LineEntry& entry : entries)
+    {
+        CvFileChecksum checksum;
+        if ((entry.fileNameOffset == LineTable::NoFile) ||
+            (entry.fileNameOffset + sizeof(CvFileChecksum) > checksums.size()))
+        {
+            table.AddEnd(entry.rva);
+            continue;
+        }
+
+        memcpy(&checksum, &checksums[entry.fileNameOffset], sizeof(checksum));
+        table.Add(entry.rva, entry.lineNumber, checksum.offstFileName);
+    }
+
+    return true;
+}
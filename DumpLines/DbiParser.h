@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "MsfFile.h"
+#include "LineTable.h"
+
+struct DbiModuleInfo
+{
+    uint16_t symStream;
+    uint32_t symByteSize;
+    uint32_t c11ByteSize;
+    uint32_t c13ByteSize;
+    std::string moduleName;
+};
+
+// Parser for the DBI stream (stream 3) of a Windows PDB: list of modules (compilands),
+// section headers and indexes of the global/public symbol streams.
+// The line tables are read from the C13 subsections of each module stream.
+class DbiParser
+{
+public:
+    DbiParser(const MsfFile& msf);
+
+    bool Read();
+
+    // Build the address -> line table of all modules (modules are parsed in parallel)
+    bool BuildLineTable(LineTable& table) const;
+
+    const std::vector<DbiModuleInfo>& GetModules() const { return _modules; }
+    uint16_t GetGlobalStreamIndex() const { return _globalStreamIndex; }
+    uint16_t GetPublicStreamIndex() const { return _publicStreamIndex; }
+    uint16_t GetSymRecordStreamIndex() const { return _symRecordStreamIndex; }
+
+    // Return false if the segment is unknown
+    bool SectionOffsetToRva(uint16_t segment, uint32_t offset, uint32_t& rva) const;
+
+private:
+    bool ReadModuleInfos(const uint8_t* data, size_t size);
+    bool ReadSectionHeaders(uint16_t stream);
+    bool ReadModuleLines(const DbiModuleInfo& module, LineTable& table) const;
+
+private:
+    const MsfFile& _msf;
+    uint16_t _globalStreamIndex;
+    uint16_t _publicStreamIndex;
+    uint16_t _symRecordStreamIndex;
+    std::vector<DbiModuleInfo> _modules;
+    std::vector<uint32_t> _sectionRvas;
+};
@@ -1,7 +1,43 @@
-#include <Windows.h>
+﻿#include <Windows.h>
 #include "DbgHelpParser.h"
 #include "SymPdbParser.h"
+#include "MsfFile.h"
+#include "DbiParser.h"
+#include "GsiNameIndex.h"
+#include "PeImage.h"
+#include "MetadataReader.h"
+#include "MethodNameIndex.h"
+#include "Wildcard.h"
+#include "PortablePdbParser.h"
+#include "SourceLineIndex.h"
+#include "SymbolServer.h"
+#include "SymbolClient.h"
+#include "IncrementalIndexer.h"
+#include "ShardedIndexer.h"
+#include "PerfMapWriter.h"
+#include "StackFolder.h"
+#include "ProcessSymbolIndex.h"
+#include "PdbFormat.h"
+#include "MethodFilter.h"
+#include "PdbDiff.h"
+#include "SourceVerifier.h"
+#include "LocalScopeIndex.h"
+#include "PdbStats.h"
+#include "HeatMap.h"
+#include "SelfTest.h"
+#include <algorithm>
+#include <chrono>
+#include <functional>
 #include <iostream>
+#include <thread>
+#include <unordered_map>
+
+struct DumpOptions
+{
+    bool showSourceFiles;
+    bool showTokens;
+    MethodFilter filter;
+};
 
 void ShowHeader()
 {
@@ -17,234 +53,1712 @@ void ShowHelp(const char* message)
     }
     std::cout << "\nUsage: DumpLines [options] <path to .pdb file>\n";
     std::cout << "\nOptions:\n";
-    std::cout << "  --sym     : Use ISymUnmanagedReader parser instead of DbgHelp\n";
+    std::cout << "  --sym     : Try ISymUnmanagedReader before DbgHelp for Windows PDB files (Portable PDB files are read directly)\n";
     std::cout << "  --source  : Dump list of source files instead of methods\n";
     std::cout << "  --token   : Dump list of managed tokens instead of methods\n";
-    std::cout << "\nOptions can be combined. Default behavior shows methods with source locations.\n";
+    std::cout << "  --filter <key>=<pattern> : Only dump the methods matching name=, type=, namespace=, file= or lines=<first>-<last> (a line of the method in the range)\n";
+    std::cout << "                             (repeat the option to combine predicates; Portable PDBs are filtered while reading)\n";
+    std::cout << "  --find <pattern> : Find symbols by name (exact name or with * and ? wildcards)\n";
+    std::cout << "  --line <file>:<line> : Find the methods and IL offsets generated for a source line\n";
+    std::cout << "  --serve   : Run a symbol server on the Unix socket given instead of the .pdb file\n";
+    std::cout << "  --cache <count>   : Number of modules kept in memory by the server (default 16)\n";
+    std::cout << "  --workers <count> : Number of threads serving clients (default: one per core)\n";
+    std::cout << "  --query <socket> : Symbolize --addresses in the .pdb file with a running server\n";
+    std::cout << "  --addresses <list> : Comma separated RVAs or method tokens with IL offset (0x06000001+0x1A)\n";
+    std::cout << "  --index <index file> : Update the index with the .pdb files of the directory given instead of the .pdb file\n";
+    std::cout << "  --shards <count> : With --index, index the list of .pdb files given instead of the .pdb file with one process per shard\n";
+    std::cout << "                     (partial indexes are kept next to the index: run again to resume the failed shards)\n";
+    std::cout << "  --shard <i>/<count> : With --index, only update the partial index of one shard (used by --shards)\n";
+    std::cout << "  --perfmap <file> : Append \"start size name\" lines for Linux perf (/tmp/perf-<pid>.map)\n";
+    std::cout << "  --jitdump <file> : Write a perf jitdump file (jit-<pid>.dump) with the code of the methods\n";
+    std::cout << "  --base <address> : Load address of the module for --perfmap/--jitdump (default: image base)\n";
+    std::cout << "  --pid <pid>      : Process id stored in the --jitdump records\n";
+    std::cout << "  --process : Symbolize --addresses (absolute) with the module list file given instead of the .pdb file\n";
+    std::cout << "              (one \"<base> <size> <image path>\" line per module, in hexadecimal)\n";
+    std::cout << "  --fold <file> : Write the stack samples file given instead of the .pdb file as flamegraph collapsed stacks\n";
+    std::cout << "  --diff <old .pdb file> : List the methods changed, moved, added or removed in the .pdb file given (Portable PDB)\n";
+    std::cout << "  --verify-sources <dir> : Check the source files of the tree against the hashes of the Portable PDB documents\n";
+    std::cout << "  --checksum-cache <file> : Keep the hashes of unchanged source files between --verify-sources runs\n";
+    std::cout << "  --page-cache <MB> : Read Windows PDB files through a page cache limited to this size\n";
+    std::cout << "  --locals <list> : Show the locals in scope at comma separated method tokens with IL offset (0x06000001+0x1A)\n";
+    std::cout << "  --stats-report <file> : Write a JSON report of the largest types, namespaces and documents (Portable PDB)\n";
+    std::cout << "  --heatmap <file> : Show the samples and code bytes per file, method and line of a native .pdb file\n";
+    std::cout << "                     (one \"<rva> [count]\" line per sample in the file, rva in hexadecimal)\n";
+    std::cout << "  --top <count> : Number of entries listed by --stats-report and --heatmap (default 20)\n";
+    std::cout << "  --selftest : Run the checks that do not need symbol files (no other argument)\n";
+    std::cout << "\nOnly one mode can be given: --source, --token, --find, --line, --serve, --query, --index, --process,\n";
+    std::cout << "--fold, --diff, --verify-sources, --locals, --stats-report, --heatmap or --perfmap/--jitdump.\n";
+    std::cout << "The other options can be combined. Default behavior shows methods with source locations.\n";
+    std::cout << "The format of the .pdb file is detected: the other backend is tried if the first one fails.\n";
 }
 
-int main(int argc, char* argv[])
+void ShowSymbolMatches(const DbiParser& dbi, const std::vector<SymbolMatch>& matches)
 {
-    // Initialize COM for ISymUnmanagedReader usage
-    CoInitialize(NULL);
-
-    ShowHeader();
-
-    if (argc < 2)
+    for (const SymbolMatch& match : matches)
     {
-        ShowHelp("Invalid arguments...");
-        CoUninitialize();
-        return -1;
+        uint32_t rva = 0;
+        if ((match.kind == S_PUB32) && dbi.SectionOffsetToRva(match.segment, match.offset, rva))
+        {
+            printf("0x%04X | rva 0x%08X    | %s\n", match.kind, rva, match.name.c_str());
+        }
+        else
+        {
+            printf("0x%04X | %04X:%08X | %s\n", match.kind, match.segment, match.offset, match.name.c_str());
+        }
     }
+}
 
-    bool showSourceFiles = false;
-    bool showTokens = false;
-    bool useSymParser = false;
-    std::string pdbFilename;
-
-    // Parse command line arguments
-    // Last argument is always the PDB filename
-    pdbFilename = argv[argc - 1];
-
-    // Check if last argument looks like a flag
-    if (pdbFilename.length() > 2 && pdbFilename.substr(0, 2) == "--")
-    {
-        ShowHelp("Missing PDB filename...");
-        CoUninitialize();
-        return -1;
-    }
+// Use the symbol hash tables of Windows PDBs or the metadata of the assembly for Portable PDBs
+int FindSymbols(const std::string& pdbFilename, const std::string& pattern)
+{
+    bool isWildcard = HasWildcard(pattern.c_str());
 
-    // Parse all arguments except the last one (which is the filename)
-    for (int i = 1; i < argc - 1; i++)
+    MsfFile msf;
+    if (msf.Open(pdbFilename))
     {
-        std::string arg = argv[i];
-        if (arg == "--source")
+        DbiParser dbi(msf);
+        if (!dbi.Read())
         {
-            showSourceFiles = true;
+            std::string error = "Failed to read the DBI stream of PDB file: ";
+            error += pdbFilename;
+            ShowHelp(error.c_str());
+            return -2;
         }
-        else if (arg == "--token")
+
+        std::vector<SymbolMatch> matches;
+        GsiNameIndex publics(msf);
+        if (publics.Read(dbi.GetPublicStreamIndex(), true, dbi.GetSymRecordStreamIndex()))
         {
-            showTokens = true;
+            isWildcard ? publics.FindWildcard(pattern.c_str(), matches) : publics.FindExact(pattern.c_str(), matches);
         }
-        else if (arg == "--sym")
+
+        GsiNameIndex globals(msf);
+        if (globals.Read(dbi.GetGlobalStreamIndex(), false, dbi.GetSymRecordStreamIndex()))
         {
-            useSymParser = true;
+            isWildcard ? globals.FindWildcard(pattern.c_str(), matches) : globals.FindExact(pattern.c_str(), matches);
         }
-        else
+
+        printf("Symbols matching %s (%zu total):\n", pattern.c_str(), matches.size());
+        printf("%s\n", std::string(75, '-').c_str());
+        ShowSymbolMatches(dbi, matches);
+
+        if (MsfFile::GetDefaultCacheBudget() != 0)
         {
-            std::string error = "Invalid option: ";
-            error += arg;
-            ShowHelp(error.c_str());
-            CoUninitialize();
-            return -1;
+            MsfCacheStats stats = msf.GetCacheStats();
+            printf("\nPage cache: %llu hits, %llu misses, %llu evictions, %llu uncached reads, %zu KB used\n",
+                static_cast<unsigned long long>(stats.hits),
+                static_cast<unsigned long long>(stats.misses),
+                static_cast<unsigned long long>(stats.evictions),
+                static_cast<unsigned long long>(stats.bypassedReads),
+                stats.cachedBytes / 1024);
         }
+        return 0;
     }
 
-    // Check for conflicting options
-    if (showSourceFiles && showTokens)
+    // method names of Portable PDBs are stored in the metadata of the assembly
+    std::string assemblyPath;
+    PeImage image;
+    uint32_t metadataSize = 0;
+    const uint8_t* pMetadata = nullptr;
+    if (GetAssemblyPathFromPdb(pdbFilename, assemblyPath) && image.Open(assemblyPath))
     {
-        ShowHelp("Cannot combine --source and --token options");
-        CoUninitialize();
-        return -1;
+        pMetadata = image.GetMetadata(metadataSize);
     }
 
-    // Choose parser based on command line argument
-    std::vector<MethodInfo> methods;
-    std::vector<std::string> sourceFiles;
-    std::vector<TokenInfo> tokens;
-    std::string guid;
-    DWORD age;
+    MetadataReader metadata;
+    if ((pMetadata == nullptr) || !metadata.Open(pMetadata, metadataSize))
+    {
+        std::string error = "Failed to read the metadata of the assembly for PDB file: ";
+        error += pdbFilename;
+        ShowHelp(error.c_str());
+        return -2;
+    }
 
-    if (useSymParser)
+    MethodNameIndex index;
+    index.Build(metadata);
+
+    std::vector<uint32_t> tokens;
+    isWildcard ? index.FindWildcard(pattern.c_str(), tokens) : index.FindExact(pattern.c_str(), tokens);
+
+    printf("Methods matching %s (%zu total):\n", pattern.c_str(), tokens.size());
+    printf("%s\n", std::string(75, '-').c_str());
+    for (uint32_t token : tokens)
     {
-        SymPdbParser parser;
-        if (!parser.LoadPdbFile(pdbFilename))
-        {
-            std::string error = "Failed to load PDB file with ISymUnmanagedReader: ";
-            error += pdbFilename;
-            ShowHelp(error.c_str());
-            CoUninitialize();
-            return -2;
-        }
+        printf("0x%08X | %s\n", token, metadata.GetQualifiedMethodName(RidFromToken(token)).c_str());
+    }
 
-        printf("PDB File: %s (ISymUnmanagedReader)\n", pdbFilename.c_str());
-        printf("     Age: %u\n", parser.GetAge());
-        printf("    GUID: %s\n", parser.GetGuid().c_str());
-        printf("\n");
+    return 0;
+}
 
-        methods = parser.GetMethods();
-        sourceFiles = parser.GetSourceFiles();
-        tokens = parser.GetTokens();
-        guid = parser.GetGuid();
-        age = parser.GetAge();
+// Build the reverse index from the sequence points of the parser and dump the matches
+template <typename TParser>
+int ShowSourceLine(TParser& parser, const std::string& file, uint32_t line)
+{
+    SourceLineIndex index;
+    index.Build(parser.GetDocuments(), parser.GetSequencePoints());
+
+    std::vector<SourceLineMatch> matches;
+    index.Find(file, line, matches);
+
+    std::unordered_map<uint32_t, std::string> methodNames;
+    for (const MethodInfo& method : parser.GetMethods())
+    {
+        methodNames[method.index] = method.name;
     }
-    else
+
+    printf("Methods at %s:%u (%zu total):\n", file.c_str(), line, matches.size());
+    printf("%-10s | %-8s | %-13s | %-32s | %s\n", "Token", "IL", "Lines", "Method Name", "Document");
+    printf("%s\n", std::string(90, '-').c_str());
+    for (const SourceLineMatch& match : matches)
     {
-        DbgHelpParser parser;
+        char lines[32];
+        snprintf(lines, sizeof(lines), "%u-%u", match.startLine, match.endLine);
+        printf("0x%08X | IL_%04X  | %-13s | %-32s | %s\n",
+            match.token,
+            match.ilOffset,
+            lines,
+            methodNames[match.token].c_str(),
+            index.GetDocument(match.document).c_str());
+    }
+
+    return 0;
+}
+
+// Portable PDBs are decoded directly; Windows PDBs go through ISymUnmanagedReader
+int FindSourceLine(const std::string& pdbFilename, const std::string& location)
+{
+    size_t separator = location.find_last_of(':');
+    if ((separator == std::string::npos) || (separator == 0) || (separator + 1 == location.size()))
+    {
+        ShowHelp("Expected <file>:<line> for --line");
+        return -1;
+    }
+    std::string file = location.substr(0, separator);
+    uint32_t line = static_cast<uint32_t>(strtoul(location.c_str() + separator + 1, nullptr, 10));
+
+    if (PortablePdbParser::IsPortablePdb(pdbFilename))
+    {
+        PortablePdbParser parser;
         if (!parser.LoadPdbFile(pdbFilename))
         {
-            std::string error = "Failed to load PDB file with DbgHelp: ";
+            std::string error = "Failed to load Portable PDB file: ";
             error += pdbFilename;
             ShowHelp(error.c_str());
-            CoUninitialize();
             return -2;
         }
 
-        printf("PDB File: %s (DbgHelp)\n", pdbFilename.c_str());
-        printf("     Age: %u\n", parser.GetAge());
-        printf("    GUID: %s\n", parser.GetGuid().c_str());
-        printf("\n");
+        return ShowSourceLine(parser, file, line);
+    }
 
-        methods = parser.GetMethods();
-        sourceFiles = parser.GetSourceFiles();
-        tokens = parser.GetTokens();
-        guid = parser.GetGuid();
-        age = parser.GetAge();
+    SymPdbParser parser;
+    if (!parser.LoadPdbFile(pdbFilename))
+    {
+        std::string error = "Failed to load PDB file with ISymUnmanagedReader: ";
+        error += pdbFilename;
+        ShowHelp(error.c_str());
+        return -2;
     }
 
-    if (showSourceFiles)
+    return ShowSourceLine(parser, file, line);
+}
+
+static SymbolServer* g_pServer = nullptr;
+
+static BOOL WINAPI StopServerHandler(DWORD ctrlType)
+{
+    if (g_pServer != nullptr)
     {
-        // Dump source files
-        if (sourceFiles.empty())
+        g_pServer->Stop();
+        return TRUE;
+    }
+
+    return FALSE;
+}
+
+int RunSymbolServer(const std::string& socketPath, size_t cacheSize, size_t workerCount)
+{
+    SymbolServer server(cacheSize, workerCount);
+    g_pServer = &server;
+    SetConsoleCtrlHandler(StopServerHandler, TRUE);
+
+    printf("Listening on %s (%zu workers, %zu cached modules) - Ctrl+C to stop\n", socketPath.c_str(), workerCount, cacheSize);
+    bool success = server.Run(socketPath);
+
+    SetConsoleCtrlHandler(StopServerHandler, FALSE);
+    g_pServer = nullptr;
+    if (!success)
+    {
+        std::string error = "Failed to listen on socket: ";
+        error += socketPath;
+        ShowHelp(error.c_str());
+        return -2;
+    }
+
+    printf("Cache: %llu hits / %llu misses\n",
+        static_cast<unsigned long long>(server.GetCache().GetHitCount()),
+        static_cast<unsigned long long>(server.GetCache().GetMissCount()));
+    return 0;
+}
+
+// Each address is either an RVA or a method token followed by +<IL offset>
+bool ParseAddresses(const std::string& list, std::vector<SymbolAddress>& addresses)
+{
+    size_t start = 0;
+    while (start < list.size())
+    {
+        size_t end = list.find(',', start);
+        if (end == std::string::npos)
         {
-            std::string error = "No source files found in PDB file: ";
-            error += pdbFilename;
-            ShowHelp(error.c_str());
-            CoUninitialize();
-            return -3;
+            end = list.size();
         }
 
-        printf("Source Files (%zu total):\n", sourceFiles.size());
-        printf("%s\n", std::string(90, '-').c_str());
-
-        for (const std::string& sourceFile : sourceFiles)
+        std::string item = list.substr(start, end - start);
+        char* next = nullptr;
+        SymbolAddress address;
+        address.address = static_cast<uint32_t>(strtoul(item.c_str(), &next, 0));
+        address.ilOffset = (*next == '+') ? static_cast<uint32_t>(strtoul(next + 1, &next, 0)) : 0;
+        if ((next == item.c_str()) || (*next != '\0'))
         {
-            printf("%s\n", sourceFile.c_str());
+            return false;
         }
+
+        addresses.push_back(address);
+        start = end + 1;
+    }
+
+    return !addresses.empty();
+}
+
+int QuerySymbolServer(const std::string& socketPath, const std::string& addressList, const std::string& pdbFilename)
+{
+    SymbolRequest request;
+    if (!ParseAddresses(addressList, request.addresses))
+    {
+        ShowHelp("Invalid list of --addresses");
+        return -1;
     }
-    else if (showTokens)
+
+    // the server may run in another directory
+    char fullPath[MAX_PATH];
+    DWORD length = GetFullPathNameA(pdbFilename.c_str(), sizeof(fullPath), fullPath, nullptr);
+    request.pdbFilePath = ((length > 0) && (length < sizeof(fullPath))) ? fullPath : pdbFilename;
+    if (!ReadPdbKey(request.pdbFilePath, request.key))
     {
-        // Dump managed tokens
-        if (tokens.empty())
+        std::string error = "Failed to read the identity of PDB file: ";
+        error += pdbFilename;
+        ShowHelp(error.c_str());
+        return -2;
+    }
+
+    SymbolClient client;
+    SymbolResponse response;
+    if (!client.Connect(socketPath) || !client.Symbolize(request, response))
+    {
+        std::string error = "Failed to query the symbol server on socket: ";
+        error += socketPath;
+        ShowHelp(error.c_str());
+        return -2;
+    }
+
+    if (response.status != SymbolStatusOk)
+    {
+        printf("Symbol server error %u for %s\n", response.status, request.pdbFilePath.c_str());
+        return -3;
+    }
+
+    printf("%-24s | %-48s | %s\n", "Address", "Function", "Source Location");
+    printf("%s\n", std::string(100, '-').c_str());
+    for (size_t i = 0; (i < response.results.size()) && (i < request.addresses.size()); i++)
+    {
+        const SymbolAddress& address = request.addresses[i];
+        const SymbolResult& result = response.results[i];
+
+        char location[32];
+        if (address.ilOffset != 0)
         {
-            std::string error = "No tokens found in PDB file: ";
-            error += pdbFilename;
-            ShowHelp(error.c_str());
-            CoUninitialize();
-            return -3;
+            snprintf(location, sizeof(location), "0x%08X+0x%X", address.address, address.ilOffset);
+        }
+        else
+        {
+            snprintf(location, sizeof(location), "0x%08X", address.address);
         }
 
-        printf("Managed Tokens (%zu total):\n", tokens.size());
-        printf("%-10s | %-10s | %-10s | %-18s | %-18s | %-6s | %s\n",
-            "Token", "Index", "Flags", "Value", "Address", "Tag", "Name");
-        printf("%s\n", std::string(120, '-').c_str());
+        std::string function = result.function.empty() ? "?" : result.function;
+        if (!result.function.empty() && (result.displacement != 0))
+        {
+            char displacement[16];
+            snprintf(displacement, sizeof(displacement), "+0x%X", result.displacement);
+            function += displacement;
+        }
 
-        for (const TokenInfo& token : tokens)
+        if (result.file.empty())
         {
-            printf("0x%08X | 0x%08X | 0x%08X | 0x%016I64X | 0x%016I64X | %-6u | %s\n",
-                token.token,
-                token.index,
-                token.flags,
-                token.value,
-                token.address,
-                token.tag,
-                token.name.c_str());
+            printf("%-24s | %-48s | N/A\n", location, function.c_str());
         }
-    }
-    else
-    {
-        // Dump methods (default behavior)
-        if (methods.empty())
+        else
         {
-            std::string error = "No methods found in PDB file: ";
-            error += pdbFilename;
-            ShowHelp(error.c_str());
-            CoUninitialize();
-            return -3;
+            printf("%-24s | %-48s | %s:%u\n", location, function.c_str(), result.file.c_str(), result.line);
         }
+    }
 
-        printf("Methods (%zu total)\n\n", methods.size());
-        printf("%s\n", std::string(75, '-').c_str());
-        printf("%-32s | %-10s | %s\n",
-            "Method Name", "Token", "Source Location");
-        printf("%s\n", std::string(75, '-').c_str());
+    return 0;
+}
 
-        for (const MethodInfo& sym : methods)
+// Locals, constants and imports in scope at <method token>+<IL offset> (Portable PDBs only)
+int ShowLocals(const std::string& pdbFilename, const std::string& addressList)
+{
+    std::vector<SymbolAddress> addresses;
+    if (!ParseAddresses(addressList, addresses))
+    {
+        ShowHelp("Invalid list of --locals");
+        return -1;
+    }
+
+    PortablePdbParser parser;
+    if (!PortablePdbParser::IsPortablePdb(pdbFilename) || !parser.LoadPdbFile(pdbFilename))
+    {
+        std::string error = "Local variables are only read from Portable PDB files: ";
+        error += pdbFilename;
+        ShowHelp(error.c_str());
+        return -2;
+    }
+
+    LocalScopeIndex scopes;
+    scopes.Build(parser.GetMetadata());
+
+    std::vector<LocalInfo> locals;
+    std::vector<ImportInfo> imports;
+    for (const SymbolAddress& address : addresses)
+    {
+        printf("0x%08X+0x%X:\n", address.address, address.ilOffset);
+
+        locals.clear();
+        if (!scopes.GetLocals(address.address, address.ilOffset, locals))
         {
-            // Print method name and token
-            printf("%-32s | 0x%08X | ",
-                sym.name.c_str(),
-                sym.index
-                );
+            printf("  not a method token\n");
+            continue;
+        }
 
-            // Print source location
-            if (!sym.sourceFile.empty() && sym.lineNumber > 0)
+        for (const LocalInfo& local : locals)
+        {
+            char slot[16];
+            if (local.isConstant)
             {
-                // Extract just the filename
-                const char* fileName = sym.sourceFile.c_str();
-                const char* lastSlash = strrchr(fileName, '\\');
-                if (!lastSlash) lastSlash = strrchr(fileName, '/');
-                if (lastSlash) fileName = lastSlash + 1;
-
-                // 16707566 (0xFEEFEE) is a special marker for hidden/compiler-generated code
-                if (sym.lineNumber == 16707566)
-                {
-                    printf("%s:hidden", fileName);
-                }
-                else
-                {
-                    printf("%s:%u", fileName, sym.lineNumber);
-                }
+                snprintf(slot, sizeof(slot), "const");
             }
             else
             {
-                printf("N/A");
+                snprintf(slot, sizeof(slot), "slot %u", local.index);
             }
+            printf("  %-8s | IL 0x%04X-0x%04X | %s%s\n", slot, local.scopeStart, local.scopeEnd, local.name,
+                ((local.attributes & 1) != 0) ? " (hidden)" : "");
+        }
 
-            printf("\n");
+        // imports of the innermost scope, then of its parents
+        for (uint32_t importScope = scopes.GetImportScope(address.address, address.ilOffset); importScope != 0; importScope = scopes.GetParentImportScope(importScope))
+        {
+            imports.clear();
+            scopes.GetImports(importScope, imports);
+            for (const ImportInfo& import : imports)
+            {
+                std::string target = import.targetNamespace;
+                if (import.typeToken != 0)
+                {
+                    char token[16];
+                    snprintf(token, sizeof(token), "0x%08X", import.typeToken);
+                    target = token;
+                }
+                printf("  import   | %s%s%s\n", import.alias.c_str(), import.alias.empty() ? "" : " = ", target.c_str());
+            }
         }
     }
 
-    CoUninitialize();
     return 0;
 }
+
+// The waits tell which stage is the bottleneck: the disk (worker waits) or the parsing (reader waits)
+static void PrintReadAheadStats(const char* indent, const ReadAheadStats& stats)
+{
+    printf("%sread ahead %zu files (%llu MB), worker waits %zu, reader waits %zu\n",
+        indent, stats.prefetchedFiles, static_cast<unsigned long long>(stats.prefetchedBytes / (1024 * 1024)),
+        stats.workerWaits, stats.readerWaits);
+}
+
+// Absolute addresses are resolved against all the modules of the process at once
+int ResolveProcessAddresses(const std::string& moduleListFilename, const std::string& addressList)
+{
+    std::vector<uint64_t> addresses;
+    size_t start = 0;
+    while (start < addressList.size())
+    {
+        size_t end = addressList.find(',', start);
+        if (end == std::string::npos)
+        {
+            end = addressList.size();
+        }
+
+        std::string item = addressList.substr(start, end - start);
+        char* next = nullptr;
+        addresses.push_back(strtoull(item.c_str(), &next, 16));
+        if ((next == item.c_str()) || (*next != '\0'))
+        {
+            ShowHelp("Invalid list of --addresses");
+            return -1;
+        }
+        start = end + 1;
+    }
+
+    std::vector<ProcessModule> modules;
+    if (!ProcessSymbolIndex::ReadModuleList(moduleListFilename, modules))
+    {
+        std::string error = "Failed to read module list file: ";
+        error += moduleListFilename;
+        ShowHelp(error.c_str());
+        return -2;
+    }
+
+    ProcessSymbolIndex index;
+    if (!index.Load(modules))
+    {
+        ShowHelp("Modules of the list are overlapping");
+        return -2;
+    }
+
+    std::vector<ResolvedAddress> results;
+    index.Resolve(addresses, results);
+
+    printf("%zu modules (%zu with symbols)\n", modules.size(), index.GetLoadedModuleCount());
+    PrintReadAheadStats("", index.GetReadAheadStats());
+    printf("%-18s | %-60s | %s\n", "Address", "Function", "Source Location");
+    printf("%s\n", std::string(110, '-').c_str());
+    for (const ResolvedAddress& result : results)
+    {
+        std::string function = "?";
+        if (result.moduleIndex >= 0)
+        {
+            const std::string& imagePath = modules[result.moduleIndex].imagePath;
+            size_t separator = imagePath.find_last_of("\\/");
+            function = (separator == std::string::npos) ? imagePath : imagePath.substr(separator + 1);
+            function += "!";
+
+            char displacement[32];
+            if (result.frame.function != nullptr)
+            {
+                function += result.frame.function;
+                snprintf(displacement, sizeof(displacement), "+0x%X", result.frame.displacement);
+            }
+            else
+            {
+                snprintf(displacement, sizeof(displacement), "0x%X", result.rva);
+            }
+            function += displacement;
+        }
+
+        if (result.frame.file == nullptr)
+        {
+            printf("0x%016llx | %-60s | N/A\n", static_cast<unsigned long long>(result.address), function.c_str());
+        }
+        else
+        {
+            printf("0x%016llx | %-60s | %s:%u\n", static_cast<unsigned long long>(result.address), function.c_str(), result.frame.file, result.frame.line);
+        }
+    }
+
+    return 0;
+}
+
+// Only the modules that changed since the last run are parsed and appended to the index
+int UpdateIndex(const std::string& indexFilename, const std::string& directory, size_t workerCount)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    SymbolIndex index;
+    if (!index.Open(indexFilename))
+    {
+        std::string error = "Failed to open index file: ";
+        error += indexFilename;
+        ShowHelp(error.c_str());
+        return -2;
+    }
+
+    IndexingStats stats;
+    IncrementalIndexer indexer(index, workerCount);
+    bool success = indexer.Update(directory, stats);
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    printf("Index: %s (%zu modules)\n", indexFilename.c_str(), index.GetModules().size());
+    printf("%s\n", std::string(75, '-').c_str());
+    printf("  scanned   : %zu\n", stats.scanned);
+    printf("  unchanged : %zu\n", stats.unchanged);
+    printf("  touched   : %zu\n", stats.touched);
+    printf("  indexed   : %zu\n", stats.indexed);
+    printf("  removed   : %zu\n", stats.removed);
+    printf("  failed    : %zu\n", stats.failed);
+    printf("  duration  : %lld ms\n", static_cast<long long>(elapsed.count()));
+    PrintReadAheadStats("  ", stats.readAhead);
+
+    return success ? 0 : -3;
+}
+
+// Worker process of --shards: its output is written to the log file of the shard
+int UpdateIndexShard(const std::string& indexFilename, const std::string& listFilename, uint32_t shardIndex, uint32_t shardCount, size_t workerCount)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    IndexingStats stats;
+    ShardedIndexer indexer(indexFilename, shardCount);
+    bool success = indexer.RunShard(listFilename, shardIndex, workerCount, stats);
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    printf("Shard %u/%u: %s\n", shardIndex, shardCount, indexer.GetShardPath(shardIndex).c_str());
+    printf("  scanned %zu, unchanged %zu, touched %zu, indexed %zu, removed %zu, failed %zu (%lld ms)\n",
+        stats.scanned, stats.unchanged, stats.touched, stats.indexed, stats.removed, stats.failed, static_cast<long long>(elapsed.count()));
+    PrintReadAheadStats("  ", stats.readAhead);
+
+    return success ? 0 : -3;
+}
+
+int UpdateShardedIndex(const std::string& indexFilename, const std::string& listFilename, uint32_t shardCount)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<ShardStatus> shards;
+    MergeStats stats;
+    ShardedIndexer indexer(indexFilename, shardCount);
+    bool success = indexer.Run(listFilename, shards, stats);
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    printf("Index: %s (%u shards)\n", indexFilename.c_str(), shardCount);
+    printf("%s\n", std::string(75, '-').c_str());
+    for (uint32_t shard = 0; shard < shards.size(); shard++)
+    {
+        printf("  shard %-4u: %s (exit code %d, %u attempt(s)) - %s.log\n", shard,
+            (shards[shard].exitCode == 0) ? "done  " : "FAILED", static_cast<int>(shards[shard].exitCode),
+            shards[shard].attempts, indexer.GetShardPath(shard).c_str());
+    }
+
+    if (success)
+    {
+        printf("  merged    : %zu modules (%zu duplicates)\n", stats.modules, stats.duplicates);
+    }
+    else
+    {
+        printf("  the index was not updated: run the same command again to resume the failed shards\n");
+    }
+    printf("  duration  : %lld ms\n", static_cast<long long>(elapsed.count()));
+
+    return success ? 0 : -3;
+}
+
+// Each distinct frame is symbolized once and identical stacks are counted together
+int FoldStackSamples(const std::string& sampleFilename, const std::string& outputFilename)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    StackFolder folder;
+    if (!folder.Fold(sampleFilename))
+    {
+        std::string error = "Failed to read stack samples file: ";
+        error += sampleFilename;
+        ShowHelp(error.c_str());
+        return -2;
+    }
+
+    if (!folder.WriteCollapsed(outputFilename))
+    {
+        printf("Failed to write %s\n", outputFilename.c_str());
+        return -3;
+    }
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    printf("Collapsed stacks: %s\n", outputFilename.c_str());
+    printf("%s\n", std::string(75, '-').c_str());
+    printf("  samples   : %llu\n", static_cast<unsigned long long>(folder.GetSampleCount()));
+    printf("  stacks    : %zu\n", folder.GetStackCount());
+    printf("  frames    : %zu\n", folder.GetFrameCount());
+    printf("  duration  : %lld ms\n", static_cast<long long>(elapsed.count()));
+    if (elapsed.count() > 0)
+    {
+        printf("  rate      : %llu samples/s\n", static_cast<unsigned long long>(folder.GetSampleCount() * 1000 / elapsed.count()));
+    }
+
+    return 0;
+}
+
+// Methods that changed, moved, were added or removed between two builds of an assembly
+int DiffPdbFiles(const std::string& oldPdbFilename, const std::string& newPdbFilename)
+{
+    auto start = std::chrono::steady_clock::now();
+    PdbDiff diff;
+    if (!diff.Compare(oldPdbFilename, newPdbFilename))
+    {
+        std::string error = "Failed to load the Portable PDB files (and their assembly) of both builds: ";
+        error += oldPdbFilename;
+        error += " / ";
+        error += newPdbFilename;
+        ShowHelp(error.c_str());
+        return -2;
+    }
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+
+    static const char* ChangeNames[] = { "changed", "moved", "added", "removed" };
+    size_t counts[4] = { 0, 0, 0, 0 };
+    for (const MethodDiff& method : diff.GetDiffs())
+    {
+        counts[static_cast<int>(method.change)]++;
+    }
+
+    printf("Old: %s\n", oldPdbFilename.c_str());
+    printf("New: %s\n", newPdbFilename.c_str());
+    printf("%zu changed, %zu moved, %zu added, %zu removed, %zu unchanged (%lld ms)\n\n",
+        counts[0], counts[1], counts[2], counts[3], diff.GetUnchangedCount(), static_cast<long long>(duration.count()));
+
+    printf("%-8s | %-10s | %-10s | %-8s | %-8s | %-8s | %-8s | %s\n",
+        "Change", "Old token", "New token", "Old line", "New line", "Old size", "New size", "Method");
+    printf("%s\n", std::string(120, '-').c_str());
+    for (const MethodDiff& method : diff.GetDiffs())
+    {
+        printf("%-8s | 0x%08X | 0x%08X | %8u | %8u | %8u | %8u | %s\n",
+            ChangeNames[static_cast<int>(method.change)],
+            method.oldToken,
+            method.newToken,
+            method.oldLine,
+            method.newLine,
+            method.oldSize,
+            method.newSize,
+            method.name.c_str());
+    }
+
+    return 0;
+}
+
+int VerifySources(const std::string& pdbFilename, const std::string& sourceRoot, const std::string& cacheFilename)
+{
+    if (!PortablePdbParser::IsPortablePdb(pdbFilename))
+    {
+        ShowHelp("Source hashes are only stored in Portable PDB files");
+        return -2;
+    }
+
+    PortablePdbParser parser;
+    if (!parser.LoadPdbFile(pdbFilename))
+    {
+        std::string error = "Failed to load Portable PDB file: ";
+        error += pdbFilename;
+        ShowHelp(error.c_str());
+        return -2;
+    }
+
+    SourceVerifier verifier;
+    if (!cacheFilename.empty() && !verifier.LoadCache(cacheFilename))
+    {
+        // a corrupted cache is rebuilt
+        printf("Ignoring invalid checksum cache: %s\n", cacheFilename.c_str());
+        verifier = SourceVerifier();
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<SourceCheck> results;
+    verifier.Verify(parser, sourceRoot, results);
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+
+    if (!cacheFilename.empty() && !verifier.SaveCache(cacheFilename))
+    {
+        printf("Failed to save checksum cache: %s\n", cacheFilename.c_str());
+    }
+
+    // only the documents that don't match are listed
+    static const char* StatusNames[] = { "match", "MISMATCH", "missing", "no hash" };
+    size_t counts[4] = { 0, 0, 0, 0 };
+    size_t cachedCount = 0;
+    for (const SourceCheck& result : results)
+    {
+        counts[static_cast<int>(result.status)]++;
+        cachedCount += result.cached ? 1 : 0;
+        if (result.status != SourceStatus::Match)
+        {
+            printf("%-8s | %s\n", StatusNames[static_cast<int>(result.status)],
+                result.localPath.empty() ? result.document.c_str() : result.localPath.c_str());
+        }
+    }
+
+    printf("\n%zu documents: %zu match, %zu mismatch, %zu missing, %zu without hash (%zu from cache, %lld ms)\n",
+        results.size(), counts[0], counts[1], counts[2], counts[3], cachedCount, static_cast<long long>(duration.count()));
+
+    return ((counts[1] == 0) && (counts[2] == 0)) ? 0 : 1;
+}
+
+int WriteStatsReport(const std::string& pdbFilename, const std::string& reportFilename, size_t topCount)
+{
+    if (!PortablePdbParser::IsPortablePdb(pdbFilename))
+    {
+        ShowHelp("The statistics are computed from the tables of Portable PDB files");
+        return -2;
+    }
+
+    PortablePdbParser parser;
+    if (!parser.LoadPdbFile(pdbFilename))
+    {
+        std::string error = "Failed to load Portable PDB file: ";
+        error += pdbFilename;
+        ShowHelp(error.c_str());
+        return -2;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    PdbStats stats;
+    stats.Compute(parser);
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+
+    if (!stats.WriteJson(reportFilename, pdbFilename, topCount))
+    {
+        printf("Failed to write report: %s\n", reportFilename.c_str());
+        return -3;
+    }
+
+    printf("Statistics of %s written to %s (%lld ms)\n", pdbFilename.c_str(), reportFilename.c_str(), static_cast<long long>(duration.count()));
+    return 0;
+}
+
+// Only the topCount hottest files, methods and lines are listed
+int ShowHeatMap(const std::string& pdbFilename, const std::string& sampleFilename, size_t topCount)
+{
+    if (PortablePdbParser::IsPortablePdb(pdbFilename))
+    {
+        ShowHelp("The code size of the methods is only available in Windows PDB files");
+        return -2;
+    }
+
+    DbgHelpParser parser;
+    if (!parser.LoadPdbFile(pdbFilename))
+    {
+        std::string error = "Failed to load PDB file with DbgHelp: ";
+        error += pdbFilename;
+        ShowHelp(error.c_str());
+        return -2;
+    }
+    std::vector<MethodInfo> methods = parser.GetMethods();
+
+    auto start = std::chrono::steady_clock::now();
+    HeatMap heatMap;
+    heatMap.Build(methods, parser.GetLineTable());
+    if (!heatMap.AddSamples(sampleFilename))
+    {
+        std::string error = "Failed to read samples file: ";
+        error += sampleFilename;
+        ShowHelp(error.c_str());
+        return -2;
+    }
+
+    std::vector<FileHeat> files;
+    std::vector<MethodHeat> methodHeat;
+    std::vector<LineHeat> lines;
+    heatMap.GetFileHeat(files);
+    heatMap.GetMethodHeat(methodHeat);
+    heatMap.GetLineHeat(lines);
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+
+    uint64_t sampleCount = heatMap.GetSampleCount();
+    printf("%zu methods, %zu files, %llu samples (%llu outside of the code of the PDB) in %lld ms\n\n",
+        heatMap.GetMethodCount(), files.size(),
+        static_cast<unsigned long long>(sampleCount),
+        static_cast<unsigned long long>(heatMap.GetUnresolvedSampleCount()),
+        static_cast<long long>(duration.count()));
+
+    // hottest first, then largest
+    auto percent = [sampleCount](uint64_t samples) { return (sampleCount == 0) ? 0.0 : 100.0 * samples / sampleCount; };
+    std::sort(files.begin(), files.end(),
+        [](const FileHeat& left, const FileHeat& right)
+        {
+            return (left.samples != right.samples) ? (left.samples > right.samples) : (left.codeBytes > right.codeBytes);
+        });
+    printf("%-10s | %-6s | %-10s | %-7s | %s\n", "Samples", "%", "Bytes", "Methods", "File");
+    printf("%s\n", std::string(100, '-').c_str());
+    for (size_t i = 0; i < (std::min)(topCount, files.size()); i++)
+    {
+        printf("%10llu | %6.2f | %10llu | %7u | %s\n",
+            static_cast<unsigned long long>(files[i].samples), percent(files[i].samples),
+            static_cast<unsigned long long>(files[i].codeBytes), files[i].methods,
+            heatMap.GetDocument(files[i].document).c_str());
+    }
+
+    std::unordered_map<uint32_t, const std::string*> methodNames;
+    for (const MethodInfo& method : methods)
+    {
+        methodNames.emplace(method.rva, &method.name);
+    }
+
+    std::sort(methodHeat.begin(), methodHeat.end(),
+        [](const MethodHeat& left, const MethodHeat& right)
+        {
+            return (left.samples != right.samples) ? (left.samples > right.samples) : (left.size > right.size);
+        });
+    printf("\n%-10s | %-6s | %-10s | %-13s | %s\n", "Samples", "%", "Bytes", "Lines", "Method");
+    printf("%s\n", std::string(100, '-').c_str());
+    for (size_t i = 0; i < (std::min)(topCount, methodHeat.size()); i++)
+    {
+        auto name = methodNames.find(methodHeat[i].rva);
+        printf("%10llu | %6.2f | %10u | %6u-%-6u | %s (%s)\n",
+            static_cast<unsigned long long>(methodHeat[i].samples), percent(methodHeat[i].samples),
+            methodHeat[i].size, methodHeat[i].firstLine, methodHeat[i].lastLine,
+            (name != methodNames.end()) ? name->second->c_str() : "?",
+            heatMap.GetDocument(methodHeat[i].document).c_str());
+    }
+
+    std::sort(lines.begin(), lines.end(),
+        [](const LineHeat& left, const LineHeat& right)
+        {
+            return (left.samples != right.samples) ? (left.samples > right.samples) : (left.codeBytes > right.codeBytes);
+        });
+    printf("\n%-10s | %-6s | %-10s | %s\n", "Samples", "%", "Bytes", "Line");
+    printf("%s\n", std::string(100, '-').c_str());
+    for (size_t i = 0; i < (std::min)(topCount, lines.size()); i++)
+    {
+        printf("%10llu | %6.2f | %10llu | %s:%u\n",
+            static_cast<unsigned long long>(lines[i].samples), percent(lines[i].samples),
+            static_cast<unsigned long long>(lines[i].codeBytes),
+            heatMap.GetDocument(lines[i].document).c_str(), lines[i].line);
+    }
+
+    return 0;
+}
+
+// Native code ranges come from DbgHelp (rva + size) or from the ReadyToRun header of the assembly
+// for Portable PDBs, and the code bytes from the image next to the .pdb file
+int ExportPerfSymbols(const std::string& pdbFilename, const std::string& perfMapFilename, const std::string& jitDumpFilename, uint64_t baseAddress, uint32_t pid)
+{
+    std::vector<MethodInfo> methods;
+    if (PortablePdbParser::IsPortablePdb(pdbFilename))
+    {
+        std::shared_ptr<const ModuleSnapshot> snapshot = ModuleSnapshot::Load(pdbFilename);
+        if ((snapshot == nullptr) || !snapshot->HasNativeCode())
+        {
+            std::string error = "The assembly next to the Portable PDB file must be a ReadyToRun image: ";
+            error += pdbFilename;
+            ShowHelp(error.c_str());
+            return -2;
+        }
+        methods = snapshot->GetNativeMethods();
+    }
+    else
+    {
+        DbgHelpParser parser;
+        if (!parser.LoadPdbFile(pdbFilename))
+        {
+            std::string error = "Failed to load PDB file with DbgHelp: ";
+            error += pdbFilename;
+            ShowHelp(error.c_str());
+            return -2;
+        }
+        methods = parser.GetMethods();
+    }
+
+    std::string imagePath;
+    PeImage image;
+    bool hasImage = GetAssemblyPathFromPdb(pdbFilename, imagePath) && image.Open(imagePath);
+    if ((baseAddress == 0) && hasImage)
+    {
+        baseAddress = image.GetImageBase();
+    }
+
+    size_t nameBytes = 0;
+    size_t codeBytes = 0;
+    for (const MethodInfo& method : methods)
+    {
+        nameBytes += method.name.size();
+        codeBytes += method.size;
+    }
+
+    if (!perfMapFilename.empty())
+    {
+        PerfMapWriter writer;
+        writer.Reserve(methods.size(), nameBytes);
+        for (const MethodInfo& method : methods)
+        {
+            if (method.size != 0)
+            {
+                writer.Add(baseAddress + method.rva, method.size, method.name);
+            }
+        }
+
+        if (!writer.Write(perfMapFilename, true))
+        {
+            std::string error = "Failed to write perf map file: ";
+            error += perfMapFilename;
+            ShowHelp(error.c_str());
+            return -2;
+        }
+        printf("%zu methods written to %s (base 0x%llx)\n", writer.GetCount(), perfMapFilename.c_str(), static_cast<unsigned long long>(baseAddress));
+    }
+
+    if (!jitDumpFilename.empty())
+    {
+        if (!hasImage)
+        {
+            std::string error = "The image of the module is needed next to the PDB file for --jitdump: ";
+            error += pdbFilename;
+            ShowHelp(error.c_str());
+            return -2;
+        }
+
+        JitDumpWriter writer(image.GetMachine(), pid, 0);
+        writer.Reserve(methods.size(), nameBytes + codeBytes);
+        for (const MethodInfo& method : methods)
+        {
+            const uint8_t* code = image.RvaToPointer(method.rva, method.size);
+            if ((method.size != 0) && (code != nullptr))
+            {
+                writer.AddCodeLoad(baseAddress + method.rva, code, method.size, method.name);
+            }
+        }
+
+        if (!writer.Write(jitDumpFilename))
+        {
+            std::string error = "Failed to write jitdump file: ";
+            error += jitDumpFilename;
+            ShowHelp(error.c_str());
+            return -2;
+        }
+        printf("%zu methods written to %s (base 0x%llx)\n", writer.GetCount(), jitDumpFilename.c_str(), static_cast<unsigned long long>(baseAddress));
+    }
+
+    return 0;
+}
+
+typedef std::function<bool(const MethodInfo& method)> LineMatcher;
+
+// lines= matches the methods with at least one line in the range: DbgHelp gives the lines of
+// the code of each method through the line table of the PDB
+LineMatcher CreateLineMatcher(DbgHelpParser& parser, const MethodFilter& filter)
+{
+    const std::vector<LineEntry>& entries = parser.GetLineTable().GetEntries();
+    return [&entries, &filter](const MethodInfo& method)
+        {
+            // the entry covering the start of the method is the last one starting before it
+            auto entry = std::upper_bound(entries.begin(), entries.end(), method.rva,
+                [](uint32_t rva, const LineEntry& other) { return rva < other.rva; });
+            if (entry != entries.begin())
+            {
+                --entry;
+            }
+
+            uint64_t end = static_cast<uint64_t>(method.rva) + (std::max)(method.size, 1u);
+            for (; (entry != entries.end()) && (entry->rva < end); ++entry)
+            {
+                if ((entry->fileNameOffset != LineTable::NoFile) && filter.MatchLine(entry->lineNumber))
+                {
+                    return true;
+                }
+            }
+
+            // without line table, only the start line is known
+            return entries.empty() && filter.MatchLine(method.lineNumber);
+        };
+}
+
+// ISymUnmanagedReader gives the sequence points of the methods (the token is kept in index)
+LineMatcher CreateLineMatcher(SymPdbParser& parser, const MethodFilter& filter)
+{
+    std::vector<uint32_t> tokens;
+    for (const SequencePoint& point : parser.GetSequencePoints())
+    {
+        if ((point.startLine != HiddenLineNumber) && filter.MatchLine(point.startLine))
+        {
+            tokens.push_back(point.token);
+        }
+    }
+    std::sort(tokens.begin(), tokens.end());
+    tokens.erase(std::unique(tokens.begin(), tokens.end()), tokens.end());
+
+    return [tokens](const MethodInfo& method) { return std::binary_search(tokens.begin(), tokens.end(), method.index); };
+}
+
+// The native backends only give the methods already enumerated: filter them afterwards
+template <typename TParser>
+std::vector<MethodInfo> GetFilteredMethods(TParser& parser, const MethodFilter& filter)
+{
+    std::vector<MethodInfo> methods = parser.GetMethods();
+    if (!filter.IsEmpty())
+    {
+        LineMatcher hasLineInRange;
+        if (filter.HasLineRange())
+        {
+            hasLineInRange = CreateLineMatcher(parser, filter);
+        }
+
+        methods.erase(
+            std::remove_if(methods.begin(), methods.end(),
+                [&filter, &hasLineInRange](const MethodInfo& method)
+                {
+                    return !filter.MatchWithoutLines(method) || (hasLineInRange && !hasLineInRange(method));
+                }),
+            methods.end());
+    }
+
+    return methods;
+}
+
+// Portable PDBs check the predicates before decoding the sequence points
+std::vector<MethodInfo> GetFilteredMethods(PortablePdbParser& parser, const MethodFilter& filter)
+{
+    return parser.GetMethods(filter);
+}
+
+// TParser is one of the backends (PortablePdbParser, DbgHelpParser or SymPdbParser): they share
+// the same LoadPdbFile/GetMethods/GetSourceFiles/GetTokens/GetGuid/GetAge members and the dump
+// is instantiated for each of them so that there is no virtual call in the enumeration loops
+template <typename TParser>
+int DumpPdb(TParser& parser, const std::string& pdbFilename, const char* backendName, const DumpOptions& options)
+{
+    printf("PDB File: %s (%s)\n", pdbFilename.c_str(), backendName);
+    printf("     Age: %u\n", parser.GetAge());
+    printf("    GUID: %s\n", parser.GetGuid().c_str());
+    printf("\n");
+
+    std::vector<MethodInfo> methods;
+    std::vector<std::string> sourceFiles;
+    std::vector<TokenInfo> tokens;
+    if (options.showSourceFiles)
+    {
+        sourceFiles = parser.GetSourceFiles();
+        sourceFiles.erase(
+            std::remove_if(sourceFiles.begin(), sourceFiles.end(), [&options](const std::string& file) { return !options.filter.MatchDocument(file); }),
+            sourceFiles.end());
+    }
+    else if (options.showTokens)
+    {
+        tokens = parser.GetTokens();
+    }
+    else
+    {
+        methods = GetFilteredMethods(parser, options.filter);
+    }
+
+    if (options.showSourceFiles)
+    {
+        // Dump source files
+        if (sourceFiles.empty())
+        {
+            std::string error = "No source files found in PDB file: ";
+            error += pdbFilename;
+            ShowHelp(error.c_str());
+            return -3;
+        }
+
+        printf("Source Files (%zu total):\n", sourceFiles.size());
+        printf("%s\n", std::string(90, '-').c_str());
+
+        for (const std::string& sourceFile : sourceFiles)
+        {
+            printf("%s\n", sourceFile.c_str());
+        }
+    }
+    else if (options.showTokens)
+    {
+        // Dump managed tokens
+        if (tokens.empty())
+        {
+            std::string error = "No tokens found in PDB file: ";
+            error += pdbFilename;
+            ShowHelp(error.c_str());
+            return -3;
+        }
+
+        printf("Managed Tokens (%zu total):\n", tokens.size());
+        printf("%-10s | %-10s | %-10s | %-18s | %-18s | %-6s | %s\n",
+            "Token", "Index", "Flags", "Value", "Address", "Tag", "Name");
+        printf("%s\n", std::string(120, '-').c_str());
+
+        for (const TokenInfo& token : tokens)
+        {
+            printf("0x%08X | 0x%08X | 0x%08X | 0x%016I64X | 0x%016I64X | %-6u | %s\n",
+                token.token,
+                token.index,
+                token.flags,
+                token.value,
+                token.address,
+                token.tag,
+                token.name.c_str());
+        }
+    }
+    else
+    {
+        // Dump methods (default behavior)
+        if (methods.empty())
+        {
+            std::string error = "No methods found in PDB file: ";
+            error += pdbFilename;
+            ShowHelp(error.c_str());
+            return -3;
+        }
+
+        printf("Methods (%zu total)\n\n", methods.size());
+        printf("%s\n", std::string(75, '-').c_str());
+        printf("%-32s | %-10s | %s\n",
+            "Method Name", "Token", "Source Location");
+        printf("%s\n", std::string(75, '-').c_str());
+
+        for (const MethodInfo& sym : methods)
+        {
+            // Print method name and token
+            printf("%-32s | 0x%08X | ",
+                sym.name.c_str(),
+                sym.index
+                );
+
+            // Print source location
+            if (!sym.sourceFile.empty() && sym.lineNumber > 0)
+            {
+                // Extract just the filename
+                const char* fileName = sym.sourceFile.c_str();
+                const char* lastSlash = strrchr(fileName, '\\');
+                if (!lastSlash) lastSlash = strrchr(fileName, '/');
+                if (lastSlash) fileName = lastSlash + 1;
+
+                // 16707566 (0xFEEFEE) is a special marker for hidden/compiler-generated code
+                if (sym.lineNumber == 16707566)
+                {
+                    printf("%s:hidden", fileName);
+                }
+                else
+                {
+                    printf("%s:%u", fileName, sym.lineNumber);
+                }
+            }
+            else
+            {
+                printf("N/A");
+            }
+
+            printf("\n");
+        }
+    }
+
+    return 0;
+}
+
+// The enumeration needed by the dump runs before a backend is chosen: when it fails, the other
+// backend can still be tried
+template <typename TParser>
+bool LoadForDump(TParser& parser, const std::string& pdbFilename, const DumpOptions& options)
+{
+    if (!parser.LoadPdbFile(pdbFilename))
+    {
+        return false;
+    }
+
+    if (options.showSourceFiles)
+    {
+        return parser.EnsureSourceFilesComputed();
+    }
+    if (options.showTokens)
+    {
+        return parser.EnsureTokensComputed();
+    }
+    return parser.EnsureMethodsComputed();
+}
+
+// The format is detected from the first bytes of the file: Portable PDBs are decoded directly and
+// Windows PDBs go through DbgHelp (or ISymUnmanagedReader with --sym), the other one being tried
+// if the first one fails
+int DumpPdbFile(const std::string& pdbFilename, bool useSymParser, const DumpOptions& options)
+{
+    PdbFormat format = DetectPdbFormat(pdbFilename);
+    if (format == PdbFormat::Unknown)
+    {
+        std::string error = "Not a Windows or Portable PDB file: ";
+        error += pdbFilename;
+        ShowHelp(error.c_str());
+        return -2;
+    }
+
+    if (format == PdbFormat::Portable)
+    {
+        PortablePdbParser parser;
+        if (!parser.LoadPdbFile(pdbFilename))
+        {
+            std::string error = "Failed to load Portable PDB file: ";
+            error += pdbFilename;
+            ShowHelp(error.c_str());
+            return -2;
+        }
+
+        return DumpPdb(parser, pdbFilename, "Portable PDB", options);
+    }
+
+    if (!useSymParser)
+    {
+        DbgHelpParser parser;
+        if (LoadForDump(parser, pdbFilename, options))
+        {
+            return DumpPdb(parser, pdbFilename, "DbgHelp", options);
+        }
+    }
+
+    {
+        SymPdbParser parser;
+        if (LoadForDump(parser, pdbFilename, options))
+        {
+            return DumpPdb(parser, pdbFilename, "ISymUnmanagedReader", options);
+        }
+    }
+
+    if (useSymParser)
+    {
+        DbgHelpParser parser;
+        if (LoadForDump(parser, pdbFilename, options))
+        {
+            return DumpPdb(parser, pdbFilename, "DbgHelp", options);
+        }
+    }
+
+    std::string error = "Failed to load PDB file with DbgHelp and ISymUnmanagedReader: ";
+    error += pdbFilename;
+    ShowHelp(error.c_str());
+    return -2;
+}
+
+// Everything but the COM initialization: each mode returns the exit code of the process
+int RunCommandLine(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        ShowHelp("Invalid arguments...");
+        return -1;
+    }
+
+    if ((argc == 2) && (strcmp(argv[1], "--selftest") == 0))
+    {
+        return RunSelfTests();
+    }
+
+    bool showSourceFiles = false;
+    bool showTokens = false;
+    bool useSymParser = false;
+    MethodFilter filter;
+    std::string findPattern;
+    std::string sourceLine;
+    bool runServer = false;
+    bool resolveProcess = false;
+    size_t cacheSize = 16;
+    size_t workerCount = (std::max)(std::thread::hardware_concurrency(), 1u);
+    std::string querySocket;
+    std::string addressList;
+    std::string indexFilename;
+    std::string perfMapFilename;
+    std::string jitDumpFilename;
+    std::string foldFilename;
+    std::string oldPdbFilename;
+    std::string sourceRoot;
+    std::string checksumCacheFilename;
+    std::string localsList;
+    uint32_t shardIndex = 0;
+    uint32_t shardCount = 0;
+    bool isShardWorker = false;
+    std::string statsFilename;
+    std::string heatMapFilename;
+    size_t topCount = 20;
+    uint64_t baseAddress = 0;
+    uint32_t pid = 0;
+    std::string pdbFilename;
+
+    // Parse command line arguments
+    // Last argument is always the PDB filename
+    pdbFilename = argv[argc - 1];
+
+    // Check if last argument looks like a flag
+    if (pdbFilename.length() > 2 && pdbFilename.substr(0, 2) == "--")
+    {
+        ShowHelp("Missing PDB filename...");
+        return -1;
+    }
+
+    // Parse all arguments except the last one (which is the filename)
+    for (int i = 1; i < argc - 1; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--source")
+        {
+            showSourceFiles = true;
+        }
+        else if (arg == "--token")
+        {
+            showTokens = true;
+        }
+        else if (arg == "--sym")
+        {
+            useSymParser = true;
+        }
+        else if (arg == "--filter")
+        {
+            if (i + 1 >= argc - 1)
+            {
+                ShowHelp("Missing predicate for --filter");
+                return -1;
+            }
+
+            std::string predicate = argv[++i];
+            if (!filter.Add(predicate))
+            {
+                std::string error = "Invalid filter: ";
+                error += predicate;
+                ShowHelp(error.c_str());
+                return -1;
+            }
+        }
+        else if (arg == "--diff")
+        {
+            if (i + 1 >= argc - 1)
+            {
+                ShowHelp("Missing old .pdb file for --diff");
+                return -1;
+            }
+            oldPdbFilename = argv[++i];
+        }
+        else if (arg == "--verify-sources")
+        {
+            if (i + 1 >= argc - 1)
+            {
+                ShowHelp("Missing source directory for --verify-sources");
+                return -1;
+            }
+            sourceRoot = argv[++i];
+        }
+        else if (arg == "--checksum-cache")
+        {
+            if (i + 1 >= argc - 1)
+            {
+                ShowHelp("Missing file for --checksum-cache");
+                return -1;
+            }
+            checksumCacheFilename = argv[++i];
+        }
+        else if (arg == "--page-cache")
+        {
+            if (i + 1 >= argc - 1)
+            {
+                ShowHelp("Missing size for --page-cache");
+                return -1;
+            }
+            MsfFile::SetDefaultCacheBudget(static_cast<size_t>(strtoull(argv[++i], nullptr, 10)) * 1024 * 1024);
+        }
+        else if (arg == "--locals")
+        {
+            if (i + 1 >= argc - 1)
+            {
+                ShowHelp("Missing list of method tokens for --locals");
+                return -1;
+            }
+            localsList = argv[++i];
+        }
+        else if (arg == "--stats-report")
+        {
+            if (i + 1 >= argc - 1)
+            {
+                ShowHelp("Missing output file for --stats-report");
+                return -1;
+            }
+            statsFilename = argv[++i];
+        }
+        else if (arg == "--heatmap")
+        {
+            if (i + 1 >= argc - 1)
+            {
+                ShowHelp("Missing samples file for --heatmap");
+                return -1;
+            }
+            heatMapFilename = argv[++i];
+        }
+        else if (arg == "--top")
+        {
+            if (i + 1 >= argc - 1)
+            {
+                ShowHelp("Missing count for --top");
+                return -1;
+            }
+            topCount = strtoul(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--find")
+        {
+            if (i + 1 >= argc - 1)
+            {
+                ShowHelp("Missing pattern for --find");
+                return -1;
+            }
+            findPattern = argv[++i];
+        }
+        else if (arg == "--line")
+        {
+            if (i + 1 >= argc - 1)
+            {
+                ShowHelp("Missing <file>:<line> for --line");
+                return -1;
+            }
+            sourceLine = argv[++i];
+        }
+        else if (arg == "--serve")
+        {
+            runServer = true;
+        }
+        else if (arg == "--process")
+        {
+            resolveProcess = true;
+        }
+        else if ((arg == "--cache") || (arg == "--workers"))
+        {
+            if (i + 1 >= argc - 1)
+            {
+                std::string error = "Missing count for ";
+                error += arg;
+                ShowHelp(error.c_str());
+                return -1;
+            }
+            size_t count = strtoul(argv[++i], nullptr, 10);
+            if (arg == "--cache")
+            {
+                cacheSize = count;
+            }
+            else
+            {
+                workerCount = count;
+            }
+        }
+        else if (arg == "--query")
+        {
+            if (i + 1 >= argc - 1)
+            {
+                ShowHelp("Missing socket path for --query");
+                return -1;
+            }
+            querySocket = argv[++i];
+        }
+        else if (arg == "--index")
+        {
+            if (i + 1 >= argc - 1)
+            {
+                ShowHelp("Missing index file for --index");
+                return -1;
+            }
+            indexFilename = argv[++i];
+        }
+        else if (arg == "--shards")
+        {
+            if (i + 1 >= argc - 1)
+            {
+                ShowHelp("Missing count for --shards");
+                return -1;
+            }
+            shardCount = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+        }
+        else if (arg == "--shard")
+        {
+            if ((i + 1 >= argc - 1) || !ShardedIndexer::ParseShard(argv[i + 1], shardIndex, shardCount))
+            {
+                ShowHelp("Missing or invalid <i>/<count> for --shard");
+                return -1;
+            }
+            isShardWorker = true;
+            i++;
+        }
+        else if ((arg == "--perfmap") || (arg == "--jitdump") || (arg == "--base") || (arg == "--pid"))
+        {
+            if (i + 1 >= argc - 1)
+            {
+                std::string error = "Missing value for ";
+                error += arg;
+                ShowHelp(error.c_str());
+                return -1;
+            }
+
+            const char* value = argv[++i];
+            if (arg == "--perfmap")
+            {
+                perfMapFilename = value;
+            }
+            else if (arg == "--jitdump")
+            {
+                jitDumpFilename = value;
+            }
+            else if (arg == "--base")
+            {
+                baseAddress = strtoull(value, nullptr, 16);
+            }
+            else
+            {
+                pid = static_cast<uint32_t>(strtoul(value, nullptr, 10));
+            }
+        }
+        else if (arg == "--fold")
+        {
+            if (i + 1 >= argc - 1)
+            {
+                ShowHelp("Missing output file for --fold");
+                return -1;
+            }
+            foldFilename = argv[++i];
+        }
+        else if (arg == "--addresses")
+        {
+            if (i + 1 >= argc - 1)
+            {
+                ShowHelp("Missing list for --addresses");
+                return -1;
+            }
+            addressList = argv[++i];
+        }
+        else
+        {
+            std::string error = "Invalid option: ";
+            error += arg;
+            ShowHelp(error.c_str());
+            return -1;
+        }
+    }
+
+    // The modes replace the default dump of the methods: only one of them can be given
+    struct Mode
+    {
+        const char* name;
+        bool isSelected;
+    };
+    const Mode modes[] =
+    {
+        { "--source", showSourceFiles },
+        { "--token", showTokens },
+        { "--find", !findPattern.empty() },
+        { "--line", !sourceLine.empty() },
+        { "--serve", runServer },
+        { "--query", !querySocket.empty() },
+        { "--index", !indexFilename.empty() },
+        { "--process", resolveProcess },
+        { "--fold", !foldFilename.empty() },
+        { "--diff", !oldPdbFilename.empty() },
+        { "--verify-sources", !sourceRoot.empty() },
+        { "--locals", !localsList.empty() },
+        { "--stats-report", !statsFilename.empty() },
+        { "--heatmap", !heatMapFilename.empty() },
+        { "--perfmap/--jitdump", !perfMapFilename.empty() || !jitDumpFilename.empty() },
+    };
+
+    const char* selectedMode = nullptr;
+    for (const Mode& mode : modes)
+    {
+        if (!mode.isSelected)
+        {
+            continue;
+        }
+
+        if (selectedMode != nullptr)
+        {
+            std::string error = "Cannot combine ";
+            error += selectedMode;
+            error += " and ";
+            error += mode.name;
+            ShowHelp(error.c_str());
+            return -1;
+        }
+        selectedMode = mode.name;
+    }
+
+    // The last argument is the socket path in server mode
+    if (runServer)
+    {
+        return RunSymbolServer(pdbFilename, cacheSize, workerCount);
+    }
+
+    // The last argument is the list of .pdb files to index
+    if (!indexFilename.empty() && isShardWorker)
+    {
+        return UpdateIndexShard(indexFilename, pdbFilename, shardIndex, shardCount, workerCount);
+    }
+
+    if (!indexFilename.empty() && (shardCount != 0))
+    {
+        return UpdateShardedIndex(indexFilename, pdbFilename, shardCount);
+    }
+
+    // The last argument is the directory to index
+    if (!indexFilename.empty())
+    {
+        return UpdateIndex(indexFilename, pdbFilename, workerCount);
+    }
+
+    // The last argument is the module list file
+    if (resolveProcess)
+    {
+        return ResolveProcessAddresses(pdbFilename, addressList);
+    }
+
+    // The last argument is the stack samples file
+    if (!foldFilename.empty())
+    {
+        return FoldStackSamples(pdbFilename, foldFilename);
+    }
+
+    // The last argument is the .pdb file of the new build
+    if (!oldPdbFilename.empty())
+    {
+        return DiffPdbFiles(oldPdbFilename, pdbFilename);
+    }
+
+    if (!localsList.empty())
+    {
+        return ShowLocals(pdbFilename, localsList);
+    }
+
+    if (!heatMapFilename.empty())
+    {
+        return ShowHeatMap(pdbFilename, heatMapFilename, topCount);
+    }
+
+    if (!statsFilename.empty())
+    {
+        return WriteStatsReport(pdbFilename, statsFilename, topCount);
+    }
+
+    if (!sourceRoot.empty())
+    {
+        return VerifySources(pdbFilename, sourceRoot, checksumCacheFilename);
+    }
+
+    if (!perfMapFilename.empty() || !jitDumpFilename.empty())
+    {
+        return ExportPerfSymbols(pdbFilename, perfMapFilename, jitDumpFilename, baseAddress, pid);
+    }
+
+    if (!querySocket.empty())
+    {
+        return QuerySymbolServer(querySocket, addressList, pdbFilename);
+    }
+
+    // Name lookup does not need to enumerate all methods
+    if (!findPattern.empty())
+    {
+        return FindSymbols(pdbFilename, findPattern);
+    }
+
+    // Reverse lookup from a source line
+    if (!sourceLine.empty())
+    {
+        return FindSourceLine(pdbFilename, sourceLine);
+    }
+
+    DumpOptions options;
+    options.showSourceFiles = showSourceFiles;
+    options.showTokens = showTokens;
+    options.filter = filter;
+
+    return DumpPdbFile(pdbFilename, useSymParser, options);
+}
+
+int main(int argc, char* argv[])
+{
+    // Initialize COM for ISymUnmanagedReader usage
+    CoInitialize(NULL);
+
+    ShowHeader();
+    int result = RunCommandLine(argc, argv);
+
+    CoUninitialize();
+    return result;
+}
@@ -0,0 +1,401 @@
+#include "GsiNameIndex.h"
+#include "ByteReader.h"
+#include "Wildcard.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+const uint32_t GsiHashSignature = 0xFFFFFFFF;
+const uint32_t GsiHashVersion = 0xEFFE0000 + 19990810;
+const uint32_t PublicsHeaderSize = 28;
+const uint32_t IPHR_HASH = 4096;
+
+// GetAll and the sorted index read the symbol record stream by windows of this size (records are less than 64 KB)
+const uint32_t RecordWindowSize = 256 * 1024;
+
+// In the PDB, bucket offsets are computed with the size of the in-memory 32-bit hash record
+const uint32_t InMemoryHashRecordSize = 12;
+
+// symbol record kinds found in the global and public streams
+const uint16_t S_CONSTANT = 0x1107;
+const uint16_t S_UDT = 0x1108;
+const uint16_t S_LDATA32 = 0x110C;
+const uint16_t S_GDATA32 = 0x110D;
+const uint16_t S_LTHREAD32 = 0x1112;
+const uint16_t S_GTHREAD32 = 0x1113;
+const uint16_t S_LMANDATA = 0x111C;
+const uint16_t S_GMANDATA = 0x111D;
+const uint16_t S_PROCREF = 0x1125;
+const uint16_t S_DATAREF = 0x1126;
+const uint16_t S_LPROCREF = 0x1127;
+const uint16_t S_ANNOTATIONREF = 0x1128;
+const uint16_t S_TOKENREF = 0x1129;
+
+#pragma pack(push, 1)
+struct GsiHashHeader
+{
+    uint32_t VerSignature;
+    uint32_t VerHdr;
+    uint32_t HrSize;
+    uint32_t NumBuckets;
+};
+
+struct GsiHashRecord
+{
+    uint32_t Off;       // offset + 1 in the symbol record stream
+    uint32_t CRef;
+};
+#pragma pack(pop)
+
+
+GsiNameIndex::GsiNameIndex(const MsfFile& msf)
+    :
+    _msf(msf),
+    _symRecordStream(0)
+{
+}
+
+uint32_t GsiNameIndex::HashStringV1(const char* str, size_t length)
+{
+    uint32_t result = 0;
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(str);
+
+    for (size_t i = 0; i < length / 4; i++)
+    {
+        uint32_t value;
+        memcpy(&value, p, sizeof(value));
+        result ^= value;
+        p += 4;
+    }
+
+    // hash a 2 byte word if possible, then the possibly remaining byte
+    size_t remaining = length % 4;
+    if (remaining >= 2)
+    {
+        result ^= static_cast<uint32_t>(p[0] | (p[1] << 8));
+        p += 2;
+        remaining -= 2;
+    }
+    if (remaining == 1)
+    {
+        result ^= *p;
+    }
+
+    const uint32_t toLowerMask = 0x20202020;
+    result |= toLowerMask;
+    result ^= (result >> 11);
+    return result ^ (result >> 16);
+}
+
+bool GsiNameIndex::Read(uint16_t hashStream, bool isPublics, uint16_t symRecordStream)
+{
+    _symRecordStream = symRecordStream;
+
+    std::vector<uint8_t> stream;
+    if (!_msf.ReadStream(hashStream, stream))
+    {
+        return false;
+    }
+
+    ByteReader reader(stream.data(), stream.size());
+    GsiHashHeader header;
+    if ((isPublics && !reader.Skip(PublicsHeaderSize)) ||
+        !reader.Read(header) ||
+        (header.VerSignature != GsiHashSignature) ||
+        (header.VerHdr != GsiHashVersion) ||
+        (header.HrSize > reader.GetRemaining()))
+    {
+        return false;
+    }
+
+    uint32_t recordCount = header.HrSize / sizeof(GsiHashRecord);
+    _recordOffsets.resize(recordCount);
+    for (uint32_t i = 0; i < recordCount; i++)
+    {
+        GsiHashRecord record;
+        reader.Read(record);
+        _recordOffsets[i] = record.Off - 1;
+    }
+
+    // bitmap of non empty buckets followed by the index of the first record of each of them
+    const uint32_t bitmapWordCount = (IPHR_HASH + 32) / 32;
+    std::vector<uint32_t> bitmap(bitmapWordCount);
+    if (!reader.ReadBytes(bitmap.data(), bitmapWordCount * sizeof(uint32_t)))
+    {
+        return false;
+    }
+
+    _bucketStarts.assign(IPHR_HASH + 1, recordCount);
+    for (uint32_t bucket = 0; bucket < IPHR_HASH; bucket++)
+    {
+        if ((bitmap[bucket / 32] & (1u << (bucket % 32))) == 0)
+        {
+            continue;
+        }
+
+        uint32_t start = 0;
+        if (!reader.Read(start))
+        {
+            return false;
+        }
+
+        _bucketStarts[bucket] = start / InMemoryHashRecordSize;
+    }
+
+    // empty buckets start where the next non empty bucket starts
+    for (uint32_t bucket = IPHR_HASH; bucket > 0; bucket--)
+    {
+        if ((bitmap[(bucket - 1) / 32] & (1u << ((bucket - 1) % 32))) == 0)
+        {
+            _bucketStarts[bucket - 1] = _bucketStarts[bucket];
+        }
+    }
+
+    return true;
+}
+
+bool GsiNameIndex::ReadRecord(uint32_t recordOffset, SymbolMatch& match) const
+{
+    uint16_t header[2];   // record length (without this field) + kind
+    if (!_msf.ReadStream(_symRecordStream, recordOffset, sizeof(header), header) || (header[0] < sizeof(uint16_t)))
+    {
+        return false;
+    }
+
+    std::vector<uint8_t> record(header[0] - sizeof(uint16_t) + 1, 0);
+    if (!_msf.ReadStream(_symRecordStream, recordOffset + sizeof(header), header[0] - sizeof(uint16_t), record.data()))
+    {
+        return false;
+    }
+
+    return ParseRecord(header[1], record.data(), record.size(), match);
+}
+
+bool GsiNameIndex::ParseRecord(uint16_t kind, const uint8_t* record, size_t size, SymbolMatch& match)
+{
+    match.kind = kind;
+    match.segment = 0;
+    match.offset = 0;
+
+    ByteReader reader(record, size);
+    switch (match.kind)
+    {
+        case S_PUB32:
+        case S_LDATA32:
+        case S_GDATA32:
+        case S_LTHREAD32:
+        case S_GTHREAD32:
+        case S_LMANDATA:
+        case S_GMANDATA:
+            // flags or type, offset, segment, name
+            reader.Skip(sizeof(uint32_t));
+            reader.Read(match.offset);
+            reader.Read(match.segment);
+            break;
+
+        case S_PROCREF:
+        case S_DATAREF:
+        case S_LPROCREF:
+        case S_ANNOTATIONREF:
+        case S_TOKENREF:
+            // checksum, offset in module stream, module index, name
+            reader.Skip(sizeof(uint32_t));
+            reader.Read(match.offset);
+            reader.Read(match.segment);
+            break;
+
+        case S_UDT:
+            reader.Skip(sizeof(uint32_t));
+            break;
+
+        case S_CONSTANT:
+        {
+            // type, numeric leaf, name
+            uint16_t leaf = 0;
+            reader.Skip(sizeof(uint32_t));
+            reader.Read(leaf);
+            if (leaf >= 0x8000)
+            {
+                static const uint8_t LeafSizes[] = { 1, 2, 2, 4, 4, 0, 0, 0, 0, 8, 8 };
+                reader.Skip((static_cast<size_t>(leaf - 0x8000) < sizeof(LeafSizes)) ? LeafSizes[leaf - 0x8000] : 0);
+            }
+            break;
+        }
+
+        default:
+            return false;
+    }
+
+    const char* name = nullptr;
+    if (!reader.ReadCString(name))
+    {
+        return false;
+    }
+
+    match.name = name;
+    return true;
+}
+
+void GsiNameIndex::FindExact(const char* name, std::vector<SymbolMatch>& matches) const
+{
+    if (_bucketStarts.empty())
+    {
+        return;
+    }
+
+    uint32_t bucket = HashStringV1(name, strlen(name)) % IPHR_HASH;
+    for (uint32_t i = _bucketStarts[bucket]; (i < _bucketStarts[bucket + 1]) && (i < _recordOffsets.size()); i++)
+    {
+        SymbolMatch match;
+        if (ReadRecord(_recordOffsets[i], match) && (match.name == name))
+        {
+            matches.push_back(match);
+        }
+    }
+}
+
+void GsiNameIndex::BuildSortedIndex() const
+{
+    // one pass over the record stream instead of one read per record in hash table order
+    _sortedIndex.reserve(_recordOffsets.size());
+    ReadRecordsInStreamOrder(
+        [this](uint32_t index, uint16_t kind, const uint8_t* record, size_t size)
+        {
+            SymbolMatch match;
+            if (!ParseRecord(kind, record, size, match))
+            {
+                return;
+            }
+
+            _sortedIndex.push_back({ static_cast<uint32_t>(_sortedNames.size()), _recordOffsets[index] });
+            _sortedNames.insert(_sortedNames.end(), match.name.begin(), match.name.end());
+            _sortedNames.push_back('\0');
+        });
+
+    const char* names = _sortedNames.data();
+    std::sort(_sortedIndex.begin(), _sortedIndex.end(),
+        [names](const SortedName& a, const SortedName& b)
+        {
+            return strcmp(names + a.nameOffset, names + b.nameOffset) < 0;
+        });
+}
+
+void GsiNameIndex::FindWildcard(const char* pattern, std::vector<SymbolMatch>& matches) const
+{
+    std::call_once(_sortedIndexBuilt, [this]() { BuildSortedIndex(); });
+
+    // only the names starting with the literal prefix of the pattern need to be checked
+    const char* names = _sortedNames.data();
+    size_t prefixLength = GetWildcardPrefixLength(pattern);
+    auto first = std::lower_bound(_sortedIndex.begin(), _sortedIndex.end(), pattern,
+        [names, prefixLength](const SortedName& entry, const char* prefix)
+        {
+            return strncmp(names + entry.nameOffset, prefix, prefixLength) < 0;
+        });
+
+    for (auto it = first; it != _sortedIndex.end(); ++it)
+    {
+        const char* name = names + it->nameOffset;
+        if (strncmp(name, pattern, prefixLength) != 0)
+        {
+            break;
+        }
+
+        SymbolMatch match;
+        if (MatchWildcard(pattern, name) && ReadRecord(it->recordOffset, match))
+        {
+            matches.push_back(match);
+        }
+    }
+}
+
+bool GsiNameIndex::ReadRecordsInStreamOrder(const RecordVisitor& visit) const
+{
+    // the record stream is read in windows, in stream order, so that the memory used does not
+    // depend on the size of the stream
+    std::vector<uint32_t> order(_recordOffsets.size());
+    for (uint32_t i = 0; i < order.size(); i++)
+    {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(),
+        [this](uint32_t a, uint32_t b) { return _recordOffsets[a] < _recordOffsets[b]; });
+
+    uint32_t streamSize = _msf.GetStreamSize(_symRecordStream);
+    std::vector<uint8_t> window;
+    uint32_t windowStart = 0;
+    auto isInWindow = [&window, &windowStart](uint32_t offset, size_t size)
+        {
+            return (offset >= windowStart) && (offset - windowStart + size <= window.size());
+        };
+    auto readWindow = [this, &window, &windowStart, streamSize](uint32_t offset)
+        {
+            windowStart = offset;
+            window.resize((std::min)(RecordWindowSize, streamSize - offset));
+            return _msf.ReadStream(_symRecordStream, offset, static_cast<uint32_t>(window.size()), window.data());
+        };
+
+    for (uint32_t i : order)
+    {
+        uint32_t recordOffset = _recordOffsets[i];
+        uint16_t header[2];
+        if ((recordOffset >= streamSize) || (streamSize - recordOffset < sizeof(header)))
+        {
+            continue;
+        }
+
+        // a record that does not fit in the current window starts the next one
+        if (!isInWindow(recordOffset, sizeof(header)) && !readWindow(recordOffset))
+        {
+            return false;
+        }
+        memcpy(header, window.data() + (recordOffset - windowStart), sizeof(header));
+
+        size_t recordSize = header[0] - sizeof(uint16_t);
+        if (header[0] < sizeof(uint16_t))
+        {
+            continue;
+        }
+        if (!isInWindow(recordOffset, sizeof(header) + recordSize))
+        {
+            if (!readWindow(recordOffset))
+            {
+                return false;
+            }
+            if (!isInWindow(recordOffset, sizeof(header) + recordSize))
+            {
+                continue;
+            }
+        }
+
+        visit(i, header[1], window.data() + (recordOffset - windowStart) + sizeof(header), recordSize);
+    }
+
+    return true;
+}
+
+void GsiNameIndex::GetAll(std::vector<SymbolMatch>& symbols) const
+{
+    // the symbols are still returned in hash table order
+    std::vector<SymbolMatch> matches(_recordOffsets.size());
+    std::vector<bool> isParsed(_recordOffsets.size(), false);
+    bool success = ReadRecordsInStreamOrder(
+        [&matches, &isParsed](uint32_t index, uint16_t kind, const uint8_t* record, size_t size)
+        {
+            isParsed[index] = ParseRecord(kind, record, size, matches[index]);
+        });
+    if (!success)
+    {
+        return;
+    }
+
+    symbols.reserve(symbols.size() + _recordOffsets.size());
+    for (size_t i = 0; i < matches.size(); i++)
+    {
+        if (isParsed[i])
+        {
+            symbols.push_back(std::move(matches[i]));
+        }
+    }
+}
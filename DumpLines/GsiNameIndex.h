@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "MsfFile.h"
+
+// public symbols are located by segment:offset
+const uint16_t S_PUB32 = 0x110E;
+
+struct SymbolMatch
+{
+    std::string name;
+    uint16_t kind;          // S_PUB32, S_PROCREF, S_GDATA32...
+    uint16_t segment;       // module index (1-based) for S_PROCREF/S_LPROCREF
+    uint32_t offset;        // offset in the module symbols stream for S_PROCREF/S_LPROCREF
+};
+
+// Name lookup backed by the hash table of the global (GSI) or public (PSI) symbols streams.
+// Exact lookups only read the records of one hash bucket; wildcard lookups use a sorted
+// index of the names that is built the first time it is needed.
+class GsiNameIndex
+{
+public:
+    GsiNameIndex(const MsfFile& msf);
+
+    // The publics stream starts with a header before the hash table
+    bool Read(uint16_t hashStream, bool isPublics, uint16_t symRecordStream);
+
+    void FindExact(const char* name, std::vector<SymbolMatch>& matches) const;
+    void FindWildcard(const char* pattern, std::vector<SymbolMatch>& matches) const;
+
+    // All the symbols of the hash table (the record stream is read once, by windows)
+    void GetAll(std::vector<SymbolMatch>& symbols) const;
+
+    // Hash function used by the PDB name tables (case insensitive for ASCII)
+    static uint32_t HashStringV1(const char* str, size_t length);
+
+private:
+    struct SortedName
+    {
+        uint32_t nameOffset;    // in _sortedNames
+        uint32_t recordOffset;  // in the symbol record stream
+    };
+
+    // index in _recordOffsets, kind and content (after the kind) of a record
+    typedef std::function<void(uint32_t index, uint16_t kind, const uint8_t* record, size_t size)> RecordVisitor;
+
+private:
+    bool ReadRecord(uint32_t recordOffset, SymbolMatch& match) const;
+    bool ReadRecordsInStreamOrder(const RecordVisitor& visit) const;
+    static bool ParseRecord(uint16_t kind, const uint8_t* record, size_t size, SymbolMatch& match);
+    void BuildSortedIndex() const;
+
+private:
+    const MsfFile& _msf;
+    uint16_t _symRecordStream;
+
+    // offset of each hash record in the symbol record stream, grouped by bucket:
+    // the records of bucket i are [_bucketStarts[i], _bucketStarts[i + 1][
+    std::vector<uint32_t> _recordOffsets;
+    std::vector<uint32_t> _bucketStarts;
+
+    mutable std::once_flag _sortedIndexBuilt;
+    mutable std::vector<char> _sortedNames;
+    mutable std::vector<SortedName> _sortedIndex;
+};
@@ -0,0 +1,261 @@
+#include "HeatMap.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+
+HeatMap::HeatMap()
+    :
+    _sampleCount(0),
+    _unresolvedCount(0)
+{
+}
+
+uint32_t HeatMap::AddDocument(const std::string& path)
+{
+    auto found = _documentIds.find(path);
+    if (found != _documentIds.end())
+    {
+        return found->second;
+    }
+
+    uint32_t document = static_cast<uint32_t>(_documents.size());
+    _documents.push_back(path);
+    _documentIds.emplace(path, document);
+    return document;
+}
+
+void HeatMap::Build(const std::vector<MethodInfo>& methods, const LineTable& lineTable)
+{
+    // a line entry covers the code up to the next entry (end entries have no file)
+    const std::vector<LineEntry>& entries = lineTable.GetEntries();
+    for (size_t i = 0; i + 1 < entries.size(); i++)
+    {
+        if (entries[i].fileNameOffset == LineTable::NoFile)
+        {
+            continue;
+        }
+
+        _lineRvas.push_back(entries[i].rva);
+        _lineSizes.push_back(entries[i + 1].rva - entries[i].rva);
+        _lineDocuments.push_back(AddDocument(lineTable.GetFileName(entries[i].fileNameOffset)));
+        _lineNumbers.push_back(entries[i].lineNumber);
+    }
+    _lineSamples.assign(_lineRvas.size(), 0);
+
+    std::vector<const MethodInfo*> sortedMethods;
+    sortedMethods.reserve(methods.size());
+    for (const MethodInfo& method : methods)
+    {
+        if ((method.rva != 0) && (method.size != 0))
+        {
+            sortedMethods.push_back(&method);
+        }
+    }
+    std::sort(sortedMethods.begin(), sortedMethods.end(),
+        [](const MethodInfo* left, const MethodInfo* right) { return left->rva < right->rva; });
+
+    size_t methodCount = sortedMethods.size();
+    _methodRvas.resize(methodCount);
+    _methodSizes.resize(methodCount);
+    _methodDocuments.resize(methodCount);
+    _methodFirstLines.resize(methodCount);
+    _methodLastLines.resize(methodCount);
+    _methodSamples.assign(methodCount, 0);
+    for (size_t i = 0; i < methodCount; i++)
+    {
+        const MethodInfo& method = *sortedMethods[i];
+        _methodRvas[i] = method.rva;
+        _methodSizes[i] = method.size;
+        _methodDocuments[i] = AddDocument(method.sourceFile);
+        _methodFirstLines[i] = method.lineNumber;
+        _methodLastLines[i] = method.lineNumber;
+
+        // line span = lines of the method document covered by the code of the method
+        auto first = std::lower_bound(_lineRvas.begin(), _lineRvas.end(), method.rva);
+        auto end = std::lower_bound(first, _lineRvas.end(), method.rva + method.size);
+        for (size_t line = first - _lineRvas.begin(); line < static_cast<size_t>(end - _lineRvas.begin()); line++)
+        {
+            if ((_lineDocuments[line] == _methodDocuments[i]) && (_lineNumbers[line] != 0))
+            {
+                _methodFirstLines[i] = (_methodFirstLines[i] == 0) ? _lineNumbers[line] : (std::min)(_methodFirstLines[i], _lineNumbers[line]);
+                _methodLastLines[i] = (std::max)(_methodLastLines[i], _lineNumbers[line]);
+            }
+        }
+    }
+}
+
+uint32_t HeatMap::FindMethod(uint32_t rva) const
+{
+    auto next = std::upper_bound(_methodRvas.begin(), _methodRvas.end(), rva);
+    if (next == _methodRvas.begin())
+    {
+        return NoMethod;
+    }
+
+    uint32_t method = static_cast<uint32_t>((next - 1) - _methodRvas.begin());
+    return (rva - _methodRvas[method] < _methodSizes[method]) ? method : NoMethod;
+}
+
+void HeatMap::AddSample(uint32_t rva, uint64_t count)
+{
+    _sampleCount += count;
+
+    bool isResolved = false;
+    uint32_t method = FindMethod(rva);
+    if (method != NoMethod)
+    {
+        _methodSamples[method] += count;
+        isResolved = true;
+    }
+
+    auto next = std::upper_bound(_lineRvas.begin(), _lineRvas.end(), rva);
+    if (next != _lineRvas.begin())
+    {
+        size_t line = (next - 1) - _lineRvas.begin();
+        if (rva - _lineRvas[line] < _lineSizes[line])
+        {
+            _lineSamples[line] += count;
+            isResolved = true;
+        }
+    }
+
+    _unresolvedCount += isResolved ? 0 : count;
+}
+
+bool HeatMap::AddSamples(const std::string& sampleFilePath)
+{
+    FILE* pFile = nullptr;
+    if ((fopen_s(&pFile, sampleFilePath.c_str(), "rt") != 0) || (pFile == nullptr))
+    {
+        return false;
+    }
+
+    bool success = true;
+    char line[256];
+    while (fgets(line, sizeof(line), pFile) != nullptr)
+    {
+        char* current = line;
+        while ((*current == ' ') || (*current == '\t'))
+        {
+            current++;
+        }
+        if ((*current == '\0') || (*current == '\n') || (*current == '\r') || (*current == '#'))
+        {
+            continue;
+        }
+
+        char* end = nullptr;
+        uint64_t rva = strtoull(current, &end, 16);
+        if ((end == current) || (rva > 0xFFFFFFFF))
+        {
+            success = false;
+            break;
+        }
+
+        // the count is optional
+        char* countEnd = nullptr;
+        uint64_t count = strtoull(end, &countEnd, 10);
+        AddSample(static_cast<uint32_t>(rva), (countEnd == end) ? 1 : count);
+    }
+
+    fclose(pFile);
+    return success;
+}
+
+void HeatMap::GetFileHeat(std::vector<FileHeat>& files) const
+{
+    // dense accumulation by document id; the line columns are more precise than the methods
+    // (code inlined from another file is attributed to that file)
+    std::vector<FileHeat> heat(_documents.size());
+    for (uint32_t document = 0; document < heat.size(); document++)
+    {
+        heat[document] = { document, 0, 0, 0 };
+    }
+
+    for (size_t i = 0; i < _methodRvas.size(); i++)
+    {
+        FileHeat& file = heat[_methodDocuments[i]];
+        file.methods++;
+        if (_lineRvas.empty())
+        {
+            file.codeBytes += _methodSizes[i];
+            file.samples += _methodSamples[i];
+        }
+    }
+
+    for (size_t i = 0; i < _lineRvas.size(); i++)
+    {
+        FileHeat& file = heat[_lineDocuments[i]];
+        file.codeBytes += _lineSizes[i];
+        file.samples += _lineSamples[i];
+    }
+
+    files.clear();
+    for (const FileHeat& file : heat)
+    {
+        if ((file.codeBytes != 0) || (file.methods != 0))
+        {
+            files.push_back(file);
+        }
+    }
+}
+
+void HeatMap::GetLineHeat(std::vector<LineHeat>& lines) const
+{
+    lines.clear();
+    if (_lineRvas.empty())
+    {
+        lines.reserve(_methodRvas.size());
+        for (size_t i = 0; i < _methodRvas.size(); i++)
+        {
+            lines.push_back({ _methodDocuments[i], _methodFirstLines[i], _methodSizes[i], _methodSamples[i] });
+        }
+    }
+    else
+    {
+        lines.reserve(_lineRvas.size());
+        for (size_t i = 0; i < _lineRvas.size(); i++)
+        {
+            lines.push_back({ _lineDocuments[i], _lineNumbers[i], _lineSizes[i], _lineSamples[i] });
+        }
+    }
+
+    // the code of a line can be split in several ranges: sum the ranges of the same line
+    std::sort(lines.begin(), lines.end(),
+        [](const LineHeat& left, const LineHeat& right)
+        {
+            return (left.document != right.document) ? (left.document < right.document) : (left.line < right.line);
+        });
+
+    size_t count = 0;
+    for (size_t i = 0; i < lines.size(); i++)
+    {
+        if ((count > 0) && (lines[count - 1].document == lines[i].document) && (lines[count - 1].line == lines[i].line))
+        {
+            lines[count - 1].codeBytes += lines[i].codeBytes;
+            lines[count - 1].samples += lines[i].samples;
+        }
+        else
+        {
+            lines[count++] = lines[i];
+        }
+    }
+    lines.resize(count);
+}
+
+void HeatMap::GetMethodHeat(std::vector<MethodHeat>& methods) const
+{
+    methods.resize(_methodRvas.size());
+    for (size_t i = 0; i < _methodRvas.size(); i++)
+    {
+        methods[i] = { _methodRvas[i], _methodSizes[i], _methodDocuments[i], _methodFirstLines[i], _methodLastLines[i], _methodSamples[i] };
+    }
+
+    std::sort(methods.begin(), methods.end(),
+        [](const MethodHeat& left, const MethodHeat& right)
+        {
+            return (left.document != right.document) ? (left.document < right.document) : (left.firstLine < right.firstLine);
+        });
+}
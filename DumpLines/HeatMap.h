@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "PdbCommon.h"
+#include "LineTable.h"
+
+struct FileHeat
+{
+    uint32_t document;
+    uint32_t methods;
+    uint64_t codeBytes;
+    uint64_t samples;
+};
+
+struct MethodHeat
+{
+    uint32_t rva;
+    uint32_t size;
+    uint32_t document;
+    uint32_t firstLine;     // lines of the document covered by the code of the method
+    uint32_t lastLine;
+    uint64_t samples;
+};
+
+struct LineHeat
+{
+    uint32_t document;
+    uint32_t line;
+    uint64_t codeBytes;
+    uint64_t samples;
+};
+
+// Code size and CPU samples per source file and line of a native module.
+// Methods (rva, size, document, line span) and line ranges (rva, size, document, line) are stored
+// in columns sorted by rva: a sample is binned with a binary search on the rva columns and the heat
+// maps are sums over the columns, without any per method object. When the PDB has no line table,
+// the code of a method is attributed to its first line.
+class HeatMap
+{
+public:
+    HeatMap();
+
+    // Methods without rva or size are ignored
+    void Build(const std::vector<MethodInfo>& methods, const LineTable& lineTable);
+
+    // Text file with one "<rva in hexadecimal> [count]" line per sample (# for comments)
+    bool AddSamples(const std::string& sampleFilePath);
+    void AddSample(uint32_t rva, uint64_t count);
+
+    uint64_t GetSampleCount() const { return _sampleCount; }
+    uint64_t GetUnresolvedSampleCount() const { return _unresolvedCount; }
+    size_t GetMethodCount() const { return _methodRvas.size(); }
+
+    const std::string& GetDocument(uint32_t document) const { return _documents[document]; }
+
+    // One entry per document with code
+    void GetFileHeat(std::vector<FileHeat>& files) const;
+
+    // One entry per document and line with code, sorted by document and line
+    void GetLineHeat(std::vector<LineHeat>& lines) const;
+
+    // Methods sorted by document and first line
+    void GetMethodHeat(std::vector<MethodHeat>& methods) const;
+
+private:
+    static const uint32_t NoMethod = 0xFFFFFFFF;
+
+private:
+    uint32_t AddDocument(const std::string& path);
+
+    // Index in the method columns of the method containing the rva (NoMethod if none)
+    uint32_t FindMethod(uint32_t rva) const;
+
+private:
+    std::vector<std::string> _documents;
+    std::unordered_map<std::string, uint32_t> _documentIds;
+
+    // methods sorted by rva
+    std::vector<uint32_t> _methodRvas;
+    std::vector<uint32_t> _methodSizes;
+    std::vector<uint32_t> _methodDocuments;
+    std::vector<uint32_t> _methodFirstLines;
+    std::vector<uint32_t> _methodLastLines;
+    std::vector<uint64_t> _methodSamples;
+
+    // line ranges sorted by rva (empty without line table)
+    std::vector<uint32_t> _lineRvas;
+    std::vector<uint32_t> _lineSizes;
+    std::vector<uint32_t> _lineDocuments;
+    std::vector<uint32_t> _lineNumbers;
+    std::vector<uint64_t> _lineSamples;
+
+    uint64_t _sampleCount;
+    uint64_t _unresolvedCount;
+};
@@ -0,0 +1,242 @@
+#include "IncrementalIndexer.h"
+#include "ModuleSnapshot.h"
+#include "Parallel.h"
+#include "ReadAheadPipeline.h"
+
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+
+const size_t ReadAheadPerWorker = 2;    // files read ahead for each parsing thread
+
+
+IncrementalIndexer::IncrementalIndexer(SymbolIndex& index, size_t workerCount)
+    :
+    _index(index),
+    _workerCount((workerCount == 0) ? 1 : workerCount)
+{
+}
+
+void IncrementalIndexer::EnumeratePdbFiles(const std::string& directory, std::vector<ScannedFile>& files)
+{
+    std::string pattern = directory + "\\*";
+    WIN32_FIND_DATAA findData;
+    HANDLE hFind = FindFirstFileA(pattern.c_str(), &findData);
+    if (hFind == INVALID_HANDLE_VALUE)
+    {
+        return;
+    }
+
+    do
+    {
+        if ((strcmp(findData.cFileName, ".") == 0) || (strcmp(findData.cFileName, "..") == 0))
+        {
+            continue;
+        }
+
+        std::string path = directory + "\\" + findData.cFileName;
+        if ((findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0)
+        {
+            EnumeratePdbFiles(path, files);
+            continue;
+        }
+
+        size_t length = strlen(findData.cFileName);
+        if ((length < 4) || (_stricmp(findData.cFileName + length - 4, ".pdb") != 0))
+        {
+            continue;
+        }
+
+        ScannedFile file;
+        file.path = path;
+        file.fileSize = (static_cast<uint64_t>(findData.nFileSizeHigh) << 32) | findData.nFileSizeLow;
+        file.lastWriteTime = (static_cast<uint64_t>(findData.ftLastWriteTime.dwHighDateTime) << 32) | findData.ftLastWriteTime.dwLowDateTime;
+        files.push_back(file);
+    } while (FindNextFileA(hFind, &findData));
+
+    FindClose(hFind);
+}
+
+bool IncrementalIndexer::Update(const std::string& directory, IndexingStats& stats)
+{
+    memset(&stats, 0, sizeof(stats));
+
+    std::string root = directory;
+    while ((root.size() > 1) && ((root.back() == '\\') || (root.back() == '/')))
+    {
+        root.pop_back();
+    }
+
+    std::vector<ScannedFile> files;
+    EnumeratePdbFiles(root, files);
+    stats.scanned = files.size();
+
+    IndexChangedFiles(files, stats);
+
+    // modules of this directory that disappeared
+    RemoveMissingModules(files, SymbolIndex::GetPathKey(root) + "\\", stats);
+
+    return _index.Flush();
+}
+
+bool IncrementalIndexer::UpdateFiles(const std::vector<std::string>& filePaths, IndexingStats& stats)
+{
+    memset(&stats, 0, sizeof(stats));
+
+    // same information as the directory listing: a missing file is removed from the index
+    std::vector<ScannedFile> files;
+    files.reserve(filePaths.size());
+    for (const std::string& path : filePaths)
+    {
+        WIN32_FILE_ATTRIBUTE_DATA attributes;
+        if (!GetFileAttributesExA(path.c_str(), GetFileExInfoStandard, &attributes) ||
+            ((attributes.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0))
+        {
+            continue;
+        }
+
+        ScannedFile file;
+        file.path = path;
+        file.fileSize = (static_cast<uint64_t>(attributes.nFileSizeHigh) << 32) | attributes.nFileSizeLow;
+        file.lastWriteTime = (static_cast<uint64_t>(attributes.ftLastWriteTime.dwHighDateTime) << 32) | attributes.ftLastWriteTime.dwLowDateTime;
+        files.push_back(file);
+    }
+    stats.scanned = files.size();
+
+    IndexChangedFiles(files, stats);
+
+    // every module of the index is expected in the list
+    RemoveMissingModules(files, "", stats);
+
+    return _index.Flush();
+}
+
+void IncrementalIndexer::IndexChangedFiles(const std::vector<ScannedFile>& files, IndexingStats& stats)
+{
+    // only the files with a different size or time need to be opened
+    std::vector<ChangedFile> changedFiles;
+    for (const ScannedFile& file : files)
+    {
+        const IndexedModule* module = _index.FindModule(file.path);
+        if ((module != nullptr) && (module->fileSize == file.fileSize) && (module->lastWriteTime == file.lastWriteTime))
+        {
+            stats.unchanged++;
+            continue;
+        }
+
+        ChangedFile changedFile;
+        changedFile.file = &file;
+        changedFile.isIndexed = (module != nullptr);
+        changedFile.hasKey = false;
+        if (changedFile.isIndexed)
+        {
+            changedFile.previousKey = module->key;
+        }
+        changedFiles.push_back(changedFile);
+    }
+
+    // the identity of the files already indexed is read first: a file copied again from the same
+    // build has the same GUID + age and is only touched, without going through the read-ahead
+    ParallelFor(changedFiles.size(), [&changedFiles](size_t i)
+        {
+            ChangedFile& changedFile = changedFiles[i];
+            changedFile.hasKey = changedFile.isIndexed && ReadPdbKey(changedFile.file->path, changedFile.key);
+        });
+
+    std::vector<const ChangedFile*> parsedFiles;
+    std::vector<std::string> parsedPaths;
+    for (const ChangedFile& changedFile : changedFiles)
+    {
+        if (changedFile.isIndexed && !changedFile.hasKey)
+        {
+            stats.failed++;
+            continue;
+        }
+        if (!changedFile.hasKey || !(changedFile.previousKey == changedFile.key))
+        {
+            parsedFiles.push_back(&changedFile);
+            parsedPaths.push_back(changedFile.file->path);
+            continue;
+        }
+
+        IndexedModule module = CreateModule(*changedFile.file);
+        module.key = changedFile.key;
+        bool success = _index.AppendTouch(module);
+        stats.touched += success ? 1 : 0;
+        stats.failed += success ? 0 : 1;
+    }
+
+    // parse the new and rebuilt files in parallel while the next ones are read ahead; records are appended
+    // as soon as they are ready so that the memory used does not depend on the number of changed files
+    ReadAheadPipeline pipeline(ReadAheadPerWorker * _workerCount, _workerCount);
+    std::mutex appendLock;
+    pipeline.Run(parsedPaths, [&](size_t i)
+        {
+            const ChangedFile& changedFile = *parsedFiles[i];
+            IndexedModule module = CreateModule(*changedFile.file);
+            module.key = changedFile.key;
+
+            bool success = false;
+            std::vector<uint8_t> record;
+            if (changedFile.hasKey || ReadPdbKey(module.path, module.key))
+            {
+                std::shared_ptr<const ModuleSnapshot> snapshot = ModuleSnapshot::Load(module.path);
+                if (snapshot != nullptr)
+                {
+                    SymbolIndex::EncodeModuleRecord(module, snapshot->GetMethods(), record);
+                    success = true;
+                }
+            }
+
+            std::lock_guard<std::mutex> guard(appendLock);
+            success = success && _index.AppendModuleRecord(record);
+            stats.indexed += success ? 1 : 0;
+            stats.failed += success ? 0 : 1;
+        });
+    stats.readAhead = pipeline.GetStats();
+}
+
+IndexedModule IncrementalIndexer::CreateModule(const ScannedFile& file)
+{
+    IndexedModule module;
+    module.path = file.path;
+    module.fileSize = file.fileSize;
+    module.lastWriteTime = file.lastWriteTime;
+    module.recordOffset = 0;
+    module.methodsOffset = 0;
+    module.methodCount = 0;
+    return module;
+}
+
+void IncrementalIndexer::RemoveMissingModules(const std::vector<ScannedFile>& files, const std::string& rootKey, IndexingStats& stats)
+{
+    std::vector<std::string> presentKeys;
+    presentKeys.reserve(files.size());
+    for (const ScannedFile& file : files)
+    {
+        presentKeys.push_back(SymbolIndex::GetPathKey(file.path));
+    }
+    std::sort(presentKeys.begin(), presentKeys.end());
+
+    std::vector<std::string> removedPaths;
+    for (const auto& module : _index.GetModules())
+    {
+        if ((module.first.compare(0, rootKey.size(), rootKey) == 0) &&
+            !std::binary_search(presentKeys.begin(), presentKeys.end(), module.first))
+        {
+            removedPaths.push_back(module.second.path);
+        }
+    }
+
+    for (const std::string& path : removedPaths)
+    {
+        if (_index.AppendRemoval(path))
+        {
+            stats.removed++;
+        }
+        else
+        {
+            stats.failed++;
+        }
+    }
+}
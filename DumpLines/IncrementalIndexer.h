@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "ReadAheadPipeline.h"
+#include "SymbolIndex.h"
+
+struct IndexingStats
+{
+    size_t scanned;
+    size_t unchanged;   // same size and time: not even opened
+    size_t touched;     // rewritten but same GUID + age: only the header is read
+    size_t indexed;     // new or rebuilt modules
+    size_t removed;
+    size_t failed;
+    ReadAheadStats readAhead;   // new and rebuilt modules read ahead while parsing
+};
+
+// Bring an index up to date with the .pdb files of a directory tree.
+// The directory listing gives the size and time of each file for free, so that only the
+// modules that changed since the last run are opened and only the new PDBs are parsed.
+class IncrementalIndexer
+{
+public:
+    // workerCount = number of threads parsing the changed files
+    IncrementalIndexer(SymbolIndex& index, size_t workerCount);
+
+    bool Update(const std::string& directory, IndexingStats& stats);
+
+    // Index exactly the given .pdb files (i.e. one shard of a larger list): the modules of the
+    // index that are not in the list are removed
+    bool UpdateFiles(const std::vector<std::string>& filePaths, IndexingStats& stats);
+
+private:
+    struct ScannedFile
+    {
+        std::string path;
+        uint64_t fileSize;
+        uint64_t lastWriteTime;
+    };
+
+    struct ChangedFile
+    {
+        const ScannedFile* file;
+        bool isIndexed;
+        PdbKey previousKey;
+        bool hasKey;        // key read before the parsing (only for the files already indexed)
+        PdbKey key;
+    };
+
+private:
+    static void EnumeratePdbFiles(const std::string& directory, std::vector<ScannedFile>& files);
+    void IndexChangedFiles(const std::vector<ScannedFile>& files, IndexingStats& stats);
+    static IndexedModule CreateModule(const ScannedFile& file);
+
+    // Remove the modules with a path starting with rootKey that were not scanned
+    void RemoveMissingModules(const std::vector<ScannedFile>& files, const std::string& rootKey, IndexingStats& stats);
+
+private:
+    SymbolIndex& _index;
+    size_t _workerCount;
+};
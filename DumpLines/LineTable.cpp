@@ -0,0 +1,112 @@
+#include "LineTable.h"
+
+#include <algorithm>
+#include <cstring>
+#include <queue>
+
+// end entries are sorted before the line starting at the same address
+static bool IsBefore(const LineEntry& a, const LineEntry& b)
+{
+    if (a.rva != b.rva)
+    {
+        return a.rva < b.rva;
+    }
+
+    return (a.fileNameOffset == LineTable::NoFile) && (b.fileNameOffset != LineTable::NoFile);
+}
+
+void LineTable::Add(uint32_t rva, uint32_t lineNumber, uint32_t fileNameOffset)
+{
+    _entries.push_back({ rva, lineNumber, fileNameOffset });
+}
+
+void LineTable::AddEnd(uint32_t rva)
+{
+    _entries.push_back({ rva, 0, NoFile });
+}
+
+void LineTable::Sort()
+{
+    std::sort(_entries.begin(), _entries.end(), IsBefore);
+}
+
+void LineTable::Merge(std::vector<LineTable>& tables)
+{
+    size_t count = _entries.size();
+    for (const LineTable& table : tables)
+    {
+        count += table._entries.size();
+    }
+
+    std::vector<LineEntry> merged;
+    merged.reserve(count);
+
+    // k-way merge: the heap contains the current position in each table
+    struct Cursor
+    {
+        const LineEntry* current;
+        const LineEntry* end;
+    };
+    auto isAfter = [](const Cursor& a, const Cursor& b) { return IsBefore(*b.current, *a.current); };
+    std::priority_queue<Cursor, std::vector<Cursor>, decltype(isAfter)> heap(isAfter);
+
+    if (!_entries.empty())
+    {
+        heap.push({ _entries.data(), _entries.data() + _entries.size() });
+    }
+    for (const LineTable& table : tables)
+    {
+        if (!table._entries.empty())
+        {
+            heap.push({ table._entries.data(), table._entries.data() + table._entries.size() });
+        }
+    }
+
+    while (!heap.empty())
+    {
+        Cursor cursor = heap.top();
+        heap.pop();
+
+        merged.push_back(*cursor.current);
+        cursor.current++;
+        if (cursor.current != cursor.end)
+        {
+            heap.push(cursor);
+        }
+    }
+
+    _entries.swap(merged);
+}
+
+const LineEntry* LineTable::Find(uint32_t rva) const
+{
+    auto it = std::upper_bound(_entries.begin(), _entries.end(), rva,
+        [](uint32_t value, const LineEntry& entry)
+        {
+            return value < entry.rva;
+        });
+
+    if (it == _entries.begin())
+    {
+        return nullptr;
+    }
+
+    --it;
+    if (it->fileNameOffset == NoFile)
+    {
+        return nullptr;
+    }
+
+    return &(*it);
+}
+
+const char* LineTable::GetFileName(uint32_t fileNameOffset) const
+{
+    if (fileNameOffset >= _fileNames.size())
+    {
+        return "";
+    }
+
+    // the string table is NUL terminated (checked when it is loaded)
+    return &_fileNames[fileNameOffset];
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+struct LineEntry
+{
+    uint32_t rva;
+    uint32_t lineNumber;
+    uint32_t fileNameOffset;    // offset in the /names string table
+};
+
+// Address -> line table sorted by RVA.
+// A line entry covers the code up to the next entry; end entries (without file)
+// mark the end of a contiguous range of code so that gaps are not attributed to a line.
+class LineTable
+{
+public:
+    static const uint32_t NoFile = 0xFFFFFFFF;
+
+public:
+    void Reserve(size_t count) { _entries.reserve(count); }
+    void Add(uint32_t rva, uint32_t lineNumber, uint32_t fileNameOffset);
+    void AddEnd(uint32_t rva);
+    void Sort();
+
+    // Merge the given tables (each one must be sorted) into this one
+    void Merge(std::vector<LineTable>& tables);
+
+    // Return nullptr if the rva is not covered by any line
+    const LineEntry* Find(uint32_t rva) const;
+
+    void SetFileNames(std::vector<char>&& fileNames) { _fileNames = std::move(fileNames); }
+    const char* GetFileName(uint32_t fileNameOffset) const;
+
+    bool IsEmpty() const { return _entries.empty(); }
+    size_t GetCount() const { return _entries.size(); }
+    const std::vector<LineEntry>& GetEntries() const { return _entries; }
+
+private:
+    std::vector<LineEntry> _entries;
+    std::vector<char> _fileNames;
+};
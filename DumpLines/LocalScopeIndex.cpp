@@ -0,0 +1,300 @@
+#include "LocalScopeIndex.h"
+#include "ByteReader.h"
+
+#include <algorithm>
+
+
+LocalScopeIndex::LocalScopeIndex()
+    :
+    _metadata(nullptr)
+{
+}
+
+bool LocalScopeIndex::Build(const MetadataReader& pdbMetadata)
+{
+    _metadata = &pdbMetadata;
+
+    // only the row values are copied: names are read from the #Strings heap on query
+    uint32_t variableCount = pdbMetadata.GetRowCount(TableLocalVariable);
+    _variables.resize(variableCount);
+    for (uint32_t rid = 1; rid <= variableCount; rid++)
+    {
+        Variable& variable = _variables[rid - 1];
+        variable.attributes = static_cast<uint16_t>(pdbMetadata.GetValue(TableLocalVariable, rid, LocalVariable_Attributes));
+        variable.index = static_cast<uint16_t>(pdbMetadata.GetValue(TableLocalVariable, rid, LocalVariable_Index));
+        variable.nameOffset = pdbMetadata.GetValue(TableLocalVariable, rid, LocalVariable_Name);
+    }
+
+    uint32_t constantCount = pdbMetadata.GetRowCount(TableLocalConstant);
+    _constantNames.resize(constantCount);
+    for (uint32_t rid = 1; rid <= constantCount; rid++)
+    {
+        _constantNames[rid - 1] = pdbMetadata.GetValue(TableLocalConstant, rid, LocalConstant_Name);
+    }
+
+    uint32_t importScopeCount = pdbMetadata.GetRowCount(TableImportScope);
+    _importScopes.resize(importScopeCount);
+    for (uint32_t rid = 1; rid <= importScopeCount; rid++)
+    {
+        _importScopes[rid - 1].parent = pdbMetadata.GetValue(TableImportScope, rid, ImportScope_Parent);
+        _importScopes[rid - 1].importsBlob = pdbMetadata.GetValue(TableImportScope, rid, ImportScope_Imports);
+    }
+
+    // LocalScope rows are sorted by method: count the scopes of each method first
+    uint32_t methodCount = pdbMetadata.GetRowCount(TableMethodDebugInformation);
+    uint32_t scopeCount = pdbMetadata.GetRowCount(TableLocalScope);
+    _methodScopes.assign(methodCount + 2, 0);
+    for (uint32_t rid = 1; rid <= scopeCount; rid++)
+    {
+        uint32_t methodRid = pdbMetadata.GetValue(TableLocalScope, rid, LocalScope_Method);
+        if ((methodRid != 0) && (methodRid <= methodCount))
+        {
+            _methodScopes[methodRid + 1]++;
+        }
+    }
+    for (uint32_t methodRid = 1; methodRid <= methodCount; methodRid++)
+    {
+        _methodScopes[methodRid + 1] += _methodScopes[methodRid];
+    }
+
+    std::vector<uint32_t> positions(_methodScopes.begin(), _methodScopes.end());
+    _scopes.resize(_methodScopes[methodCount + 1]);
+    for (uint32_t rid = 1; rid <= scopeCount; rid++)
+    {
+        uint32_t methodRid = pdbMetadata.GetValue(TableLocalScope, rid, LocalScope_Method);
+        if ((methodRid == 0) || (methodRid > methodCount))
+        {
+            continue;
+        }
+
+        Scope& scope = _scopes[positions[methodRid]++];
+        scope.startOffset = pdbMetadata.GetValue(TableLocalScope, rid, LocalScope_StartOffset);
+        scope.endOffset = scope.startOffset + pdbMetadata.GetValue(TableLocalScope, rid, LocalScope_Length);
+        scope.parent = NoScope;
+        scope.importScope = pdbMetadata.GetValue(TableLocalScope, rid, LocalScope_ImportScope);
+
+        // lists are 1-based; a list ends where the list of the next row starts
+        uint32_t firstVariable = pdbMetadata.GetValue(TableLocalScope, rid, LocalScope_VariableList);
+        uint32_t lastVariable = pdbMetadata.GetListEnd(TableLocalScope, rid, LocalScope_VariableList, TableLocalVariable);
+        scope.firstVariable = (firstVariable == 0) ? 0 : (std::min)(firstVariable - 1, variableCount);
+        scope.variableEnd = (std::max)(scope.firstVariable, (std::min)(lastVariable, variableCount));
+
+        uint32_t firstConstant = pdbMetadata.GetValue(TableLocalScope, rid, LocalScope_ConstantList);
+        uint32_t lastConstant = pdbMetadata.GetListEnd(TableLocalScope, rid, LocalScope_ConstantList, TableLocalConstant);
+        scope.firstConstant = (firstConstant == 0) ? 0 : (std::min)(firstConstant - 1, constantCount);
+        scope.constantEnd = (std::max)(scope.firstConstant, (std::min)(lastConstant, constantCount));
+    }
+
+    // outer scopes first (start ascending, length descending), then link each scope to the
+    // innermost scope that contains it
+    std::vector<uint32_t> openScopes;
+    for (uint32_t methodRid = 1; methodRid <= methodCount; methodRid++)
+    {
+        uint32_t first = _methodScopes[methodRid];
+        uint32_t end = _methodScopes[methodRid + 1];
+        std::sort(_scopes.begin() + first, _scopes.begin() + end,
+            [](const Scope& left, const Scope& right)
+            {
+                if (left.startOffset != right.startOffset)
+                {
+                    return left.startOffset < right.startOffset;
+                }
+                return left.endOffset > right.endOffset;
+            });
+
+        openScopes.clear();
+        for (uint32_t i = first; i < end; i++)
+        {
+            while (!openScopes.empty() && (_scopes[openScopes.back()].endOffset < _scopes[i].endOffset))
+            {
+                openScopes.pop_back();
+            }
+            while (!openScopes.empty() && (_scopes[openScopes.back()].endOffset <= _scopes[i].startOffset))
+            {
+                openScopes.pop_back();
+            }
+
+            _scopes[i].parent = openScopes.empty() ? NoScope : openScopes.back();
+            openScopes.push_back(i);
+        }
+    }
+
+    return true;
+}
+
+uint32_t LocalScopeIndex::FindLastScope(uint32_t methodRid, uint32_t ilOffset) const
+{
+    if ((methodRid == 0) || (methodRid + 1 >= _methodScopes.size()))
+    {
+        return NoScope;
+    }
+
+    // last scope starting at or before the offset: the scopes containing the offset are
+    // this one and its parents
+    auto first = _scopes.begin() + _methodScopes[methodRid];
+    auto end = _scopes.begin() + _methodScopes[methodRid + 1];
+    auto next = std::upper_bound(first, end, ilOffset,
+        [](uint32_t offset, const Scope& scope) { return offset < scope.startOffset; });
+    if (next == first)
+    {
+        return NoScope;
+    }
+
+    return static_cast<uint32_t>((next - 1) - _scopes.begin());
+}
+
+bool LocalScopeIndex::GetLocals(uint32_t methodToken, uint32_t ilOffset, std::vector<LocalInfo>& locals) const
+{
+    if ((_metadata == nullptr) || (TableFromToken(methodToken) != TableMethodDef))
+    {
+        return false;
+    }
+
+    for (uint32_t i = FindLastScope(RidFromToken(methodToken), ilOffset); i != NoScope; i = _scopes[i].parent)
+    {
+        const Scope& scope = _scopes[i];
+        if (ilOffset >= scope.endOffset)
+        {
+            continue;
+        }
+
+        for (uint32_t variable = scope.firstVariable; variable < scope.variableEnd; variable++)
+        {
+            LocalInfo local;
+            local.name = _metadata->GetString(_variables[variable].nameOffset);
+            local.isConstant = false;
+            local.index = _variables[variable].index;
+            local.attributes = _variables[variable].attributes;
+            local.scopeStart = scope.startOffset;
+            local.scopeEnd = scope.endOffset;
+            locals.push_back(local);
+        }
+
+        for (uint32_t constant = scope.firstConstant; constant < scope.constantEnd; constant++)
+        {
+            LocalInfo local;
+            local.name = _metadata->GetString(_constantNames[constant]);
+            local.isConstant = true;
+            local.index = 0;
+            local.attributes = 0;
+            local.scopeStart = scope.startOffset;
+            local.scopeEnd = scope.endOffset;
+            locals.push_back(local);
+        }
+    }
+
+    return true;
+}
+
+uint32_t LocalScopeIndex::GetImportScope(uint32_t methodToken, uint32_t ilOffset) const
+{
+    for (uint32_t i = FindLastScope(RidFromToken(methodToken), ilOffset); i != NoScope; i = _scopes[i].parent)
+    {
+        if (ilOffset < _scopes[i].endOffset)
+        {
+            return _scopes[i].importScope;
+        }
+    }
+
+    return 0;
+}
+
+uint32_t LocalScopeIndex::GetParentImportScope(uint32_t importScopeRid) const
+{
+    return ((importScopeRid == 0) || (importScopeRid > _importScopes.size())) ? 0 : _importScopes[importScopeRid - 1].parent;
+}
+
+std::string LocalScopeIndex::GetBlobString(uint32_t blobIndex) const
+{
+    // alias and namespace are UTF-8 strings stored in the #Blob heap
+    const uint8_t* data = nullptr;
+    uint32_t size = 0;
+    if ((blobIndex == 0) || !_metadata->GetBlob(blobIndex, data, size))
+    {
+        return "";
+    }
+
+    return std::string(reinterpret_cast<const char*>(data), size);
+}
+
+bool LocalScopeIndex::GetImports(uint32_t importScopeRid, std::vector<ImportInfo>& imports) const
+{
+    if ((_metadata == nullptr) || (importScopeRid == 0) || (importScopeRid > _importScopes.size()))
+    {
+        return false;
+    }
+
+    const uint8_t* blob = nullptr;
+    uint32_t blobSize = 0;
+    uint32_t blobIndex = _importScopes[importScopeRid - 1].importsBlob;
+    if (blobIndex == 0)
+    {
+        return true;
+    }
+    if (!_metadata->GetBlob(blobIndex, blob, blobSize))
+    {
+        return false;
+    }
+
+    // TypeDefOrRefOrSpecEncoded: the 2 lowest bits select the table
+    static const uint32_t TypeTables[] = { TableTypeDef, TableTypeRef, TableTypeSpec, 0 };
+
+    ByteReader reader(blob, blobSize);
+    while (reader.GetRemaining() > 0)
+    {
+        ImportInfo import;
+        import.assemblyRef = 0;
+        import.typeToken = 0;
+        if (!reader.ReadCompressedUInt(import.kind))
+        {
+            return false;
+        }
+
+        bool hasAlias = (import.kind >= ImportXmlNamespace);
+        bool hasAssembly = (import.kind == ImportAssemblyNamespace) || (import.kind == AliasAssemblyReference) || (import.kind == AliasAssemblyNamespace);
+        bool hasNamespace = (import.kind == ImportNamespace) || (import.kind == ImportAssemblyNamespace) || (import.kind == ImportXmlNamespace) ||
+            (import.kind == AliasNamespace) || (import.kind == AliasAssemblyNamespace);
+        bool hasType = (import.kind == ImportType) || (import.kind == AliasType);
+        if ((import.kind < ImportNamespace) || (import.kind > AliasType))
+        {
+            return false;
+        }
+
+        uint32_t value = 0;
+        if (hasAlias)
+        {
+            if (!reader.ReadCompressedUInt(value))
+            {
+                return false;
+            }
+            import.alias = GetBlobString(value);
+        }
+        if (hasAssembly)
+        {
+            if (!reader.ReadCompressedUInt(import.assemblyRef))
+            {
+                return false;
+            }
+        }
+        if (hasNamespace)
+        {
+            if (!reader.ReadCompressedUInt(value))
+            {
+                return false;
+            }
+            import.targetNamespace = GetBlobString(value);
+        }
+        if (hasType)
+        {
+            if (!reader.ReadCompressedUInt(value) || (TypeTables[value & 0x03] == 0))
+            {
+                return false;
+            }
+            import.typeToken = (TypeTables[value & 0x03] << 24) | (value >> 2);
+        }
+
+        imports.push_back(import);
+    }
+
+    return true;
+}
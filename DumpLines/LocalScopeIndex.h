@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "MetadataReader.h"
+
+// Local variable or constant visible at an IL offset
+struct LocalInfo
+{
+    const char* name;       // points into the #Strings heap of the PDB
+    bool isConstant;
+    uint16_t index;         // slot of the variable (0 for constants)
+    uint16_t attributes;    // 1 = DebuggerHidden
+    uint32_t scopeStart;    // IL range of the scope declaring the local
+    uint32_t scopeEnd;
+};
+
+enum ImportKind
+{
+    ImportNamespace = 1,
+    ImportAssemblyNamespace = 2,
+    ImportType = 3,
+    ImportXmlNamespace = 4,
+    ImportAssemblyReferenceAlias = 5,
+    AliasAssemblyReference = 6,
+    AliasNamespace = 7,
+    AliasAssemblyNamespace = 8,
+    AliasType = 9
+};
+
+struct ImportInfo
+{
+    uint32_t kind;
+    std::string alias;
+    std::string targetNamespace;
+    uint32_t assemblyRef;   // AssemblyRef rid (0 if none)
+    uint32_t typeToken;     // TypeDef, TypeRef or TypeSpec token (0 if none)
+};
+
+// Flat arrays decoded from the LocalScope, LocalVariable, LocalConstant and ImportScope tables
+// of a Portable PDB. Only the row values are copied when the index is built: names and import
+// blobs are decoded when they are queried. Scopes of a method are sorted by start offset
+// (outer scope first), so the scopes containing an IL offset are found by a binary search
+// followed by a walk up the parent scopes.
+class LocalScopeIndex
+{
+public:
+    LocalScopeIndex();
+
+    // The metadata must outlive the index
+    bool Build(const MetadataReader& pdbMetadata);
+
+    size_t GetScopeCount() const { return _scopes.size(); }
+
+    // Locals and constants in scope at the IL offset (innermost scope first)
+    bool GetLocals(uint32_t methodToken, uint32_t ilOffset, std::vector<LocalInfo>& locals) const;
+
+    // ImportScope rid of the innermost scope at the IL offset (0 if none)
+    uint32_t GetImportScope(uint32_t methodToken, uint32_t ilOffset) const;
+    uint32_t GetParentImportScope(uint32_t importScopeRid) const;
+
+    // Imports declared by the given scope only (not by its parents)
+    bool GetImports(uint32_t importScopeRid, std::vector<ImportInfo>& imports) const;
+
+private:
+    static const uint32_t NoScope = 0xFFFFFFFF;
+
+    struct Scope
+    {
+        uint32_t startOffset;
+        uint32_t endOffset;
+        uint32_t parent;        // index in _scopes (NoScope for the outermost scopes)
+        uint32_t importScope;
+        uint32_t firstVariable; // [first, end[ in _variables
+        uint32_t variableEnd;
+        uint32_t firstConstant; // [first, end[ in _constants
+        uint32_t constantEnd;
+    };
+
+    struct Variable
+    {
+        uint32_t nameOffset;
+        uint16_t index;
+        uint16_t attributes;
+    };
+
+    struct ImportScope
+    {
+        uint32_t parent;
+        uint32_t importsBlob;
+    };
+
+private:
+    // Innermost scope of the method starting at or before the IL offset (NoScope if none)
+    uint32_t FindLastScope(uint32_t methodRid, uint32_t ilOffset) const;
+    std::string GetBlobString(uint32_t blobIndex) const;
+
+private:
+    const MetadataReader* _metadata;
+
+    // scopes of method rid m are _scopes[_methodScopes[m] .. _methodScopes[m + 1][
+    std::vector<uint32_t> _methodScopes;
+    std::vector<Scope> _scopes;
+    std::vector<Variable> _variables;
+    std::vector<uint32_t> _constantNames;
+    std::vector<ImportScope> _importScopes;
+};
@@ -0,0 +1,80 @@
+#include "MappedFile.h"
+
+
+MappedFile::MappedFile()
+    :
+    _hFile(INVALID_HANDLE_VALUE),
+    _hMapping(NULL),
+    _pView(nullptr),
+    _size(0)
+{
+}
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+void MappedFile::Close()
+{
+    if (_pView != nullptr)
+    {
+        UnmapViewOfFile(_pView);
+        _pView = nullptr;
+    }
+    if (_hMapping != NULL)
+    {
+        CloseHandle(_hMapping);
+        _hMapping = NULL;
+    }
+    if (_hFile != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(_hFile);
+        _hFile = INVALID_HANDLE_VALUE;
+    }
+
+    _size = 0;
+}
+
+bool MappedFile::Open(const std::string& filePath)
+{
+    Close();
+
+    _hFile = CreateFileA(
+        filePath.c_str(),
+        GENERIC_READ,
+        FILE_SHARE_READ,
+        NULL,
+        OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL,
+        NULL
+    );
+    if (_hFile == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(_hFile, &size) || (size.QuadPart == 0))
+    {
+        Close();
+        return false;
+    }
+
+    _hMapping = CreateFileMappingA(_hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (_hMapping == NULL)
+    {
+        Close();
+        return false;
+    }
+
+    _pView = static_cast<const uint8_t*>(MapViewOfFile(_hMapping, FILE_MAP_READ, 0, 0, 0));
+    if (_pView == nullptr)
+    {
+        Close();
+        return false;
+    }
+
+    _size = static_cast<size_t>(size.QuadPart);
+    return true;
+}
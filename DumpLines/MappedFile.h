@@ -0,0 +1,30 @@
+#pragma once
+
+#include <windows.h>
+#include <cstdint>
+#include <string>
+
+// Read-only memory mapping of a whole file
+class MappedFile
+{
+public:
+    MappedFile();
+    ~MappedFile();
+
+    bool Open(const std::string& filePath);
+    void Close();
+
+    const uint8_t* GetData() const { return _pView; }
+    size_t GetSize() const { return _size; }
+    bool IsOpen() const { return _pView != nullptr; }
+
+private:
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+private:
+    HANDLE _hFile;
+    HANDLE _hMapping;
+    const uint8_t* _pView;
+    size_t _size;
+};
@@ -0,0 +1,608 @@
+#include "MetadataReader.h"
+#include "ByteReader.h"
+
+#include <cstring>
+
+const uint32_t MetadataSignature = 0x424A5342;  // BSJB
+
+// Column types of the table schemas
+const uint8_t ColEnd = 0;
+const uint8_t ColU16 = 1;
+const uint8_t ColU32 = 2;
+const uint8_t ColString = 3;
+const uint8_t ColGuid = 4;
+const uint8_t ColBlob = 5;
+const uint8_t ColTable = 0x40;  // | MetadataTable
+const uint8_t ColCoded = 0x80;  // | CodedIndex
+
+enum CodedIndex
+{
+    CodedTypeDefOrRef,
+    CodedHasConstant,
+    CodedHasCustomAttribute,
+    CodedHasFieldMarshal,
+    CodedHasDeclSecurity,
+    CodedMemberRefParent,
+    CodedHasSemantics,
+    CodedMethodDefOrRef,
+    CodedMemberForwarded,
+    CodedImplementation,
+    CodedCustomAttributeType,
+    CodedResolutionScope,
+    CodedTypeOrMethodDef,
+    CodedHasCustomDebugInformation,
+    CodedIndexCount
+};
+
+const uint8_t NoTable = 0xFF;
+
+struct CodedIndexInfo
+{
+    uint8_t tagBits;
+    uint8_t tables[27];
+};
+
+// ECMA-335 II.24.2.6 and Portable PDB specification
+static const CodedIndexInfo CodedIndexes[CodedIndexCount] =
+{
+    // TypeDefOrRef
+    { 2, { TableTypeDef, TableTypeRef, TableTypeSpec, NoTable } },
+    // HasConstant
+    { 2, { TableField, TableParam, TableProperty, NoTable } },
+    // HasCustomAttribute
+    { 5, { TableMethodDef, TableField, TableTypeRef, TableTypeDef, TableParam, TableInterfaceImpl, TableMemberRef,
+           TableModule, TableDeclSecurity, TableProperty, TableEvent, TableStandAloneSig, TableModuleRef, TableTypeSpec,
+           TableAssembly, TableAssemblyRef, TableFile, TableExportedType, TableManifestResource, TableGenericParam,
+           TableGenericParamConstraint, TableMethodSpec, NoTable } },
+    // HasFieldMarshal
+    { 1, { TableField, TableParam, NoTable } },
+    // HasDeclSecurity
+    { 2, { TableTypeDef, TableMethodDef, TableAssembly, NoTable } },
+    // MemberRefParent
+    { 3, { TableTypeDef, TableTypeRef, TableModuleRef, TableMethodDef, TableTypeSpec, NoTable } },
+    // HasSemantics
+    { 1, { TableEvent, TableProperty, NoTable } },
+    // MethodDefOrRef
+    { 1, { TableMethodDef, TableMemberRef, NoTable } },
+    // MemberForwarded
+    { 1, { TableField, TableMethodDef, NoTable } },
+    // Implementation
+    { 2, { TableFile, TableAssemblyRef, TableExportedType, NoTable } },
+    // CustomAttributeType (tags 0, 1 and 4 are not used)
+    { 3, { TableMethodDef, TableMemberRef, NoTable } },
+    // ResolutionScope
+    { 2, { TableModule, TableModuleRef, TableAssemblyRef, TableTypeRef, NoTable } },
+    // TypeOrMethodDef
+    { 1, { TableTypeDef, TableMethodDef, NoTable } },
+    // HasCustomDebugInformation
+    { 5, { TableMethodDef, TableField, TableTypeRef, TableTypeDef, TableParam, TableInterfaceImpl, TableMemberRef,
+           TableModule, TableDeclSecurity, TableProperty, TableEvent, TableStandAloneSig, TableModuleRef, TableTypeSpec,
+           TableAssembly, TableAssemblyRef, TableFile, TableExportedType, TableManifestResource, TableGenericParam,
+           TableGenericParamConstraint, TableMethodSpec, TableDocument, TableLocalScope, TableLocalVariable,
+           TableLocalConstant, TableImportScope } },
+};
+
+#define T(table) (ColTable | (table))
+#define C(coded) (ColCoded | (coded))
+
+static const uint8_t TableSchemas[TableCount][10] =
+{
+    /* 0x00 Module */                   { ColU16, ColString, ColGuid, ColGuid, ColGuid },
+    /* 0x01 TypeRef */                  { C(CodedResolutionScope), ColString, ColString },
+    /* 0x02 TypeDef */                  { ColU32, ColString, ColString, C(CodedTypeDefOrRef), T(TableField), T(TableMethodDef) },
+    /* 0x03 FieldPtr */                 { T(TableField) },
+    /* 0x04 Field */                    { ColU16, ColString, ColBlob },
+    /* 0x05 MethodPtr */                { T(TableMethodDef) },
+    /* 0x06 MethodDef */                { ColU32, ColU16, ColU16, ColString, ColBlob, T(TableParam) },
+    /* 0x07 ParamPtr */                 { T(TableParam) },
+    /* 0x08 Param */                    { ColU16, ColU16, ColString },
+    /* 0x09 InterfaceImpl */            { T(TableTypeDef), C(CodedTypeDefOrRef) },
+    /* 0x0A MemberRef */                { C(CodedMemberRefParent), ColString, ColBlob },
+    /* 0x0B Constant */                 { ColU16, C(CodedHasConstant), ColBlob },
+    /* 0x0C CustomAttribute */          { C(CodedHasCustomAttribute), C(CodedCustomAttributeType), ColBlob },
+    /* 0x0D FieldMarshal */             { C(CodedHasFieldMarshal), ColBlob },
+    /* 0x0E DeclSecurity */             { ColU16, C(CodedHasDeclSecurity), ColBlob },
+    /* 0x0F ClassLayout */              { ColU16, ColU32, T(TableTypeDef) },
+    /* 0x10 FieldLayout */              { ColU32, T(TableField) },
+    /* 0x11 StandAloneSig */            { ColBlob },
+    /* 0x12 EventMap */                 { T(TableTypeDef), T(TableEvent) },
+    /* 0x13 EventPtr */                 { T(TableEvent) },
+    /* 0x14 Event */                    { ColU16, ColString, C(CodedTypeDefOrRef) },
+    /* 0x15 PropertyMap */              { T(TableTypeDef), T(TableProperty) },
+    /* 0x16 PropertyPtr */              { T(TableProperty) },
+    /* 0x17 Property */                 { ColU16, ColString, ColBlob },
+    /* 0x18 MethodSemantics */          { ColU16, T(TableMethodDef), C(CodedHasSemantics) },
+    /* 0x19 MethodImpl */               { T(TableTypeDef), C(CodedMethodDefOrRef), C(CodedMethodDefOrRef) },
+    /* 0x1A ModuleRef */                { ColString },
+    /* 0x1B TypeSpec */                 { ColBlob },
+    /* 0x1C ImplMap */                  { ColU16, C(CodedMemberForwarded), ColString, T(TableModuleRef) },
+    /* 0x1D FieldRVA */                 { ColU32, T(TableField) },
+    /* 0x1E EncLog */                   { ColU32, ColU32 },
+    /* 0x1F EncMap */                   { ColU32 },
+    /* 0x20 Assembly */                 { ColU32, ColU16, ColU16, ColU16, ColU16, ColU32, ColBlob, ColString, ColString },
+    /* 0x21 AssemblyProcessor */        { ColU32 },
+    /* 0x22 AssemblyOS */               { ColU32, ColU32, ColU32 },
+    /* 0x23 AssemblyRef */              { ColU16, ColU16, ColU16, ColU16, ColU32, ColBlob, ColString, ColString, ColBlob },
+    /* 0x24 AssemblyRefProcessor */     { ColU32, T(TableAssemblyRef) },
+    /* 0x25 AssemblyRefOS */            { ColU32, ColU32, ColU32, T(TableAssemblyRef) },
+    /* 0x26 File */                     { ColU32, ColString, ColBlob },
+    /* 0x27 ExportedType */             { ColU32, ColU32, ColString, ColString, C(CodedImplementation) },
+    /* 0x28 ManifestResource */         { ColU32, ColU32, ColString, C(CodedImplementation) },
+    /* 0x29 NestedClass */              { T(TableTypeDef), T(TableTypeDef) },
+    /* 0x2A GenericParam */             { ColU16, ColU16, C(CodedTypeOrMethodDef), ColString },
+    /* 0x2B MethodSpec */               { C(CodedMethodDefOrRef), ColBlob },
+    /* 0x2C GenericParamConstraint */   { T(TableGenericParam), C(CodedTypeDefOrRef) },
+    /* 0x2D */ { ColEnd },
+    /* 0x2E */ { ColEnd },
+    /* 0x2F */ { ColEnd },
+    /* 0x30 Document */                 { ColBlob, ColGuid, ColBlob, ColGuid },
+    /* 0x31 MethodDebugInformation */   { T(TableDocument), ColBlob },
+    /* 0x32 LocalScope */               { T(TableMethodDef), T(TableImportScope), T(TableLocalVariable), T(TableLocalConstant), ColU32, ColU32 },
+    /* 0x33 LocalVariable */            { ColU16, ColU16, ColString },
+    /* 0x34 LocalConstant */            { ColString, ColBlob },
+    /* 0x35 ImportScope */              { T(TableImportScope), ColBlob },
+    /* 0x36 StateMachineMethod */       { T(TableMethodDef), T(TableMethodDef) },
+    /* 0x37 CustomDebugInformation */   { C(CodedHasCustomDebugInformation), ColGuid, ColBlob },
+};
+
+#undef T
+#undef C
+
+
+MetadataReader::MetadataReader()
+    :
+    _strings({ nullptr, 0 }),
+    _blobs({ nullptr, 0 }),
+    _guids({ nullptr, 0 }),
+    _pdbStream(nullptr),
+    _entryPoint(0)
+{
+    memset(_tables, 0, sizeof(_tables));
+    memset(_indexRowCounts, 0, sizeof(_indexRowCounts));
+}
+
+bool MetadataReader::Open(const uint8_t* data, size_t size)
+{
+    // metadata root: signature, versions, version string, flags and stream headers
+    ByteReader reader(data, size);
+    uint32_t signature = 0;
+    uint32_t versionLength = 0;
+    if (!reader.Read(signature) || (signature != MetadataSignature) ||
+        !reader.Skip(2 * sizeof(uint16_t) + sizeof(uint32_t)) ||
+        !reader.Read(versionLength) || !reader.Skip(versionLength))
+    {
+        return false;
+    }
+
+    uint16_t flags = 0;
+    uint16_t streamCount = 0;
+    if (!reader.Read(flags) || !reader.Read(streamCount))
+    {
+        return false;
+    }
+
+    const uint8_t* tablesStream = nullptr;
+    uint32_t tablesStreamSize = 0;
+    uint32_t pdbStreamSize = 0;
+    for (uint16_t i = 0; i < streamCount; i++)
+    {
+        uint32_t offset = 0;
+        uint32_t streamSize = 0;
+        const char* name = nullptr;
+        if (!reader.Read(offset) || !reader.Read(streamSize) || !reader.ReadCString(name) || !reader.Align(4))
+        {
+            return false;
+        }
+
+        if ((offset > size) || (streamSize > size - offset))
+        {
+            return false;
+        }
+
+        const uint8_t* streamData = data + offset;
+        if ((strcmp(name, "#~") == 0) || (strcmp(name, "#-") == 0))
+        {
+            tablesStream = streamData;
+            tablesStreamSize = streamSize;
+        }
+        else
+        if (strcmp(name, "#Strings") == 0)
+        {
+            _strings = { streamData, streamSize };
+        }
+        else
+        if (strcmp(name, "#Blob") == 0)
+        {
+            _blobs = { streamData, streamSize };
+        }
+        else
+        if (strcmp(name, "#GUID") == 0)
+        {
+            _guids = { streamData, streamSize };
+        }
+        else
+        if (strcmp(name, "#Pdb") == 0)
+        {
+            _pdbStream = streamData;
+            pdbStreamSize = streamSize;
+        }
+    }
+
+    if (tablesStream == nullptr)
+    {
+        return false;
+    }
+
+    // the #Pdb stream must be read first because it contains the row counts of the assembly tables
+    if ((_pdbStream != nullptr) && !ReadPdbStream(_pdbStream, pdbStreamSize))
+    {
+        return false;
+    }
+
+    return ReadTablesStream(tablesStream, tablesStreamSize);
+}
+
+bool MetadataReader::ReadPdbStream(const uint8_t* data, uint32_t size)
+{
+    // PdbId (20 bytes), EntryPoint, ReferencedTypeSystemTables and their row counts
+    ByteReader reader(data, size);
+    uint64_t referencedTables = 0;
+    if (!reader.Skip(20) || !reader.Read(_entryPoint) || !reader.Read(referencedTables))
+    {
+        return false;
+    }
+
+    for (uint32_t table = 0; table < 64; table++)
+    {
+        if ((referencedTables & (1ull << table)) == 0)
+        {
+            continue;
+        }
+
+        uint32_t rowCount = 0;
+        if (!reader.Read(rowCount))
+        {
+            return false;
+        }
+
+        if (table < TableCount)
+        {
+            _indexRowCounts[table] = rowCount;
+        }
+    }
+
+    return true;
+}
+
+bool MetadataReader::ReadTablesStream(const uint8_t* data, uint32_t size)
+{
+    ByteReader reader(data, size);
+    uint8_t heapSizes = 0;
+    uint64_t validTables = 0;
+    uint64_t sortedTables = 0;
+    if (!reader.Skip(sizeof(uint32_t) + 2 * sizeof(uint8_t)) ||
+        !reader.Read(heapSizes) ||
+        !reader.Skip(sizeof(uint8_t)) ||
+        !reader.Read(validTables) ||
+        !reader.Read(sortedTables))
+    {
+        return false;
+    }
+
+    for (uint32_t table = 0; table < 64; table++)
+    {
+        if ((validTables & (1ull << table)) == 0)
+        {
+            continue;
+        }
+
+        uint32_t rowCount = 0;
+        if (!reader.Read(rowCount) || (table >= TableCount) || (TableSchemas[table][0] == ColEnd))
+        {
+            return false;
+        }
+
+        _tables[table].rowCount = rowCount;
+        if (rowCount != 0)
+        {
+            _indexRowCounts[table] = rowCount;
+        }
+    }
+
+    // extra data flag
+    if ((heapSizes & 0x40) != 0)
+    {
+        reader.Skip(sizeof(uint32_t));
+    }
+
+    // compute the layout of each table: rows are stored one table after the other
+    const uint8_t* rows = reader.GetCurrent();
+    const uint8_t* end = data + size;
+    for (uint32_t table = 0; table < TableCount; table++)
+    {
+        TableInfo& info = _tables[table];
+        uint32_t rowSize = 0;
+        for (uint8_t column = 0; (column < MaxColumns) && (TableSchemas[table][column] != ColEnd); column++)
+        {
+            uint8_t columnSize = GetColumnSize(TableSchemas[table][column], heapSizes);
+            info.columnOffsets[column] = static_cast<uint8_t>(rowSize);
+            info.columnSizes[column] = columnSize;
+            info.columnCount = column + 1;
+            rowSize += columnSize;
+        }
+        info.rowSize = rowSize;
+
+        if (info.rowCount == 0)
+        {
+            continue;
+        }
+
+        uint64_t tableSize = static_cast<uint64_t>(rowSize) * info.rowCount;
+        if (tableSize > static_cast<uint64_t>(end - rows))
+        {
+            return false;
+        }
+
+        info.rows = rows;
+        rows += tableSize;
+    }
+
+    return true;
+}
+
+uint8_t MetadataReader::GetColumnSize(uint8_t columnType, uint8_t heapSizes) const
+{
+    if ((columnType & ColCoded) != 0)
+    {
+        // 2 bytes if all the referenced tables have less than 2^(16 - tag bits) rows
+        const CodedIndexInfo& coded = CodedIndexes[columnType & ~ColCoded];
+        uint32_t maxRows = 0;
+        for (uint8_t table : coded.tables)
+        {
+            if (table == NoTable)
+            {
+                break;
+            }
+
+            if (_indexRowCounts[table] > maxRows)
+            {
+                maxRows = _indexRowCounts[table];
+            }
+        }
+
+        return (maxRows < (1u << (16 - coded.tagBits))) ? 2 : 4;
+    }
+
+    if ((columnType & ColTable) != 0)
+    {
+        return (_indexRowCounts[columnType & ~ColTable] < 0x10000) ? 2 : 4;
+    }
+
+    switch (columnType)
+    {
+        case ColU16:
+            return 2;
+        case ColU32:
+            return 4;
+        case ColString:
+            return ((heapSizes & 0x01) != 0) ? 4 : 2;
+        case ColGuid:
+            return ((heapSizes & 0x02) != 0) ? 4 : 2;
+        case ColBlob:
+            return ((heapSizes & 0x04) != 0) ? 4 : 2;
+    }
+
+    return 0;
+}
+
+uint32_t MetadataReader::GetValue(MetadataTable table, uint32_t rid, uint32_t column) const
+{
+    const TableInfo& info = _tables[table];
+    if ((rid == 0) || (rid > info.rowCount) || (column >= info.columnCount))
+    {
+        return 0;
+    }
+
+    const uint8_t* p = info.rows + static_cast<size_t>(rid - 1) * info.rowSize + info.columnOffsets[column];
+    if (info.columnSizes[column] == 2)
+    {
+        return p[0] | (p[1] << 8);
+    }
+
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+const char* MetadataReader::GetString(uint32_t offset) const
+{
+    if (offset >= _strings.size)
+    {
+        return "";
+    }
+
+    // make sure the string is terminated inside the heap
+    const char* str = reinterpret_cast<const char*>(_strings.data + offset);
+    if (memchr(str, 0, _strings.size - offset) == nullptr)
+    {
+        return "";
+    }
+
+    return str;
+}
+
+bool MetadataReader::GetBlob(uint32_t offset, const uint8_t*& data, uint32_t& size) const
+{
+    if (offset >= _blobs.size)
+    {
+        return false;
+    }
+
+    ByteReader reader(_blobs.data + offset, _blobs.size - offset);
+    if (!reader.ReadCompressedUInt(size) || (size > reader.GetRemaining()))
+    {
+        return false;
+    }
+
+    data = reader.GetCurrent();
+    return true;
+}
+
+const uint8_t* MetadataReader::GetGuid(uint32_t index) const
+{
+    if ((index == 0) || (static_cast<uint64_t>(index) * 16 > _guids.size))
+    {
+        return nullptr;
+    }
+
+    return _guids.data + (index - 1) * 16;
+}
+
+uint32_t MetadataReader::GetListEnd(MetadataTable table, uint32_t rid, uint32_t column, MetadataTable listTable) const
+{
+    if (rid < GetRowCount(table))
+    {
+        return GetValue(table, rid + 1, column) - 1;
+    }
+
+    return GetRowCount(listTable);
+}
+
+uint32_t MetadataReader::GetMethodDeclaringType(uint32_t methodRid) const
+{
+    // MethodList is sorted: find the last type whose list starts before the method
+    uint32_t low = 1;
+    uint32_t high = GetRowCount(TableTypeDef);
+    uint32_t found = 0;
+    while (low <= high)
+    {
+        uint32_t middle = low + (high - low) / 2;
+        uint32_t firstMethod = GetValue(TableTypeDef, middle, TypeDef_MethodList);
+        if (firstMethod <= methodRid)
+        {
+            found = middle;
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle - 1;
+        }
+    }
+
+    // types without methods have the same MethodList as the next type: keep the last one
+    return found;
+}
+
+uint32_t MetadataReader::GetEnclosingType(uint32_t typeRid) const
+{
+    // NestedClass is sorted by its NestedClass column
+    uint32_t low = 1;
+    uint32_t high = GetRowCount(TableNestedClass);
+    while (low <= high)
+    {
+        uint32_t middle = low + (high - low) / 2;
+        uint32_t nestedRid = GetValue(TableNestedClass, middle, NestedClass_NestedClass);
+        if (nestedRid == typeRid)
+        {
+            return GetValue(TableNestedClass, middle, NestedClass_EnclosingClass);
+        }
+
+        if (nestedRid < typeRid)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle - 1;
+        }
+    }
+
+    return 0;
+}
+
+uint32_t MetadataReader::GetOutermostType(uint32_t typeRid) const
+{
+    // the nesting depth is bounded to survive a corrupted NestedClass table
+    for (int depth = 0; depth < 64; depth++)
+    {
+        uint32_t enclosingRid = GetEnclosingType(typeRid);
+        if ((enclosingRid == 0) || (enclosingRid == typeRid))
+        {
+            break;
+        }
+        typeRid = enclosingRid;
+    }
+    return typeRid;
+}
+
+std::string MetadataReader::GetQualifiedTypeName(uint32_t typeRid) const
+{
+    // only the outermost type has a namespace; the nesting depth is bounded to survive
+    // a corrupted NestedClass table
+    std::string name = GetString(GetValue(TableTypeDef, typeRid, TypeDef_TypeName));
+    for (int depth = 0; depth < 64; depth++)
+    {
+        uint32_t enclosingRid = GetEnclosingType(typeRid);
+        if ((enclosingRid == 0) || (enclosingRid == typeRid))
+        {
+            break;
+        }
+
+        typeRid = enclosingRid;
+        name.insert(0, 1, '/');
+        name.insert(0, GetString(GetValue(TableTypeDef, typeRid, TypeDef_TypeName)));
+    }
+
+    const char* typeNamespace = GetString(GetValue(TableTypeDef, typeRid, TypeDef_TypeNamespace));
+    if (*typeNamespace != '\0')
+    {
+        name.insert(0, 1, '.');
+        name.insert(0, typeNamespace);
+    }
+    return name;
+}
+
+std::string MetadataReader::GetTypeName(uint32_t token) const
+{
+    uint32_t rid = RidFromToken(token);
+    if (TableFromToken(token) == TableTypeDef)
+    {
+        return ((rid == 0) || (rid > GetRowCount(TableTypeDef))) ? "" : GetQualifiedTypeName(rid);
+    }
+    if ((TableFromToken(token) != TableTypeRef) || (rid == 0) || (rid > GetRowCount(TableTypeRef)))
+    {
+        return "";
+    }
+
+    // the resolution scope of a nested type reference is the reference to its enclosing type
+    const uint32_t ResolutionScopeTypeRef = 3;
+    std::string name = GetString(GetValue(TableTypeRef, rid, TypeRef_TypeName));
+    for (int depth = 0; depth < 64; depth++)
+    {
+        uint32_t scope = GetValue(TableTypeRef, rid, TypeRef_ResolutionScope);
+        if (((scope & 0x03) != ResolutionScopeTypeRef) || ((scope >> 2) == rid) || ((scope >> 2) == 0))
+        {
+            break;
+        }
+
+        rid = scope >> 2;
+        name.insert(0, 1, '/');
+        name.insert(0, GetString(GetValue(TableTypeRef, rid, TypeRef_TypeName)));
+    }
+
+    const char* typeNamespace = GetString(GetValue(TableTypeRef, rid, TypeRef_TypeNamespace));
+    if (*typeNamespace != '\0')
+    {
+        name.insert(0, 1, '.');
+        name.insert(0, typeNamespace);
+    }
+    return name;
+}
+
+std::string MetadataReader::GetQualifiedMethodName(uint32_t methodRid) const
+{
+    std::string name = GetQualifiedTypeName(GetMethodDeclaringType(methodRid));
+    name += "::";
+    name += GetString(GetValue(TableMethodDef, methodRid, MethodDef_Name));
+    return name;
+}
@@ -0,0 +1,173 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+// ECMA-335 metadata tables (0x30 and above are the Portable PDB debug tables)
+enum MetadataTable
+{
+    TableModule = 0x00,
+    TableTypeRef = 0x01,
+    TableTypeDef = 0x02,
+    TableFieldPtr = 0x03,
+    TableField = 0x04,
+    TableMethodPtr = 0x05,
+    TableMethodDef = 0x06,
+    TableParamPtr = 0x07,
+    TableParam = 0x08,
+    TableInterfaceImpl = 0x09,
+    TableMemberRef = 0x0A,
+    TableConstant = 0x0B,
+    TableCustomAttribute = 0x0C,
+    TableFieldMarshal = 0x0D,
+    TableDeclSecurity = 0x0E,
+    TableClassLayout = 0x0F,
+    TableFieldLayout = 0x10,
+    TableStandAloneSig = 0x11,
+    TableEventMap = 0x12,
+    TableEventPtr = 0x13,
+    TableEvent = 0x14,
+    TablePropertyMap = 0x15,
+    TablePropertyPtr = 0x16,
+    TableProperty = 0x17,
+    TableMethodSemantics = 0x18,
+    TableMethodImpl = 0x19,
+    TableModuleRef = 0x1A,
+    TableTypeSpec = 0x1B,
+    TableImplMap = 0x1C,
+    TableFieldRva = 0x1D,
+    TableEncLog = 0x1E,
+    TableEncMap = 0x1F,
+    TableAssembly = 0x20,
+    TableAssemblyProcessor = 0x21,
+    TableAssemblyOS = 0x22,
+    TableAssemblyRef = 0x23,
+    TableAssemblyRefProcessor = 0x24,
+    TableAssemblyRefOS = 0x25,
+    TableFile = 0x26,
+    TableExportedType = 0x27,
+    TableManifestResource = 0x28,
+    TableNestedClass = 0x29,
+    TableGenericParam = 0x2A,
+    TableMethodSpec = 0x2B,
+    TableGenericParamConstraint = 0x2C,
+
+    TableDocument = 0x30,
+    TableMethodDebugInformation = 0x31,
+    TableLocalScope = 0x32,
+    TableLocalVariable = 0x33,
+    TableLocalConstant = 0x34,
+    TableImportScope = 0x35,
+    TableStateMachineMethod = 0x36,
+    TableCustomDebugInformation = 0x37,
+
+    TableCount = 0x40
+};
+
+// Column indexes of the tables used by DumpLines
+enum TypeRefColumn { TypeRef_ResolutionScope, TypeRef_TypeName, TypeRef_TypeNamespace };
+enum TypeDefColumn { TypeDef_Flags, TypeDef_TypeName, TypeDef_TypeNamespace, TypeDef_Extends, TypeDef_FieldList, TypeDef_MethodList };
+enum MethodDefColumn { MethodDef_Rva, MethodDef_ImplFlags, MethodDef_Flags, MethodDef_Name, MethodDef_Signature, MethodDef_ParamList };
+enum TypeSpecColumn { TypeSpec_Signature };
+enum NestedClassColumn { NestedClass_NestedClass, NestedClass_EnclosingClass };
+enum DocumentColumn { Document_Name, Document_HashAlgorithm, Document_Hash, Document_Language };
+enum MethodDebugInformationColumn { MethodDebugInformation_Document, MethodDebugInformation_SequencePoints };
+enum LocalScopeColumn { LocalScope_Method, LocalScope_ImportScope, LocalScope_VariableList, LocalScope_ConstantList, LocalScope_StartOffset, LocalScope_Length };
+enum LocalVariableColumn { LocalVariable_Attributes, LocalVariable_Index, LocalVariable_Name };
+enum LocalConstantColumn { LocalConstant_Name, LocalConstant_Signature };
+enum ImportScopeColumn { ImportScope_Parent, ImportScope_Imports };
+enum StateMachineMethodColumn { StateMachineMethod_MoveNextMethod, StateMachineMethod_KickoffMethod };
+enum CustomDebugInformationColumn { CustomDebugInformation_Parent, CustomDebugInformation_Kind, CustomDebugInformation_Value };
+
+const uint32_t MethodDefTokenType = 0x06000000;
+
+inline uint32_t RidFromToken(uint32_t token) { return token & 0x00FFFFFF; }
+inline uint32_t TableFromToken(uint32_t token) { return token >> 24; }
+
+// Reader of ECMA-335 metadata (BSJB root): used both for the metadata of managed
+// assemblies and for Portable PDB files that share the same physical format.
+// The reader works on memory owned by the caller and never copies the tables.
+class MetadataReader
+{
+public:
+    MetadataReader();
+
+    bool Open(const uint8_t* data, size_t size);
+
+    // Portable PDB files have a #Pdb stream
+    bool IsPortablePdb() const { return _pdbStream != nullptr; }
+    const uint8_t* GetPdbId() const { return _pdbStream; }  // 20 bytes: GUID + stamp
+    uint32_t GetEntryPoint() const { return _entryPoint; }
+
+    uint32_t GetRowCount(MetadataTable table) const { return _tables[table].rowCount; }
+
+    // rid is 1-based; return 0 for invalid rows or columns
+    uint32_t GetValue(MetadataTable table, uint32_t rid, uint32_t column) const;
+
+    // Return "" for invalid offsets
+    const char* GetString(uint32_t offset) const;
+    bool GetBlob(uint32_t offset, const uint8_t*& data, uint32_t& size) const;
+    // index is 1-based; return nullptr for the null GUID
+    const uint8_t* GetGuid(uint32_t index) const;
+
+    // Return the rid of the TypeDef that owns the given MethodDef rid (0 if not found)
+    uint32_t GetMethodDeclaringType(uint32_t methodRid) const;
+
+    // Return the rid of the TypeDef enclosing a nested type (0 for top level types)
+    uint32_t GetEnclosingType(uint32_t typeRid) const;
+
+    // Return the rid of the top level type of a nested type (the type itself if not nested):
+    // only this one has a namespace
+    uint32_t GetOutermostType(uint32_t typeRid) const;
+
+    // namespace.Outer/Nested
+    std::string GetQualifiedTypeName(uint32_t typeRid) const;
+
+    // namespace.Outer/Nested of a TypeDef or TypeRef token ("" for the other tokens)
+    std::string GetTypeName(uint32_t token) const;
+
+    // namespace.Outer/Nested::Method
+    std::string GetQualifiedMethodName(uint32_t methodRid) const;
+
+    // Return the rid of the last element of a list column: the list of row rid
+    // ends where the list of the next row starts
+    uint32_t GetListEnd(MetadataTable table, uint32_t rid, uint32_t column, MetadataTable listTable) const;
+
+private:
+    static const uint32_t MaxColumns = 9;
+
+    struct TableInfo
+    {
+        uint32_t rowCount;
+        uint32_t rowSize;
+        const uint8_t* rows;
+        uint8_t columnCount;
+        uint8_t columnOffsets[MaxColumns];
+        uint8_t columnSizes[MaxColumns];
+    };
+
+    struct HeapInfo
+    {
+        const uint8_t* data;
+        uint32_t size;
+    };
+
+private:
+    bool ReadPdbStream(const uint8_t* data, uint32_t size);
+    bool ReadTablesStream(const uint8_t* data, uint32_t size);
+    uint8_t GetColumnSize(uint8_t columnType, uint8_t heapSizes) const;
+
+private:
+    TableInfo _tables[TableCount];
+
+    // row counts used to compute the size of indexes: for Portable PDB, the type system
+    // tables are in the assembly and their row counts are stored in the #Pdb stream
+    uint32_t _indexRowCounts[TableCount];
+
+    HeapInfo _strings;
+    HeapInfo _blobs;
+    HeapInfo _guids;
+    const uint8_t* _pdbStream;
+    uint32_t _entryPoint;
+};
@@ -0,0 +1,141 @@
+#include "MethodFilter.h"
+#include "Wildcard.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+
+
+static std::string ToLower(const std::string& text)
+{
+    std::string lower = text;
+    std::transform(lower.begin(), lower.end(), lower.begin(),
+        [](char c) { return static_cast<char>(tolower(static_cast<unsigned char>(c))); });
+    return lower;
+}
+
+
+MethodFilter::MethodFilter()
+    :
+    _firstLine(0),
+    _lastLine(0)
+{
+}
+
+bool MethodFilter::Add(const std::string& predicate)
+{
+    size_t separator = predicate.find('=');
+    if ((separator == std::string::npos) || (separator + 1 == predicate.size()))
+    {
+        return false;
+    }
+
+    std::string key = predicate.substr(0, separator);
+    std::string value = predicate.substr(separator + 1);
+    if (key == "name")
+    {
+        _name = value;
+    }
+    else
+    if (key == "type")
+    {
+        _type = value;
+    }
+    else
+    if (key == "namespace")
+    {
+        _namespace = value;
+    }
+    else
+    if (key == "file")
+    {
+        _document = ToLower(value);
+    }
+    else
+    if (key == "lines")
+    {
+        // <line> or <first>-<last>
+        char* next = nullptr;
+        _firstLine = static_cast<uint32_t>(strtoul(value.c_str(), &next, 10));
+        _lastLine = (*next == '-') ? static_cast<uint32_t>(strtoul(next + 1, &next, 10)) : _firstLine;
+        if ((*next != '\0') || (_lastLine == 0) || (_firstLine > _lastLine))
+        {
+            _lastLine = 0;
+            return false;
+        }
+    }
+    else
+    {
+        return false;
+    }
+
+    return true;
+}
+
+bool MethodFilter::IsEmpty() const
+{
+    return !HasNamePredicate() && !HasTypePredicate() && !HasDocumentPredicate() && !HasLineRange();
+}
+
+bool MethodFilter::MatchName(const char* name) const
+{
+    return _name.empty() || MatchWildcard(_name.c_str(), name);
+}
+
+bool MethodFilter::MatchType(const char* typeNamespace, const char* typeName) const
+{
+    return (_type.empty() || MatchWildcard(_type.c_str(), typeName)) &&
+        (_namespace.empty() || MatchWildcard(_namespace.c_str(), typeNamespace));
+}
+
+bool MethodFilter::MatchDocument(const std::string& path) const
+{
+    return _document.empty() || MatchWildcard(_document.c_str(), ToLower(path).c_str());
+}
+
+bool MethodFilter::MatchLine(uint32_t line) const
+{
+    return (_lastLine == 0) || ((line >= _firstLine) && (line <= _lastLine));
+}
+
+bool MethodFilter::MatchWithoutLines(const MethodInfo& method) const
+{
+    // namespace.Type::Method (managed) or namespace::Type::Method (native)
+    std::string name = method.name;
+    std::string typeNamespace;
+    std::string typeName;
+    size_t separator = name.rfind("::");
+    if (separator != std::string::npos)
+    {
+        std::string type = name.substr(0, separator);
+        name = name.substr(separator + 2);
+
+        size_t typeSeparator = type.rfind("::");
+        size_t separatorSize = 2;
+        if (typeSeparator == std::string::npos)
+        {
+            typeSeparator = type.rfind('.');
+            separatorSize = 1;
+        }
+
+        if (typeSeparator != std::string::npos)
+        {
+            typeNamespace = type.substr(0, typeSeparator);
+            typeName = type.substr(typeSeparator + separatorSize);
+        }
+        else
+        {
+            typeName = type;
+        }
+    }
+    else
+    if (HasTypePredicate())
+    {
+        // the type is unknown
+        return false;
+    }
+
+    return MatchName(name.c_str()) &&
+        MatchType(typeNamespace.c_str(), typeName.c_str()) &&
+        MatchDocument(method.sourceFile);
+}
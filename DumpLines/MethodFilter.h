@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include "PdbCommon.h"
+
+// Predicates given with --filter <key>=<value> (all of them must match):
+//    name=<pattern>        method name (without the type)
+//    type=<pattern>        name of the declaring type (without the namespace)
+//    namespace=<pattern>   namespace of the declaring type (of the outermost type for nested types)
+//    file=<pattern>        path of a source file of the method (case insensitive)
+//    lines=<first>-<last>  at least one sequence point starts in this range of lines
+// Patterns accept * and ? wildcards.
+class MethodFilter
+{
+public:
+    MethodFilter();
+
+    // Return false if the predicate is not valid
+    bool Add(const std::string& predicate);
+
+    bool IsEmpty() const;
+    bool HasNamePredicate() const { return !_name.empty(); }
+    bool HasTypePredicate() const { return !_type.empty() || !_namespace.empty(); }
+    bool HasDocumentPredicate() const { return !_document.empty(); }
+    bool HasLineRange() const { return _lastLine != 0; }
+
+    bool MatchName(const char* name) const;
+    bool MatchType(const char* typeNamespace, const char* typeName) const;
+    bool MatchDocument(const std::string& path) const;
+    bool MatchLine(uint32_t line) const;
+
+    // For the backends that only give a method name (possibly qualified with the type)
+    // and the start location: used after the enumeration. lines= is not checked: the start
+    // line is not enough, the caller checks MatchLine on all the lines of the method
+    bool MatchWithoutLines(const MethodInfo& method) const;
+
+private:
+    std::string _name;
+    std::string _type;
+    std::string _namespace;
+    std::string _document;  // lowercase
+    uint32_t _firstLine;
+    uint32_t _lastLine;
+};
@@ -0,0 +1,106 @@
+#include "MethodNameIndex.h"
+#include "Wildcard.h"
+
+#include <algorithm>
+#include <cstring>
+
+
+MethodNameIndex::MethodNameIndex()
+    :
+    _pMetadata(nullptr),
+    _bucketMask(0)
+{
+}
+
+uint32_t MethodNameIndex::Hash(const char* name)
+{
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for (const uint8_t* p = reinterpret_cast<const uint8_t*>(name); *p != 0; p++)
+    {
+        hash ^= *p;
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+const char* MethodNameIndex::GetName(uint32_t rid) const
+{
+    return _pMetadata->GetString(_pMetadata->GetValue(TableMethodDef, rid, MethodDef_Name));
+}
+
+void MethodNameIndex::Build(const MetadataReader& metadata)
+{
+    _pMetadata = &metadata;
+
+    uint32_t methodCount = metadata.GetRowCount(TableMethodDef);
+
+    // power of 2 number of buckets with a load factor <= 0.5
+    uint32_t bucketCount = 16;
+    while (bucketCount < methodCount * 2)
+    {
+        bucketCount *= 2;
+    }
+    _bucketMask = bucketCount - 1;
+    _buckets.assign(bucketCount, 0);
+    _next.assign(methodCount + 1, 0);
+    _sorted.resize(methodCount);
+
+    // insert in reverse order so that chains are sorted by rid
+    for (uint32_t rid = methodCount; rid > 0; rid--)
+    {
+        uint32_t bucket = Hash(GetName(rid)) & _bucketMask;
+        _next[rid] = _buckets[bucket];
+        _buckets[bucket] = rid;
+        _sorted[rid - 1] = rid;
+    }
+
+    std::sort(_sorted.begin(), _sorted.end(),
+        [this](uint32_t a, uint32_t b)
+        {
+            int result = strcmp(GetName(a), GetName(b));
+            return (result != 0) ? (result < 0) : (a < b);
+        });
+}
+
+void MethodNameIndex::FindExact(const char* name, std::vector<uint32_t>& tokens) const
+{
+    if (_buckets.empty())
+    {
+        return;
+    }
+
+    for (uint32_t rid = _buckets[Hash(name) & _bucketMask]; rid != 0; rid = _next[rid])
+    {
+        if (strcmp(GetName(rid), name) == 0)
+        {
+            tokens.push_back(MethodDefTokenType | rid);
+        }
+    }
+}
+
+void MethodNameIndex::FindWildcard(const char* pattern, std::vector<uint32_t>& tokens) const
+{
+    // only the names starting with the literal prefix of the pattern need to be checked
+    size_t prefixLength = GetWildcardPrefixLength(pattern);
+    auto first = std::lower_bound(_sorted.begin(), _sorted.end(), pattern,
+        [this, prefixLength](uint32_t rid, const char* prefix)
+        {
+            return strncmp(GetName(rid), prefix, prefixLength) < 0;
+        });
+
+    for (auto it = first; it != _sorted.end(); ++it)
+    {
+        const char* name = GetName(*it);
+        if (strncmp(name, pattern, prefixLength) != 0)
+        {
+            break;
+        }
+
+        if (MatchWildcard(pattern, name))
+        {
+            tokens.push_back(MethodDefTokenType | *it);
+        }
+    }
+}
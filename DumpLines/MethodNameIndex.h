@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "MetadataReader.h"
+
+// Name lookup over the MethodDef table of a managed assembly.
+// Method names are never copied: both the hash table and the sorted index refer to
+// rows whose names are read in place from the #Strings heap.
+class MethodNameIndex
+{
+public:
+    MethodNameIndex();
+
+    void Build(const MetadataReader& metadata);
+
+    // Return the MethodDef tokens of the matching methods
+    void FindExact(const char* name, std::vector<uint32_t>& tokens) const;
+    void FindWildcard(const char* pattern, std::vector<uint32_t>& tokens) const;
+
+private:
+    const char* GetName(uint32_t rid) const;
+    static uint32_t Hash(const char* name);
+
+private:
+    const MetadataReader* _pMetadata;
+
+    // chained hash table: _buckets[hash & _bucketMask] is the first rid of the chain
+    // and _next[rid] the next rid with the same bucket (0 ends the chain)
+    std::vector<uint32_t> _buckets;
+    std::vector<uint32_t> _next;
+    uint32_t _bucketMask;
+
+    // rids sorted by method name for prefix/wildcard lookups
+    std::vector<uint32_t> _sorted;
+};
@@ -0,0 +1,330 @@
+#include "ModuleSnapshot.h"
+#include "MsfFile.h"
+#include "PdbInfoStream.h"
+#include "DbiParser.h"
+#include "GsiNameIndex.h"
+#include "MappedFile.h"
+#include "MetadataReader.h"
+#include "PortablePdbParser.h"
+
+#include <algorithm>
+
+
+bool ReadPdbKey(const std::string& pdbFilePath, PdbKey& key)
+{
+    memset(&key, 0, sizeof(key));
+
+    if (PortablePdbParser::IsPortablePdb(pdbFilePath))
+    {
+        MappedFile file;
+        MetadataReader metadata;
+        if (!file.Open(pdbFilePath) || !metadata.Open(file.GetData(), file.GetSize()) || !metadata.IsPortablePdb())
+        {
+            return false;
+        }
+
+        memcpy(key.guid, metadata.GetPdbId(), sizeof(key.guid));
+        key.age = 1;
+        return true;
+    }
+
+    MsfFile msf;
+    PdbInfoStream info;
+    if (!msf.Open(pdbFilePath) || !info.Read(msf))
+    {
+        return false;
+    }
+
+    memcpy(key.guid, info.GetGuid(), sizeof(key.guid));
+    key.age = info.GetAge();
+    return true;
+}
+
+ModuleSnapshot::ModuleSnapshot()
+    :
+    _isManaged(false)
+{
+    memset(&_key, 0, sizeof(_key));
+}
+
+std::shared_ptr<const ModuleSnapshot> ModuleSnapshot::Load(const std::string& pdbFilePath)
+{
+    std::shared_ptr<ModuleSnapshot> snapshot(new ModuleSnapshot());
+    snapshot->_pdbFilePath = pdbFilePath;
+    snapshot->_isManaged = PortablePdbParser::IsPortablePdb(pdbFilePath);
+
+    bool loaded = snapshot->_isManaged ? snapshot->LoadPortablePdb() : snapshot->LoadWindowsPdb();
+    if (!loaded)
+    {
+        return nullptr;
+    }
+
+    return snapshot;
+}
+
+uint32_t ModuleSnapshot::AddName(const std::string& name)
+{
+    uint32_t offset = static_cast<uint32_t>(_names.size());
+    _names.insert(_names.end(), name.begin(), name.end());
+    _names.push_back('\0');
+    return offset;
+}
+
+bool ModuleSnapshot::LoadWindowsPdb()
+{
+    MsfFile msf;
+    if (!msf.Open(_pdbFilePath))
+    {
+        return false;
+    }
+
+    PdbInfoStream info;
+    DbiParser dbi(msf);
+    if (!info.Read(msf) || !dbi.Read())
+    {
+        return false;
+    }
+
+    memcpy(_key.guid, info.GetGuid(), sizeof(_key.guid));
+    _key.age = info.GetAge();
+
+    // a PDB without line information can still give function names
+    dbi.BuildLineTable(_lines);
+
+    std::vector<SymbolMatch> symbols;
+    GsiNameIndex publics(msf);
+    if (publics.Read(dbi.GetPublicStreamIndex(), true, dbi.GetSymRecordStreamIndex()))
+    {
+        publics.GetAll(symbols);
+    }
+
+    _functions.reserve(symbols.size());
+    for (const SymbolMatch& symbol : symbols)
+    {
+        uint32_t rva = 0;
+        if ((symbol.kind == S_PUB32) && dbi.SectionOffsetToRva(symbol.segment, symbol.offset, rva))
+        {
+            _functions.push_back({ rva, AddName(symbol.name) });
+        }
+    }
+
+    // keep the first name of aliased addresses
+    std::stable_sort(_functions.begin(), _functions.end(),
+        [](const Function& a, const Function& b) { return a.address < b.address; });
+    _functions.erase(
+        std::unique(_functions.begin(), _functions.end(),
+            [](const Function& a, const Function& b) { return a.address == b.address; }),
+        _functions.end());
+
+    return true;
+}
+
+bool ModuleSnapshot::LoadPortablePdb()
+{
+    PortablePdbParser parser;
+    if (!parser.LoadPdbFile(_pdbFilePath))
+    {
+        return false;
+    }
+
+    memcpy(_key.guid, parser.GetMetadata().GetPdbId(), sizeof(_key.guid));
+    _key.age = parser.GetAge();
+
+    // prefer namespace.Type::Method when the assembly is available
+    const MetadataReader* assemblyMetadata = parser.GetAssemblyMetadata();
+    std::vector<MethodInfo> methods = parser.GetMethods();
+    _functions.reserve(methods.size());
+    for (const MethodInfo& method : methods)
+    {
+        std::string name = (assemblyMetadata != nullptr) ? assemblyMetadata->GetQualifiedMethodName(RidFromToken(method.index)) : method.name;
+        _functions.push_back({ method.index, AddName(name) });
+    }
+
+    // the name offsets are resolved once so that symbolizing a MoveNext frame costs an indexed load
+    std::vector<uint32_t> kickoffMethods = parser.GetKickoffMethods();
+    _kickoffNames.assign(kickoffMethods.size(), NoKickoff);
+    for (size_t rid = 1; rid < kickoffMethods.size(); rid++)
+    {
+        uint32_t kickoffToken = MethodDefTokenType | kickoffMethods[rid];
+        auto kickoff = std::lower_bound(_functions.begin(), _functions.end(), kickoffToken,
+            [](const Function& function, uint32_t value) { return function.address < value; });
+        if ((kickoffMethods[rid] != 0) && (kickoff != _functions.end()) && (kickoff->address == kickoffToken))
+        {
+            _kickoffNames[rid] = kickoff->nameOffset;
+        }
+    }
+
+    // NOTE: methods and sequence points are by design sorted by token
+    _documents = parser.GetDocuments();
+    _sequencePoints = parser.GetSequencePoints();
+
+    ReadyToRunImage readyToRun;
+    const PeImage* assembly = parser.GetAssemblyImage();
+    if ((assembly != nullptr) && readyToRun.Read(*assembly))
+    {
+        _nativeRanges = readyToRun.GetRanges();
+    }
+
+    return true;
+}
+
+bool ModuleSnapshot::Symbolize(uint32_t address, uint32_t ilOffset, SymbolizedFrame& frame) const
+{
+    frame.function = nullptr;
+    frame.displacement = 0;
+    frame.file = nullptr;
+    frame.line = 0;
+
+    if (!_isManaged)
+    {
+        return SymbolizeNative(address, frame);
+    }
+
+    if (((address & 0xFF000000) != MethodDefTokenType) && !_nativeRanges.empty())
+    {
+        return SymbolizeReadyToRun(address, frame);
+    }
+
+    return SymbolizeManaged(address, ilOffset, frame);
+}
+
+bool ModuleSnapshot::SymbolizeNative(uint32_t rva, SymbolizedFrame& frame) const
+{
+    // the function is the closest public symbol before the address
+    auto next = std::upper_bound(_functions.begin(), _functions.end(), rva,
+        [](uint32_t value, const Function& function) { return value < function.address; });
+    if (next != _functions.begin())
+    {
+        const Function& function = *(next - 1);
+        frame.function = _names.data() + function.nameOffset;
+        frame.displacement = rva - function.address;
+    }
+
+    const LineEntry* entry = _lines.Find(rva);
+    if (entry != nullptr)
+    {
+        frame.file = _lines.GetFileName(entry->fileNameOffset);
+        frame.line = entry->lineNumber;
+    }
+
+    return (frame.function != nullptr) || (frame.file != nullptr);
+}
+
+bool ModuleSnapshot::SymbolizeManaged(uint32_t token, uint32_t ilOffset, SymbolizedFrame& frame) const
+{
+    auto function = std::lower_bound(_functions.begin(), _functions.end(), token,
+        [](const Function& function, uint32_t value) { return function.address < value; });
+    if ((function == _functions.end()) || (function->address != token))
+    {
+        return false;
+    }
+
+    // MoveNext of a state machine: show the async/iterator method (the lines are already in its source)
+    uint32_t rid = RidFromToken(token);
+    uint32_t nameOffset = ((rid < _kickoffNames.size()) && (_kickoffNames[rid] != NoKickoff)) ? _kickoffNames[rid] : function->nameOffset;
+    frame.function = _names.data() + nameOffset;
+    frame.displacement = ilOffset;
+
+    // last visible sequence point of the method starting before the IL offset
+    auto next = std::upper_bound(_sequencePoints.begin(), _sequencePoints.end(), std::make_pair(token, ilOffset),
+        [](const std::pair<uint32_t, uint32_t>& value, const SequencePoint& point)
+        {
+            return (value.first != point.token) ? (value.first < point.token) : (value.second < point.ilOffset);
+        });
+    while (next != _sequencePoints.begin())
+    {
+        --next;
+        if (next->token != token)
+        {
+            break;
+        }
+
+        if ((next->startLine != HiddenLineNumber) && (next->document < _documents.size()))
+        {
+            frame.file = _documents[next->document].c_str();
+            frame.line = next->startLine;
+            break;
+        }
+    }
+
+    return true;
+}
+
+bool ModuleSnapshot::SymbolizeReadyToRun(uint32_t rva, SymbolizedFrame& frame) const
+{
+    const NativeMethodRange* range = ReadyToRunImage::Find(_nativeRanges, rva);
+    if (range == nullptr)
+    {
+        return false;
+    }
+
+    // the native -> IL offset mapping is not decoded: the line is the one of the method start
+    if (!SymbolizeManaged(range->token, 0, frame))
+    {
+        return false;
+    }
+
+    frame.displacement = rva - range->beginRva;
+    return true;
+}
+
+std::vector<MethodInfo> ModuleSnapshot::GetNativeMethods() const
+{
+    std::vector<MethodInfo> methods;
+    methods.reserve(_nativeRanges.size());
+    for (const NativeMethodRange& range : _nativeRanges)
+    {
+        SymbolizedFrame frame = { nullptr, 0, nullptr, 0 };
+        if (!SymbolizeReadyToRun(range.beginRva, frame))
+        {
+            continue;
+        }
+
+        MethodInfo info;
+        info.name = frame.function;
+        info.modBase = 0;
+        info.address = range.beginRva;
+        info.size = range.endRva - range.beginRva;
+        info.rva = range.beginRva;
+        info.index = range.token;
+        info.lineNumber = frame.line;
+        if (frame.file != nullptr)
+        {
+            info.sourceFile = frame.file;
+        }
+
+        methods.push_back(info);
+    }
+
+    return methods;
+}
+
+std::vector<MethodInfo> ModuleSnapshot::GetMethods() const
+{
+    std::vector<MethodInfo> methods;
+    methods.reserve(_functions.size());
+    for (size_t i = 0; i < _functions.size(); i++)
+    {
+        const Function& function = _functions[i];
+
+        MethodInfo info;
+        info.name = _names.data() + function.nameOffset;
+        info.modBase = 0;
+        info.address = function.address;
+        info.size = (!_isManaged && (i + 1 < _functions.size())) ? _functions[i + 1].address - function.address : 0;
+        info.rva = function.address;
+        info.index = function.address;
+        info.lineNumber = 0;
+
+        SymbolizedFrame frame;
+        if (Symbolize(function.address, 0, frame) && (frame.file != nullptr))
+        {
+            info.sourceFile = frame.file;
+            info.lineNumber = frame.line;
+        }
+
+        methods.push_back(info);
+    }
+
+    return methods;
+}
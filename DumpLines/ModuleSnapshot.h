@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+#include "PdbCommon.h"
+#include "LineTable.h"
+#include "ReadyToRunImage.h"
+
+// Identity of a PDB file: GUID + age (the age of Portable PDBs is always 1)
+struct PdbKey
+{
+    uint8_t guid[16];
+    uint32_t age;
+
+    bool operator==(const PdbKey& other) const
+    {
+        return (age == other.age) && (memcmp(guid, other.guid, sizeof(guid)) == 0);
+    }
+
+    bool IsEmpty() const
+    {
+        static const uint8_t EmptyGuid[16] = { 0 };
+        return memcmp(guid, EmptyGuid, sizeof(guid)) == 0;
+    }
+};
+
+struct PdbKeyHash
+{
+    size_t operator()(const PdbKey& key) const
+    {
+        // the GUID is already random enough
+        uint64_t low = 0;
+        memcpy(&low, key.guid, sizeof(low));
+        return static_cast<size_t>(low ^ key.age);
+    }
+};
+
+// Only read the header of the PDB (Windows or Portable) to get its identity
+bool ReadPdbKey(const std::string& pdbFilePath, PdbKey& key);
+
+// Result of a symbolization: pointers are valid as long as the snapshot is alive
+struct SymbolizedFrame
+{
+    const char* function;
+    uint32_t displacement;  // from the start of the function (native) or IL offset (managed)
+    const char* file;
+    uint32_t line;
+};
+
+// Immutable symbolization data of a module: once loaded, it can be queried from any
+// thread without locking. Windows PDBs map RVAs to the public symbols and the C13 line
+// table; Portable PDBs map method token + IL offset to the sequence points. When the
+// assembly next to a Portable PDB is a ReadyToRun image, native RVAs of precompiled
+// methods are also mapped to their token.
+class ModuleSnapshot
+{
+public:
+    // Return nullptr if the file is not a valid PDB
+    // Only the native readers are used (neither DbgHelp nor COM): modules can be loaded on several threads at once
+    static std::shared_ptr<const ModuleSnapshot> Load(const std::string& pdbFilePath);
+
+    const PdbKey& GetKey() const { return _key; }
+    const std::string& GetPdbFilePath() const { return _pdbFilePath; }
+    bool IsManaged() const { return _isManaged; }
+
+    // address = RVA for native code or method token for managed code
+    // (for ReadyToRun images, an address that is not a MethodDef token is an RVA)
+    bool Symbolize(uint32_t address, uint32_t ilOffset, SymbolizedFrame& frame) const;
+
+    bool HasNativeCode() const { return !_isManaged || !_nativeRanges.empty(); }
+
+    // One entry per precompiled method of a ReadyToRun image (rva, size and index = token)
+    std::vector<MethodInfo> GetNativeMethods() const;
+
+    // One entry per function with the location of its first line (rva = index = address)
+    std::vector<MethodInfo> GetMethods() const;
+
+private:
+    ModuleSnapshot();
+    bool LoadWindowsPdb();
+    bool LoadPortablePdb();
+    uint32_t AddName(const std::string& name);
+    bool SymbolizeNative(uint32_t rva, SymbolizedFrame& frame) const;
+    bool SymbolizeManaged(uint32_t token, uint32_t ilOffset, SymbolizedFrame& frame) const;
+    bool SymbolizeReadyToRun(uint32_t rva, SymbolizedFrame& frame) const;
+
+private:
+    static const uint32_t NoKickoff = 0xFFFFFFFF;
+
+    struct Function
+    {
+        uint32_t address;       // RVA or token
+        uint32_t nameOffset;    // in _names
+    };
+
+private:
+    std::string _pdbFilePath;
+    PdbKey _key;
+    bool _isManaged;
+
+    // sorted by address
+    std::vector<Function> _functions;
+    std::vector<char> _names;
+
+    // native code
+    LineTable _lines;
+
+    // managed code: sequence points sorted by token and IL offset
+    std::vector<std::string> _documents;
+    std::vector<SequencePoint> _sequencePoints;
+
+    // MoveNext method rid -> name of the async/iterator method that created the state machine
+    // (NoKickoff for the other methods): frames of generated types show the user method
+    std::vector<uint32_t> _kickoffNames;
+
+    // ReadyToRun images: native code of the precompiled methods sorted by RVA
+    std::vector<NativeMethodRange> _nativeRanges;
+};
@@ -0,0 +1,328 @@
+#include "MsfFile.h"
+#include "ByteReader.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+// "Microsoft C/C++ MSF 7.00\r\n\x1a" followed by "DS\0\0\0"
+static const char MsfMagic[] = "Microsoft C/C++ MSF 7.00\r\n\x1a" "DS\0\0";
+static const size_t MsfMagicSize = MsfFile::MagicSize;
+
+#pragma pack(push, 1)
+struct MsfSuperBlock
+{
+    char FileMagic[MsfMagicSize];
+    uint32_t BlockSize;
+    uint32_t FreeBlockMapBlock;
+    uint32_t NumBlocks;
+    uint32_t NumDirectoryBytes;
+    uint32_t Unknown;
+    uint32_t BlockMapAddr;
+};
+#pragma pack(pop)
+
+const uint32_t MaxBlockSize = 4096;
+const size_t CacheBypassDivisor = 4;    // reads larger than budget / 4 are not cached
+
+static std::atomic<size_t>& GetDefaultCacheBudgetValue()
+{
+    static std::atomic<size_t> budget(0);
+    return budget;
+}
+
+
+MsfFile::MsfFile()
+    :
+    _hFile(INVALID_HANDLE_VALUE),
+    _blockSize(0),
+    _blockCount(0)
+{
+}
+
+MsfFile::~MsfFile()
+{
+    Close();
+}
+
+void MsfFile::Close()
+{
+    if (_hFile != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(_hFile);
+        _hFile = INVALID_HANDLE_VALUE;
+    }
+
+    _streamSizes.clear();
+    _streamFirstBlock.clear();
+    _blocks.clear();
+    _cache.Clear();
+}
+
+void MsfFile::SetDefaultCacheBudget(size_t budget)
+{
+    GetDefaultCacheBudgetValue() = budget;
+}
+
+size_t MsfFile::GetDefaultCacheBudget()
+{
+    return GetDefaultCacheBudgetValue();
+}
+
+void MsfFile::SetCacheBudget(size_t budget)
+{
+    _cache.Reset(_blockSize, budget);
+}
+
+bool MsfFile::HasMagic(const uint8_t* header, size_t size)
+{
+    return (size >= MsfMagicSize) && (memcmp(header, MsfMagic, MsfMagicSize) == 0);
+}
+
+bool MsfFile::Open(const std::string& pdbFilePath)
+{
+    Close();
+
+    _hFile = CreateFileA(
+        pdbFilePath.c_str(),
+        GENERIC_READ,
+        FILE_SHARE_READ,
+        NULL,
+        OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL,
+        NULL
+    );
+    if (_hFile == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    MsfSuperBlock superBlock;
+    if (!ReadAt(0, sizeof(superBlock), &superBlock))
+    {
+        Close();
+        return false;
+    }
+
+    if (memcmp(superBlock.FileMagic, MsfMagic, MsfMagicSize) != 0)
+    {
+        Close();
+        return false;
+    }
+
+    // only 512, 1024, 2048 and 4096 are valid block sizes
+    if ((superBlock.BlockSize < 512) || (superBlock.BlockSize > MaxBlockSize) ||
+        ((superBlock.BlockSize & (superBlock.BlockSize - 1)) != 0))
+    {
+        Close();
+        return false;
+    }
+
+    _blockSize = superBlock.BlockSize;
+    _blockCount = superBlock.NumBlocks;
+
+    // the block map lists the blocks used by the stream directory
+    uint32_t directoryBlockCount = (superBlock.NumDirectoryBytes + _blockSize - 1) / _blockSize;
+    std::vector<uint32_t> directoryBlocks(directoryBlockCount);
+    if ((directoryBlockCount > _blockSize / sizeof(uint32_t)) ||
+        !ReadAt(static_cast<uint64_t>(superBlock.BlockMapAddr) * _blockSize, directoryBlockCount * sizeof(uint32_t), directoryBlocks.data()))
+    {
+        Close();
+        return false;
+    }
+
+    std::vector<uint8_t> directory(superBlock.NumDirectoryBytes);
+    if (!ReadBlocks(directoryBlocks, superBlock.NumDirectoryBytes, directory.data()))
+    {
+        Close();
+        return false;
+    }
+
+    // directory = stream count + stream sizes + blocks of each stream
+    ByteReader reader(directory.data(), directory.size());
+    uint32_t streamCount = 0;
+    if (!reader.Read(streamCount) || (streamCount > reader.GetRemaining() / sizeof(uint32_t)))
+    {
+        Close();
+        return false;
+    }
+
+    _streamSizes.resize(streamCount);
+    reader.ReadBytes(_streamSizes.data(), streamCount * sizeof(uint32_t));
+
+    _streamFirstBlock.resize(streamCount + 1);
+    uint32_t totalBlocks = 0;
+    for (uint32_t i = 0; i < streamCount; i++)
+    {
+        _streamFirstBlock[i] = totalBlocks;
+        if (_streamSizes[i] != NilStreamSize)
+        {
+            totalBlocks += (_streamSizes[i] + _blockSize - 1) / _blockSize;
+        }
+    }
+    _streamFirstBlock[streamCount] = totalBlocks;
+
+    if (totalBlocks > reader.GetRemaining() / sizeof(uint32_t))
+    {
+        Close();
+        return false;
+    }
+
+    _blocks.resize(totalBlocks);
+    reader.ReadBytes(_blocks.data(), totalBlocks * sizeof(uint32_t));
+
+    _cache.Reset(_blockSize, GetDefaultCacheBudget());
+    return true;
+}
+
+uint32_t MsfFile::GetStreamSize(uint32_t stream) const
+{
+    if ((stream >= _streamSizes.size()) || (_streamSizes[stream] == NilStreamSize))
+    {
+        return 0;
+    }
+
+    return _streamSizes[stream];
+}
+
+bool MsfFile::ReadStream(uint32_t stream, std::vector<uint8_t>& buffer) const
+{
+    if (stream >= _streamSizes.size())
+    {
+        return false;
+    }
+
+    uint32_t size = GetStreamSize(stream);
+    buffer.resize(size);
+    if (size == 0)
+    {
+        return true;
+    }
+
+    return ReadStream(stream, 0, size, buffer.data());
+}
+
+bool MsfFile::ReadStream(uint32_t stream, uint32_t offset, uint32_t size, void* buffer) const
+{
+    uint32_t streamSize = GetStreamSize(stream);
+    if ((offset > streamSize) || (size > streamSize - offset))
+    {
+        return false;
+    }
+
+    const uint32_t* blocks = _blocks.data() + _streamFirstBlock[stream];
+    uint32_t streamBlockCount = _streamFirstBlock[stream + 1] - _streamFirstBlock[stream];
+    uint8_t* dest = static_cast<uint8_t*>(buffer);
+    if (_cache.IsEnabled())
+    {
+        // large reads would evict the whole cache for pages that are not read again
+        if (size <= _cache.GetBudget() / CacheBypassDivisor)
+        {
+            return ReadCachedBlocks(blocks, streamBlockCount, offset, size, dest);
+        }
+        _cache.CountBypass();
+    }
+
+    while (size > 0)
+    {
+        uint32_t blockIndex = offset / _blockSize;
+        uint32_t offsetInBlock = offset % _blockSize;
+        uint32_t chunk = _blockSize - offsetInBlock;
+        if (chunk > size)
+        {
+            chunk = size;
+        }
+
+        // merge physically contiguous blocks into a single read
+        uint32_t lastIndex = blockIndex;
+        while ((chunk < size) && (lastIndex + 1 < streamBlockCount) && (blocks[lastIndex + 1] == blocks[lastIndex] + 1))
+        {
+            lastIndex++;
+            chunk += ((size - chunk) < _blockSize) ? (size - chunk) : _blockSize;
+        }
+
+        uint32_t block = blocks[blockIndex];
+        if (blocks[lastIndex] >= _blockCount)
+        {
+            return false;
+        }
+
+        if (!ReadAt(static_cast<uint64_t>(block) * _blockSize + offsetInBlock, chunk, dest))
+        {
+            return false;
+        }
+
+        dest += chunk;
+        offset += chunk;
+        size -= chunk;
+    }
+
+    return true;
+}
+
+bool MsfFile::ReadCachedBlocks(const uint32_t* blocks, uint32_t blockCount, uint32_t offset, uint32_t size, uint8_t* dest) const
+{
+    uint8_t page[MaxBlockSize];
+    while (size > 0)
+    {
+        uint32_t blockIndex = offset / _blockSize;
+        uint32_t offsetInBlock = offset % _blockSize;
+        uint32_t chunk = (std::min)(_blockSize - offsetInBlock, size);
+        if ((blockIndex >= blockCount) || (blocks[blockIndex] >= _blockCount))
+        {
+            return false;
+        }
+
+        // evicted pages are simply read again
+        uint32_t block = blocks[blockIndex];
+        if (!_cache.Lookup(block, page))
+        {
+            if (!ReadAt(static_cast<uint64_t>(block) * _blockSize, _blockSize, page))
+            {
+                return false;
+            }
+            _cache.Insert(block, page);
+        }
+
+        memcpy(dest, page + offsetInBlock, chunk);
+        dest += chunk;
+        offset += chunk;
+        size -= chunk;
+    }
+
+    return true;
+}
+
+bool MsfFile::ReadBlocks(const std::vector<uint32_t>& blocks, uint32_t size, void* buffer) const
+{
+    uint8_t* dest = static_cast<uint8_t*>(buffer);
+    for (uint32_t block : blocks)
+    {
+        uint32_t chunk = (size < _blockSize) ? size : _blockSize;
+        if (!ReadAt(static_cast<uint64_t>(block) * _blockSize, chunk, dest))
+        {
+            return false;
+        }
+
+        dest += chunk;
+        size -= chunk;
+    }
+
+    return true;
+}
+
+bool MsfFile::ReadAt(uint64_t fileOffset, uint32_t size, void* buffer) const
+{
+    // positional read: the file pointer is not shared between threads
+    OVERLAPPED overlapped = { 0 };
+    overlapped.Offset = static_cast<DWORD>(fileOffset);
+    overlapped.OffsetHigh = static_cast<DWORD>(fileOffset >> 32);
+
+    DWORD read = 0;
+    if (!ReadFile(_hFile, buffer, size, &read, &overlapped))
+    {
+        return false;
+    }
+
+    return (read == size);
+}
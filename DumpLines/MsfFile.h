@@ -0,0 +1,68 @@
+#pragma once
+
+#include <windows.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "MsfPageCache.h"
+
+// Reader for the MSF 7.00 container used by Windows PDB files.
+// The file is made of fixed size blocks; each stream is a list of (non contiguous)
+// blocks described by the stream directory.
+// Reads are positional so a single instance can be shared by several threads.
+// With a page cache budget, ranged reads up to a quarter of the budget go through a cache of
+// blocks; larger reads bypass it. The large streams are only read by ranges so that huge PDBs are
+// processed with a bounded amount of memory: the symbol record stream (one record or one window at
+// a time) and the C13 lines of the modules (one subsection at a time). The small streams (PDB info,
+// DBI header and module list, section headers, /names, GSI hash tables) are still read whole.
+class MsfFile
+{
+public:
+    static const uint32_t NilStreamSize = 0xFFFFFFFF;
+    static const size_t MagicSize = 32;
+
+public:
+    MsfFile();
+    ~MsfFile();
+
+    bool Open(const std::string& pdbFilePath);
+    void Close();
+
+    // "Microsoft C/C++ MSF 7.00" signature at the start of the file
+    static bool HasMagic(const uint8_t* header, size_t size);
+
+    uint32_t GetBlockSize() const { return _blockSize; }
+    uint32_t GetStreamCount() const { return static_cast<uint32_t>(_streamSizes.size()); }
+    uint32_t GetStreamSize(uint32_t stream) const;
+
+    // Read a whole stream (an empty buffer is returned for nil streams): only for small streams
+    bool ReadStream(uint32_t stream, std::vector<uint8_t>& buffer) const;
+
+    // Read part of a stream without loading the rest of it
+    bool ReadStream(uint32_t stream, uint32_t offset, uint32_t size, void* buffer) const;
+
+    // Budget (in bytes) of the page cache of the files opened afterwards (0 = no cache, the default)
+    static void SetDefaultCacheBudget(size_t budget);
+    static size_t GetDefaultCacheBudget();
+
+    // Change the budget of this file: the cached pages are dropped
+    void SetCacheBudget(size_t budget);
+    MsfCacheStats GetCacheStats() const { return _cache.GetStats(); }
+
+private:
+    bool ReadAt(uint64_t fileOffset, uint32_t size, void* buffer) const;
+    bool ReadBlocks(const std::vector<uint32_t>& blocks, uint32_t size, void* buffer) const;
+    bool ReadCachedBlocks(const uint32_t* blocks, uint32_t blockCount, uint32_t offset, uint32_t size, uint8_t* dest) const;
+
+private:
+    HANDLE _hFile;
+    uint32_t _blockSize;
+    uint32_t _blockCount;
+
+    // block list of stream i is _blocks[_streamFirstBlock[i] .. _streamFirstBlock[i+1][
+    std::vector<uint32_t> _streamSizes;
+    std::vector<uint32_t> _streamFirstBlock;
+    std::vector<uint32_t> _blocks;
+
+    mutable MsfPageCache _cache;
+};
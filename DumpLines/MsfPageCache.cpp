@@ -0,0 +1,110 @@
+#include "MsfPageCache.h"
+
+#include <algorithm>
+#include <cstring>
+
+
+MsfPageCache::MsfPageCache()
+    :
+    _pageSize(0),
+    _capacity(0),
+    _hand(0),
+    _pagesPerChunk(1)
+{
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+void MsfPageCache::Reset(uint32_t pageSize, size_t budget)
+{
+    std::lock_guard<std::mutex> guard(_lock);
+    _pageSize = pageSize;
+    _capacity = (pageSize == 0) ? 0 : static_cast<uint32_t>((std::min)(budget / pageSize, static_cast<size_t>(NoPage - 1)));
+    _hand = 0;
+    _pagesPerChunk = (pageSize == 0) ? 1 : static_cast<uint32_t>((std::max)(ChunkSize / pageSize, static_cast<size_t>(1)));
+    _slots.clear();
+    _chunks.clear();
+    _pageSlots.clear();
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+uint8_t* MsfPageCache::GetSlotData(uint32_t slot) const
+{
+    return _chunks[slot / _pagesPerChunk].get() + static_cast<size_t>(slot % _pagesPerChunk) * _pageSize;
+}
+
+void MsfPageCache::Clear()
+{
+    Reset(0, 0);
+}
+
+bool MsfPageCache::Lookup(uint32_t page, uint8_t* data)
+{
+    std::lock_guard<std::mutex> guard(_lock);
+    auto found = _pageSlots.find(page);
+    if (found == _pageSlots.end())
+    {
+        _stats.misses++;
+        return false;
+    }
+
+    _stats.hits++;
+    _slots[found->second].referenced = true;
+    memcpy(data, GetSlotData(found->second), _pageSize);
+    return true;
+}
+
+void MsfPageCache::Insert(uint32_t page, const uint8_t* data)
+{
+    std::lock_guard<std::mutex> guard(_lock);
+    if ((_capacity == 0) || (_pageSlots.find(page) != _pageSlots.end()))
+    {
+        // another thread has read the same page in the meantime
+        return;
+    }
+
+    uint32_t slot;
+    if (_slots.size() < _capacity)
+    {
+        // the memory only grows with the pages actually read
+        slot = static_cast<uint32_t>(_slots.size());
+        _slots.push_back({ NoPage, false });
+        if (slot % _pagesPerChunk == 0)
+        {
+            size_t chunkPages = (std::min)(_pagesPerChunk, _capacity - slot);
+            _chunks.emplace_back(new uint8_t[chunkPages * _pageSize]);
+        }
+    }
+    else
+    {
+        // clock: give a second chance to the pages used since the last pass
+        while (_slots[_hand].referenced)
+        {
+            _slots[_hand].referenced = false;
+            _hand = (_hand + 1) % _capacity;
+        }
+
+        slot = _hand;
+        _hand = (_hand + 1) % _capacity;
+        _pageSlots.erase(_slots[slot].page);
+        _stats.evictions++;
+    }
+
+    _slots[slot].page = page;
+    _slots[slot].referenced = false;
+    _pageSlots[page] = slot;
+    memcpy(GetSlotData(slot), data, _pageSize);
+}
+
+void MsfPageCache::CountBypass()
+{
+    std::lock_guard<std::mutex> guard(_lock);
+    _stats.bypassedReads++;
+}
+
+MsfCacheStats MsfPageCache::GetStats() const
+{
+    std::lock_guard<std::mutex> guard(_lock);
+    MsfCacheStats stats = _stats;
+    stats.cachedBytes = _slots.size() * static_cast<size_t>(_pageSize);
+    return stats;
+}
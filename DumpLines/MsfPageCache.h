@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+struct MsfCacheStats
+{
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    uint64_t bypassedReads;     // reads too large for the budget: read directly from the file
+    size_t cachedBytes;
+};
+
+// Fixed budget cache of MSF blocks (pages) shared by the threads reading the same file.
+// Memory grows with the pages actually read, up to the budget; then the clock (second chance)
+// policy evicts a page that was not used since the hand last passed over it.
+class MsfPageCache
+{
+public:
+    MsfPageCache();
+
+    // A budget smaller than a page disables the cache
+    void Reset(uint32_t pageSize, size_t budget);
+    void Clear();
+
+    bool IsEnabled() const { return _capacity != 0; }
+    size_t GetBudget() const { return static_cast<size_t>(_capacity) * _pageSize; }
+
+    // Copy a page into data; return false on a miss
+    bool Lookup(uint32_t page, uint8_t* data);
+
+    // Add a page read from the file (possibly evicting another one)
+    void Insert(uint32_t page, const uint8_t* data);
+
+    void CountBypass();
+    MsfCacheStats GetStats() const;
+
+private:
+    MsfPageCache(const MsfPageCache&) = delete;
+    MsfPageCache& operator=(const MsfPageCache&) = delete;
+
+    static const uint32_t NoPage = 0xFFFFFFFF;
+    static const size_t ChunkSize = 1024 * 1024;
+
+    struct Slot
+    {
+        uint32_t page;
+        bool referenced;
+    };
+
+private:
+    uint8_t* GetSlotData(uint32_t slot) const;
+
+private:
+    mutable std::mutex _lock;
+    uint32_t _pageSize;
+    uint32_t _capacity;     // in pages
+    uint32_t _hand;
+
+    // pages are stored in 1 MB chunks allocated when needed (a growing vector could
+    // temporarily take twice the budget)
+    std::vector<Slot> _slots;
+    std::vector<std::unique_ptr<uint8_t[]>> _chunks;
+    uint32_t _pagesPerChunk;
+    std::unordered_map<uint32_t, uint32_t> _pageSlots;
+    MsfCacheStats _stats;
+};
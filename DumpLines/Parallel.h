@@ -0,0 +1,45 @@
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// Call body(i) for each i in [0, count[ using all available cores.
+// Items are handed out one at a time so that uneven work (i.e. modules of
+// very different sizes) is balanced between the threads.
+template <typename TBody>
+void ParallelFor(size_t count, TBody body)
+{
+    size_t threadCount = std::thread::hardware_concurrency();
+    if (threadCount == 0)
+    {
+        threadCount = 1;
+    }
+    if (threadCount > count)
+    {
+        threadCount = count;
+    }
+
+    std::atomic<size_t> next(0);
+    auto worker = [&]()
+        {
+            for (size_t i = next++; i < count; i = next++)
+            {
+                body(i);
+            }
+        };
+
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < threadCount; i++)
+    {
+        threads.emplace_back(worker);
+    }
+
+    // the calling thread is also doing its share of the work
+    worker();
+
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+}
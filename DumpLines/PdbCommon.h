@@ -2,6 +2,7 @@
 
 #include <string>
 #include <cstdint>
+#include <cstdio>
 
 // Common structures used by both DbgHelpParser and SymPdbParser
 
@@ -17,6 +18,14 @@ struct MethodInfo
     uint32_t lineNumber;
 };
 
+// Result of a lazily computed part of a parser (methods, source files, tokens...)
+enum class ComputeState
+{
+    NotComputed,
+    Computed,
+    Failed
+};
+
 struct TokenInfo
 {
     uint32_t token;
@@ -27,3 +36,33 @@ struct TokenInfo
     uint32_t tag;
     std::string name;
 };
+
+// Sequence point of a managed method: IL offset -> source range
+struct SequencePoint
+{
+    uint32_t token;
+    uint32_t ilOffset;
+    uint32_t document;      // index in the list of source files
+    uint32_t startLine;     // 0xFEEFEE for hidden sequence points
+    uint32_t endLine;
+    uint16_t startColumn;
+    uint16_t endColumn;
+};
+
+const uint32_t HiddenLineNumber = 0xFEEFEE;
+
+// Same layout as the GUID returned by DbgHelp (Data1, Data2 and Data3 are little endian)
+inline std::string FormatPdbGuid(const uint8_t* guid)
+{
+    uint32_t data1 = guid[0] | (guid[1] << 8) | (guid[2] << 16) | (static_cast<uint32_t>(guid[3]) << 24);
+    uint32_t data2 = guid[4] | (guid[5] << 8);
+    uint32_t data3 = guid[6] | (guid[7] << 8);
+
+    char strGUID[80];
+    snprintf(strGUID, sizeof(strGUID), "%08x%04x%04x%02x%02x%02x%02x%02x%02x%02x%02x",
+        data1, data2, data3,
+        guid[8], guid[9], guid[10], guid[11],
+        guid[12], guid[13], guid[14], guid[15]
+        );
+    return strGUID;
+}
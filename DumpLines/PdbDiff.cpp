@@ -0,0 +1,345 @@
+#include "PdbDiff.h"
+#include "Parallel.h"
+#include "SignatureDecoder.h"
+
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+
+const uint32_t EntriesPerTask = 256;    // methods fingerprinted by each ParallelFor item
+const uint64_t HashSeed = 14695981039346656037ull;
+const uint32_t MaxTypeSpecDepth = 8;    // TypeSpec signatures referencing other TypeSpecs
+
+
+// FNV-1a (64-bit: there is one key per method of both builds)
+static uint64_t HashBytes(uint64_t hash, const void* data, size_t size)
+{
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; i++)
+    {
+        hash = (hash ^ bytes[i]) * 1099511628211ull;
+    }
+    return hash;
+}
+
+static uint64_t HashValue(uint64_t hash, uint32_t value)
+{
+    return HashBytes(hash, &value, sizeof(value));
+}
+
+static bool IsHidden(const SequencePoint& point)
+{
+    return point.startLine == HiddenLineNumber;
+}
+
+static bool ResolveTypeName(const MetadataReader& metadata, uint32_t token, uint32_t depth, std::string& name)
+{
+    if (TableFromToken(token) != TableTypeSpec)
+    {
+        name = metadata.GetTypeName(token);
+        return !name.empty();
+    }
+
+    // generic instantiations, arrays... are described by their own signature
+    const uint8_t* signature = nullptr;
+    uint32_t signatureSize = 0;
+    if ((depth >= MaxTypeSpecDepth) ||
+        !metadata.GetBlob(metadata.GetValue(TableTypeSpec, RidFromToken(token), TypeSpec_Signature), signature, signatureSize))
+    {
+        return false;
+    }
+
+    SignatureDecoder decoder(
+        [&metadata, depth](uint32_t typeToken, std::string& typeName)
+        {
+            return ResolveTypeName(metadata, typeToken, depth + 1, typeName);
+        });
+    return decoder.DecodeTypeSignature(signature, signatureSize, name);
+}
+
+
+PdbDiff::PdbDiff()
+    :
+    _unchangedCount(0)
+{
+}
+
+uint64_t PdbDiff::ComputeKey(const std::string& name, const std::string& signature)
+{
+    // the separator keeps "a" + "bc" and "ab" + "c" apart
+    uint64_t key = HashBytes(HashSeed, name.data(), name.size());
+    key = HashBytes(key, "", 1);
+    return HashBytes(key, signature.data(), signature.size());
+}
+
+uint32_t PdbDiff::GetIlSize(const Build& build, uint32_t methodRid)
+{
+    // tiny header: size in the upper 6 bits; fat header: 12 bytes with the size at offset 4
+    uint32_t rva = build.parser.GetAssemblyMetadata()->GetValue(TableMethodDef, methodRid, MethodDef_Rva);
+    const uint8_t* header = (rva != 0) ? build.parser.GetAssemblyImage()->RvaToPointer(rva, 1) : nullptr;
+    if (header == nullptr)
+    {
+        return 0;
+    }
+
+    if ((header[0] & 0x03) == 0x02)
+    {
+        return header[0] >> 2;
+    }
+
+    header = build.parser.GetAssemblyImage()->RvaToPointer(rva, 12);
+    if ((header == nullptr) || ((header[0] & 0x03) != 0x03))
+    {
+        return 0;
+    }
+
+    uint32_t codeSize = 0;
+    memcpy(&codeSize, header + 4, sizeof(codeSize));
+    return codeSize;
+}
+
+void PdbDiff::ComputeEntry(const Build& build, const std::vector<uint64_t>& documentHashes, uint32_t methodRid, MethodEntry& entry)
+{
+    const MetadataReader& metadata = *build.parser.GetAssemblyMetadata();
+
+    entry.token = MethodDefTokenType | methodRid;
+    entry.name = metadata.GetQualifiedMethodName(methodRid);
+
+    // overloads only differ by their signature; the type tokens of the blob are renumbered when
+    // a type or type reference is added or removed, so the type names are hashed instead
+    const uint8_t* signature = nullptr;
+    uint32_t signatureSize = 0;
+    std::string signatureText;
+    if (metadata.GetBlob(metadata.GetValue(TableMethodDef, methodRid, MethodDef_Signature), signature, signatureSize))
+    {
+        SignatureDecoder decoder(
+            [&metadata](uint32_t token, std::string& typeName)
+            {
+                return ResolveTypeName(metadata, token, 0, typeName);
+            });
+        if (!decoder.DecodeMethodSignature(signature, signatureSize, signatureText))
+        {
+            signatureText.assign(reinterpret_cast<const char*>(signature), signatureSize);
+        }
+    }
+    entry.key = ComputeKey(entry.name, signatureText);
+
+    std::vector<SequencePoint> points;
+    if (!build.parser.ReadSequencePoints(methodRid, points))
+    {
+        points.clear();
+    }
+
+    entry.firstLine = 0;
+    for (const SequencePoint& point : points)
+    {
+        if (!IsHidden(point))
+        {
+            entry.firstLine = point.startLine;
+            break;
+        }
+    }
+
+    // adding a line above a method only changes its location: the lines are relative to the first one
+    entry.ilSize = GetIlSize(build, methodRid);
+    entry.shapeHash = HashValue(HashSeed, entry.ilSize);
+    entry.locationHash = HashValue(HashSeed, entry.firstLine);
+    for (const SequencePoint& point : points)
+    {
+        entry.shapeHash = HashValue(entry.shapeHash, point.ilOffset);
+        if (!IsHidden(point))
+        {
+            entry.shapeHash = HashValue(entry.shapeHash, point.startLine - entry.firstLine);
+            entry.shapeHash = HashValue(entry.shapeHash, point.endLine - point.startLine);
+            entry.shapeHash = HashValue(entry.shapeHash, (static_cast<uint32_t>(point.startColumn) << 16) | point.endColumn);
+        }
+
+        uint64_t documentHash = (point.document < documentHashes.size()) ? documentHashes[point.document] : 0;
+        entry.locationHash = HashBytes(entry.locationHash, &documentHash, sizeof(documentHash));
+    }
+}
+
+bool PdbDiff::LoadBuild(const std::string& pdbFilePath, Build& build)
+{
+    // names and signatures come from the assembly next to the .pdb file
+    if (!build.parser.LoadPdbFile(pdbFilePath) || (build.parser.GetAssemblyMetadata() == nullptr))
+    {
+        return false;
+    }
+
+    const std::vector<std::string>& documents = build.parser.GetDocuments();
+    std::vector<uint64_t> documentHashes(documents.size());
+    for (size_t i = 0; i < documents.size(); i++)
+    {
+        documentHashes[i] = HashBytes(HashSeed, documents[i].data(), documents[i].size());
+    }
+
+    uint32_t methodCount = build.parser.GetMetadata().GetRowCount(TableMethodDebugInformation);
+    build.methods.resize(methodCount);
+    ParallelFor((methodCount + EntriesPerTask - 1) / EntriesPerTask,
+        [&](size_t task)
+        {
+            uint32_t first = static_cast<uint32_t>(task) * EntriesPerTask;
+            uint32_t last = (std::min)(first + EntriesPerTask, methodCount);
+            for (uint32_t i = first; i < last; i++)
+            {
+                ComputeEntry(build, documentHashes, i + 1, build.methods[i]);
+            }
+        });
+
+    return true;
+}
+
+bool PdbDiff::CompareSequencePoints(const MethodEntry& oldEntry, const MethodEntry& newEntry, MethodChange& change) const
+{
+    std::vector<SequencePoint> oldPoints;
+    std::vector<SequencePoint> newPoints;
+    if (!_old.parser.ReadSequencePoints(RidFromToken(oldEntry.token), oldPoints))
+    {
+        oldPoints.clear();
+    }
+    if (!_new.parser.ReadSequencePoints(RidFromToken(newEntry.token), newPoints))
+    {
+        newPoints.clear();
+    }
+
+    change = MethodChange::Changed;
+    if ((oldEntry.ilSize != newEntry.ilSize) || (oldPoints.size() != newPoints.size()))
+    {
+        return true;
+    }
+
+    bool moved = (oldEntry.firstLine != newEntry.firstLine);
+    const std::vector<std::string>& oldDocuments = _old.parser.GetDocuments();
+    const std::vector<std::string>& newDocuments = _new.parser.GetDocuments();
+    for (size_t i = 0; i < oldPoints.size(); i++)
+    {
+        const SequencePoint& oldPoint = oldPoints[i];
+        const SequencePoint& newPoint = newPoints[i];
+        if ((oldPoint.ilOffset != newPoint.ilOffset) || (IsHidden(oldPoint) != IsHidden(newPoint)))
+        {
+            return true;
+        }
+
+        if (!IsHidden(oldPoint) &&
+            ((oldPoint.startLine - oldEntry.firstLine != newPoint.startLine - newEntry.firstLine) ||
+             (oldPoint.endLine - oldPoint.startLine != newPoint.endLine - newPoint.startLine) ||
+             (oldPoint.startColumn != newPoint.startColumn) ||
+             (oldPoint.endColumn != newPoint.endColumn)))
+        {
+            return true;
+        }
+
+        if ((oldPoint.document < oldDocuments.size()) && (newPoint.document < newDocuments.size()) &&
+            (oldDocuments[oldPoint.document] != newDocuments[newPoint.document]))
+        {
+            moved = true;
+        }
+    }
+
+    // fingerprint collision: nothing has changed
+    change = MethodChange::Moved;
+    return moved;
+}
+
+void PdbDiff::MatchMethods(const std::vector<MethodEntry>& oldMethods, const std::vector<MethodEntry>& newMethods,
+    std::vector<MethodDiff>& diffs, std::vector<std::pair<uint32_t, uint32_t>>& mismatches, size_t& unchangedCount)
+{
+    std::unordered_map<uint64_t, uint32_t> oldIndexes(oldMethods.size());
+    for (uint32_t i = 0; i < oldMethods.size(); i++)
+    {
+        oldIndexes.emplace(oldMethods[i].key, i);
+    }
+
+    // pairs (old, new) whose fingerprints are different
+    std::vector<uint8_t> matched(oldMethods.size(), 0);
+    for (uint32_t i = 0; i < newMethods.size(); i++)
+    {
+        const MethodEntry& newEntry = newMethods[i];
+        auto found = oldIndexes.find(newEntry.key);
+        if ((found == oldIndexes.end()) || (oldMethods[found->second].name != newEntry.name))
+        {
+            MethodDiff diff = { MethodChange::Added, newEntry.name, 0, newEntry.token, 0, newEntry.firstLine, 0, newEntry.ilSize };
+            diffs.push_back(diff);
+            continue;
+        }
+
+        const MethodEntry& oldEntry = oldMethods[found->second];
+        matched[found->second] = 1;
+        if ((oldEntry.shapeHash == newEntry.shapeHash) && (oldEntry.locationHash == newEntry.locationHash))
+        {
+            unchangedCount++;
+            continue;
+        }
+
+        mismatches.emplace_back(found->second, i);
+    }
+
+    for (uint32_t i = 0; i < oldMethods.size(); i++)
+    {
+        if (!matched[i])
+        {
+            const MethodEntry& oldEntry = oldMethods[i];
+            MethodDiff diff = { MethodChange::Removed, oldEntry.name, oldEntry.token, 0, oldEntry.firstLine, 0, oldEntry.ilSize, 0 };
+            diffs.push_back(diff);
+        }
+    }
+}
+
+bool PdbDiff::Compare(const std::string& oldPdbFilePath, const std::string& newPdbFilePath)
+{
+    _diffs.clear();
+    _unchangedCount = 0;
+
+    // both builds are loaded at the same time; each one also fingerprints its methods in parallel
+    bool loaded[2] = { false, false };
+    ParallelFor(2,
+        [&](size_t i)
+        {
+            loaded[i] = (i == 0) ? LoadBuild(oldPdbFilePath, _old) : LoadBuild(newPdbFilePath, _new);
+        });
+    if (!loaded[0] || !loaded[1])
+    {
+        return false;
+    }
+
+    std::vector<std::pair<uint32_t, uint32_t>> mismatches;
+    MatchMethods(_old.methods, _new.methods, _diffs, mismatches, _unchangedCount);
+
+    // full comparison of the sequence points only for the fingerprint mismatches
+    std::vector<uint8_t> changes(mismatches.size(), 0);
+    std::vector<MethodChange> kinds(mismatches.size(), MethodChange::Changed);
+    ParallelFor(mismatches.size(),
+        [&](size_t i)
+        {
+            MethodChange change;
+            changes[i] = CompareSequencePoints(_old.methods[mismatches[i].first], _new.methods[mismatches[i].second], change) ? 1 : 0;
+            kinds[i] = change;
+        });
+
+    for (size_t i = 0; i < mismatches.size(); i++)
+    {
+        if (!changes[i])
+        {
+            _unchangedCount++;
+            continue;
+        }
+
+        const MethodEntry& oldEntry = _old.methods[mismatches[i].first];
+        const MethodEntry& newEntry = _new.methods[mismatches[i].second];
+        MethodDiff diff = { kinds[i], newEntry.name, oldEntry.token, newEntry.token, oldEntry.firstLine, newEntry.firstLine, oldEntry.ilSize, newEntry.ilSize };
+        _diffs.push_back(diff);
+    }
+
+    std::sort(_diffs.begin(), _diffs.end(),
+        [](const MethodDiff& left, const MethodDiff& right)
+        {
+            if (left.change != right.change)
+            {
+                return left.change < right.change;
+            }
+            return left.name < right.name;
+        });
+
+    return true;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "PortablePdbParser.h"
+
+enum class MethodChange
+{
+    Changed,    // IL size or sequence points are different
+    Moved,      // same sequence points but at other lines (or in another file)
+    Added,
+    Removed
+};
+
+struct MethodDiff
+{
+    MethodChange change;
+    std::string name;       // namespace.Type::Method (Outer/Nested for nested types)
+    uint32_t oldToken;      // 0 for added methods
+    uint32_t newToken;      // 0 for removed methods
+    uint32_t oldLine;
+    uint32_t newLine;
+    uint32_t oldSize;       // IL code size
+    uint32_t newSize;
+};
+
+// Compare the methods of two builds of an assembly (Portable PDB + assembly next to it).
+// Tokens are not stable between builds: methods are aligned by qualified name + decoded signature
+// (type names instead of the tokens of the signature blob). A fingerprint of the sequence points is computed for each method in parallel
+// and the sequence points are only compared when the fingerprints are different.
+class PdbDiff
+{
+public:
+    struct MethodEntry
+    {
+        uint64_t key;           // qualified name + signature
+        uint64_t shapeHash;     // IL size, IL offsets and lines relative to the first one
+        uint64_t locationHash;  // first line and documents
+        uint32_t token;
+        uint32_t firstLine;
+        uint32_t ilSize;
+        std::string name;
+    };
+
+public:
+    PdbDiff();
+
+    bool Compare(const std::string& oldPdbFilePath, const std::string& newPdbFilePath);
+
+    // Sorted by change and name
+    const std::vector<MethodDiff>& GetDiffs() const { return _diffs; }
+    size_t GetUnchangedCount() const { return _unchangedCount; }
+
+    // signature = text of SignatureDecoder (the raw blob if it could not be decoded)
+    static uint64_t ComputeKey(const std::string& name, const std::string& signature);
+
+    // Pair the methods of both builds by key: the unpaired ones are added to diffs as Added or Removed,
+    // the pairs with the same fingerprints are counted as unchanged and the other ones are returned
+    // in mismatches (old index, new index)
+    static void MatchMethods(const std::vector<MethodEntry>& oldMethods, const std::vector<MethodEntry>& newMethods,
+        std::vector<MethodDiff>& diffs, std::vector<std::pair<uint32_t, uint32_t>>& mismatches, size_t& unchangedCount);
+
+    struct Build
+    {
+        PortablePdbParser parser;
+        std::vector<MethodEntry> methods;
+    };
+
+private:
+    static bool LoadBuild(const std::string& pdbFilePath, Build& build);
+    static void ComputeEntry(const Build& build, const std::vector<uint64_t>& documentHashes, uint32_t methodRid, MethodEntry& entry);
+    static uint32_t GetIlSize(const Build& build, uint32_t methodRid);
+    // Full comparison after a fingerprint mismatch: return false if the methods are identical
+    bool CompareSequencePoints(const MethodEntry& oldEntry, const MethodEntry& newEntry, MethodChange& change) const;
+
+private:
+    Build _old;
+    Build _new;
+    std::vector<MethodDiff> _diffs;
+    size_t _unchangedCount;
+};
@@ -0,0 +1,31 @@
+#include "PdbFormat.h"
+#include "MsfFile.h"
+
+#include <cstdio>
+#include <cstring>
+
+
+PdbFormat DetectPdbFormat(const std::string& pdbFilePath)
+{
+    FILE* file = nullptr;
+    if (fopen_s(&file, pdbFilePath.c_str(), "rb") != 0)
+    {
+        return PdbFormat::Unknown;
+    }
+
+    uint8_t header[MsfFile::MagicSize] = { 0 };
+    size_t read = fread(header, 1, sizeof(header), file);
+    fclose(file);
+
+    if ((read >= 4) && (memcmp(header, "BSJB", 4) == 0))
+    {
+        return PdbFormat::Portable;
+    }
+
+    if (MsfFile::HasMagic(header, read))
+    {
+        return PdbFormat::Windows;
+    }
+
+    return PdbFormat::Unknown;
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <string>
+
+enum class PdbFormat
+{
+    Unknown,
+    Windows,    // MSF 7.00 container
+    Portable,   // ECMA-335 metadata (BSJB)
+};
+
+// Only the first bytes of the file are read
+PdbFormat DetectPdbFormat(const std::string& pdbFilePath);
@@ -0,0 +1,116 @@
+#include "PdbInfoStream.h"
+#include "ByteReader.h"
+#include "PdbCommon.h"
+
+#include <cstring>
+
+
+PdbInfoStream::PdbInfoStream()
+    :
+    _version(0),
+    _signature(0),
+    _age(0)
+{
+    memset(_guid, 0, sizeof(_guid));
+}
+
+bool PdbInfoStream::Read(const MsfFile& msf)
+{
+    std::vector<uint8_t> stream;
+    if (!msf.ReadStream(PdbStreamIndex, stream))
+    {
+        return false;
+    }
+
+    ByteReader reader(stream.data(), stream.size());
+    if (!reader.Read(_version) ||
+        !reader.Read(_signature) ||
+        !reader.Read(_age) ||
+        !reader.ReadBytes(_guid, sizeof(_guid)))
+    {
+        return false;
+    }
+
+    // named stream map = string buffer + serialized hash table (offset in buffer -> stream index)
+    uint32_t stringsSize = 0;
+    if (!reader.Read(stringsSize))
+    {
+        return false;
+    }
+
+    const char* strings = reinterpret_cast<const char*>(reader.GetCurrent());
+    if (!reader.Skip(stringsSize))
+    {
+        return false;
+    }
+
+    uint32_t size = 0;
+    uint32_t capacity = 0;
+    uint32_t presentWordCount = 0;
+    if (!reader.Read(size) || !reader.Read(capacity) || !reader.Read(presentWordCount))
+    {
+        return false;
+    }
+
+    // the counts come from the file: checked against the stream before allocating anything
+    if (presentWordCount > reader.GetRemaining() / sizeof(uint32_t))
+    {
+        return false;
+    }
+
+    std::vector<uint32_t> presentBits(presentWordCount);
+    if (!reader.ReadBytes(presentBits.data(), presentWordCount * sizeof(uint32_t)))
+    {
+        return false;
+    }
+
+    uint32_t deletedWordCount = 0;
+    if (!reader.Read(deletedWordCount) ||
+        (deletedWordCount > reader.GetRemaining() / sizeof(uint32_t)) ||
+        !reader.Skip(deletedWordCount * sizeof(uint32_t)))
+    {
+        return false;
+    }
+
+    _namedStreams.clear();
+    for (uint32_t bucket = 0; bucket < capacity; bucket++)
+    {
+        if ((bucket / 32 >= presentWordCount) || ((presentBits[bucket / 32] & (1u << (bucket % 32))) == 0))
+        {
+            continue;
+        }
+
+        uint32_t nameOffset = 0;
+        uint32_t streamIndex = 0;
+        if (!reader.Read(nameOffset) || !reader.Read(streamIndex))
+        {
+            return false;
+        }
+
+        if (nameOffset < stringsSize)
+        {
+            size_t maxLength = stringsSize - nameOffset;
+            _namedStreams.emplace_back(std::string(strings + nameOffset, strnlen(strings + nameOffset, maxLength)), streamIndex);
+        }
+    }
+
+    return true;
+}
+
+std::string PdbInfoStream::GetGuidString() const
+{
+    return FormatPdbGuid(_guid);
+}
+
+uint32_t PdbInfoStream::FindNamedStream(const char* name) const
+{
+    for (const auto& namedStream : _namedStreams)
+    {
+        if (namedStream.first == name)
+        {
+            return namedStream.second;
+        }
+    }
+
+    return MsfFile::NilStreamSize;
+}
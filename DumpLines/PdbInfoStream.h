@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "MsfFile.h"
+
+// Well-known stream indexes of a Windows PDB
+const uint32_t PdbStreamIndex = 1;
+const uint32_t TpiStreamIndex = 2;
+const uint32_t DbiStreamIndex = 3;
+const uint32_t IpiStreamIndex = 4;
+
+// PDB info stream (stream 1): identity of the PDB and map of the named streams
+class PdbInfoStream
+{
+public:
+    PdbInfoStream();
+
+    bool Read(const MsfFile& msf);
+
+    uint32_t GetAge() const { return _age; }
+    const uint8_t* GetGuid() const { return _guid; }
+    std::string GetGuidString() const;
+
+    // Return MsfFile::NilStreamSize if there is no stream with that name (i.e. "/names")
+    uint32_t FindNamedStream(const char* name) const;
+
+private:
+    uint32_t _version;
+    uint32_t _signature;
+    uint32_t _age;
+    uint8_t _guid[16];
+    std::vector<std::pair<std::string, uint32_t>> _namedStreams;
+};
@@ -0,0 +1,370 @@
+#include "PdbStats.h"
+#include "Parallel.h"
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+#include <unordered_map>
+
+// row counts reported with the totals
+static const std::pair<MetadataTable, const char*> DebugTables[] =
+{
+    { TableDocument, "Document" },
+    { TableMethodDebugInformation, "MethodDebugInformation" },
+    { TableLocalScope, "LocalScope" },
+    { TableLocalVariable, "LocalVariable" },
+    { TableLocalConstant, "LocalConstant" },
+    { TableImportScope, "ImportScope" },
+    { TableStateMachineMethod, "StateMachineMethod" },
+    { TableCustomDebugInformation, "CustomDebugInformation" }
+};
+
+
+static void WriteJsonString(FILE* file, const std::string& value)
+{
+    fputc('"', file);
+    for (char c : value)
+    {
+        if ((c == '"') || (c == '\\'))
+        {
+            fputc('\\', file);
+            fputc(c, file);
+        }
+        else
+        if (static_cast<unsigned char>(c) < 0x20)
+        {
+            fprintf(file, "\\u%04x", static_cast<unsigned char>(c));
+        }
+        else
+        {
+            fputc(c, file);
+        }
+    }
+    fputc('"', file);
+}
+
+
+PdbStats::PdbStats()
+{
+    memset(&_merged.totals, 0, sizeof(_merged.totals));
+    memset(_merged.pointsHistogram, 0, sizeof(_merged.pointsHistogram));
+    memset(_merged.bytesHistogram, 0, sizeof(_merged.bytesHistogram));
+}
+
+size_t PdbStats::GetBucket(uint64_t value)
+{
+    size_t bucket = 0;
+    while ((value != 0) && (bucket < HistogramBuckets - 1))
+    {
+        value >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+void PdbStats::Add(StatsCounters& counters, const StatsCounters& other)
+{
+    counters.methods += other.methods;
+    counters.sequencePoints += other.sequencePoints;
+    counters.hiddenSequencePoints += other.hiddenSequencePoints;
+    counters.sequencePointBytes += other.sequencePointBytes;
+    counters.nameBytes += other.nameBytes;
+}
+
+bool PdbStats::Compute(const PortablePdbParser& parser)
+{
+    const MetadataReader& metadata = parser.GetMetadata();
+    uint32_t methodCount = metadata.GetRowCount(TableMethodDebugInformation);
+    const MetadataReader* assemblyMetadata = parser.GetAssemblyMetadata();
+    size_t typeCount = (assemblyMetadata == nullptr) ? 0 : assemblyMetadata->GetRowCount(TableTypeDef);
+    size_t documentCount = metadata.GetRowCount(TableDocument);
+
+    // one contiguous slice of rows per thread: the accumulators are never shared
+    size_t sliceCount = (std::max)(std::thread::hardware_concurrency(), 1u);
+    sliceCount = (std::min)(sliceCount, static_cast<size_t>((std::max)(methodCount, 1u)));
+    std::vector<Accumulator> accumulators(sliceCount);
+    ParallelFor(sliceCount,
+        [&](size_t slice)
+        {
+            Accumulator& accumulator = accumulators[slice];
+            memset(&accumulator.totals, 0, sizeof(accumulator.totals));
+            memset(accumulator.pointsHistogram, 0, sizeof(accumulator.pointsHistogram));
+            memset(accumulator.bytesHistogram, 0, sizeof(accumulator.bytesHistogram));
+            accumulator.types.assign(typeCount + 1, StatsCounters());
+            accumulator.documents.assign(documentCount + 1, StatsCounters());
+
+            uint32_t firstRid = static_cast<uint32_t>(1 + methodCount * slice / sliceCount);
+            uint32_t endRid = static_cast<uint32_t>(1 + methodCount * (slice + 1) / sliceCount);
+            AccumulateMethods(parser, firstRid, endRid, accumulator);
+        });
+
+    _merged.types.assign(typeCount + 1, StatsCounters());
+    _merged.documents.assign(documentCount + 1, StatsCounters());
+    for (const Accumulator& accumulator : accumulators)
+    {
+        Merge(accumulator);
+    }
+
+    _tableRowCounts.clear();
+    for (const auto& table : DebugTables)
+    {
+        _tableRowCounts.push_back(metadata.GetRowCount(table.first));
+    }
+
+    ComputeContributors(parser);
+    return true;
+}
+
+void PdbStats::AccumulateMethods(const PortablePdbParser& parser, uint32_t firstRid, uint32_t endRid, Accumulator& accumulator) const
+{
+    const MetadataReader& metadata = parser.GetMetadata();
+    const MetadataReader* assemblyMetadata = parser.GetAssemblyMetadata();
+
+    // the sequence points of a method are decoded in the same buffer and only counted
+    std::vector<SequencePoint> points;
+    uint32_t typeRid = 0;
+    uint32_t nextTypeMethod = 0;
+    for (uint32_t rid = firstRid; rid < endRid; rid++)
+    {
+        // rows are sorted by method and MethodList is sorted: the declaring type only
+        // changes when the method list of the next type starts
+        uint32_t nameBytes = 0;
+        if (assemblyMetadata != nullptr)
+        {
+            if ((typeRid == 0) || ((nextTypeMethod != 0) && (rid >= nextTypeMethod)))
+            {
+                typeRid = assemblyMetadata->GetMethodDeclaringType(rid);
+                nextTypeMethod = (typeRid < assemblyMetadata->GetRowCount(TableTypeDef)) ?
+                    assemblyMetadata->GetValue(TableTypeDef, typeRid + 1, TypeDef_MethodList) : 0;
+            }
+            nameBytes = static_cast<uint32_t>(strlen(assemblyMetadata->GetString(assemblyMetadata->GetValue(TableMethodDef, rid, MethodDef_Name))));
+        }
+
+        const uint8_t* blob = nullptr;
+        uint32_t blobSize = 0;
+        uint32_t blobIndex = metadata.GetValue(TableMethodDebugInformation, rid, MethodDebugInformation_SequencePoints);
+        if ((blobIndex == 0) || !metadata.GetBlob(blobIndex, blob, blobSize))
+        {
+            blobSize = 0;
+        }
+
+        points.clear();
+        if ((blobSize != 0) && !parser.ReadSequencePoints(rid, points))
+        {
+            points.clear();
+        }
+
+        StatsCounters method;
+        method.methods = 1;
+        method.sequencePoints = points.size();
+        method.hiddenSequencePoints = 0;
+        method.sequencePointBytes = blobSize;
+        method.nameBytes = nameBytes;
+        for (const SequencePoint& point : points)
+        {
+            bool isHidden = (point.startLine == HiddenLineNumber);
+            method.hiddenSequencePoints += isHidden ? 1 : 0;
+
+            // points of a method can be in several documents (i.e. partial methods, #line)
+            if (point.document < accumulator.documents.size() - 1)
+            {
+                StatsCounters& document = accumulator.documents[point.document + 1];
+                document.sequencePoints++;
+                document.hiddenSequencePoints += isHidden ? 1 : 0;
+            }
+        }
+
+        // the method and its blob belong to its first document
+        uint32_t documentRid = metadata.GetValue(TableMethodDebugInformation, rid, MethodDebugInformation_Document);
+        if ((documentRid == 0) && !points.empty())
+        {
+            documentRid = points[0].document + 1;
+        }
+        if ((documentRid != 0) && (documentRid < accumulator.documents.size()))
+        {
+            accumulator.documents[documentRid].methods++;
+            accumulator.documents[documentRid].sequencePointBytes += blobSize;
+        }
+
+        Add(accumulator.types[(typeRid < accumulator.types.size()) ? typeRid : 0], method);
+        Add(accumulator.totals, method);
+        accumulator.pointsHistogram[GetBucket(method.sequencePoints)]++;
+        accumulator.bytesHistogram[GetBucket(method.sequencePointBytes)]++;
+    }
+}
+
+void PdbStats::Merge(const Accumulator& accumulator)
+{
+    Add(_merged.totals, accumulator.totals);
+    for (size_t i = 0; i < accumulator.types.size(); i++)
+    {
+        Add(_merged.types[i], accumulator.types[i]);
+    }
+    for (size_t i = 0; i < accumulator.documents.size(); i++)
+    {
+        Add(_merged.documents[i], accumulator.documents[i]);
+    }
+    for (size_t i = 0; i < HistogramBuckets; i++)
+    {
+        _merged.pointsHistogram[i] += accumulator.pointsHistogram[i];
+        _merged.bytesHistogram[i] += accumulator.bytesHistogram[i];
+    }
+}
+
+void PdbStats::ComputeContributors(const PortablePdbParser& parser)
+{
+    // names are only built for the types and documents that have methods
+    const MetadataReader* assemblyMetadata = parser.GetAssemblyMetadata();
+    std::unordered_map<std::string, size_t> namespaceIndexes;
+    _types.clear();
+    _namespaces.clear();
+    for (uint32_t typeRid = 0; typeRid < _merged.types.size(); typeRid++)
+    {
+        const StatsCounters& counters = _merged.types[typeRid];
+        if (counters.methods == 0)
+        {
+            continue;
+        }
+
+        Contributor type;
+        type.counters = counters;
+        std::string typeNamespace;
+        if ((typeRid == 0) || (assemblyMetadata == nullptr))
+        {
+            type.name = "<unknown>";
+            typeNamespace = "<unknown>";
+        }
+        else
+        {
+            type.name = assemblyMetadata->GetQualifiedTypeName(typeRid);
+            uint32_t outermostRid = assemblyMetadata->GetOutermostType(typeRid);
+            typeNamespace = assemblyMetadata->GetString(assemblyMetadata->GetValue(TableTypeDef, outermostRid, TypeDef_TypeNamespace));
+        }
+
+        auto found = namespaceIndexes.find(typeNamespace);
+        if (found == namespaceIndexes.end())
+        {
+            found = namespaceIndexes.emplace(typeNamespace, _namespaces.size()).first;
+            _namespaces.push_back({ typeNamespace, StatsCounters() });
+        }
+        Add(_namespaces[found->second].counters, counters);
+
+        _types.push_back(std::move(type));
+    }
+
+    _documents.clear();
+    const std::vector<std::string>& documentNames = parser.GetDocuments();
+    for (size_t documentRid = 1; documentRid < _merged.documents.size(); documentRid++)
+    {
+        Contributor document;
+        document.counters = _merged.documents[documentRid];
+        if (documentRid - 1 < documentNames.size())
+        {
+            document.name = documentNames[documentRid - 1];
+        }
+        document.counters.nameBytes = document.name.size();
+        _documents.push_back(std::move(document));
+    }
+}
+
+void PdbStats::WriteCounters(FILE* file, const StatsCounters& counters)
+{
+    fprintf(file, "\"methods\": %llu, \"sequencePoints\": %llu, \"hiddenSequencePoints\": %llu, \"sequencePointBytes\": %llu, \"nameBytes\": %llu",
+        static_cast<unsigned long long>(counters.methods),
+        static_cast<unsigned long long>(counters.sequencePoints),
+        static_cast<unsigned long long>(counters.hiddenSequencePoints),
+        static_cast<unsigned long long>(counters.sequencePointBytes),
+        static_cast<unsigned long long>(counters.nameBytes));
+}
+
+void PdbStats::WriteTop(FILE* file, const char* name, const std::vector<Contributor>& contributors, size_t topCount)
+{
+    // only the top entries are sorted
+    std::vector<const Contributor*> top;
+    top.reserve(contributors.size());
+    for (const Contributor& contributor : contributors)
+    {
+        top.push_back(&contributor);
+    }
+
+    size_t count = (std::min)(topCount, top.size());
+    std::partial_sort(top.begin(), top.begin() + count, top.end(),
+        [](const Contributor* left, const Contributor* right)
+        {
+            if (left->counters.sequencePoints != right->counters.sequencePoints)
+            {
+                return left->counters.sequencePoints > right->counters.sequencePoints;
+            }
+            return left->counters.sequencePointBytes > right->counters.sequencePointBytes;
+        });
+
+    fprintf(file, "  \"%s\": [\n", name);
+    for (size_t i = 0; i < count; i++)
+    {
+        fprintf(file, "    { \"name\": ");
+        WriteJsonString(file, top[i]->name);
+        fprintf(file, ", ");
+        WriteCounters(file, top[i]->counters);
+        fprintf(file, " }%s\n", (i + 1 < count) ? "," : "");
+    }
+    fprintf(file, "  ],\n");
+}
+
+void PdbStats::WriteHistogram(FILE* file, const char* name, const uint64_t* histogram)
+{
+    // empty buckets are skipped
+    fprintf(file, "    \"%s\": [", name);
+    bool first = true;
+    for (size_t bucket = 0; bucket < HistogramBuckets; bucket++)
+    {
+        if (histogram[bucket] == 0)
+        {
+            continue;
+        }
+
+        uint64_t min = (bucket == 0) ? 0 : (1ull << (bucket - 1));
+        uint64_t max = (bucket == 0) ? 0 : (1ull << bucket) - 1;
+        fprintf(file, "%s\n      { \"min\": %llu, \"max\": %llu, \"methods\": %llu }", first ? "" : ",",
+            static_cast<unsigned long long>(min),
+            static_cast<unsigned long long>(max),
+            static_cast<unsigned long long>(histogram[bucket]));
+        first = false;
+    }
+    fprintf(file, "\n    ]");
+}
+
+bool PdbStats::WriteJson(const std::string& filename, const std::string& pdbFilename, size_t topCount) const
+{
+    FILE* file = nullptr;
+    if ((fopen_s(&file, filename.c_str(), "wb") != 0) || (file == nullptr))
+    {
+        return false;
+    }
+
+    fprintf(file, "{\n  \"pdb\": ");
+    WriteJsonString(file, pdbFilename);
+    fprintf(file, ",\n  \"totals\": { ");
+    WriteCounters(file, _merged.totals);
+    fprintf(file, ", \"types\": %zu, \"namespaces\": %zu, \"documents\": %zu },\n", _types.size(), _namespaces.size(), _documents.size());
+
+    fprintf(file, "  \"tables\": { ");
+    for (size_t i = 0; i < _tableRowCounts.size(); i++)
+    {
+        fprintf(file, "%s\"%s\": %u", (i == 0) ? "" : ", ", DebugTables[i].second, _tableRowCounts[i]);
+    }
+    fprintf(file, " },\n");
+
+    WriteTop(file, "topTypes", _types, topCount);
+    WriteTop(file, "topNamespaces", _namespaces, topCount);
+    WriteTop(file, "topDocuments", _documents, topCount);
+
+    fprintf(file, "  \"histograms\": {\n");
+    WriteHistogram(file, "sequencePointsPerMethod", _merged.pointsHistogram);
+    fprintf(file, ",\n");
+    WriteHistogram(file, "sequencePointBytesPerMethod", _merged.bytesHistogram);
+    fprintf(file, "\n  }\n}\n");
+
+    bool succeeded = (ferror(file) == 0);
+    fclose(file);
+    return succeeded;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "PortablePdbParser.h"
+
+struct StatsCounters
+{
+    uint64_t methods;
+    uint64_t sequencePoints;
+    uint64_t hiddenSequencePoints;
+    uint64_t sequencePointBytes;    // size of the sequence points blobs
+    uint64_t nameBytes;             // method names (types and namespaces) or document name
+};
+
+// Where the size of a Portable PDB comes from: sequence points, methods and name bytes per
+// type, namespace and document. The MethodDebugInformation rows are read in a single pass
+// split in one contiguous slice per thread; each thread adds to its own dense arrays (indexed
+// by TypeDef and Document rid) that are merged at the end, so no MethodInfo is created.
+class PdbStats
+{
+public:
+    PdbStats();
+
+    bool Compute(const PortablePdbParser& parser);
+
+    // The topCount largest contributors (by sequence points) and the histograms per method
+    bool WriteJson(const std::string& filename, const std::string& pdbFilename, size_t topCount) const;
+
+private:
+    // bucket 0 = 0, bucket n = [2^(n-1), 2^n[
+    static const size_t HistogramBuckets = 33;
+
+    struct Accumulator
+    {
+        StatsCounters totals;
+        std::vector<StatsCounters> types;       // index = TypeDef rid (0 = unknown type)
+        std::vector<StatsCounters> documents;   // index = Document rid
+        uint64_t pointsHistogram[HistogramBuckets];
+        uint64_t bytesHistogram[HistogramBuckets];
+    };
+
+    struct Contributor
+    {
+        std::string name;
+        StatsCounters counters;
+    };
+
+private:
+    static size_t GetBucket(uint64_t value);
+    static void Add(StatsCounters& counters, const StatsCounters& other);
+    void AccumulateMethods(const PortablePdbParser& parser, uint32_t firstRid, uint32_t endRid, Accumulator& accumulator) const;
+    void Merge(const Accumulator& accumulator);
+    void ComputeContributors(const PortablePdbParser& parser);
+
+    static void WriteCounters(FILE* file, const StatsCounters& counters);
+    static void WriteTop(FILE* file, const char* name, const std::vector<Contributor>& contributors, size_t topCount);
+    static void WriteHistogram(FILE* file, const char* name, const uint64_t* histogram);
+
+private:
+    Accumulator _merged;
+    std::vector<uint32_t> _tableRowCounts;     // debug tables (see DebugTables)
+    std::vector<Contributor> _types;
+    std::vector<Contributor> _namespaces;
+    std::vector<Contributor> _documents;
+};
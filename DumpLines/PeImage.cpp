@@ -0,0 +1,234 @@
+#include "PeImage.h"
+#include "ByteReader.h"
+
+const uint16_t DosSignature = 0x5A4D;           // MZ
+const uint32_t PeSignature = 0x00004550;        // PE\0\0
+const uint16_t Pe32Magic = 0x10B;
+const uint16_t Pe32PlusMagic = 0x20B;
+const uint32_t ComDescriptorDirectory = 14;
+
+#pragma pack(push, 1)
+struct CoffHeader
+{
+    uint16_t Machine;
+    uint16_t NumberOfSections;
+    uint32_t TimeDateStamp;
+    uint32_t PointerToSymbolTable;
+    uint32_t NumberOfSymbols;
+    uint16_t SizeOfOptionalHeader;
+    uint16_t Characteristics;
+};
+
+struct SectionHeader
+{
+    char Name[8];
+    uint32_t VirtualSize;
+    uint32_t VirtualAddress;
+    uint32_t SizeOfRawData;
+    uint32_t PointerToRawData;
+    uint32_t PointerToRelocations;
+    uint32_t PointerToLinenumbers;
+    uint16_t NumberOfRelocations;
+    uint16_t NumberOfLinenumbers;
+    uint32_t Characteristics;
+};
+
+struct Cor20Header
+{
+    uint32_t cb;
+    uint16_t MajorRuntimeVersion;
+    uint16_t MinorRuntimeVersion;
+    PeDataDirectory MetaData;
+    uint32_t Flags;
+    uint32_t EntryPointToken;
+    PeDataDirectory Resources;
+    PeDataDirectory StrongNameSignature;
+    PeDataDirectory CodeManagerTable;
+    PeDataDirectory VTableFixups;
+    PeDataDirectory ExportAddressTableJumps;
+    PeDataDirectory ManagedNativeHeader;
+};
+#pragma pack(pop)
+
+
+PeImage::PeImage()
+    :
+    _is64Bit(false),
+    _machine(0),
+    _imageBase(0),
+    _sizeOfImage(0),
+    _corFlags(0),
+    _metadata({ 0, 0 }),
+    _managedNativeHeader({ 0, 0 })
+{
+}
+
+bool PeImage::Open(const std::string& filePath)
+{
+    if (!_file.Open(filePath))
+    {
+        return false;
+    }
+
+    ByteReader reader(_file.GetData(), _file.GetSize());
+    uint16_t dosSignature = 0;
+    uint32_t peHeaderOffset = 0;
+    if (!reader.Read(dosSignature) || (dosSignature != DosSignature) ||
+        !reader.Seek(0x3C) || !reader.Read(peHeaderOffset) || !reader.Seek(peHeaderOffset))
+    {
+        return false;
+    }
+
+    uint32_t peSignature = 0;
+    CoffHeader coffHeader;
+    if (!reader.Read(peSignature) || (peSignature != PeSignature) || !reader.Read(coffHeader))
+    {
+        return false;
+    }
+    _machine = coffHeader.Machine;
+
+    // the optional header layout depends on PE32 vs PE32+
+    size_t optionalHeaderStart = reader.GetPosition();
+    uint16_t magic = 0;
+    if (!reader.Read(magic))
+    {
+        return false;
+    }
+
+    uint32_t dataDirectoriesOffset = 0;
+    if (magic == Pe32Magic)
+    {
+        uint32_t imageBase = 0;
+        reader.Seek(optionalHeaderStart + 28);
+        reader.Read(imageBase);
+        _imageBase = imageBase;
+        dataDirectoriesOffset = 96;
+    }
+    else
+    if (magic == Pe32PlusMagic)
+    {
+        _is64Bit = true;
+        reader.Seek(optionalHeaderStart + 24);
+        reader.Read(_imageBase);
+        dataDirectoriesOffset = 112;
+    }
+    else
+    {
+        return false;
+    }
+
+    reader.Seek(optionalHeaderStart + 56);
+    reader.Read(_sizeOfImage);
+
+    uint32_t directoryCount = 0;
+    reader.Seek(optionalHeaderStart + dataDirectoriesOffset - sizeof(uint32_t));
+    reader.Read(directoryCount);
+
+    PeDataDirectory comDescriptor = { 0, 0 };
+    if (directoryCount > ComDescriptorDirectory)
+    {
+        reader.Seek(optionalHeaderStart + dataDirectoriesOffset + ComDescriptorDirectory * sizeof(PeDataDirectory));
+        reader.Read(comDescriptor);
+    }
+
+    if (!reader.Seek(optionalHeaderStart + coffHeader.SizeOfOptionalHeader))
+    {
+        return false;
+    }
+
+    _sections.resize(coffHeader.NumberOfSections);
+    for (Section& section : _sections)
+    {
+        SectionHeader header;
+        if (!reader.Read(header))
+        {
+            return false;
+        }
+
+        section.virtualAddress = header.VirtualAddress;
+        section.virtualSize = header.VirtualSize;
+        section.pointerToRawData = header.PointerToRawData;
+        section.sizeOfRawData = header.SizeOfRawData;
+    }
+
+    // native images don't have a CLI header
+    if (comDescriptor.rva == 0)
+    {
+        return true;
+    }
+
+    const uint8_t* pCorHeader = RvaToPointer(comDescriptor.rva, sizeof(Cor20Header));
+    if (pCorHeader == nullptr)
+    {
+        return false;
+    }
+
+    Cor20Header corHeader;
+    memcpy(&corHeader, pCorHeader, sizeof(corHeader));
+    _corFlags = corHeader.Flags;
+    _metadata = corHeader.MetaData;
+    _managedNativeHeader = corHeader.ManagedNativeHeader;
+
+    return true;
+}
+
+const uint8_t* PeImage::RvaToPointer(uint32_t rva, uint32_t size) const
+{
+    for (const Section& section : _sections)
+    {
+        if ((rva >= section.virtualAddress) && (rva - section.virtualAddress < section.sizeOfRawData))
+        {
+            uint32_t offsetInSection = rva - section.virtualAddress;
+            if (size > section.sizeOfRawData - offsetInSection)
+            {
+                return nullptr;
+            }
+
+            uint64_t fileOffset = static_cast<uint64_t>(section.pointerToRawData) + offsetInSection;
+            if (fileOffset + size > _file.GetSize())
+            {
+                return nullptr;
+            }
+
+            return _file.GetData() + fileOffset;
+        }
+    }
+
+    return nullptr;
+}
+
+const uint8_t* PeImage::GetMetadata(uint32_t& size) const
+{
+    size = _metadata.size;
+    return RvaToPointer(_metadata.rva, _metadata.size);
+}
+
+
+bool GetAssemblyPathFromPdb(const std::string& pdbFilePath, std::string& assemblyPath)
+{
+    // Replace .pdb extension with .dll or .exe
+    size_t dotPos = pdbFilePath.rfind(".pdb");
+    if (dotPos == std::string::npos || dotPos != pdbFilePath.length() - 4)
+    {
+        return false; // Not a .pdb file
+    }
+
+    // Try .dll first, then .exe
+    // NOTE: .exe are not managed assemblies in .NET Core so .dll first
+    std::string dllPath = pdbFilePath.substr(0, dotPos) + ".dll";
+    std::string exePath = pdbFilePath.substr(0, dotPos) + ".exe";
+
+    if (GetFileAttributesA(dllPath.c_str()) != INVALID_FILE_ATTRIBUTES)
+    {
+        assemblyPath = dllPath;
+        return true;
+    }
+
+    if (GetFileAttributesA(exePath.c_str()) != INVALID_FILE_ATTRIBUTES)
+    {
+        assemblyPath = exePath;
+        return true;
+    }
+
+    return false; // Cannot find corresponding assembly file
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "MappedFile.h"
+
+struct PeDataDirectory
+{
+    uint32_t rva;
+    uint32_t size;
+};
+
+// Minimal parser for the headers of a PE file on disk (not a loaded image):
+// sections (to translate RVAs into file offsets) and the CLI header of managed assemblies
+class PeImage
+{
+public:
+    PeImage();
+
+    bool Open(const std::string& filePath);
+
+    // Return nullptr if the range is not mapped by a section of the file
+    const uint8_t* RvaToPointer(uint32_t rva, uint32_t size) const;
+
+    bool IsManaged() const { return _metadata.size != 0; }
+    bool Is64Bit() const { return _is64Bit; }
+    uint16_t GetMachine() const { return _machine; }
+    uint64_t GetImageBase() const { return _imageBase; }
+    uint32_t GetSizeOfImage() const { return _sizeOfImage; }
+
+    // CLI header content
+    uint32_t GetCorFlags() const { return _corFlags; }
+    const uint8_t* GetMetadata(uint32_t& size) const;
+    PeDataDirectory GetManagedNativeHeader() const { return _managedNativeHeader; }
+
+private:
+    struct Section
+    {
+        uint32_t virtualAddress;
+        uint32_t virtualSize;
+        uint32_t pointerToRawData;
+        uint32_t sizeOfRawData;
+    };
+
+private:
+    MappedFile _file;
+    bool _is64Bit;
+    uint16_t _machine;
+    uint64_t _imageBase;
+    uint32_t _sizeOfImage;
+    std::vector<Section> _sections;
+    uint32_t _corFlags;
+    PeDataDirectory _metadata;
+    PeDataDirectory _managedNativeHeader;
+};
+
+// Find the .dll (or .exe) next to a .pdb file
+bool GetAssemblyPathFromPdb(const std::string& pdbFilePath, std::string& assemblyPath);
@@ -0,0 +1,158 @@
+#include <windows.h>
+#include "PerfMapWriter.h"
+#include "ByteWriter.h"
+
+const uint32_t JitDumpMagic = 0x4A695444;     // JiTD
+const uint32_t JitDumpVersion = 1;
+const uint32_t JitDumpHeaderSize = 40;
+const uint32_t JitCodeLoad = 0;
+
+// JIT_CODE_LOAD record without the name and the code
+const uint32_t JitCodeLoadSize = 2 * sizeof(uint32_t) + sizeof(uint64_t) + 2 * sizeof(uint32_t) + 4 * sizeof(uint64_t);
+
+
+static bool WriteWholeFile(const std::string& filePath, const void* data, size_t size, bool append)
+{
+    HANDLE hFile = CreateFileA(
+        filePath.c_str(),
+        GENERIC_WRITE,
+        FILE_SHARE_READ,
+        NULL,
+        append ? OPEN_ALWAYS : CREATE_ALWAYS,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+        NULL
+    );
+    if (hFile == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    // an offset of 0xFFFFFFFF:0xFFFFFFFF appends at the end of the file
+    OVERLAPPED overlapped = { 0 };
+    if (append)
+    {
+        overlapped.Offset = 0xFFFFFFFF;
+        overlapped.OffsetHigh = 0xFFFFFFFF;
+    }
+
+    bool success = true;
+    const uint8_t* current = static_cast<const uint8_t*>(data);
+    while (success && (size > 0))
+    {
+        DWORD chunk = (size > 0x40000000) ? 0x40000000 : static_cast<DWORD>(size);
+        DWORD written = 0;
+        success = WriteFile(hFile, current, chunk, &written, append ? &overlapped : NULL) && (written == chunk);
+        current += chunk;
+        size -= chunk;
+    }
+
+    CloseHandle(hFile);
+    return success;
+}
+
+
+PerfMapWriter::PerfMapWriter()
+    :
+    _count(0)
+{
+}
+
+void PerfMapWriter::Reserve(size_t methodCount, size_t nameBytes)
+{
+    // 16 digits for the start + 8 for the size + 2 spaces + newline
+    _buffer.reserve(_buffer.size() + methodCount * 27 + nameBytes);
+}
+
+void PerfMapWriter::AppendHex(uint64_t value)
+{
+    static const char Digits[] = "0123456789abcdef";
+
+    char digits[16];
+    int count = 0;
+    do
+    {
+        digits[count++] = Digits[value & 0xF];
+        value >>= 4;
+    } while (value != 0);
+
+    while (count > 0)
+    {
+        _buffer.push_back(digits[--count]);
+    }
+}
+
+void PerfMapWriter::Add(uint64_t start, uint32_t size, const std::string& name)
+{
+    AppendHex(start);
+    _buffer.push_back(' ');
+    AppendHex(size);
+    _buffer.push_back(' ');
+    _buffer.insert(_buffer.end(), name.begin(), name.end());
+    _buffer.push_back('\n');
+    _count++;
+}
+
+bool PerfMapWriter::Write(const std::string& filePath, bool append) const
+{
+    return WriteWholeFile(filePath, _buffer.data(), _buffer.size(), append);
+}
+
+
+JitDumpWriter::JitDumpWriter(uint16_t peMachine, uint32_t pid, uint64_t timestamp)
+    :
+    _pid(pid),
+    _timestamp(timestamp),
+    _count(0)
+{
+    ByteWriter writer(_buffer);
+    writer.Write(JitDumpMagic);
+    writer.Write(JitDumpVersion);
+    writer.Write(JitDumpHeaderSize);
+    writer.Write(GetElfMachine(peMachine));
+    writer.Write(static_cast<uint32_t>(0));     // padding
+    writer.Write(pid);
+    writer.Write(timestamp);
+    writer.Write(static_cast<uint64_t>(0));     // flags
+}
+
+uint32_t JitDumpWriter::GetElfMachine(uint16_t peMachine)
+{
+    switch (peMachine)
+    {
+        case 0x014C: return 3;      // i386 -> EM_386
+        case 0x01C4: return 40;     // ARMNT -> EM_ARM
+        case 0x8664: return 62;     // AMD64 -> EM_X86_64
+        case 0xAA64: return 183;    // ARM64 -> EM_AARCH64
+        default: return 0;
+    }
+}
+
+void JitDumpWriter::Reserve(size_t methodCount, size_t byteCount)
+{
+    // byteCount = size of the names and of the code
+    _buffer.reserve(_buffer.size() + methodCount * (JitCodeLoadSize + 1) + byteCount);
+}
+
+void JitDumpWriter::AddCodeLoad(uint64_t start, const uint8_t* code, uint32_t size, const std::string& name)
+{
+    uint32_t totalSize = JitCodeLoadSize + static_cast<uint32_t>(name.size()) + 1 + size;
+
+    ByteWriter writer(_buffer);
+    writer.Write(JitCodeLoad);
+    writer.Write(totalSize);
+    writer.Write(_timestamp);
+    writer.Write(_pid);
+    writer.Write(_pid);                                 // tid
+    writer.Write(start);                                // vma
+    writer.Write(start);                                // code address
+    writer.Write(static_cast<uint64_t>(size));
+    writer.Write(static_cast<uint64_t>(_count));        // code index
+    writer.WriteBytes(name.c_str(), name.size() + 1);
+    writer.WriteBytes(code, size);
+    _count++;
+}
+
+bool JitDumpWriter::Write(const std::string& filePath) const
+{
+    return WriteWholeFile(filePath, _buffer.data(), _buffer.size(), false);
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Writers for the symbol files used by Linux perf to resolve addresses in code that
+// is not described by an ELF image. All records are formatted into one pre-sized buffer
+// that is written with a single call so that exporting a whole module is cheap enough
+// to be done when a profiler attaches.
+
+// perf-<pid>.map: one "START SIZE name" line per method (hexadecimal without 0x)
+class PerfMapWriter
+{
+public:
+    PerfMapWriter();
+
+    void Reserve(size_t methodCount, size_t nameBytes);
+    void Add(uint64_t start, uint32_t size, const std::string& name);
+    size_t GetCount() const { return _count; }
+
+    // perf reads /tmp/perf-<pid>.map: each module of a process is appended to the same file
+    bool Write(const std::string& filePath, bool append) const;
+
+private:
+    void AppendHex(uint64_t value);
+
+private:
+    std::vector<char> _buffer;
+    size_t _count;
+};
+
+// jit-<pid>.dump: header + one JIT_CODE_LOAD record (with the code bytes) per method
+class JitDumpWriter
+{
+public:
+    JitDumpWriter(uint16_t peMachine, uint32_t pid, uint64_t timestamp);
+
+    void Reserve(size_t methodCount, size_t byteCount);
+    void AddCodeLoad(uint64_t start, const uint8_t* code, uint32_t size, const std::string& name);
+    size_t GetCount() const { return _count; }
+
+    bool Write(const std::string& filePath) const;
+
+    // ELF e_machine value corresponding to a PE machine (0 if unknown)
+    static uint32_t GetElfMachine(uint16_t peMachine);
+
+private:
+    std::vector<uint8_t> _buffer;
+    uint32_t _pid;
+    uint64_t _timestamp;
+    size_t _count;
+};
@@ -0,0 +1,491 @@
+#include "PortablePdbParser.h"
+#include "PdbFormat.h"
+#include "ByteReader.h"
+
+#include <algorithm>
+#include <cstring>
+
+
+PortablePdbParser::PortablePdbParser()
+    :
+    _hasAssembly(false),
+    _methodsComputed(false),
+    _tokensComputed(false),
+    _age(0)
+{
+}
+
+PortablePdbParser::~PortablePdbParser()
+{
+}
+
+bool PortablePdbParser::IsPortablePdb(const std::string& pdbFilePath)
+{
+    return DetectPdbFormat(pdbFilePath) == PdbFormat::Portable;
+}
+
+bool PortablePdbParser::LoadPdbFile(const std::string& pdbFilePath)
+{
+    if (!_pdbFile.Open(pdbFilePath))
+    {
+        return false;
+    }
+
+    if (!_metadata.Open(_pdbFile.GetData(), _pdbFile.GetSize()) || !_metadata.IsPortablePdb())
+    {
+        return false;
+    }
+
+    // PDB id = GUID + timestamp; the age of Portable PDBs is always 1
+    _guid = FormatPdbGuid(_metadata.GetPdbId());
+    _age = 1;
+
+    // method names are only available from the metadata of the assembly
+    std::string assemblyPath;
+    if (GetAssemblyPathFromPdb(pdbFilePath, assemblyPath) && _assembly.Open(assemblyPath))
+    {
+        uint32_t metadataSize = 0;
+        const uint8_t* pMetadata = _assembly.GetMetadata(metadataSize);
+        _hasAssembly = (pMetadata != nullptr) && _assemblyMetadata.Open(pMetadata, metadataSize);
+    }
+
+    // Compute source files
+    if (!ComputeDocuments())
+    {
+        return false;
+    }
+
+    // method info and tokens are computed by the first GetMethods() / GetTokens() call
+    return true;
+}
+
+std::string PortablePdbParser::GetDocumentName(uint32_t documentRid) const
+{
+    // blob = separator + list of blob indexes of the UTF-8 parts
+    const uint8_t* blob = nullptr;
+    uint32_t blobSize = 0;
+    if (!_metadata.GetBlob(_metadata.GetValue(TableDocument, documentRid, Document_Name), blob, blobSize) || (blobSize == 0))
+    {
+        return "";
+    }
+
+    ByteReader reader(blob, blobSize);
+    uint8_t separator = 0;
+    reader.Read(separator);
+
+    std::string name;
+    bool first = true;
+    uint32_t partIndex = 0;
+    while (reader.ReadCompressedUInt(partIndex))
+    {
+        if (!first && (separator != 0))
+        {
+            name += static_cast<char>(separator);
+        }
+        first = false;
+
+        const uint8_t* part = nullptr;
+        uint32_t partSize = 0;
+        if ((partIndex != 0) && _metadata.GetBlob(partIndex, part, partSize))
+        {
+            name.append(reinterpret_cast<const char*>(part), partSize);
+        }
+    }
+
+    return name;
+}
+
+bool PortablePdbParser::ComputeDocuments()
+{
+    uint32_t documentCount = _metadata.GetRowCount(TableDocument);
+    _documents.reserve(documentCount);
+    for (uint32_t rid = 1; rid <= documentCount; rid++)
+    {
+        _documents.push_back(GetDocumentName(rid));
+    }
+
+    return true;
+}
+
+std::string PortablePdbParser::GetMethodName(uint32_t token) const
+{
+    char buffer[16];
+    return GetMethodName(token, buffer);
+}
+
+const char* PortablePdbParser::GetMethodName(uint32_t token, char (&buffer)[16]) const
+{
+    if (_hasAssembly)
+    {
+        const char* name = _assemblyMetadata.GetString(_assemblyMetadata.GetValue(TableMethodDef, RidFromToken(token), MethodDef_Name));
+        if (*name != '\0')
+        {
+            return name;
+        }
+    }
+
+    // Fallback to token if we can't get the name
+    snprintf(buffer, sizeof(buffer), "0x%08x", token);
+    return buffer;
+}
+
+bool PortablePdbParser::ReadSequencePoints(uint32_t methodRid, std::vector<SequencePoint>& points) const
+{
+    const uint8_t* blob = nullptr;
+    uint32_t blobSize = 0;
+    uint32_t blobIndex = _metadata.GetValue(TableMethodDebugInformation, methodRid, MethodDebugInformation_SequencePoints);
+    if ((blobIndex == 0) || !_metadata.GetBlob(blobIndex, blob, blobSize))
+    {
+        return false;
+    }
+
+    // header: local signature + initial document (only if the method spans several documents)
+    ByteReader reader(blob, blobSize);
+    uint32_t localSignature = 0;
+    uint32_t document = _metadata.GetValue(TableMethodDebugInformation, methodRid, MethodDebugInformation_Document);
+    if (!reader.ReadCompressedUInt(localSignature) || ((document == 0) && !reader.ReadCompressedUInt(document)))
+    {
+        return false;
+    }
+
+    uint32_t token = MethodDefTokenType | methodRid;
+    uint32_t ilOffset = 0;
+    uint32_t previousStartLine = 0;
+    uint32_t previousStartColumn = 0;
+    bool firstRecord = true;
+    bool firstNonHidden = true;
+    while (reader.GetRemaining() > 0)
+    {
+        uint32_t deltaIlOffset = 0;
+        if (!reader.ReadCompressedUInt(deltaIlOffset))
+        {
+            return false;
+        }
+
+        // document record
+        if (!firstRecord && (deltaIlOffset == 0))
+        {
+            if (!reader.ReadCompressedUInt(document))
+            {
+                return false;
+            }
+            continue;
+        }
+
+        ilOffset = firstRecord ? deltaIlOffset : ilOffset + deltaIlOffset;
+        firstRecord = false;
+
+        uint32_t deltaLines = 0;
+        int32_t deltaColumns = 0;
+        if (!reader.ReadCompressedUInt(deltaLines))
+        {
+            return false;
+        }
+
+        if (deltaLines == 0)
+        {
+            uint32_t columns = 0;
+            if (!reader.ReadCompressedUInt(columns))
+            {
+                return false;
+            }
+            deltaColumns = static_cast<int32_t>(columns);
+        }
+        else
+        if (!reader.ReadCompressedInt(deltaColumns))
+        {
+            return false;
+        }
+
+        SequencePoint point;
+        point.token = token;
+        point.ilOffset = ilOffset;
+        point.document = document - 1;
+
+        if ((deltaLines == 0) && (deltaColumns == 0))
+        {
+            point.startLine = HiddenLineNumber;
+            point.endLine = HiddenLineNumber;
+            point.startColumn = 0;
+            point.endColumn = 0;
+            points.push_back(point);
+            continue;
+        }
+
+        // the first non hidden sequence point stores absolute values; then deltas are signed
+        if (firstNonHidden)
+        {
+            if (!reader.ReadCompressedUInt(previousStartLine) || !reader.ReadCompressedUInt(previousStartColumn))
+            {
+                return false;
+            }
+            firstNonHidden = false;
+        }
+        else
+        {
+            int32_t deltaStartLine = 0;
+            int32_t deltaStartColumn = 0;
+            if (!reader.ReadCompressedInt(deltaStartLine) || !reader.ReadCompressedInt(deltaStartColumn))
+            {
+                return false;
+            }
+            previousStartLine += deltaStartLine;
+            previousStartColumn += deltaStartColumn;
+        }
+
+        point.startLine = previousStartLine;
+        point.startColumn = static_cast<uint16_t>(previousStartColumn);
+        point.endLine = previousStartLine + deltaLines;
+        point.endColumn = static_cast<uint16_t>(previousStartColumn + deltaColumns);
+        points.push_back(point);
+    }
+
+    return true;
+}
+
+std::vector<SequencePoint> PortablePdbParser::GetSequencePoints()
+{
+    std::vector<SequencePoint> points;
+    uint32_t methodCount = _metadata.GetRowCount(TableMethodDebugInformation);
+    for (uint32_t rid = 1; rid <= methodCount; rid++)
+    {
+        ReadSequencePoints(rid, points);
+    }
+
+    return points;
+}
+
+std::vector<uint32_t> PortablePdbParser::GetKickoffMethods() const
+{
+    uint32_t methodCount = _metadata.GetRowCount(TableMethodDebugInformation);
+    std::vector<uint32_t> kickoffMethods(methodCount + 1, 0);
+
+    // iterators and async methods compiled by Roslyn: the StateMachineMethod table is the only
+    // MoveNext -> kickoff link (the async stepping information is attached to MoveNext itself)
+    uint32_t stateMachineCount = _metadata.GetRowCount(TableStateMachineMethod);
+    for (uint32_t rid = 1; rid <= stateMachineCount; rid++)
+    {
+        uint32_t moveNext = _metadata.GetValue(TableStateMachineMethod, rid, StateMachineMethod_MoveNextMethod);
+        if ((moveNext != 0) && (moveNext <= methodCount))
+        {
+            kickoffMethods[moveNext] = _metadata.GetValue(TableStateMachineMethod, rid, StateMachineMethod_KickoffMethod);
+        }
+    }
+
+    return kickoffMethods;
+}
+
+MethodInfo PortablePdbParser::CreateMethodInfo(uint32_t methodRid, const std::vector<SequencePoint>& points) const
+{
+    uint32_t token = MethodDefTokenType | methodRid;
+
+    MethodInfo info;
+    info.index = token;
+    info.modBase = 0;
+    info.address = 0;
+    info.size = 0;
+    info.rva = token;
+    info.name = GetMethodName(token);
+    info.sourceFile = "";
+    info.lineNumber = 0;
+
+    // Get the first sequence point's document and line
+    if (!points.empty() && (points[0].document < _documents.size()))
+    {
+        info.sourceFile = _documents[points[0].document];
+        info.lineNumber = points[0].startLine;
+    }
+
+    return info;
+}
+
+bool PortablePdbParser::ComputeMethodsInfo()
+{
+    // MethodDebugInformation has one row per MethodDef: rid = MethodDef rid
+    uint32_t methodCount = _metadata.GetRowCount(TableMethodDebugInformation);
+    _methods.reserve(methodCount);
+
+    std::vector<SequencePoint> points;
+    for (uint32_t rid = 1; rid <= methodCount; rid++)
+    {
+        points.clear();
+        if (!ReadSequencePoints(rid, points))
+        {
+            points.clear();
+        }
+        _methods.push_back(CreateMethodInfo(rid, points));
+    }
+
+    // NOTE: methods are by design sorted by token
+
+    return true;
+}
+
+std::vector<uint8_t> PortablePdbParser::GetTypeCandidates(const MethodFilter& filter) const
+{
+    // 1 for each MethodDef rid declared by a matching type
+    uint32_t methodCount = _metadata.GetRowCount(TableMethodDebugInformation);
+    std::vector<uint8_t> candidates(methodCount + 1, 0);
+    if (!_hasAssembly)
+    {
+        // type names are only in the assembly
+        return candidates;
+    }
+
+    uint32_t typeCount = _assemblyMetadata.GetRowCount(TableTypeDef);
+    for (uint32_t typeRid = 1; typeRid <= typeCount; typeRid++)
+    {
+        // nested types have no namespace: use the one of the outermost type
+        uint32_t outerRid = _assemblyMetadata.GetOutermostType(typeRid);
+        const char* typeNamespace = _assemblyMetadata.GetString(_assemblyMetadata.GetValue(TableTypeDef, outerRid, TypeDef_TypeNamespace));
+        const char* typeName = _assemblyMetadata.GetString(_assemblyMetadata.GetValue(TableTypeDef, typeRid, TypeDef_TypeName));
+        if (!filter.MatchType(typeNamespace, typeName))
+        {
+            continue;
+        }
+
+        uint32_t firstMethod = _assemblyMetadata.GetValue(TableTypeDef, typeRid, TypeDef_MethodList);
+        uint32_t lastMethod = _assemblyMetadata.GetListEnd(TableTypeDef, typeRid, TypeDef_MethodList, TableMethodDef);
+        for (uint32_t methodRid = firstMethod; (methodRid <= lastMethod) && (methodRid <= methodCount); methodRid++)
+        {
+            candidates[methodRid] = 1;
+        }
+    }
+
+    return candidates;
+}
+
+std::vector<MethodInfo> PortablePdbParser::GetMethods(const MethodFilter& filter)
+{
+    if (filter.IsEmpty())
+    {
+        return GetMethods();
+    }
+
+    uint32_t methodCount = _metadata.GetRowCount(TableMethodDebugInformation);
+    std::vector<uint8_t> candidates = filter.HasTypePredicate() ? GetTypeCandidates(filter) : std::vector<uint8_t>(methodCount + 1, 1);
+
+    // the file predicate is checked once per document instead of once per method
+    std::vector<uint8_t> documentMatches(_documents.size(), 1);
+    if (filter.HasDocumentPredicate())
+    {
+        for (size_t i = 0; i < _documents.size(); i++)
+        {
+            documentMatches[i] = filter.MatchDocument(_documents[i]) ? 1 : 0;
+        }
+    }
+    bool needPoints = filter.HasDocumentPredicate() || filter.HasLineRange();
+
+    std::vector<MethodInfo> methods;
+    std::vector<SequencePoint> points;
+    for (uint32_t rid = 1; rid <= methodCount; rid++)
+    {
+        if (!candidates[rid])
+        {
+            continue;
+        }
+
+        // methods spanning a single document store it in the row: no need to decode the blob
+        uint32_t document = _metadata.GetValue(TableMethodDebugInformation, rid, MethodDebugInformation_Document);
+        if ((document != 0) && (document <= documentMatches.size()) && !documentMatches[document - 1])
+        {
+            continue;
+        }
+
+        // matched in the string heap: no string is built for the methods that are filtered out
+        char tokenName[16];
+        if (filter.HasNamePredicate() && !filter.MatchName(GetMethodName(MethodDefTokenType | rid, tokenName)))
+        {
+            continue;
+        }
+
+        points.clear();
+        if (!ReadSequencePoints(rid, points))
+        {
+            points.clear();
+        }
+        if (needPoints)
+        {
+            bool found = false;
+            for (const SequencePoint& point : points)
+            {
+                if ((point.startLine != HiddenLineNumber) &&
+                    (point.document < documentMatches.size()) && documentMatches[point.document] &&
+                    filter.MatchLine(point.startLine))
+                {
+                    found = true;
+                    break;
+                }
+            }
+
+            if (!found)
+            {
+                continue;
+            }
+        }
+
+        methods.push_back(CreateMethodInfo(rid, points));
+    }
+
+    return methods;
+}
+
+bool PortablePdbParser::ComputeTokens()
+{
+    // only methods with sequence points have symbols
+    uint32_t methodCount = _metadata.GetRowCount(TableMethodDebugInformation);
+    _tokens.reserve(methodCount);
+    for (uint32_t rid = 1; rid <= methodCount; rid++)
+    {
+        if (_metadata.GetValue(TableMethodDebugInformation, rid, MethodDebugInformation_SequencePoints) == 0)
+        {
+            continue;
+        }
+
+        TokenInfo info;
+        info.token = MethodDefTokenType | rid;
+        info.index = info.token;
+        info.flags = 0;
+        info.value = 0;
+        info.address = 0;
+        info.tag = 0;
+
+        char name[16];
+        snprintf(name, sizeof(name), " 0x%08x", info.token);
+        info.name = name;
+
+        _tokens.push_back(info);
+    }
+
+    return true;
+}
+
+std::vector<MethodInfo> PortablePdbParser::GetMethods()
+{
+    if (!_methodsComputed)
+    {
+        ComputeMethodsInfo();
+        _methodsComputed = true;
+    }
+
+    return _methods;
+}
+
+std::vector<std::string> PortablePdbParser::GetSourceFiles()
+{
+    // Sort alphabetically
+    std::vector<std::string> sourceFiles = _documents;
+    std::sort(sourceFiles.begin(), sourceFiles.end());
+    return sourceFiles;
+}
+
+std::vector<TokenInfo> PortablePdbParser::GetTokens()
+{
+    if (!_tokensComputed)
+    {
+        ComputeTokens();
+        _tokensComputed = true;
+    }
+
+    return _tokens;
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <windows.h>
+#include <string>
+#include <vector>
+#include "PdbCommon.h"
+#include "MethodFilter.h"
+#include "MappedFile.h"
+#include "MetadataReader.h"
+#include "PeImage.h"
+
+// Parser that reads Portable PDB files directly (no COM): the debug tables share
+// the ECMA-335 metadata format and method names come from the companion assembly
+class PortablePdbParser
+{
+public:
+    PortablePdbParser();
+    ~PortablePdbParser();
+
+    bool LoadPdbFile(const std::string& pdbFilePath);
+    std::vector<MethodInfo> GetMethods();
+
+    // Only the methods matching the filter: the predicates are checked on the metadata
+    // (names, document rows) before the sequence points are decoded
+    std::vector<MethodInfo> GetMethods(const MethodFilter& filter);
+
+    std::vector<std::string> GetSourceFiles();
+    std::vector<TokenInfo> GetTokens();
+    std::string GetGuid() const { return _guid; }
+    DWORD GetAge() const { return _age; }
+
+    // Documents in Document table order: SequencePoint::document is an index in this list
+    const std::vector<std::string>& GetDocuments() const { return _documents; }
+
+    // All sequence points sorted by method token and IL offset (decoded in a single pass)
+    std::vector<SequencePoint> GetSequencePoints();
+
+    // Append the sequence points of the given method
+    bool ReadSequencePoints(uint32_t methodRid, std::vector<SequencePoint>& points) const;
+
+    // Dense array indexed by MethodDef rid: rid of the kickoff method for the MoveNext methods of
+    // async and iterator state machines, 0 for the other methods
+    std::vector<uint32_t> GetKickoffMethods() const;
+
+    const MetadataReader& GetMetadata() const { return _metadata; }
+
+    // Return nullptr if the assembly was not found next to the .pdb file
+    const MetadataReader* GetAssemblyMetadata() const { return _hasAssembly ? &_assemblyMetadata : nullptr; }
+    const PeImage* GetAssemblyImage() const { return _hasAssembly ? &_assembly : nullptr; }
+
+    // Portable PDB files start with the BSJB signature of the metadata root
+    static bool IsPortablePdb(const std::string& pdbFilePath);
+
+private:
+    bool ComputeDocuments();
+    bool ComputeMethodsInfo();
+    bool ComputeTokens();
+    MethodInfo CreateMethodInfo(uint32_t methodRid, const std::vector<SequencePoint>& points) const;
+    std::vector<uint8_t> GetTypeCandidates(const MethodFilter& filter) const;
+    std::string GetDocumentName(uint32_t documentRid) const;
+    std::string GetMethodName(uint32_t token) const;
+
+    // Name in the string heap of the assembly, or the token formatted in buffer
+    const char* GetMethodName(uint32_t token, char (&buffer)[16]) const;
+
+private:
+    MappedFile _pdbFile;
+    MetadataReader _metadata;
+    PeImage _assembly;
+    MetadataReader _assemblyMetadata;
+    bool _hasAssembly;
+
+    std::vector<std::string> _documents;
+    // methods and tokens are computed on first use (a filtered enumeration doesn't need them)
+    std::vector<MethodInfo> _methods;
+    std::vector<TokenInfo> _tokens;
+    bool _methodsComputed;
+    bool _tokensComputed;
+    std::string _guid;
+    DWORD _age;
+};
@@ -0,0 +1,183 @@
+#include "ProcessSymbolIndex.h"
+#include "ReadAheadPipeline.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <thread>
+
+const size_t ReadAheadPerWorker = 2;    // files read ahead for each parsing thread
+
+
+static std::string GetPdbPathFromImage(const std::string& imagePath)
+{
+    size_t dotPos = imagePath.rfind('.');
+    size_t separatorPos = imagePath.find_last_of("\\/");
+    if ((dotPos == std::string::npos) || ((separatorPos != std::string::npos) && (dotPos < separatorPos)))
+    {
+        return imagePath + ".pdb";
+    }
+
+    return imagePath.substr(0, dotPos) + ".pdb";
+}
+
+
+ProcessSymbolIndex::ProcessSymbolIndex()
+{
+    memset(&_readAheadStats, 0, sizeof(_readAheadStats));
+}
+
+bool ProcessSymbolIndex::ReadModuleList(const std::string& filePath, std::vector<ProcessModule>& modules)
+{
+    std::ifstream file(filePath);
+    if (!file)
+    {
+        return false;
+    }
+
+    // no fixed size buffer: long image paths must not be split
+    bool success = true;
+    std::string line;
+    while (std::getline(file, line))
+    {
+        size_t first = line.find_first_not_of(" \t");
+        if ((first == std::string::npos) || (line[first] == '\r') || (line[first] == '#'))
+        {
+            continue;
+        }
+
+        ProcessModule module;
+        char* end = nullptr;
+        module.baseAddress = strtoull(line.c_str() + first, &end, 16);
+        module.size = static_cast<uint32_t>(strtoul(end, &end, 16));
+        while ((*end == ' ') || (*end == '\t'))
+        {
+            end++;
+        }
+
+        module.imagePath = end;
+        while (!module.imagePath.empty() && (module.imagePath.back() == '\r'))
+        {
+            module.imagePath.pop_back();
+        }
+
+        if (module.imagePath.empty() || (module.size == 0))
+        {
+            success = false;
+            break;
+        }
+        modules.push_back(module);
+    }
+
+    return success;
+}
+
+bool ProcessSymbolIndex::Load(const std::vector<ProcessModule>& modules)
+{
+    _modules = modules;
+    _snapshots.clear();
+    _snapshots.resize(modules.size());
+
+    // module table first: overlapping modules mean that the list is wrong
+    std::vector<uint32_t> order(modules.size());
+    for (uint32_t i = 0; i < order.size(); i++)
+    {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(),
+        [&modules](uint32_t a, uint32_t b) { return modules[a].baseAddress < modules[b].baseAddress; });
+
+    _moduleStarts.clear();
+    _moduleEnds.clear();
+    _moduleIndices.clear();
+    for (uint32_t index : order)
+    {
+        const ProcessModule& module = modules[index];
+        if (!_moduleEnds.empty() && (_moduleEnds.back() > module.baseAddress))
+        {
+            return false;
+        }
+
+        _moduleStarts.push_back(module.baseAddress);
+        _moduleEnds.push_back(module.baseAddress + module.size);
+        _moduleIndices.push_back(index);
+    }
+
+    // a module without symbols is still identified by its range; the .pdb files are read ahead
+    // by an I/O thread while the ones already read are parsed
+    std::vector<std::string> pdbPaths;
+    pdbPaths.reserve(modules.size());
+    for (const ProcessModule& module : _modules)
+    {
+        pdbPaths.push_back(GetPdbPathFromImage(module.imagePath));
+    }
+
+    size_t workerCount = (std::max)(std::thread::hardware_concurrency(), 1u);
+    ReadAheadPipeline pipeline(ReadAheadPerWorker * workerCount, workerCount);
+    pipeline.Run(pdbPaths, [this, &pdbPaths](size_t i) { _snapshots[i] = ModuleSnapshot::Load(pdbPaths[i]); });
+    _readAheadStats = pipeline.GetStats();
+
+    return true;
+}
+
+bool ProcessSymbolIndex::FindModule(uint64_t address, size_t& moduleIndex) const
+{
+    auto next = std::upper_bound(_moduleStarts.begin(), _moduleStarts.end(), address);
+    if (next == _moduleStarts.begin())
+    {
+        return false;
+    }
+
+    size_t position = (next - _moduleStarts.begin()) - 1;
+    if (address >= _moduleEnds[position])
+    {
+        return false;
+    }
+
+    moduleIndex = _moduleIndices[position];
+    return true;
+}
+
+void ProcessSymbolIndex::Resolve(const std::vector<uint64_t>& addresses, std::vector<ResolvedAddress>& results) const
+{
+    results.resize(addresses.size());
+
+    for (size_t index = 0; index < addresses.size(); index++)
+    {
+        uint64_t address = addresses[index];
+        ResolvedAddress& result = results[index];
+        result.address = address;
+        result.moduleIndex = -1;
+        result.rva = 0;
+        result.frame = { nullptr, 0, nullptr, 0 };
+
+        size_t moduleIndex = 0;
+        if (!FindModule(address, moduleIndex))
+        {
+            continue;
+        }
+
+        result.moduleIndex = static_cast<int32_t>(moduleIndex);
+        result.rva = static_cast<uint32_t>(address - _modules[moduleIndex].baseAddress);
+
+        const ModuleSnapshot* snapshot = _snapshots[moduleIndex].get();
+        if ((snapshot != nullptr) && snapshot->HasNativeCode())
+        {
+            snapshot->Symbolize(result.rva, 0, result.frame);
+        }
+    }
+}
+
+size_t ProcessSymbolIndex::GetLoadedModuleCount() const
+{
+    size_t count = 0;
+    for (const auto& snapshot : _snapshots)
+    {
+        if (snapshot != nullptr)
+        {
+            count++;
+        }
+    }
+    return count;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "ModuleSnapshot.h"
+#include "ReadAheadPipeline.h"
+
+// Module loaded in a process: the .pdb file is expected next to the image
+// (the image path can also directly be the path of the .pdb file)
+struct ProcessModule
+{
+    std::string imagePath;
+    uint64_t baseAddress;
+    uint32_t size;
+};
+
+struct ResolvedAddress
+{
+    uint64_t address;
+    int32_t moduleIndex;    // in the module list (-1 if the address is not in a module)
+    uint32_t rva;
+    SymbolizedFrame frame;  // valid as long as the index is alive
+};
+
+// Symbolization of absolute addresses of a whole process. The modules are sorted by
+// base address: an address is resolved by finding its module and symbolizing its RVA
+// with the snapshot of the module (which already sorts its own code ranges).
+// The module table is stored as separate arrays (structure of arrays) to keep the
+// searched start addresses contiguous in memory.
+class ProcessSymbolIndex
+{
+public:
+    ProcessSymbolIndex();
+
+    // Modules are loaded in parallel; overlapping modules are rejected
+    bool Load(const std::vector<ProcessModule>& modules);
+
+    // Resolve a batch of addresses (results are returned in the order of the addresses)
+    void Resolve(const std::vector<uint64_t>& addresses, std::vector<ResolvedAddress>& results) const;
+
+    const std::vector<ProcessModule>& GetModules() const { return _modules; }
+    size_t GetLoadedModuleCount() const;
+    const ReadAheadStats& GetReadAheadStats() const { return _readAheadStats; }
+
+    // One "<base> <size> <path>" line per module (base and size in hexadecimal)
+    static bool ReadModuleList(const std::string& filePath, std::vector<ProcessModule>& modules);
+
+private:
+    bool FindModule(uint64_t address, size_t& moduleIndex) const;
+
+private:
+    std::vector<ProcessModule> _modules;
+    std::vector<std::shared_ptr<const ModuleSnapshot>> _snapshots;
+    ReadAheadStats _readAheadStats;
+
+    // module index sorted by base address
+    std::vector<uint64_t> _moduleStarts;
+    std::vector<uint64_t> _moduleEnds;
+    std::vector<uint32_t> _moduleIndices;
+};
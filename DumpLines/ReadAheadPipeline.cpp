@@ -0,0 +1,105 @@
+#include "ReadAheadPipeline.h"
+
+#include <cstring>
+#include <thread>
+
+
+ReadAheadPipeline::ReadAheadPipeline(size_t readAheadCount, size_t workerCount)
+    :
+    _readAheadCount((readAheadCount == 0) ? 1 : readAheadCount),
+    _workerCount((workerCount == 0) ? 1 : workerCount),
+    _readDone(false)
+{
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+void ReadAheadPipeline::Run(const std::vector<std::string>& filePaths, const std::function<void(size_t)>& parse)
+{
+    memset(&_stats, 0, sizeof(_stats));
+    _queue.clear();
+    _readDone = false;
+
+    std::thread reader([this, &filePaths]() { ReadFiles(filePaths); });
+
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < _workerCount; i++)
+    {
+        workers.emplace_back([this, &parse]() { ParseFiles(parse); });
+    }
+
+    reader.join();
+    for (std::thread& worker : workers)
+    {
+        worker.join();
+    }
+}
+
+void ReadAheadPipeline::ReadFiles(const std::vector<std::string>& filePaths)
+{
+    for (size_t i = 0; i < filePaths.size(); i++)
+    {
+        PrefetchedFile prefetched;
+        prefetched.index = i;
+        prefetched.file.reset(new MappedFile());
+
+        // the reads are issued asynchronously: the I/O thread moves on to the next file
+        // while the disk is busy; a failed prefetch only means that the parser will wait
+        bool isPrefetched = false;
+        if (prefetched.file->Open(filePaths[i]))
+        {
+            WIN32_MEMORY_RANGE_ENTRY range;
+            range.VirtualAddress = const_cast<uint8_t*>(prefetched.file->GetData());
+            range.NumberOfBytes = prefetched.file->GetSize();
+            isPrefetched = PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0) != FALSE;
+        }
+
+        std::unique_lock<std::mutex> guard(_queueLock);
+        if (isPrefetched)
+        {
+            _stats.prefetchedFiles++;
+            _stats.prefetchedBytes += prefetched.file->GetSize();
+        }
+
+        // backpressure: wait for the parsers to catch up
+        if (_queue.size() >= _readAheadCount)
+        {
+            _stats.readerWaits++;
+            _queueChanged.wait(guard, [this]() { return _queue.size() < _readAheadCount; });
+        }
+
+        _queue.push_back(std::move(prefetched));
+        _queueChanged.notify_all();
+    }
+
+    std::lock_guard<std::mutex> guard(_queueLock);
+    _readDone = true;
+    _queueChanged.notify_all();
+}
+
+void ReadAheadPipeline::ParseFiles(const std::function<void(size_t)>& parse)
+{
+    for (;;)
+    {
+        PrefetchedFile prefetched;
+        {
+            std::unique_lock<std::mutex> guard(_queueLock);
+            if (_queue.empty() && !_readDone)
+            {
+                _stats.workerWaits++;
+                _queueChanged.wait(guard, [this]() { return _readDone || !_queue.empty(); });
+            }
+
+            if (_queue.empty())
+            {
+                return;
+            }
+
+            prefetched = std::move(_queue.front());
+            _queue.pop_front();
+            _queueChanged.notify_all();
+        }
+
+        // the mapping is released once the parser has read the file
+        parse(prefetched.index);
+    }
+}
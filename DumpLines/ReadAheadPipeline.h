@@ -0,0 +1,59 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "MappedFile.h"
+
+struct ReadAheadStats
+{
+    size_t prefetchedFiles;
+    uint64_t prefetchedBytes;
+    size_t workerWaits;     // a worker had nothing to parse: the I/O stage is the bottleneck
+    size_t readerWaits;     // the queue was full: the parsers are the bottleneck
+};
+
+// Call parse(i) for each file of a list on worker threads while a dedicated I/O thread maps
+// the next files and asks the system to read them (PrefetchVirtualMemory issues large reads
+// in the background): the parsers then find the data in the file cache instead of blocking
+// on the disk. At most readAheadCount files wait for a worker, so that the read-ahead can't
+// evict the pages of files that were not parsed yet.
+class ReadAheadPipeline
+{
+public:
+    ReadAheadPipeline(size_t readAheadCount, size_t workerCount);
+
+    // parse(i) is called exactly once for each i, even if the file could not be prefetched
+    void Run(const std::vector<std::string>& filePaths, const std::function<void(size_t)>& parse);
+
+    const ReadAheadStats& GetStats() const { return _stats; }
+
+private:
+    ReadAheadPipeline(const ReadAheadPipeline&) = delete;
+    ReadAheadPipeline& operator=(const ReadAheadPipeline&) = delete;
+
+    struct PrefetchedFile
+    {
+        size_t index;
+        std::unique_ptr<MappedFile> file;   // keeps the view mapped until the file is parsed
+    };
+
+private:
+    void ReadFiles(const std::vector<std::string>& filePaths);
+    void ParseFiles(const std::function<void(size_t)>& parse);
+
+private:
+    size_t _readAheadCount;
+    size_t _workerCount;
+    ReadAheadStats _stats;
+
+    std::mutex _queueLock;
+    std::condition_variable _queueChanged;
+    std::deque<PrefetchedFile> _queue;
+    bool _readDone;
+};
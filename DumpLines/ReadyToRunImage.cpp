@@ -0,0 +1,355 @@
+#include "ReadyToRunImage.h"
+#include "ByteReader.h"
+#include "MetadataReader.h"
+
+#include <algorithm>
+#include <cstring>
+
+const uint32_t ReadyToRunSignature = 0x00525452;    // RTR
+const uint32_t ReadyToRunFlagComponent = 0x20;      // part of a composite image
+const uint32_t RuntimeFunctionsSection = 102;
+const uint32_t MethodDefEntryPointsSection = 103;
+const uint32_t NativeArrayBlockSize = 16;
+
+
+// NativeFormat variable length unsigned integer: the number of low 1 bits gives the size
+static bool DecodeUnsigned(const uint8_t* data, uint32_t size, uint32_t& offset, uint32_t& value)
+{
+    if (offset >= size)
+    {
+        return false;
+    }
+
+    const uint8_t* p = data + offset;
+    uint32_t first = p[0];
+    uint32_t length = 0;
+    if ((first & 1) == 0)
+    {
+        length = 1;
+    }
+    else if ((first & 2) == 0)
+    {
+        length = 2;
+    }
+    else if ((first & 4) == 0)
+    {
+        length = 3;
+    }
+    else if ((first & 8) == 0)
+    {
+        length = 4;
+    }
+    else if ((first & 16) == 0)
+    {
+        length = 5;
+    }
+    else
+    {
+        return false;
+    }
+
+    if (length > size - offset)
+    {
+        return false;
+    }
+
+    switch (length)
+    {
+        case 1: value = first >> 1; break;
+        case 2: value = (first >> 2) | (p[1] << 6); break;
+        case 3: value = (first >> 3) | (p[1] << 5) | (p[2] << 13); break;
+        case 4: value = (first >> 4) | (p[1] << 4) | (p[2] << 12) | (p[3] << 20); break;
+        default: memcpy(&value, p + 1, sizeof(value)); break;
+    }
+
+    offset += length;
+    return true;
+}
+
+// NativeArray lookup: each block of 16 elements is a small binary tree whose nodes
+// tell if the left (bit 0) and right (bit 1) children exist, leaves give the element offset
+static bool GetNativeArrayElement(const uint8_t* data, uint32_t size, uint32_t baseOffset, uint32_t entryIndexSize, uint32_t index, uint32_t& offset)
+{
+    uint32_t blockOffset = 0;
+    uint32_t indexOffset = baseOffset + (index / NativeArrayBlockSize) * (1 << entryIndexSize);
+    if (indexOffset + (1u << entryIndexSize) > size)
+    {
+        return false;
+    }
+
+    if (entryIndexSize == 0)
+    {
+        blockOffset = data[indexOffset];
+    }
+    else
+    if (entryIndexSize == 1)
+    {
+        uint16_t value = 0;
+        memcpy(&value, data + indexOffset, sizeof(value));
+        blockOffset = value;
+    }
+    else
+    {
+        memcpy(&blockOffset, data + indexOffset, sizeof(blockOffset));
+    }
+    offset = baseOffset + blockOffset;
+
+    for (uint32_t bit = NativeArrayBlockSize >> 1; bit > 0; bit >>= 1)
+    {
+        uint32_t next = offset;
+        uint32_t value = 0;
+        if (!DecodeUnsigned(data, size, next, value))
+        {
+            return false;
+        }
+
+        if ((index & bit) != 0)
+        {
+            if ((value & 2) != 0)
+            {
+                offset += value >> 2;
+                continue;
+            }
+        }
+        else
+        if ((value & 1) != 0)
+        {
+            offset = next;
+            continue;
+        }
+
+        // leaf for a single element of the block
+        if (((value & 3) == 0) && ((value >> 2) == (index & (NativeArrayBlockSize - 1))))
+        {
+            offset = next;
+            return true;
+        }
+
+        return false;
+    }
+
+    return true;
+}
+
+
+ReadyToRunImage::ReadyToRunImage()
+    :
+    _majorVersion(0),
+    _minorVersion(0),
+    _flags(0)
+{
+}
+
+bool ReadyToRunImage::Read(const PeImage& image)
+{
+    PeDataDirectory header = image.GetManagedNativeHeader();
+    const uint8_t* pHeader = image.RvaToPointer(header.rva, header.size);
+    if ((header.rva == 0) || (pHeader == nullptr))
+    {
+        return false;
+    }
+
+    ByteReader reader(pHeader, header.size);
+    uint32_t signature = 0;
+    uint32_t sectionCount = 0;
+    if (!reader.Read(signature) || (signature != ReadyToRunSignature) ||
+        !reader.Read(_majorVersion) ||
+        !reader.Read(_minorVersion) ||
+        !reader.Read(_flags) ||
+        !reader.Read(sectionCount) ||
+        ((_flags & ReadyToRunFlagComponent) != 0))
+    {
+        return false;
+    }
+
+    PeDataDirectory runtimeFunctions = { 0, 0 };
+    PeDataDirectory entryPoints = { 0, 0 };
+    for (uint32_t i = 0; i < sectionCount; i++)
+    {
+        uint32_t type = 0;
+        PeDataDirectory section;
+        if (!reader.Read(type) || !reader.Read(section))
+        {
+            return false;
+        }
+
+        if (type == RuntimeFunctionsSection)
+        {
+            runtimeFunctions = section;
+        }
+        else
+        if (type == MethodDefEntryPointsSection)
+        {
+            entryPoints = section;
+        }
+    }
+
+    std::vector<NativeMethodRange> functions;
+    const uint8_t* pEntryPoints = image.RvaToPointer(entryPoints.rva, entryPoints.size);
+    if ((pEntryPoints == nullptr) ||
+        !ReadRuntimeFunctions(image, runtimeFunctions, functions) ||
+        !ReadEntryPoints(pEntryPoints, entryPoints.size, functions))
+    {
+        return false;
+    }
+
+    std::sort(_ranges.begin(), _ranges.end(),
+        [](const NativeMethodRange& a, const NativeMethodRange& b) { return a.beginRva < b.beginRva; });
+    return true;
+}
+
+bool ReadyToRunImage::ReadRuntimeFunctions(const PeImage& image, const PeDataDirectory& section, std::vector<NativeMethodRange>& functions) const
+{
+    // only x64 stores the end address: the other platforms store the begin address + unwind data
+    uint16_t machine = image.GetMachine();
+    uint32_t entrySize = (machine == MachineAmd64) ? 3 * sizeof(uint32_t) : 2 * sizeof(uint32_t);
+    const uint8_t* pFunctions = image.RvaToPointer(section.rva, section.size);
+    if (pFunctions == nullptr)
+    {
+        return false;
+    }
+
+    ByteReader reader(pFunctions, section.size);
+    uint32_t count = section.size / entrySize;
+    functions.resize(count);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        NativeMethodRange& function = functions[i];
+        uint32_t unwindData = 0;
+        function.token = 0;
+        reader.Read(function.beginRva);
+        if (machine == MachineAmd64)
+        {
+            reader.Read(function.endRva);
+        }
+        reader.Read(unwindData);
+
+        if (machine == MachineAmd64)
+        {
+            continue;
+        }
+
+        // the bit 0 of Thumb-2 code addresses is set
+        if (machine == MachineArmNT)
+        {
+            function.beginRva &= ~1u;
+        }
+
+        // a function with an unknown length ends where the next one starts
+        const uint8_t* pXdata = ((unwindData & 3) == 0) ? image.RvaToPointer(unwindData, sizeof(uint32_t)) : nullptr;
+        uint32_t length = GetFunctionLength(machine, unwindData, pXdata);
+        function.endRva = (length != 0) ? function.beginRva + length : 0;
+    }
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (functions[i].endRva == 0)
+        {
+            functions[i].endRva = (i + 1 < count) ? functions[i + 1].beginRva : functions[i].beginRva;
+        }
+    }
+
+    return count > 0;
+}
+
+uint32_t ReadyToRunImage::GetFunctionLength(uint16_t machine, uint32_t unwindData, const uint8_t* xdata)
+{
+    // ARM64 counts instructions (4 bytes), ARM counts Thumb-2 halfwords (2 bytes)
+    uint32_t unit = 0;
+    if (machine == MachineArm64)
+    {
+        unit = 4;
+    }
+    else
+    if (machine == MachineArmNT)
+    {
+        unit = 2;
+    }
+    else
+    {
+        return 0;
+    }
+
+    // Flag (2 low bits): 0 = RVA of the .xdata record, 1 = packed unwind data, 2 = packed unwind
+    // data of a fragment without prologue; packed data store FunctionLength in bits 2-12
+    switch (unwindData & 3)
+    {
+        case 0:
+        {
+            // the first word of the .xdata record stores FunctionLength in bits 0-17
+            if (xdata == nullptr)
+            {
+                return 0;
+            }
+            uint32_t header = 0;
+            memcpy(&header, xdata, sizeof(header));
+            return (header & 0x3FFFF) * unit;
+        }
+
+        case 1:
+        case 2:
+            return ((unwindData >> 2) & 0x7FF) * unit;
+
+        default:
+            return 0;
+    }
+}
+
+bool ReadyToRunImage::ReadEntryPoints(const uint8_t* section, uint32_t size, std::vector<NativeMethodRange>& functions)
+{
+    // NativeArray header: element count << 2 | size of the block offsets (1, 2 or 4 bytes)
+    uint32_t offset = 0;
+    uint32_t header = 0;
+    if (!DecodeUnsigned(section, size, offset, header))
+    {
+        return false;
+    }
+
+    uint32_t elementCount = header >> 2;
+    uint32_t entryIndexSize = header & 3;
+    if (entryIndexSize > 2)
+    {
+        return false;
+    }
+
+    _ranges.reserve(elementCount);
+    for (uint32_t rid = 1; rid <= elementCount; rid++)
+    {
+        // methods that were not precompiled are JITted at runtime
+        uint32_t elementOffset = 0;
+        uint32_t id = 0;
+        if (!GetNativeArrayElement(section, size, offset, entryIndexSize, rid - 1, elementOffset) ||
+            !DecodeUnsigned(section, size, elementOffset, id))
+        {
+            continue;
+        }
+
+        // bit 0 = the method has fixups to resolve before the first call (not needed here)
+        uint32_t functionIndex = ((id & 1) != 0) ? (id >> 2) : (id >> 1);
+        if (functionIndex >= functions.size())
+        {
+            continue;
+        }
+
+        // only the main body: the funclets that follow it cannot be told apart from
+        // the code of generic instantiations without decoding InstanceEntryPoints
+        NativeMethodRange range = functions[functionIndex];
+        range.token = MethodDefTokenType | rid;
+        _ranges.push_back(range);
+    }
+
+    return true;
+}
+
+const NativeMethodRange* ReadyToRunImage::Find(const std::vector<NativeMethodRange>& ranges, uint32_t rva)
+{
+    auto next = std::upper_bound(ranges.begin(), ranges.end(), rva,
+        [](uint32_t value, const NativeMethodRange& range) { return value < range.beginRva; });
+    if (next == ranges.begin())
+    {
+        return nullptr;
+    }
+
+    const NativeMethodRange& range = *(next - 1);
+    return (rva < range.endRva) ? &range : nullptr;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "PeImage.h"
+
+// IMAGE_FILE_MACHINE_* values of the images that can contain ReadyToRun code
+const uint16_t MachineArmNT = 0x01C4;
+const uint16_t MachineAmd64 = 0x8664;
+const uint16_t MachineArm64 = 0xAA64;
+
+// Native code of a precompiled method: a method has one range for its main body
+// and one per funclet (catch/finally handlers are separate runtime functions)
+struct NativeMethodRange
+{
+    uint32_t beginRva;
+    uint32_t endRva;        // exclusive
+    uint32_t token;         // MethodDef token
+};
+
+// Reader of the ReadyToRun (crossgen) header pointed to by the ManagedNativeHeader of
+// the CLI header: the MethodDefEntryPoints section gives the index of the first
+// runtime function of each precompiled method and the RuntimeFunctions section gives
+// the native code ranges. Composite images (code of several assemblies in one file)
+// are not supported.
+class ReadyToRunImage
+{
+public:
+    ReadyToRunImage();
+
+    // Return false if the image is not a ReadyToRun image
+    bool Read(const PeImage& image);
+
+    uint16_t GetMajorVersion() const { return _majorVersion; }
+    uint16_t GetMinorVersion() const { return _minorVersion; }
+
+    // Sorted by beginRva
+    const std::vector<NativeMethodRange>& GetRanges() const { return _ranges; }
+
+    // Binary search of the range containing the RVA
+    static const NativeMethodRange* Find(const std::vector<NativeMethodRange>& ranges, uint32_t rva);
+
+    // Length in bytes of an ARM64 or ARM runtime function from its unwind word: packed unwind
+    // data store the length in the word itself, otherwise the word is the RVA of the .xdata
+    // record whose first bytes are given in xdata (nullptr if not mapped). 0 if unknown.
+    static uint32_t GetFunctionLength(uint16_t machine, uint32_t unwindData, const uint8_t* xdata);
+
+private:
+    bool ReadRuntimeFunctions(const PeImage& image, const PeDataDirectory& section, std::vector<NativeMethodRange>& functions) const;
+    bool ReadEntryPoints(const uint8_t* section, uint32_t size, std::vector<NativeMethodRange>& functions);
+
+private:
+    uint16_t _majorVersion;
+    uint16_t _minorVersion;
+    uint32_t _flags;
+    std::vector<NativeMethodRange> _ranges;
+};
@@ -0,0 +1,219 @@
+#include <windows.h>
+#include "SelfTest.h"
+#include "PdbDiff.h"
+#include "ReadyToRunImage.h"
+#include "SignatureDecoder.h"
+#include "SymbolClient.h"
+#include "SymbolServer.h"
+
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define CHECK(condition)                                                        \
+    if (!(condition))                                                           \
+    {                                                                           \
+        printf("    %s(%d): %s\n", __FILE__, __LINE__, #condition);           \
+        return false;                                                           \
+    }
+
+
+// TypeDefOrRefOrSpecEncoded (the 2 lowest bits select the table: TypeDef, TypeRef, TypeSpec)
+static uint8_t EncodeTypeDef(uint32_t rid) { return static_cast<uint8_t>(rid << 2); }
+static uint8_t EncodeTypeRef(uint32_t rid) { return static_cast<uint8_t>((rid << 2) | 1); }
+
+static std::string DecodeSignature(const std::vector<uint8_t>& blob, const std::map<uint32_t, std::string>& typeNames)
+{
+    SignatureDecoder decoder(
+        [&typeNames](uint32_t token, std::string& name)
+        {
+            auto found = typeNames.find(token);
+            if (found == typeNames.end())
+            {
+                return false;
+            }
+            name = found->second;
+            return true;
+        });
+
+    std::string text;
+    return decoder.DecodeMethodSignature(blob.data(), blob.size(), text) ? text : "";
+}
+
+static PdbDiff::MethodEntry CreateEntry(const std::string& name, const std::string& signature, uint32_t token)
+{
+    PdbDiff::MethodEntry entry;
+    entry.key = PdbDiff::ComputeKey(name, signature);
+    entry.shapeHash = 1;
+    entry.locationHash = 2;
+    entry.token = token;
+    entry.firstLine = 10;
+    entry.ilSize = 20;
+    entry.name = name;
+    return entry;
+}
+
+// Two builds of an assembly that only differ by an extra type N.Extra defined before N.A:
+// the type tokens of the signatures are renumbered but no method is added or removed
+static bool TestDiffIgnoresRenumberedTypes()
+{
+    const uint8_t Void = 0x01;
+    const uint8_t Int32 = 0x08;
+    const uint8_t Class = 0x12;
+    const uint8_t GenericInst = 0x15;
+
+    // void C::M(N.B, List<N.A>)
+    std::map<uint32_t, std::string> oldTypes = {
+        { 0x02000002, "N.A" }, { 0x02000003, "N.B" }, { 0x01000001, "System.Collections.Generic.List`1" } };
+    std::vector<uint8_t> oldBlob = { 0x00, 2, Void, Class, EncodeTypeDef(3), GenericInst, Class, EncodeTypeRef(1), 1, Class, EncodeTypeDef(2) };
+
+    std::map<uint32_t, std::string> newTypes = {
+        { 0x02000002, "N.Extra" }, { 0x02000003, "N.A" }, { 0x02000004, "N.B" }, { 0x01000001, "System.Collections.Generic.List`1" } };
+    std::vector<uint8_t> newBlob = { 0x00, 2, Void, Class, EncodeTypeDef(4), GenericInst, Class, EncodeTypeRef(1), 1, Class, EncodeTypeDef(3) };
+
+    // int C::M(int) is an overload that must stay apart
+    std::vector<uint8_t> overloadBlob = { 0x00, 1, Int32, Int32 };
+
+    std::string oldSignature = DecodeSignature(oldBlob, oldTypes);
+    std::string newSignature = DecodeSignature(newBlob, newTypes);
+    CHECK(oldBlob != newBlob);
+    CHECK(!oldSignature.empty());
+    CHECK(oldSignature == newSignature);
+    CHECK(oldSignature != DecodeSignature(overloadBlob, oldTypes));
+
+    std::vector<PdbDiff::MethodEntry> oldMethods = {
+        CreateEntry("N.C::M", oldSignature, 0x06000001),
+        CreateEntry("N.C::M", DecodeSignature(overloadBlob, oldTypes), 0x06000002) };
+    std::vector<PdbDiff::MethodEntry> newMethods = {
+        CreateEntry("N.C::M", newSignature, 0x06000001),
+        CreateEntry("N.C::M", DecodeSignature(overloadBlob, newTypes), 0x06000002) };
+
+    std::vector<MethodDiff> diffs;
+    std::vector<std::pair<uint32_t, uint32_t>> mismatches;
+    size_t unchangedCount = 0;
+    PdbDiff::MatchMethods(oldMethods, newMethods, diffs, mismatches, unchangedCount);
+    CHECK(diffs.empty());
+    CHECK(mismatches.empty());
+    CHECK(unchangedCount == 2);
+    return true;
+}
+
+// The unwind word of an ARM64 / ARM runtime function either points to an .xdata record or
+// holds packed unwind data (Flag = 1 or 2) with the function length in bits 2-12
+static bool TestRuntimeFunctionLength()
+{
+    // .xdata record: FunctionLength = 0x25 in bits 0-17, the other bits are not part of it
+    const uint32_t xdataHeader = 0xF8C00025;
+    const uint8_t* xdata = reinterpret_cast<const uint8_t*>(&xdataHeader);
+    CHECK(ReadyToRunImage::GetFunctionLength(MachineArm64, 0x00012340, xdata) == 0x25 * 4);
+    CHECK(ReadyToRunImage::GetFunctionLength(MachineArmNT, 0x00012340, xdata) == 0x25 * 2);
+    CHECK(ReadyToRunImage::GetFunctionLength(MachineArm64, 0x00012340, nullptr) == 0);
+
+    // packed: FunctionLength = 0x40, the upper bits (frame and register layout) are ignored
+    const uint32_t packed = 0xFFE00000 | (0x40 << 2);
+    CHECK(ReadyToRunImage::GetFunctionLength(MachineArm64, packed | 1, nullptr) == 0x40 * 4);
+    CHECK(ReadyToRunImage::GetFunctionLength(MachineArm64, packed | 2, nullptr) == 0x40 * 4);
+    CHECK(ReadyToRunImage::GetFunctionLength(MachineArmNT, packed | 1, nullptr) == 0x40 * 2);
+
+    // the packed word is never read as an RVA, even if an .xdata record is given
+    CHECK(ReadyToRunImage::GetFunctionLength(MachineArm64, packed | 1, xdata) == 0x40 * 4);
+
+    // reserved Flag and x64 (the end address is in the runtime function)
+    CHECK(ReadyToRunImage::GetFunctionLength(MachineArm64, packed | 3, nullptr) == 0);
+    CHECK(ReadyToRunImage::GetFunctionLength(MachineAmd64, packed | 1, nullptr) == 0);
+    return true;
+}
+
+static std::string GetSelfTestSocketPath()
+{
+    char tempPath[MAX_PATH] = { 0 };
+    GetTempPathA(MAX_PATH, tempPath);
+
+    char fileName[64];
+    snprintf(fileName, sizeof(fileName), "DumpLines-selftest-%u.sock", static_cast<uint32_t>(GetCurrentProcessId()));
+    return std::string(tempPath) + fileName;
+}
+
+// A local client sends two requests on the same connection: the PDB does not exist, so both
+// are answered with SymbolStatusModuleNotFound without any result
+static bool TestSymbolServerReply()
+{
+    std::string socketPath = GetSelfTestSocketPath();
+    SymbolServer server(4, 2);
+    bool runResult = false;
+    std::thread serverThread([&]() { runResult = server.Run(socketPath); });
+
+    // the server listens once Run() has created the socket
+    SymbolClient client;
+    bool connected = false;
+    for (int attempt = 0; (attempt < 500) && !connected; attempt++)
+    {
+        connected = client.Connect(socketPath);
+        if (!connected)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+
+    SymbolRequest request = {};
+    request.pdbFilePath = socketPath + ".missing.pdb";
+    request.addresses.push_back({ 0x1000, 0 });
+
+    SymbolResponse first = {};
+    SymbolResponse second = {};
+    bool firstReplied = connected && client.Symbolize(request, first);
+    bool secondReplied = connected && client.Symbolize(request, second);
+    client.Close();
+
+    server.Stop();
+    serverThread.join();
+
+    CHECK(connected);
+    CHECK(firstReplied);
+    CHECK(first.status == SymbolStatusModuleNotFound);
+    CHECK(first.results.empty());
+    CHECK(secondReplied);
+    CHECK(second.status == SymbolStatusModuleNotFound);
+    CHECK(runResult);
+    return true;
+}
+
+// Stop() called before Run() must not be lost: Run() returns instead of waiting for clients
+static bool TestSymbolServerStopBeforeRun()
+{
+    SymbolServer server(4, 1);
+    server.Stop();
+    CHECK(server.Run(GetSelfTestSocketPath()));
+    return true;
+}
+
+struct SelfTest
+{
+    const char* name;
+    bool (*run)();
+};
+
+static const SelfTest SelfTests[] =
+{
+    { "PdbDiff: renumbered type tokens", TestDiffIgnoresRenumberedTypes },
+    { "ReadyToRun: ARM64 / ARM function length", TestRuntimeFunctionLength },
+    { "SymbolServer: local client request", TestSymbolServerReply },
+    { "SymbolServer: Stop() before Run()", TestSymbolServerStopBeforeRun },
+};
+
+int RunSelfTests()
+{
+    size_t failed = 0;
+    for (const SelfTest& test : SelfTests)
+    {
+        bool success = test.run();
+        printf("[%s] %s\n", success ? " OK " : "FAIL", test.name);
+        failed += success ? 0 : 1;
+    }
+
+    printf("%zu test(s), %zu failed\n", sizeof(SelfTests) / sizeof(SelfTests[0]), failed);
+    return (failed == 0) ? 0 : -3;
+}
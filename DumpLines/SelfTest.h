@@ -0,0 +1,5 @@
+#pragma once
+
+// Checks of the parts of DumpLines that can run without symbol files (--selftest):
+// synthetic signatures, unwind records, a local symbol server... Return 0 if every test passed.
+int RunSelfTests();
@@ -0,0 +1,309 @@
+#include "Sha.h"
+
+#include <cstring>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define SHA_EXTENSIONS
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define SHA_TARGET
+#else
+#include <cpuid.h>
+#define SHA_TARGET __attribute__((target("sha,sse4.1")))
+#endif
+#endif
+
+const size_t BlockSize = 64;
+
+typedef void (*BlockFunction)(uint32_t* state, const uint8_t* blocks, size_t count);
+
+
+static inline uint32_t RotateLeft(uint32_t value, int count)
+{
+    return (value << count) | (value >> (32 - count));
+}
+
+static inline uint32_t RotateRight(uint32_t value, int count)
+{
+    return (value >> count) | (value << (32 - count));
+}
+
+static inline uint32_t LoadBigEndian(const uint8_t* bytes)
+{
+    return (static_cast<uint32_t>(bytes[0]) << 24) | (static_cast<uint32_t>(bytes[1]) << 16) | (static_cast<uint32_t>(bytes[2]) << 8) | bytes[3];
+}
+
+static inline void StoreBigEndian(uint32_t value, uint8_t* bytes)
+{
+    bytes[0] = static_cast<uint8_t>(value >> 24);
+    bytes[1] = static_cast<uint8_t>(value >> 16);
+    bytes[2] = static_cast<uint8_t>(value >> 8);
+    bytes[3] = static_cast<uint8_t>(value);
+}
+
+// Full blocks are hashed in place; the tail is copied with the padding and the bit length
+static void HashMessage(BlockFunction processBlocks, uint32_t* state, const uint8_t* data, size_t size)
+{
+    size_t blockCount = size / BlockSize;
+    processBlocks(state, data, blockCount);
+
+    uint8_t tail[2 * BlockSize] = { 0 };
+    size_t remaining = size - blockCount * BlockSize;
+    memcpy(tail, data + blockCount * BlockSize, remaining);
+    tail[remaining] = 0x80;
+
+    size_t tailSize = (remaining + 9 <= BlockSize) ? BlockSize : 2 * BlockSize;
+    uint64_t bitLength = static_cast<uint64_t>(size) * 8;
+    StoreBigEndian(static_cast<uint32_t>(bitLength >> 32), tail + tailSize - 8);
+    StoreBigEndian(static_cast<uint32_t>(bitLength), tail + tailSize - 4);
+    processBlocks(state, tail, tailSize / BlockSize);
+}
+
+
+static void Sha1Blocks(uint32_t* state, const uint8_t* blocks, size_t count)
+{
+    uint32_t w[80];
+    for (size_t block = 0; block < count; block++, blocks += BlockSize)
+    {
+        for (int i = 0; i < 16; i++)
+        {
+            w[i] = LoadBigEndian(blocks + 4 * i);
+        }
+        for (int i = 16; i < 80; i++)
+        {
+            w[i] = RotateLeft(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+        }
+
+        uint32_t a = state[0];
+        uint32_t b = state[1];
+        uint32_t c = state[2];
+        uint32_t d = state[3];
+        uint32_t e = state[4];
+        for (int i = 0; i < 80; i++)
+        {
+            uint32_t f;
+            uint32_t k;
+            if (i < 20)
+            {
+                f = (b & c) | (~b & d);
+                k = 0x5A827999;
+            }
+            else
+            if (i < 40)
+            {
+                f = b ^ c ^ d;
+                k = 0x6ED9EBA1;
+            }
+            else
+            if (i < 60)
+            {
+                f = (b & c) | (b & d) | (c & d);
+                k = 0x8F1BBCDC;
+            }
+            else
+            {
+                f = b ^ c ^ d;
+                k = 0xCA62C1D6;
+            }
+
+            uint32_t temp = RotateLeft(a, 5) + f + e + k + w[i];
+            e = d;
+            d = c;
+            c = RotateLeft(b, 30);
+            b = a;
+            a = temp;
+        }
+
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+    }
+}
+
+void ComputeSha1(const uint8_t* data, size_t size, uint8_t hash[Sha1Size])
+{
+    uint32_t state[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+    HashMessage(Sha1Blocks, state, data, size);
+    for (int i = 0; i < 5; i++)
+    {
+        StoreBigEndian(state[i], hash + 4 * i);
+    }
+}
+
+
+static const uint32_t Sha256K[64] =
+{
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static void Sha256Blocks(uint32_t* state, const uint8_t* blocks, size_t count)
+{
+    uint32_t w[64];
+    for (size_t block = 0; block < count; block++, blocks += BlockSize)
+    {
+        for (int i = 0; i < 16; i++)
+        {
+            w[i] = LoadBigEndian(blocks + 4 * i);
+        }
+        for (int i = 16; i < 64; i++)
+        {
+            uint32_t s0 = RotateRight(w[i - 15], 7) ^ RotateRight(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            uint32_t s1 = RotateRight(w[i - 2], 17) ^ RotateRight(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+
+        uint32_t a = state[0];
+        uint32_t b = state[1];
+        uint32_t c = state[2];
+        uint32_t d = state[3];
+        uint32_t e = state[4];
+        uint32_t f = state[5];
+        uint32_t g = state[6];
+        uint32_t h = state[7];
+        for (int i = 0; i < 64; i++)
+        {
+            uint32_t s1 = RotateRight(e, 6) ^ RotateRight(e, 11) ^ RotateRight(e, 25);
+            uint32_t choice = (e & f) ^ (~e & g);
+            uint32_t temp1 = h + s1 + choice + Sha256K[i] + w[i];
+            uint32_t s0 = RotateRight(a, 2) ^ RotateRight(a, 13) ^ RotateRight(a, 22);
+            uint32_t majority = (a & b) ^ (a & c) ^ (b & c);
+            uint32_t temp2 = s0 + majority;
+
+            h = g;
+            g = f;
+            f = e;
+            e = d + temp1;
+            d = c;
+            c = b;
+            b = a;
+            a = temp1 + temp2;
+        }
+
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+        state[5] += f;
+        state[6] += g;
+        state[7] += h;
+    }
+}
+
+#ifdef SHA_EXTENSIONS
+// 4 rounds with the message words msg (w[i..i+3] + K[i..i+3] are added here)
+#define SHA256_ROUNDS(msg, i) \
+    { \
+        __m128i wk = _mm_add_epi32(msg, _mm_loadu_si128(reinterpret_cast<const __m128i*>(Sha256K + (i)))); \
+        cdgh = _mm_sha256rnds2_epu32(cdgh, abef, wk); \
+        abef = _mm_sha256rnds2_epu32(abef, cdgh, _mm_shuffle_epi32(wk, 0x0E)); \
+    }
+
+// next 4 message words from the 16 previous ones: w0..w3 = w[i-16..i-1]
+#define SHA256_SCHEDULE(w0, w1, w2, w3) \
+    w0 = _mm_sha256msg2_epu32(_mm_add_epi32(_mm_sha256msg1_epu32(w0, w1), _mm_alignr_epi8(w3, w2, 4)), w3);
+
+SHA_TARGET static void Sha256BlocksShaExtensions(uint32_t* state, const uint8_t* blocks, size_t count)
+{
+    const __m128i byteSwap = _mm_set_epi64x(0x0c0d0e0f08090a0bll, 0x0405060700010203ll);
+
+    // the instructions use the state as (a, b, e, f) and (c, d, g, h)
+    __m128i dcba = _mm_loadu_si128(reinterpret_cast<const __m128i*>(state));
+    __m128i hgfe = _mm_loadu_si128(reinterpret_cast<const __m128i*>(state + 4));
+    __m128i cdab = _mm_shuffle_epi32(dcba, 0xB1);
+    __m128i efgh = _mm_shuffle_epi32(hgfe, 0x1B);
+    __m128i abef = _mm_alignr_epi8(cdab, efgh, 8);
+    __m128i cdgh = _mm_blend_epi16(efgh, cdab, 0xF0);
+
+    for (size_t block = 0; block < count; block++, blocks += BlockSize)
+    {
+        __m128i savedAbef = abef;
+        __m128i savedCdgh = cdgh;
+
+        __m128i w0 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(blocks)), byteSwap);
+        __m128i w1 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(blocks + 16)), byteSwap);
+        __m128i w2 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(blocks + 32)), byteSwap);
+        __m128i w3 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(blocks + 48)), byteSwap);
+
+        SHA256_ROUNDS(w0, 0);
+        SHA256_ROUNDS(w1, 4);
+        SHA256_ROUNDS(w2, 8);
+        SHA256_ROUNDS(w3, 12);
+        for (int i = 16; i < 64; i += 16)
+        {
+            SHA256_SCHEDULE(w0, w1, w2, w3);
+            SHA256_ROUNDS(w0, i);
+            SHA256_SCHEDULE(w1, w2, w3, w0);
+            SHA256_ROUNDS(w1, i + 4);
+            SHA256_SCHEDULE(w2, w3, w0, w1);
+            SHA256_ROUNDS(w2, i + 8);
+            SHA256_SCHEDULE(w3, w0, w1, w2);
+            SHA256_ROUNDS(w3, i + 12);
+        }
+
+        abef = _mm_add_epi32(abef, savedAbef);
+        cdgh = _mm_add_epi32(cdgh, savedCdgh);
+    }
+
+    // back to (a, b, c, d) and (e, f, g, h)
+    __m128i feba = _mm_shuffle_epi32(abef, 0x1B);
+    __m128i dchg = _mm_shuffle_epi32(cdgh, 0xB1);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(state), _mm_blend_epi16(feba, dchg, 0xF0));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(state + 4), _mm_alignr_epi8(dchg, feba, 8));
+}
+#endif
+
+bool HasShaExtensions()
+{
+#ifdef SHA_EXTENSIONS
+    // CPUID leaf 7: EBX bit 29 = SHA; leaf 1: ECX bit 19 = SSE4.1
+    static const bool hasExtensions = []()
+        {
+#ifdef _MSC_VER
+            int registers[4];
+            __cpuidex(registers, 1, 0);
+            bool hasSse41 = (registers[2] & (1 << 19)) != 0;
+            __cpuidex(registers, 7, 0);
+            return hasSse41 && ((registers[1] & (1 << 29)) != 0);
+#else
+            unsigned int eax, ebx, ecx, edx;
+            if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx) || ((ecx & (1 << 19)) == 0))
+            {
+                return false;
+            }
+            return __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) && ((ebx & (1u << 29)) != 0);
+#endif
+        }();
+    return hasExtensions;
+#else
+    return false;
+#endif
+}
+
+void ComputeSha256(const uint8_t* data, size_t size, uint8_t hash[Sha256Size])
+{
+    uint32_t state[8] = { 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 };
+    BlockFunction processBlocks = Sha256Blocks;
+#ifdef SHA_EXTENSIONS
+    if (HasShaExtensions())
+    {
+        processBlocks = Sha256BlocksShaExtensions;
+    }
+#endif
+
+    HashMessage(processBlocks, state, data, size);
+    for (int i = 0; i < 8; i++)
+    {
+        StoreBigEndian(state[i], hash + 4 * i);
+    }
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+const size_t Sha1Size = 20;
+const size_t Sha256Size = 32;
+
+// One-shot SHA-1 and SHA-256 of a buffer (source files are mapped in memory).
+// SHA-256 uses the SHA extensions of x64 CPUs when they are available.
+void ComputeSha1(const uint8_t* data, size_t size, uint8_t hash[Sha1Size]);
+void ComputeSha256(const uint8_t* data, size_t size, uint8_t hash[Sha256Size]);
+
+bool HasShaExtensions();
@@ -0,0 +1,83 @@
+# Local run of the sharded indexing (--shards / --shard / merge) with a failed shard:
+#  1. index the list with -Shards worker processes and kill every attempt of -KilledShard,
+#     so that the coordinator gives up and keeps the previous index
+#  2. run the same command again: the killed shard resumes from its partial index,
+#     the other shards find their files unchanged and the partial indexes are merged
+#  3. run one worker directly with --shard and merge again
+#
+# The list must be large enough (a few thousand .pdb files) for the shard to still be
+# running when it is killed.
+#
+#   .\ShardResume.ps1 -Exe x64\Release\DumpLines.exe -ListFile pdbs.txt -IndexFile $env:TEMP\pdbs.idx
+
+param(
+    [Parameter(Mandatory = $true)] [string] $Exe,
+    [Parameter(Mandatory = $true)] [string] $ListFile,
+    [Parameter(Mandatory = $true)] [string] $IndexFile,
+    [int] $Shards = 4,
+    [int] $KilledShard = 1
+)
+
+$ErrorActionPreference = "Stop"
+
+function Invoke-DumpLines([string[]] $Arguments)
+{
+    $quoted = $Arguments | ForEach-Object { "`"$_`"" }
+    $process = Start-Process -FilePath $Exe -ArgumentList $quoted -NoNewWindow -PassThru
+    return $process
+}
+
+function Get-ShardLog([int] $Shard)
+{
+    return Get-Content "$IndexFile.shard-$Shard-of-$Shards.log" -Raw
+}
+
+Remove-Item "$IndexFile", "$IndexFile.shard-*" -ErrorAction SilentlyContinue
+
+Write-Host "== 1. index with $Shards shards, killing shard $KilledShard"
+$coordinator = Invoke-DumpLines @("--index", $IndexFile, "--shards", $Shards, $ListFile)
+$killed = 0
+while (!$coordinator.HasExited)
+{
+    Get-CimInstance Win32_Process -Filter "Name = 'DumpLines.exe'" |
+        Where-Object { $_.CommandLine -like "*--shard $KilledShard/$Shards *" } |
+        ForEach-Object { Stop-Process -Id $_.ProcessId -Force -ErrorAction SilentlyContinue; $killed++ }
+    Start-Sleep -Milliseconds 50
+}
+$coordinator.WaitForExit()
+if (($killed -eq 0) -or ($coordinator.ExitCode -eq 0))
+{
+    throw "shard $KilledShard finished before it could be killed: use a larger list"
+}
+if (Test-Path $IndexFile)
+{
+    throw "the index must not be written when a shard failed"
+}
+
+Write-Host "== 2. run again: shard $KilledShard resumes"
+$coordinator = Invoke-DumpLines @("--index", $IndexFile, "--shards", $Shards, $ListFile)
+$coordinator.WaitForExit()
+if (($coordinator.ExitCode -ne 0) -or !(Test-Path $IndexFile))
+{
+    throw "the second run failed (exit code $($coordinator.ExitCode))"
+}
+for ($shard = 0; $shard -lt $Shards; $shard++)
+{
+    if (($shard -ne $KilledShard) -and ((Get-ShardLog $shard) -notmatch "indexed 0,"))
+    {
+        throw "shard $shard indexed files again instead of finding them unchanged"
+    }
+}
+Write-Host (Get-ShardLog $KilledShard)
+
+Write-Host "== 3. one worker with --shard, then merge"
+$worker = Invoke-DumpLines @("--shard", "0/$Shards", "--index", $IndexFile, $ListFile)
+$worker.WaitForExit()
+$coordinator = Invoke-DumpLines @("--index", $IndexFile, "--shards", $Shards, $ListFile)
+$coordinator.WaitForExit()
+if (($worker.ExitCode -ne 0) -or ($coordinator.ExitCode -ne 0))
+{
+    throw "--shard 0/$Shards or the merge failed"
+}
+
+Write-Host "OK"
@@ -0,0 +1,282 @@
+#include "ShardedIndexer.h"
+#include "SymbolIndex.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <queue>
+#include <thread>
+
+
+ShardedIndexer::ShardedIndexer(const std::string& indexFilePath, uint32_t shardCount)
+    :
+    _indexFilePath(indexFilePath),
+    _shardCount((shardCount == 0) ? 1 : shardCount)
+{
+}
+
+bool ShardedIndexer::ParseShard(const std::string& text, uint32_t& shardIndex, uint32_t& shardCount)
+{
+    char* end = nullptr;
+    shardIndex = static_cast<uint32_t>(strtoul(text.c_str(), &end, 10));
+    if ((end == text.c_str()) || (*end != '/'))
+    {
+        return false;
+    }
+
+    const char* count = end + 1;
+    shardCount = static_cast<uint32_t>(strtoul(count, &end, 10));
+    return (end != count) && (*end == '\0') && (shardIndex < shardCount);
+}
+
+bool ShardedIndexer::ReadFileList(const std::string& listFilePath, std::vector<std::string>& filePaths)
+{
+    std::ifstream file(listFilePath);
+    if (!file)
+    {
+        return false;
+    }
+
+    // no fixed size buffer: long paths (\\?\ prefix) must not be split
+    std::string line;
+    while (std::getline(file, line))
+    {
+        size_t first = line.find_first_not_of(" \t");
+        if ((first == std::string::npos) || (line[first] == '\r') || (line[first] == '#'))
+        {
+            continue;
+        }
+
+        size_t last = line.find_last_not_of(" \t\r");
+        filePaths.push_back(line.substr(first, last - first + 1));
+    }
+
+    return true;
+}
+
+std::string ShardedIndexer::GetShardPath(uint32_t shardIndex) const
+{
+    char suffix[64];
+    snprintf(suffix, sizeof(suffix), ".shard-%u-of-%u", shardIndex, _shardCount);
+    return _indexFilePath + suffix;
+}
+
+uint64_t ShardedIndexer::HashPath(const std::string& pathKey)
+{
+    // FNV-1a: the partition must be the same in every process (and every build of the tool)
+    uint64_t hash = 14695981039346656037ull;
+    for (char c : pathKey)
+    {
+        hash = (hash ^ static_cast<uint8_t>(c)) * 1099511628211ull;
+    }
+    return hash;
+}
+
+bool ShardedIndexer::RunShard(const std::string& listFilePath, uint32_t shardIndex, size_t workerCount, IndexingStats& stats)
+{
+    memset(&stats, 0, sizeof(stats));
+
+    std::vector<std::string> filePaths;
+    if ((shardIndex >= _shardCount) || !ReadFileList(listFilePath, filePaths))
+    {
+        return false;
+    }
+
+    // the same path is in the same shard whatever its case or separators
+    std::vector<std::string> shardPaths;
+    for (const std::string& path : filePaths)
+    {
+        if (HashPath(SymbolIndex::GetPathKey(path)) % _shardCount == shardIndex)
+        {
+            shardPaths.push_back(path);
+        }
+    }
+
+    SymbolIndex index;
+    if (!index.Open(GetShardPath(shardIndex)))
+    {
+        return false;
+    }
+
+    IncrementalIndexer indexer(index, workerCount);
+    return indexer.UpdateFiles(shardPaths, stats) && (stats.failed == 0);
+}
+
+bool ShardedIndexer::StartShard(const std::string& listFilePath, uint32_t shardIndex, size_t workerCount, PROCESS_INFORMATION& process) const
+{
+    char modulePath[MAX_PATH];
+    DWORD length = GetModuleFileNameA(NULL, modulePath, sizeof(modulePath));
+    if ((length == 0) || (length >= sizeof(modulePath)))
+    {
+        return false;
+    }
+
+    std::string commandLine = "\"";
+    commandLine += modulePath;
+    commandLine += "\" --shard " + std::to_string(shardIndex) + "/" + std::to_string(_shardCount);
+    commandLine += " --workers " + std::to_string(workerCount);
+    commandLine += " --index \"";
+    commandLine += _indexFilePath;
+    commandLine += "\" \"";
+    commandLine += listFilePath;
+    commandLine += "\"";
+
+    // the handle of the log file is inherited by the worker as stdout and stderr
+    SECURITY_ATTRIBUTES security = { sizeof(security), NULL, TRUE };
+    std::string logPath = GetShardPath(shardIndex) + ".log";
+    HANDLE hLog = CreateFileA(logPath.c_str(), GENERIC_WRITE, FILE_SHARE_READ, &security, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (hLog == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    STARTUPINFOA startup;
+    memset(&startup, 0, sizeof(startup));
+    startup.cb = sizeof(startup);
+    startup.dwFlags = STARTF_USESTDHANDLES;
+    startup.hStdInput = NULL;
+    startup.hStdOutput = hLog;
+    startup.hStdError = hLog;
+
+    std::vector<char> buffer(commandLine.begin(), commandLine.end());
+    buffer.push_back('\0');
+    BOOL started = CreateProcessA(NULL, buffer.data(), NULL, NULL, TRUE, CREATE_NO_WINDOW, NULL, NULL, &startup, &process);
+    CloseHandle(hLog);
+    return started != FALSE;
+}
+
+bool ShardedIndexer::Run(const std::string& listFilePath, std::vector<ShardStatus>& shards, MergeStats& stats)
+{
+    memset(&stats, 0, sizeof(stats));
+    shards.assign(_shardCount, { 0, 0 });
+
+    size_t workerCount = (std::max)(std::thread::hardware_concurrency() / _shardCount, 1u);
+    std::vector<uint32_t> pendingShards;
+    for (uint32_t shard = 0; shard < _shardCount; shard++)
+    {
+        pendingShards.push_back(shard);
+    }
+
+    // all the pending shards run at the same time; a failed shard resumes from its partial index
+    for (uint32_t attempt = 0; (attempt < MaxShardAttempts) && !pendingShards.empty(); attempt++)
+    {
+        std::vector<PROCESS_INFORMATION> processes(pendingShards.size());
+        std::vector<bool> started(pendingShards.size());
+        for (size_t i = 0; i < pendingShards.size(); i++)
+        {
+            shards[pendingShards[i]].attempts++;
+            started[i] = StartShard(listFilePath, pendingShards[i], workerCount, processes[i]);
+        }
+
+        std::vector<uint32_t> failedShards;
+        for (size_t i = 0; i < pendingShards.size(); i++)
+        {
+            ShardStatus& status = shards[pendingShards[i]];
+            status.exitCode = static_cast<DWORD>(-1);
+            if (started[i])
+            {
+                WaitForSingleObject(processes[i].hProcess, INFINITE);
+                GetExitCodeProcess(processes[i].hProcess, &status.exitCode);
+                CloseHandle(processes[i].hThread);
+                CloseHandle(processes[i].hProcess);
+            }
+
+            if (status.exitCode != 0)
+            {
+                failedShards.push_back(pendingShards[i]);
+            }
+        }
+
+        pendingShards.swap(failedShards);
+    }
+
+    // the previous global index is kept until every shard is complete
+    return pendingShards.empty() && Merge(stats);
+}
+
+bool ShardedIndexer::Merge(MergeStats& stats)
+{
+    memset(&stats, 0, sizeof(stats));
+    stats.shards = _shardCount;
+
+    // modules of each partial index sorted by path key
+    typedef const std::pair<const std::string, IndexedModule>* ModuleEntry;
+    std::vector<std::unique_ptr<SymbolIndex>> partials;
+    std::vector<std::vector<ModuleEntry>> sortedModules(_shardCount);
+    for (uint32_t shard = 0; shard < _shardCount; shard++)
+    {
+        partials.emplace_back(new SymbolIndex());
+        if (!partials[shard]->Open(GetShardPath(shard)))
+        {
+            return false;
+        }
+
+        for (const auto& module : partials[shard]->GetModules())
+        {
+            sortedModules[shard].push_back(&module);
+        }
+        std::sort(sortedModules[shard].begin(), sortedModules[shard].end(),
+            [](ModuleEntry left, ModuleEntry right) { return left->first < right->first; });
+    }
+
+    // the new index is written next to the current one and replaces it once complete
+    std::string mergingPath = _indexFilePath + ".merging";
+    DeleteFileA(mergingPath.c_str());
+    SymbolIndex merged;
+    if (!merged.Open(mergingPath))
+    {
+        return false;
+    }
+
+    // k-way merge: the heap holds the smallest remaining key of each partial index
+    auto isAfter = [&sortedModules](const Cursor& left, const Cursor& right)
+        {
+            const std::string& leftKey = sortedModules[left.shard][left.position]->first;
+            const std::string& rightKey = sortedModules[right.shard][right.position]->first;
+            return (leftKey != rightKey) ? (leftKey > rightKey) : (left.shard > right.shard);
+        };
+    std::priority_queue<Cursor, std::vector<Cursor>, decltype(isAfter)> heap(isAfter);
+    for (uint32_t shard = 0; shard < _shardCount; shard++)
+    {
+        if (!sortedModules[shard].empty())
+        {
+            heap.push({ shard, 0 });
+        }
+    }
+
+    const std::string* lastKey = nullptr;
+    while (!heap.empty())
+    {
+        Cursor cursor = heap.top();
+        heap.pop();
+
+        ModuleEntry module = sortedModules[cursor.shard][cursor.position];
+        if ((lastKey != nullptr) && (*lastKey == module->first))
+        {
+            stats.duplicates++;
+        }
+        else
+        {
+            if (!merged.CopyModuleRecord(*partials[cursor.shard], module->second))
+            {
+                return false;
+            }
+            stats.modules++;
+            lastKey = &module->first;
+        }
+
+        if (++cursor.position < sortedModules[cursor.shard].size())
+        {
+            heap.push(cursor);
+        }
+    }
+
+    if (!merged.Flush())
+    {
+        return false;
+    }
+    merged.Close();
+
+    return MoveFileExA(mergingPath.c_str(), _indexFilePath.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != FALSE;
+}
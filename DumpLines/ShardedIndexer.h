@@ -0,0 +1,69 @@
+#pragma once
+
+#include <windows.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "IncrementalIndexer.h"
+
+struct ShardStatus
+{
+    DWORD exitCode;     // of the last attempt (0 = success)
+    uint32_t attempts;
+};
+
+struct MergeStats
+{
+    size_t shards;
+    size_t modules;
+    size_t duplicates;  // same path key in several partial indexes: always 0 unless a partial index was not
+                        // written by its shard (a path key always hashes to the same shard); the lowest shard wins
+};
+
+// Index a large list of .pdb files with several processes. The paths are hash-partitioned
+// between shardCount worker processes; each one keeps its own partial index next to the global
+// index (<index>.shard-<i>-of-<count>). Partial indexes are incremental and drop an interrupted
+// record when they are opened, so that a failed shard restarts from where it stopped. Once every
+// shard succeeded, the partial indexes are combined by a k-way merge on the path key into a new
+// global index (sorted by path) that replaces the previous one.
+class ShardedIndexer
+{
+public:
+    ShardedIndexer(const std::string& indexFilePath, uint32_t shardCount);
+
+    // "<index>/<count>" with index in [0, count[
+    static bool ParseShard(const std::string& text, uint32_t& shardIndex, uint32_t& shardCount);
+
+    // One path per line (empty lines and # comments are skipped)
+    static bool ReadFileList(const std::string& listFilePath, std::vector<std::string>& filePaths);
+
+    std::string GetShardPath(uint32_t shardIndex) const;
+
+    // Worker process: bring the partial index up to date with the files of the shard
+    bool RunShard(const std::string& listFilePath, uint32_t shardIndex, size_t workerCount, IndexingStats& stats);
+
+    // Coordinator: run one worker process per shard (once more for the failed ones) and merge the
+    // partial indexes if they all succeeded; the threads of the machine are split between the workers
+    bool Run(const std::string& listFilePath, std::vector<ShardStatus>& shards, MergeStats& stats);
+
+    bool Merge(MergeStats& stats);
+
+private:
+    static const uint32_t MaxShardAttempts = 2;
+
+    struct Cursor
+    {
+        uint32_t shard;
+        size_t position;
+    };
+
+private:
+    static uint64_t HashPath(const std::string& pathKey);
+
+    // The output of the worker goes to <partial index>.log
+    bool StartShard(const std::string& listFilePath, uint32_t shardIndex, size_t workerCount, PROCESS_INFORMATION& process) const;
+
+private:
+    std::string _indexFilePath;
+    uint32_t _shardCount;
+};
@@ -0,0 +1,255 @@
+#include "SignatureDecoder.h"
+#include "MetadataReader.h"
+
+// ECMA-335 II.23.1.16 element types
+const uint8_t ELEMENT_TYPE_PTR = 0x0F;
+const uint8_t ELEMENT_TYPE_BYREF = 0x10;
+const uint8_t ELEMENT_TYPE_VALUETYPE = 0x11;
+const uint8_t ELEMENT_TYPE_CLASS = 0x12;
+const uint8_t ELEMENT_TYPE_VAR = 0x13;
+const uint8_t ELEMENT_TYPE_ARRAY = 0x14;
+const uint8_t ELEMENT_TYPE_GENERICINST = 0x15;
+const uint8_t ELEMENT_TYPE_FNPTR = 0x1B;
+const uint8_t ELEMENT_TYPE_SZARRAY = 0x1D;
+const uint8_t ELEMENT_TYPE_MVAR = 0x1E;
+const uint8_t ELEMENT_TYPE_CMOD_REQD = 0x1F;
+const uint8_t ELEMENT_TYPE_CMOD_OPT = 0x20;
+const uint8_t ELEMENT_TYPE_SENTINEL = 0x41;
+const uint8_t ELEMENT_TYPE_PINNED = 0x45;
+
+// calling convention flag followed by the number of generic parameters
+const uint8_t SIG_GENERIC = 0x10;
+
+
+static const char* GetPrimitiveTypeName(uint8_t element)
+{
+    switch (element)
+    {
+        case 0x01: return "void";
+        case 0x02: return "bool";
+        case 0x03: return "char";
+        case 0x04: return "int8";
+        case 0x05: return "uint8";
+        case 0x06: return "int16";
+        case 0x07: return "uint16";
+        case 0x08: return "int32";
+        case 0x09: return "uint32";
+        case 0x0A: return "int64";
+        case 0x0B: return "uint64";
+        case 0x0C: return "float32";
+        case 0x0D: return "float64";
+        case 0x0E: return "string";
+        case 0x16: return "typedref";
+        case 0x18: return "native int";
+        case 0x19: return "native uint";
+        case 0x1C: return "object";
+        default: return nullptr;
+    }
+}
+
+
+SignatureDecoder::SignatureDecoder(const TypeNameResolver& resolveTypeName)
+    :
+    _resolveTypeName(resolveTypeName)
+{
+}
+
+bool SignatureDecoder::DecodeMethodSignature(const uint8_t* blob, size_t size, std::string& text) const
+{
+    ByteReader reader(blob, size);
+    return DecodeMethod(reader, 0, text);
+}
+
+bool SignatureDecoder::DecodeTypeSignature(const uint8_t* blob, size_t size, std::string& text) const
+{
+    ByteReader reader(blob, size);
+    return DecodeType(reader, 0, text);
+}
+
+bool SignatureDecoder::DecodeMethod(ByteReader& reader, uint32_t depth, std::string& text) const
+{
+    uint8_t callingConvention = 0;
+    uint32_t genericCount = 0;
+    uint32_t parameterCount = 0;
+    if (!reader.Read(callingConvention) ||
+        (((callingConvention & SIG_GENERIC) != 0) && !reader.ReadCompressedUInt(genericCount)) ||
+        !reader.ReadCompressedUInt(parameterCount))
+    {
+        return false;
+    }
+
+    text += std::to_string(callingConvention);
+    if ((callingConvention & SIG_GENERIC) != 0)
+    {
+        text += '<' + std::to_string(genericCount) + '>';
+    }
+    text += ' ';
+    if (!DecodeType(reader, depth + 1, text))
+    {
+        return false;
+    }
+
+    text += '(';
+    for (uint32_t i = 0; i < parameterCount; i++)
+    {
+        // vararg call sites: the optional parameters follow a sentinel
+        uint8_t element = 0;
+        size_t position = reader.GetPosition();
+        if (reader.Read(element) && (element == ELEMENT_TYPE_SENTINEL))
+        {
+            text += "...,";
+        }
+        else
+        {
+            reader.Seek(position);
+        }
+
+        if (!DecodeType(reader, depth + 1, text))
+        {
+            return false;
+        }
+        text += ',';
+    }
+    text += ')';
+    return true;
+}
+
+bool SignatureDecoder::DecodeTypeToken(ByteReader& reader, std::string& text) const
+{
+    // TypeDefOrRefOrSpecEncoded: the 2 lowest bits select the table
+    static const uint32_t TypeTables[] = { TableTypeDef, TableTypeRef, TableTypeSpec, 0 };
+
+    uint32_t value = 0;
+    std::string name;
+    if (!reader.ReadCompressedUInt(value) || (TypeTables[value & 0x03] == 0) ||
+        !_resolveTypeName((TypeTables[value & 0x03] << 24) | (value >> 2), name))
+    {
+        return false;
+    }
+
+    text += '[';
+    text += name;
+    text += ']';
+    return true;
+}
+
+bool SignatureDecoder::DecodeType(ByteReader& reader, uint32_t depth, std::string& text) const
+{
+    uint8_t element = 0;
+    if ((depth > MaxDepth) || !reader.Read(element))
+    {
+        return false;
+    }
+
+    const char* primitive = GetPrimitiveTypeName(element);
+    if (primitive != nullptr)
+    {
+        text += primitive;
+        return true;
+    }
+
+    uint32_t count = 0;
+    switch (element)
+    {
+        case ELEMENT_TYPE_PTR:
+        case ELEMENT_TYPE_BYREF:
+        case ELEMENT_TYPE_SZARRAY:
+            if (!DecodeType(reader, depth + 1, text))
+            {
+                return false;
+            }
+            text += (element == ELEMENT_TYPE_PTR) ? "*" : ((element == ELEMENT_TYPE_BYREF) ? "&" : "[]");
+            return true;
+
+        case ELEMENT_TYPE_VALUETYPE:
+        case ELEMENT_TYPE_CLASS:
+            text += (element == ELEMENT_TYPE_VALUETYPE) ? "valuetype " : "class ";
+            return DecodeTypeToken(reader, text);
+
+        case ELEMENT_TYPE_VAR:
+        case ELEMENT_TYPE_MVAR:
+            if (!reader.ReadCompressedUInt(count))
+            {
+                return false;
+            }
+            text += ((element == ELEMENT_TYPE_VAR) ? "!" : "!!") + std::to_string(count);
+            return true;
+
+        case ELEMENT_TYPE_ARRAY:
+        {
+            // type rank numSizes size* numLoBounds loBound*
+            uint32_t rank = 0;
+            if (!DecodeType(reader, depth + 1, text) || !reader.ReadCompressedUInt(rank) || !reader.ReadCompressedUInt(count))
+            {
+                return false;
+            }
+
+            text += '[' + std::to_string(rank);
+            for (uint32_t i = 0; i < count; i++)
+            {
+                uint32_t size = 0;
+                if (!reader.ReadCompressedUInt(size))
+                {
+                    return false;
+                }
+                text += ',' + std::to_string(size);
+            }
+            if (!reader.ReadCompressedUInt(count))
+            {
+                return false;
+            }
+            text += ';';
+            for (uint32_t i = 0; i < count; i++)
+            {
+                int32_t loBound = 0;
+                if (!reader.ReadCompressedInt(loBound))
+                {
+                    return false;
+                }
+                text += ',' + std::to_string(loBound);
+            }
+            text += ']';
+            return true;
+        }
+
+        case ELEMENT_TYPE_GENERICINST:
+            // CLASS or VALUETYPE + token, then the type arguments
+            if (!DecodeType(reader, depth + 1, text) || !reader.ReadCompressedUInt(count))
+            {
+                return false;
+            }
+            text += '<';
+            for (uint32_t i = 0; i < count; i++)
+            {
+                if (!DecodeType(reader, depth + 1, text))
+                {
+                    return false;
+                }
+                text += ',';
+            }
+            text += '>';
+            return true;
+
+        case ELEMENT_TYPE_FNPTR:
+            text += "fnptr ";
+            return DecodeMethod(reader, depth + 1, text);
+
+        case ELEMENT_TYPE_CMOD_REQD:
+        case ELEMENT_TYPE_CMOD_OPT:
+            // the modifier precedes the type it applies to
+            text += (element == ELEMENT_TYPE_CMOD_REQD) ? "modreq" : "modopt";
+            if (!DecodeTypeToken(reader, text))
+            {
+                return false;
+            }
+            text += ' ';
+            return DecodeType(reader, depth + 1, text);
+
+        case ELEMENT_TYPE_PINNED:
+            text += "pinned ";
+            return DecodeType(reader, depth + 1, text);
+
+        default:
+            return false;
+    }
+}
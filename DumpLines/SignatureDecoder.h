@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include "ByteReader.h"
+
+// Decoder of ECMA-335 signature blobs (II.23.2) into a text where the TypeDefOrRefOrSpecEncoded
+// tokens are replaced by the names of the types: unlike the blob, the text does not change when
+// types or type references are added or removed in another build of the assembly.
+class SignatureDecoder
+{
+public:
+    // Name of a TypeDef, TypeRef or TypeSpec token (false if the token is invalid)
+    typedef std::function<bool(uint32_t token, std::string& name)> TypeNameResolver;
+
+public:
+    SignatureDecoder(const TypeNameResolver& resolveTypeName);
+
+    // MethodDefSig / MethodRefSig: calling convention, generic parameter count, return type, parameters
+    bool DecodeMethodSignature(const uint8_t* blob, size_t size, std::string& text) const;
+
+    // TypeSpec blob
+    bool DecodeTypeSignature(const uint8_t* blob, size_t size, std::string& text) const;
+
+private:
+    // function pointers and generic instantiations nest signatures: bounded for corrupted blobs
+    static const uint32_t MaxDepth = 32;
+
+private:
+    bool DecodeMethod(ByteReader& reader, uint32_t depth, std::string& text) const;
+    bool DecodeType(ByteReader& reader, uint32_t depth, std::string& text) const;
+    bool DecodeTypeToken(ByteReader& reader, std::string& text) const;
+
+private:
+    TypeNameResolver _resolveTypeName;
+};
@@ -0,0 +1,231 @@
+#include "SourceLineIndex.h"
+
+#include <algorithm>
+#include <cctype>
+
+
+SourceLineIndex::SourceLineIndex()
+{
+}
+
+std::string SourceLineIndex::GetLowerFileName(const std::string& path)
+{
+    size_t pos = path.find_last_of("\\/");
+    std::string name = (pos == std::string::npos) ? path : path.substr(pos + 1);
+    std::transform(name.begin(), name.end(), name.begin(), [](char c) { return static_cast<char>(tolower(static_cast<unsigned char>(c))); });
+    return name;
+}
+
+void SourceLineIndex::Build(const std::vector<std::string>& documents, const std::vector<SequencePoint>& sequencePoints)
+{
+    _documents = documents;
+    _documentSpans.clear();
+    _documentSpans.resize(documents.size());
+    _documentsByFileName.clear();
+    for (uint32_t document = 0; document < documents.size(); document++)
+    {
+        _documentsByFileName.emplace(GetLowerFileName(documents[document]), document);
+    }
+
+    // group the sequence points by document: the stable sort keeps them sorted by method and IL offset
+    _points.clear();
+    _points.reserve(sequencePoints.size());
+    for (const auto& point : sequencePoints)
+    {
+        if ((point.startLine != HiddenLineNumber) && (point.document < documents.size()))
+        {
+            _points.push_back(point);
+        }
+    }
+    std::stable_sort(_points.begin(), _points.end(),
+        [](const SequencePoint& left, const SequencePoint& right) { return left.document < right.document; });
+
+    // one span per (document, method) run
+    size_t current = 0;
+    while (current < _points.size())
+    {
+        const SequencePoint& first = _points[current];
+
+        MethodSpan span;
+        span.startLine = first.startLine;
+        span.endLine = first.endLine + 1;
+        span.maxEndLine = 0;
+        span.firstPoint = static_cast<uint32_t>(current);
+
+        size_t next = current + 1;
+        while ((next < _points.size()) && (_points[next].document == first.document) && (_points[next].token == first.token))
+        {
+            span.startLine = (std::min)(span.startLine, _points[next].startLine);
+            span.endLine = (std::max)(span.endLine, _points[next].endLine + 1);
+            next++;
+        }
+        span.pointCount = static_cast<uint32_t>(next - current);
+
+        _documentSpans[first.document].spans.push_back(span);
+        current = next;
+    }
+
+    for (auto& documentSpans : _documentSpans)
+    {
+        std::sort(documentSpans.spans.begin(), documentSpans.spans.end(),
+            [](const MethodSpan& left, const MethodSpan& right) { return left.startLine < right.startLine; });
+        documentSpans.maxLevel = IndexSpans(documentSpans.spans);
+    }
+}
+
+// Implicit interval tree over an array sorted by start line: leaves are at even indexes and
+// a node at level k has its k lowest bits set. Returns the level of the root (-1 if empty).
+int SourceLineIndex::IndexSpans(std::vector<MethodSpan>& spans)
+{
+    size_t count = spans.size();
+    if (count == 0)
+    {
+        return -1;
+    }
+
+    size_t lastIndex = 0;
+    uint32_t lastMaxEnd = 0;
+    for (size_t i = 0; i < count; i += 2)
+    {
+        lastIndex = i;
+        lastMaxEnd = spans[i].maxEndLine = spans[i].endLine;
+    }
+
+    int level = 1;
+    for (; (static_cast<size_t>(1) << level) <= count; level++)
+    {
+        size_t half = static_cast<size_t>(1) << (level - 1);
+        size_t step = half << 2;
+        for (size_t i = (half << 1) - 1; i < count; i += step)
+        {
+            uint32_t leftMax = spans[i - half].maxEndLine;
+            uint32_t rightMax = (i + half < count) ? spans[i + half].maxEndLine : lastMaxEnd;
+            spans[i].maxEndLine = (std::max)(spans[i].endLine, (std::max)(leftMax, rightMax));
+        }
+
+        // the last node may have a missing right subtree: track the max of its ancestor
+        lastIndex = ((lastIndex >> level) & 1) ? lastIndex - half : lastIndex + half;
+        if ((lastIndex < count) && (spans[lastIndex].maxEndLine > lastMaxEnd))
+        {
+            lastMaxEnd = spans[lastIndex].maxEndLine;
+        }
+    }
+
+    return level - 1;
+}
+
+void SourceLineIndex::FindInDocument(uint32_t document, uint32_t line, std::vector<SourceLineMatch>& matches) const
+{
+    const DocumentSpans& documentSpans = _documentSpans[document];
+    const std::vector<MethodSpan>& spans = documentSpans.spans;
+    if (documentSpans.maxLevel < 0)
+    {
+        return;
+    }
+
+    // spans containing [line, line + 1[
+    std::vector<size_t> found;
+    struct Node
+    {
+        int level;
+        size_t index;
+        bool leftDone;
+    };
+    Node stack[64];
+    int top = 0;
+    stack[top++] = { documentSpans.maxLevel, (static_cast<size_t>(1) << documentSpans.maxLevel) - 1, false };
+    size_t count = spans.size();
+    while (top > 0)
+    {
+        Node node = stack[--top];
+        if (node.level <= 3)
+        {
+            // small subtree: linear scan
+            size_t first = (node.index >> node.level) << node.level;
+            size_t last = (std::min)(first + (static_cast<size_t>(1) << (node.level + 1)) - 1, count);
+            for (size_t i = first; (i < last) && (spans[i].startLine <= line); i++)
+            {
+                if (line < spans[i].endLine)
+                {
+                    found.push_back(i);
+                }
+            }
+        }
+        else
+        if (!node.leftDone)
+        {
+            size_t left = node.index - (static_cast<size_t>(1) << (node.level - 1));
+            stack[top++] = { node.level, node.index, true };
+            if ((left >= count) || (spans[left].maxEndLine > line))
+            {
+                stack[top++] = { node.level - 1, left, false };
+            }
+        }
+        else
+        if ((node.index < count) && (spans[node.index].startLine <= line))
+        {
+            if (line < spans[node.index].endLine)
+            {
+                found.push_back(node.index);
+            }
+            stack[top++] = { node.level - 1, node.index + (static_cast<size_t>(1) << (node.level - 1)), false };
+        }
+    }
+
+    // keep the sequence points of the matching methods that cover the line
+    for (size_t spanIndex : found)
+    {
+        const MethodSpan& span = spans[spanIndex];
+        for (uint32_t i = span.firstPoint; i < span.firstPoint + span.pointCount; i++)
+        {
+            const SequencePoint& point = _points[i];
+            if ((point.startLine <= line) && (line <= point.endLine))
+            {
+                SourceLineMatch match;
+                match.token = point.token;
+                match.ilOffset = point.ilOffset;
+                match.document = document;
+                match.startLine = point.startLine;
+                match.endLine = point.endLine;
+                matches.push_back(match);
+            }
+        }
+    }
+}
+
+void SourceLineIndex::Find(const std::string& file, uint32_t line, std::vector<SourceLineMatch>& matches) const
+{
+    // the file name selects the candidates; a path must also match the end of the document path
+    std::string lowerFile = file;
+    std::transform(lowerFile.begin(), lowerFile.end(), lowerFile.begin(),
+        [](char c) { return (c == '/') ? '\\' : static_cast<char>(tolower(static_cast<unsigned char>(c))); });
+    bool hasPath = (lowerFile.find('\\') != std::string::npos);
+
+    size_t firstMatch = matches.size();
+    auto range = _documentsByFileName.equal_range(GetLowerFileName(file));
+    for (auto it = range.first; it != range.second; ++it)
+    {
+        uint32_t document = it->second;
+        if (hasPath)
+        {
+            std::string lowerDocument = _documents[document];
+            std::transform(lowerDocument.begin(), lowerDocument.end(), lowerDocument.begin(),
+                [](char c) { return (c == '/') ? '\\' : static_cast<char>(tolower(static_cast<unsigned char>(c))); });
+            if ((lowerDocument.size() < lowerFile.size()) ||
+                (lowerDocument.compare(lowerDocument.size() - lowerFile.size(), lowerFile.size(), lowerFile) != 0))
+            {
+                continue;
+            }
+        }
+
+        FindInDocument(document, line, matches);
+    }
+
+    std::sort(matches.begin() + firstMatch, matches.end(),
+        [](const SourceLineMatch& left, const SourceLineMatch& right)
+        {
+            return (left.document != right.document) ? (left.document < right.document) :
+                   (left.token != right.token) ? (left.token < right.token) :
+                   (left.ilOffset < right.ilOffset);
+        });
+}
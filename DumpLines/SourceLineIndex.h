@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "PdbCommon.h"
+
+struct SourceLineMatch
+{
+    uint32_t token;
+    uint32_t ilOffset;
+    uint32_t document;
+    uint32_t startLine;
+    uint32_t endLine;
+};
+
+// Reverse index: source file:line -> methods and IL offsets.
+// Each document has an implicit interval tree (sorted array augmented with the max end
+// line of each subtree) over the line span of the methods defined in this document,
+// so that a query only visits O(log n) nodes plus the matching methods.
+class SourceLineIndex
+{
+public:
+    SourceLineIndex();
+
+    // Sequence points must be grouped by method (sorted by token) as returned by the parsers
+    void Build(const std::vector<std::string>& documents, const std::vector<SequencePoint>& sequencePoints);
+
+    // The file can be a full path or just a file name (case insensitive)
+    void Find(const std::string& file, uint32_t line, std::vector<SourceLineMatch>& matches) const;
+
+    const std::string& GetDocument(uint32_t document) const { return _documents[document]; }
+
+private:
+    struct MethodSpan
+    {
+        uint32_t startLine;
+        uint32_t endLine;       // exclusive
+        uint32_t maxEndLine;    // max end line of the subtree rooted at this node
+        uint32_t firstPoint;    // sequence points of the method in this document
+        uint32_t pointCount;
+    };
+
+    struct DocumentSpans
+    {
+        std::vector<MethodSpan> spans;
+        int maxLevel;
+    };
+
+private:
+    static int IndexSpans(std::vector<MethodSpan>& spans);
+    void FindInDocument(uint32_t document, uint32_t line, std::vector<SourceLineMatch>& matches) const;
+    static std::string GetLowerFileName(const std::string& path);
+
+private:
+    std::vector<std::string> _documents;
+    std::vector<DocumentSpans> _documentSpans;
+    std::vector<SequencePoint> _points;
+
+    // lower case file name -> documents with that name
+    std::unordered_multimap<std::string, uint32_t> _documentsByFileName;
+};
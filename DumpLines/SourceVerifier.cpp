@@ -0,0 +1,270 @@
+#include <windows.h>
+#include "SourceVerifier.h"
+#include "ByteReader.h"
+#include "ByteWriter.h"
+#include "MappedFile.h"
+#include "Parallel.h"
+
+#include <cstdio>
+#include <cstring>
+
+const uint32_t SourceCacheSignature = 0x43534C44;  // DLSC
+const uint32_t SourceCacheVersion = 1;
+
+// Document.HashAlgorithm GUIDs (in their binary layout)
+static const uint8_t Sha1Guid[16] = { 0xec, 0x16, 0x18, 0xff, 0x5e, 0xaa, 0x10, 0x4d, 0x87, 0xf7, 0x6f, 0x49, 0x63, 0x83, 0x34, 0x60 };
+static const uint8_t Sha256Guid[16] = { 0x0f, 0xd0, 0x29, 0x88, 0xb8, 0x11, 0x13, 0x42, 0x87, 0x8b, 0x77, 0x0e, 0x85, 0x97, 0xac, 0x16 };
+
+
+static bool IsSeparator(char c)
+{
+    return (c == '\\') || (c == '/');
+}
+
+
+SourceVerifier::SourceVerifier()
+{
+}
+
+SourceVerifier::HashAlgorithm SourceVerifier::GetHashAlgorithm(const uint8_t* guid)
+{
+    if (guid == nullptr)
+    {
+        return HashUnknown;
+    }
+
+    if (memcmp(guid, Sha256Guid, sizeof(Sha256Guid)) == 0)
+    {
+        return HashSha256;
+    }
+
+    if (memcmp(guid, Sha1Guid, sizeof(Sha1Guid)) == 0)
+    {
+        return HashSha1;
+    }
+
+    return HashUnknown;
+}
+
+size_t SourceVerifier::GetHashSize(uint8_t algorithm)
+{
+    return (algorithm == HashSha256) ? Sha256Size : ((algorithm == HashSha1) ? Sha1Size : 0);
+}
+
+std::string SourceVerifier::GetCommonDirectory(const std::vector<std::string>& paths)
+{
+    if (paths.empty())
+    {
+        return "";
+    }
+
+    // longest common prefix, then back to the last separator
+    size_t length = paths[0].size();
+    for (const std::string& path : paths)
+    {
+        size_t i = 0;
+        while ((i < length) && (i < path.size()) && (path[i] == paths[0][i]))
+        {
+            i++;
+        }
+        length = i;
+    }
+
+    while ((length > 0) && !IsSeparator(paths[0][length - 1]))
+    {
+        length--;
+    }
+
+    return paths[0].substr(0, length);
+}
+
+bool SourceVerifier::HashFile(const std::string& path, uint64_t fileSize, uint8_t algorithm, uint8_t* hash)
+{
+    // empty files can't be mapped
+    static const uint8_t Empty[1] = { 0 };
+    const uint8_t* data = Empty;
+    MappedFile file;
+    if (fileSize != 0)
+    {
+        if (!file.Open(path))
+        {
+            return false;
+        }
+        data = file.GetData();
+        fileSize = file.GetSize();
+    }
+
+    if (algorithm == HashSha256)
+    {
+        ComputeSha256(data, static_cast<size_t>(fileSize), hash);
+    }
+    else
+    {
+        ComputeSha1(data, static_cast<size_t>(fileSize), hash);
+    }
+
+    return true;
+}
+
+bool SourceVerifier::LoadCache(const std::string& cacheFilePath)
+{
+    WIN32_FILE_ATTRIBUTE_DATA attributes;
+    if (!GetFileAttributesExA(cacheFilePath.c_str(), GetFileExInfoStandard, &attributes) ||
+        ((attributes.nFileSizeHigh == 0) && (attributes.nFileSizeLow == 0)))
+    {
+        return true;
+    }
+
+    MappedFile file;
+    if (!file.Open(cacheFilePath))
+    {
+        return false;
+    }
+
+    ByteReader reader(file.GetData(), file.GetSize());
+    uint32_t signature = 0;
+    uint32_t version = 0;
+    if (!reader.Read(signature) || !reader.Read(version) || (signature != SourceCacheSignature) || (version != SourceCacheVersion))
+    {
+        return false;
+    }
+
+    std::string path;
+    CachedHash entry;
+    while (reader.ReadShortString(path) &&
+           reader.Read(entry.fileSize) &&
+           reader.Read(entry.lastWriteTime) &&
+           reader.Read(entry.algorithm) &&
+           reader.ReadBytes(entry.hash, sizeof(entry.hash)))
+    {
+        _cache[path] = entry;
+    }
+
+    return true;
+}
+
+bool SourceVerifier::SaveCache(const std::string& cacheFilePath) const
+{
+    std::vector<uint8_t> buffer;
+    ByteWriter writer(buffer);
+    writer.Write(SourceCacheSignature);
+    writer.Write(SourceCacheVersion);
+    for (const auto& entry : _cache)
+    {
+        writer.WriteShortString(entry.first.c_str(), entry.first.size());
+        writer.Write(entry.second.fileSize);
+        writer.Write(entry.second.lastWriteTime);
+        writer.Write(entry.second.algorithm);
+        writer.WriteBytes(entry.second.hash, sizeof(entry.second.hash));
+    }
+
+    FILE* pFile = nullptr;
+    if ((fopen_s(&pFile, cacheFilePath.c_str(), "wb") != 0) || (pFile == nullptr))
+    {
+        return false;
+    }
+
+    bool success = fwrite(buffer.data(), 1, buffer.size(), pFile) == buffer.size();
+    fclose(pFile);
+    return success;
+}
+
+bool SourceVerifier::Verify(const PortablePdbParser& parser, const std::string& sourceRoot, std::vector<SourceCheck>& results)
+{
+    const MetadataReader& metadata = parser.GetMetadata();
+    const std::vector<std::string>& documents = parser.GetDocuments();
+
+    std::vector<DocumentFile> files(documents.size());
+    std::vector<std::string> hashedDocuments;
+    for (uint32_t i = 0; i < documents.size(); i++)
+    {
+        DocumentFile& file = files[i];
+        file.algorithm = GetHashAlgorithm(metadata.GetGuid(metadata.GetValue(TableDocument, i + 1, Document_HashAlgorithm)));
+        file.expectedHash = nullptr;
+        file.expectedSize = 0;
+        file.exists = false;
+        if ((file.algorithm != HashUnknown) &&
+            metadata.GetBlob(metadata.GetValue(TableDocument, i + 1, Document_Hash), file.expectedHash, file.expectedSize) &&
+            (file.expectedSize == GetHashSize(file.algorithm)))
+        {
+            hashedDocuments.push_back(documents[i]);
+        }
+        else
+        {
+            file.algorithm = HashUnknown;
+        }
+    }
+
+    // build paths (C:\build\src\..., /_/src/...) are relative to their common directory
+    std::string commonDirectory = GetCommonDirectory(hashedDocuments);
+    std::string root = sourceRoot;
+    if (!root.empty() && !IsSeparator(root.back()))
+    {
+        root += '\\';
+    }
+
+    results.resize(documents.size());
+    for (size_t i = 0; i < documents.size(); i++)
+    {
+        SourceCheck& result = results[i];
+        result.document = documents[i];
+        result.status = (files[i].algorithm == HashUnknown) ? SourceStatus::NoHash : SourceStatus::Missing;
+        result.cached = false;
+        if ((files[i].algorithm != HashUnknown) && (documents[i].compare(0, commonDirectory.size(), commonDirectory) == 0))
+        {
+            result.localPath = root + documents[i].substr(commonDirectory.size());
+        }
+    }
+
+    // the files whose size and time are in the cache are not read; the others are hashed in parallel
+    ParallelFor(documents.size(),
+        [&](size_t i)
+        {
+            DocumentFile& file = files[i];
+            SourceCheck& result = results[i];
+            WIN32_FILE_ATTRIBUTE_DATA attributes;
+            if (result.localPath.empty() ||
+                !GetFileAttributesExA(result.localPath.c_str(), GetFileExInfoStandard, &attributes) ||
+                ((attributes.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0))
+            {
+                return;
+            }
+
+            file.fileSize = (static_cast<uint64_t>(attributes.nFileSizeHigh) << 32) | attributes.nFileSizeLow;
+            file.lastWriteTime = (static_cast<uint64_t>(attributes.ftLastWriteTime.dwHighDateTime) << 32) | attributes.ftLastWriteTime.dwLowDateTime;
+            file.computed.fileSize = file.fileSize;
+            file.computed.lastWriteTime = file.lastWriteTime;
+            file.computed.algorithm = file.algorithm;
+            memset(file.computed.hash, 0, sizeof(file.computed.hash));
+
+            auto cached = _cache.find(result.localPath);
+            if ((cached != _cache.end()) &&
+                (cached->second.fileSize == file.fileSize) &&
+                (cached->second.lastWriteTime == file.lastWriteTime) &&
+                (cached->second.algorithm == file.algorithm))
+            {
+                file.computed = cached->second;
+                file.exists = true;
+                result.cached = true;
+            }
+            else
+            {
+                file.exists = HashFile(result.localPath, file.fileSize, file.algorithm, file.computed.hash);
+            }
+
+            if (file.exists)
+            {
+                result.status = (memcmp(file.computed.hash, file.expectedHash, file.expectedSize) == 0) ? SourceStatus::Match : SourceStatus::Mismatch;
+            }
+        });
+
+    for (size_t i = 0; i < documents.size(); i++)
+    {
+        if (files[i].exists && !results[i].cached)
+        {
+            _cache[results[i].localPath] = files[i].computed;
+        }
+    }
+
+    return true;
+}
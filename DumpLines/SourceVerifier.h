@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "PortablePdbParser.h"
+#include "Sha.h"
+
+enum class SourceStatus
+{
+    Match,
+    Mismatch,
+    Missing,    // not found in the local tree
+    NoHash      // no (or unknown) hash in the PDB
+};
+
+struct SourceCheck
+{
+    std::string document;   // path stored in the PDB
+    std::string localPath;
+    SourceStatus status;
+    bool cached;            // hash taken from the cache (same size and time as the last run)
+};
+
+// Check a local source tree against the SHA1/SHA256 hashes of the Document rows of a
+// Portable PDB: the common directory of the documents is replaced by the root of the tree.
+// Files are mapped and hashed on all cores; the hash of each file is cached with its size
+// and time so that files unchanged since the last run are not read again.
+class SourceVerifier
+{
+public:
+    SourceVerifier();
+
+    // A missing cache file is an empty cache
+    bool LoadCache(const std::string& cacheFilePath);
+    bool SaveCache(const std::string& cacheFilePath) const;
+
+    // Results are in Document table order
+    bool Verify(const PortablePdbParser& parser, const std::string& sourceRoot, std::vector<SourceCheck>& results);
+
+private:
+    enum HashAlgorithm : uint8_t
+    {
+        HashUnknown,
+        HashSha1,
+        HashSha256
+    };
+
+    struct CachedHash
+    {
+        uint64_t fileSize;
+        uint64_t lastWriteTime;
+        uint8_t algorithm;
+        uint8_t hash[Sha256Size];
+    };
+
+    // What is known about each document before hashing
+    struct DocumentFile
+    {
+        uint8_t algorithm;
+        const uint8_t* expectedHash;
+        uint32_t expectedSize;
+        bool exists;
+        uint64_t fileSize;
+        uint64_t lastWriteTime;
+        CachedHash computed;
+    };
+
+private:
+    static HashAlgorithm GetHashAlgorithm(const uint8_t* guid);
+    static size_t GetHashSize(uint8_t algorithm);
+    static std::string GetCommonDirectory(const std::vector<std::string>& paths);
+    static bool HashFile(const std::string& path, uint64_t fileSize, uint8_t algorithm, uint8_t* hash);
+
+private:
+    // local path -> hash of the file when it had this size and time
+    std::unordered_map<std::string, CachedHash> _cache;
+};
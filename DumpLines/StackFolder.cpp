@@ -0,0 +1,255 @@
+#include "StackFolder.h"
+#include "ByteReader.h"
+#include "MappedFile.h"
+#include "Parallel.h"
+
+#include <cstdio>
+#include <cstring>
+
+const size_t InitialTableSize = 1024;   // power of 2
+
+
+static uint32_t HashFrameIds(const uint32_t* ids, uint32_t length)
+{
+    // FNV-1a on the ids
+    uint32_t hash = 2166136261u;
+    for (uint32_t i = 0; i < length; i++)
+    {
+        hash = (hash ^ ids[i]) * 16777619u;
+    }
+    return hash;
+}
+
+static std::string GetFileName(const std::string& filePath)
+{
+    size_t separator = filePath.find_last_of("\\/");
+    return (separator == std::string::npos) ? filePath : filePath.substr(separator + 1);
+}
+
+
+StackFolder::StackFolder()
+    :
+    _frameSlots(InitialTableSize, 0),
+    _stackSlots(InitialTableSize, 0),
+    _sampleCount(0)
+{
+}
+
+bool StackFolder::Fold(const std::string& sampleFilePath)
+{
+    MappedFile file;
+    if (!file.Open(sampleFilePath))
+    {
+        return false;
+    }
+
+    ByteReader reader(file.GetData(), file.GetSize());
+    uint32_t magic = 0;
+    uint32_t version = 0;
+    uint32_t moduleCount = 0;
+    if (!reader.Read(magic) || (magic != StackSampleMagic) ||
+        !reader.Read(version) || (version != StackSampleVersion) ||
+        !reader.Read(moduleCount) || (moduleCount > 0xFFFF))
+    {
+        return false;
+    }
+
+    _modulePaths.resize(moduleCount);
+    for (std::string& path : _modulePaths)
+    {
+        if (!reader.ReadShortString(path))
+        {
+            return false;
+        }
+    }
+
+    // a module without a valid .pdb is still shown with the raw tokens
+    _modules.resize(moduleCount);
+    ParallelFor(moduleCount, [this](size_t i) { _modules[i] = ModuleSnapshot::Load(_modulePaths[i]); });
+
+    const size_t FrameSize = sizeof(uint16_t) + 2 * sizeof(uint32_t);
+    while (reader.GetRemaining() > 0)
+    {
+        uint16_t frameCount = 0;
+        if (!reader.Read(frameCount) || (frameCount * FrameSize > reader.GetRemaining()))
+        {
+            return false;
+        }
+
+        _sampleCount++;
+        if (frameCount == 0)
+        {
+            continue;
+        }
+
+        // the ids are appended at the end of the pool and removed if the stack is already known
+        uint32_t offset = static_cast<uint32_t>(_stackPool.size());
+        _stackPool.resize(_stackPool.size() + frameCount);
+        for (uint32_t i = 0; i < frameCount; i++)
+        {
+            FrameKey key;
+            reader.Read(key.module);
+            reader.Read(key.token);
+            reader.Read(key.ilOffset);
+            if (key.module >= moduleCount)
+            {
+                return false;
+            }
+
+            // stored from the leaf but folded from the root
+            _stackPool[offset + frameCount - 1 - i] = GetNameId(key);
+        }
+
+        AddStack(offset, frameCount);
+    }
+
+    return true;
+}
+
+uint32_t StackFolder::GetNameId(const FrameKey& key)
+{
+    size_t mask = _frameSlots.size() - 1;
+    for (size_t slot = FrameKeyHash()(key) & mask; ; slot = (slot + 1) & mask)
+    {
+        uint32_t index = _frameSlots[slot];
+        if (index == 0)
+        {
+            // first time this frame is seen: symbolize it
+            std::string name = FormatFrame(key);
+            auto result = _nameIds.emplace(name, static_cast<uint32_t>(_frameNames.size()));
+            if (result.second)
+            {
+                _frameNames.push_back(std::move(name));
+            }
+
+            _frames.push_back({ key, result.first->second });
+            _frameSlots[slot] = static_cast<uint32_t>(_frames.size());
+            if (_frames.size() * 2 > _frameSlots.size())
+            {
+                GrowFrameTable();
+            }
+            return result.first->second;
+        }
+
+        const Frame& frame = _frames[index - 1];
+        if (frame.key == key)
+        {
+            return frame.nameId;
+        }
+    }
+}
+
+void StackFolder::GrowFrameTable()
+{
+    std::vector<uint32_t> slots(_frameSlots.size() * 2, 0);
+    size_t mask = slots.size() - 1;
+    for (size_t i = 0; i < _frames.size(); i++)
+    {
+        size_t slot = FrameKeyHash()(_frames[i].key) & mask;
+        while (slots[slot] != 0)
+        {
+            slot = (slot + 1) & mask;
+        }
+        slots[slot] = static_cast<uint32_t>(i + 1);
+    }
+    _frameSlots.swap(slots);
+}
+
+std::string StackFolder::FormatFrame(const FrameKey& key) const
+{
+    const ModuleSnapshot* module = _modules[key.module].get();
+    SymbolizedFrame frame;
+    if ((module != nullptr) && module->Symbolize(key.token, key.ilOffset, frame) && (frame.function != nullptr))
+    {
+        return frame.function;
+    }
+
+    char address[16];
+    sprintf_s(address, sizeof(address), "!0x%08X", key.token);
+    return GetFileName(_modulePaths[key.module]) + address;
+}
+
+void StackFolder::AddStack(uint32_t offset, uint32_t length)
+{
+    const uint32_t* ids = _stackPool.data() + offset;
+    uint32_t hash = HashFrameIds(ids, length);
+
+    size_t mask = _stackSlots.size() - 1;
+    size_t slot = hash & mask;
+    for (; _stackSlots[slot] != 0; slot = (slot + 1) & mask)
+    {
+        Stack& stack = _stacks[_stackSlots[slot] - 1];
+        if ((stack.hash == hash) && (stack.length == length) &&
+            (memcmp(_stackPool.data() + stack.offset, ids, length * sizeof(uint32_t)) == 0))
+        {
+            stack.count++;
+            _stackPool.resize(offset);
+            return;
+        }
+    }
+
+    _stacks.push_back({ offset, length, hash, 1 });
+    _stackSlots[slot] = static_cast<uint32_t>(_stacks.size());
+    if (_stacks.size() * 2 > _stackSlots.size())
+    {
+        GrowStackTable();
+    }
+}
+
+void StackFolder::GrowStackTable()
+{
+    std::vector<uint32_t> slots(_stackSlots.size() * 2, 0);
+    size_t mask = slots.size() - 1;
+    for (size_t i = 0; i < _stacks.size(); i++)
+    {
+        size_t slot = _stacks[i].hash & mask;
+        while (slots[slot] != 0)
+        {
+            slot = (slot + 1) & mask;
+        }
+        slots[slot] = static_cast<uint32_t>(i + 1);
+    }
+    _stackSlots.swap(slots);
+}
+
+bool StackFolder::WriteCollapsed(const std::string& outputFilePath) const
+{
+    // the names are concatenated once per stack: compute the size first
+    size_t size = 0;
+    for (const Stack& stack : _stacks)
+    {
+        for (uint32_t i = 0; i < stack.length; i++)
+        {
+            size += _frameNames[_stackPool[stack.offset + i]].size() + 1;
+        }
+        size += 22;
+    }
+
+    std::string buffer;
+    buffer.reserve(size);
+    char count[24];
+    for (const Stack& stack : _stacks)
+    {
+        for (uint32_t i = 0; i < stack.length; i++)
+        {
+            if (i > 0)
+            {
+                buffer.push_back(';');
+            }
+            buffer.append(_frameNames[_stackPool[stack.offset + i]]);
+        }
+
+        int length = sprintf_s(count, sizeof(count), " %llu\n", static_cast<unsigned long long>(stack.count));
+        buffer.append(count, length);
+    }
+
+    FILE* pFile = nullptr;
+    if ((fopen_s(&pFile, outputFilePath.c_str(), "wb") != 0) || (pFile == nullptr))
+    {
+        return false;
+    }
+
+    bool success = fwrite(buffer.data(), 1, buffer.size(), pFile) == buffer.size();
+    success = (fclose(pFile) == 0) && success;
+    return success;
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "ModuleSnapshot.h"
+
+// Binary stream of managed stack samples (little endian):
+//    magic "DLSS" (4 bytes) + version (4 bytes) + module count (4 bytes)
+//    module count x path of the .pdb file (2 bytes length + characters)
+//    samples until the end of the file:
+//       frame count (2 bytes) + frame count x (module index (2 bytes), token (4 bytes), IL offset (4 bytes))
+//       frames are stored from the leaf to the root
+const uint32_t StackSampleMagic = 0x53534C44;  // DLSS
+const uint32_t StackSampleVersion = 1;
+
+// Fold stack samples into the collapsed format of flamegraph.pl ("root;...;leaf count").
+// Each distinct (module, token, IL offset) frame is symbolized and formatted only once and
+// mapped to the id of its name; identical stacks are aggregated in an open addressing hash
+// table keyed by their sequence of ids, stored in a single pool to avoid an allocation per sample.
+class StackFolder
+{
+public:
+    StackFolder();
+
+    bool Fold(const std::string& sampleFilePath);
+    bool WriteCollapsed(const std::string& outputFilePath) const;
+
+    uint64_t GetSampleCount() const { return _sampleCount; }
+    size_t GetStackCount() const { return _stacks.size(); }
+    size_t GetFrameCount() const { return _frameNames.size(); }
+
+private:
+    struct FrameKey
+    {
+        uint32_t token;
+        uint32_t ilOffset;
+        uint16_t module;
+
+        bool operator==(const FrameKey& other) const
+        {
+            return (token == other.token) && (ilOffset == other.ilOffset) && (module == other.module);
+        }
+    };
+
+    struct FrameKeyHash
+    {
+        size_t operator()(const FrameKey& key) const
+        {
+            uint64_t value = (static_cast<uint64_t>(key.token) << 32) ^ (static_cast<uint64_t>(key.module) << 48) ^ key.ilOffset;
+            value ^= value >> 33;
+            value *= 0xff51afd7ed558ccdULL;
+            value ^= value >> 33;
+            return static_cast<size_t>(value);
+        }
+    };
+
+    struct Frame
+    {
+        FrameKey key;
+        uint32_t nameId;
+    };
+
+    struct Stack
+    {
+        uint32_t offset;    // in _stackPool
+        uint32_t length;
+        uint32_t hash;
+        uint64_t count;
+    };
+
+private:
+    uint32_t GetNameId(const FrameKey& key);
+    std::string FormatFrame(const FrameKey& key) const;
+    void GrowFrameTable();
+    void AddStack(uint32_t offset, uint32_t length);
+    void GrowStackTable();
+
+private:
+    std::vector<std::shared_ptr<const ModuleSnapshot>> _modules;
+    std::vector<std::string> _modulePaths;
+
+    std::vector<Frame> _frames;
+    std::vector<uint32_t> _frameSlots;  // frame index + 1 (0 = empty slot)
+
+    // distinct frame names: several IL offsets of a method share the same name
+    std::unordered_map<std::string, uint32_t> _nameIds;
+    std::vector<std::string> _frameNames;
+
+    std::vector<uint32_t> _stackPool;   // frame ids of all distinct stacks (root first)
+    std::vector<Stack> _stacks;
+    std::vector<uint32_t> _stackSlots;  // stack index + 1 (0 = empty slot)
+    uint64_t _sampleCount;
+};
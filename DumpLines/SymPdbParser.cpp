@@ -1,8 +1,8 @@
 #include "SymPdbParser.h"
+#include "PeImage.h"
+#include "Utf16.h"
 #include <atlbase.h>
 #include <algorithm>
-#include <sstream>
-#include <iomanip>
 #include <cor.h>
 #include <CorHdr.h>
 #include <metahost.h>
@@ -28,8 +28,16 @@ DEFINE_GUID(IID_ISymUnmanagedBinder,
 SymPdbParser::SymPdbParser()
     : _pReader(nullptr)
     , _pMetaDataImport(nullptr)
+    , _methodsState(ComputeState::NotComputed)
+    , _sourceFilesState(ComputeState::NotComputed)
+    , _tokensState(ComputeState::NotComputed)
     , _age(0)
+    , _comInitialized(false)
 {
+    // S_FALSE if COM is already initialized on this thread (still needs to be balanced)
+    // or RPC_E_CHANGED_MODE if the thread already joined another apartment
+    HRESULT hr = CoInitializeEx(NULL, COINIT_MULTITHREADED);
+    _comInitialized = SUCCEEDED(hr);
 }
 
 SymPdbParser::~SymPdbParser()
@@ -44,6 +52,11 @@ SymPdbParser::~SymPdbParser()
         _pMetaDataImport->Release();
         _pMetaDataImport = nullptr;
     }
+    if (_comInitialized)
+    {
+        CoUninitialize();
+        _comInitialized = false;
+    }
 }
 
 bool SymPdbParser::LoadPdbFile(const std::string& pdbFilePath)
@@ -56,39 +69,16 @@ bool SymPdbParser::LoadPdbFile(const std::string& pdbFilePath)
         return false;
     }
 
-    // Derive the assembly file path from the PDB file path
-    // Replace .pdb extension with .dll or .exe
-    std::string assemblyPath = pdbFilePath;
-    size_t dotPos = assemblyPath.rfind(".pdb");
-    if (dotPos == std::string::npos || dotPos != assemblyPath.length() - 4)
-    {
-        return false; // Not a .pdb file
-    }
-
-    // Try .dll first, then .exe
-    // NOTE: .exe are not managed assemblies in .NET Core so .dll first
-    std::string dllPath = assemblyPath.substr(0, dotPos) + ".dll";
-    std::string exePath = assemblyPath.substr(0, dotPos) + ".exe";
-
+    // Derive the assembly file path from the PDB file path (.dll or .exe)
     std::string moduleFilePath;
-    if (GetFileAttributesA(dllPath.c_str()) != INVALID_FILE_ATTRIBUTES)
-    {
-        moduleFilePath = dllPath;
-    }
-    else
-    if (GetFileAttributesA(exePath.c_str()) != INVALID_FILE_ATTRIBUTES)
-    {
-        moduleFilePath = exePath;
-    }
-    else
+    if (!GetAssemblyPathFromPdb(pdbFilePath, moduleFilePath))
     {
         return false; // Cannot find corresponding assembly file
     }
 
     // Convert path to wide strings
-    int len = MultiByteToWideChar(CP_ACP, 0, moduleFilePath.c_str(), -1, NULL, 0);
-    std::wstring wModulePath(len, L'\0');
-    MultiByteToWideChar(CP_ACP, 0, moduleFilePath.c_str(), -1, &wModulePath[0], len);
+    std::wstring wModulePath;
+    AppendWide(moduleFilePath.c_str(), moduleFilePath.size(), wModulePath);
 
     // Create metadata dispenser using the CLR hosting API for .NET Framework 4.0+
     CComPtr<ICLRMetaHost> pMetaHost;
@@ -156,25 +146,8 @@ bool SymPdbParser::LoadPdbFile(const std::string& pdbFilePath)
     _guid = "N/A (ISymUnmanagedReader)";
     _age = 0;
 
-    // Compute method info
-    //if (!ComputeMethodsInfoByTypes())
-    if (!ComputeMethodsInfo())
-    {
-        return false;
-    }
-
-    // Compute source files
-    if (!ComputeSourceFiles())
-    {
-        return false;
-    }
-
-    // Compute tokens
-    if (!ComputeTokens())
-    {
-        return false;
-    }
-
+    // method info (with the documents and sequence points), source files and tokens are computed
+    // by the first call that needs them (or by the Ensure*Computed calls)
     return true;
 }
 
@@ -227,80 +200,95 @@ bool SymPdbParser::GetMethodInfoFromSymbol(ISymUnmanagedMethod* pMethod, MethodI
         if (SUCCEEDED(hr))
         {
             // Convert method name to narrow string
-            int len = WideCharToMultiByte(CP_UTF8, 0, methodName, -1, NULL, 0, NULL, NULL);
-            std::string narrowMethodName(len - 1, '\0');
-            WideCharToMultiByte(CP_UTF8, 0, methodName, -1, &narrowMethodName[0], len, NULL, NULL);
-            info.name = narrowMethodName;
+            info.name = ToUtf8(methodName, wcsnlen(methodName, ARRAYSIZE(methodName)));
         }
         else
         {
             // Fallback to token if we can't get the name
-            std::ostringstream oss;
-            oss << "0x" << std::hex << std::setw(8) << std::setfill('0') << token;
-            info.name = oss.str();
+            info.name = FormatToken("0x", token);
         }
     }
     else
     {
         // Fallback to token if metadata import is not available
-        std::ostringstream oss;
-        oss << "0x" << std::hex << std::setw(8) << std::setfill('0') << token;
-        info.name = oss.str();
+        info.name = FormatToken("0x", token);
     }
 
-    // Get sequence points (source line information)
+    // Get all sequence points (source line information): the first one gives the start line
+    // of the method and all of them are kept for the line -> IL offset queries
     ULONG32 cPoints = 0;
     hr = pMethod->GetSequencePointCount(&cPoints);
     if (SUCCEEDED(hr) && (cPoints > 0))
     {
-        cPoints = 1; // We only need the first sequence point for start line
-        std::vector<ULONG32> offsets(cPoints);
-        std::vector<ULONG32> lines(cPoints);
-        std::vector<ULONG32> columns(cPoints);
-        std::vector<ULONG32> endLines(cPoints);
-        std::vector<ULONG32> endColumns(cPoints);
-        std::vector<ISymUnmanagedDocument*> documents(cPoints);
+        // temporary arrays: released from the arena at the end of the method
+        Arena::Mark mark = _arena.GetMark();
+        ULONG32* offsets = _arena.AllocateArray<ULONG32>(cPoints);
+        ULONG32* lines = _arena.AllocateArray<ULONG32>(cPoints);
+        ULONG32* columns = _arena.AllocateArray<ULONG32>(cPoints);
+        ULONG32* endLines = _arena.AllocateArray<ULONG32>(cPoints);
+        ULONG32* endColumns = _arena.AllocateArray<ULONG32>(cPoints);
+        ISymUnmanagedDocument** documents = _arena.AllocateArray<ISymUnmanagedDocument*>(cPoints);
 
         ULONG32 actualCount = 0;
         hr = pMethod->GetSequencePoints(
             cPoints,
             &actualCount,
-            &offsets[0],
-            &documents[0],
-            &lines[0],
-            &columns[0],
-            &endLines[0],
-            &endColumns[0]
+            offsets,
+            documents,
+            lines,
+            columns,
+            endLines,
+            endColumns
         );
 
         if (SUCCEEDED(hr) && (actualCount > 0))
         {
-            // Get the first sequence point's document and line
-            ISymUnmanagedDocument* pDoc = documents[0];
-            if (pDoc != nullptr)
+            ISymUnmanagedDocument* pPreviousDoc = nullptr;
+            uint32_t documentIndex = 0;
+            for (ULONG32 i = 0; i < actualCount; i++)
             {
-                // Get document URL (file path)
-                ULONG32 urlLen = 0;
-                hr = pDoc->GetURL(0, &urlLen, NULL);
-                if (SUCCEEDED(hr) && (urlLen > 0))
+                ISymUnmanagedDocument* pDoc = documents[i];
+                if (pDoc == nullptr)
                 {
-                    std::vector<WCHAR> url(urlLen);
-                    hr = pDoc->GetURL(urlLen, &urlLen, &url[0]);
-                    if (SUCCEEDED(hr))
-                    {
-                        // Convert wide string to narrow string
-                        int len = WideCharToMultiByte(CP_UTF8, 0, &url[0], urlLen, NULL, 0, NULL, NULL);
-                        std::string narrowUrl(len, '\0');
-                        WideCharToMultiByte(CP_UTF8, 0, &url[0], urlLen, &narrowUrl[0], len, NULL, NULL);
-                        info.sourceFile = narrowUrl;
-                    }
+                    continue;
                 }
 
-                // NOTE: 0xFEEFEE is a special value indicating hidden lines
-                info.lineNumber = lines[0];
-                pDoc->Release();
+                // consecutive sequence points usually share the same document
+                if (pDoc != pPreviousDoc)
+                {
+                    documentIndex = GetDocumentIndex(pDoc);
+                    pPreviousDoc = pDoc;
+                }
+
+                if (info.sourceFile.empty())
+                {
+                    // Get the first sequence point's document and line
+                    // NOTE: 0xFEEFEE is a special value indicating hidden lines
+                    info.sourceFile = _documents[documentIndex];
+                    info.lineNumber = lines[i];
+                }
+
+                SequencePoint point;
+                point.token = token;
+                point.ilOffset = offsets[i];
+                point.document = documentIndex;
+                point.startLine = lines[i];
+                point.endLine = endLines[i];
+                point.startColumn = static_cast<uint16_t>(columns[i]);
+                point.endColumn = static_cast<uint16_t>(endColumns[i]);
+                _sequencePoints.push_back(point);
+            }
+
+            for (ULONG32 i = 0; i < actualCount; i++)
+            {
+                if (documents[i] != nullptr)
+                {
+                    documents[i]->Release();
+                }
             }
         }
+
+        _arena.Rewind(mark);
     }
     else
     {
@@ -317,7 +305,95 @@ bool SymPdbParser::GetMethodInfoFromSymbol(ISymUnmanagedMethod* pMethod, MethodI
 }
 
 
+// The UTF-8 conversion goes through the same buffer for all the strings of the parser:
+// the returned string is the only allocation
+std::string SymPdbParser::ToUtf8(const WCHAR* str, size_t length)
+{
+    _conversionBuffer.clear();
+    AppendUtf8(str, length, _conversionBuffer);
+    return _conversionBuffer;
+}
+
+std::string SymPdbParser::FormatToken(const char* prefix, uint32_t token)
+{
+    char name[16];
+    snprintf(name, sizeof(name), "%s%08x", prefix, token);
+    return name;
+}
+
+std::string SymPdbParser::GetDocumentUrl(ISymUnmanagedDocument* pDoc)
+{
+    // Get document URL (file path)
+    ULONG32 urlLen = 0;
+    HRESULT hr = pDoc->GetURL(0, &urlLen, NULL);
+    if (FAILED(hr) || (urlLen == 0))
+    {
+        return "";
+    }
+
+    Arena::Mark mark = _arena.GetMark();
+    WCHAR* url = _arena.AllocateArray<WCHAR>(urlLen);
+    hr = pDoc->GetURL(urlLen, &urlLen, url);
+    if (FAILED(hr))
+    {
+        _arena.Rewind(mark);
+        return "";
+    }
+
+    // Convert wide string to narrow string (without the trailing \0)
+    std::string narrowUrl = ToUtf8(url, wcsnlen(url, urlLen));
+    _arena.Rewind(mark);
+    return narrowUrl;
+}
+
+uint32_t SymPdbParser::GetDocumentIndex(ISymUnmanagedDocument* pDoc)
+{
+    std::string url = GetDocumentUrl(pDoc);
+    auto it = _documentIndexes.find(url);
+    if (it != _documentIndexes.end())
+    {
+        return it->second;
+    }
+
+    uint32_t index = static_cast<uint32_t>(_documents.size());
+    _documents.push_back(url);
+    _documentIndexes[url] = index;
+    return index;
+}
+
+
 const uint32_t LAST_METHODDEF_TOKEN = 0x00010000;
+
+// Number of rows in the MethodDef table (0 if the metadata tables are not available)
+ULONG SymPdbParser::GetMethodDefCount()
+{
+    if (_pMetaDataImport == nullptr)
+    {
+        return 0;
+    }
+
+    // Get IMetaDataTables interface to query the MethodDef table
+    CComPtr<IMetaDataTables> pTables;
+    HRESULT hr = _pMetaDataImport->QueryInterface(IID_IMetaDataTables, (void**)&pTables);
+    if (FAILED(hr) || pTables == nullptr)
+    {
+        return 0;
+    }
+
+    // Get the number of rows in the MethodDef table (table index 0x06 = Method)
+    ULONG cRows = 0;
+    hr = pTables->GetTableInfo(
+        0x06,           // MethodDef table
+        NULL,           // cbRow (not needed)
+        &cRows,         // pcRows (number of methods)
+        NULL,           // pcCols (not needed)
+        NULL,           // piKey (not needed)
+        NULL            // ppName (not needed)
+    );
+
+    return FAILED(hr) ? 0 : cRows;
+}
+
 bool SymPdbParser::ComputeMethodsInfo()
 {
     if (_pReader == nullptr || _pMetaDataImport == nullptr)
@@ -326,35 +402,18 @@ bool SymPdbParser::ComputeMethodsInfo()
     }
 
     HRESULT hr;
-    ULONG cRows = 0;
+    ULONG cRows = GetMethodDefCount();
 
-    // Get IMetaDataTables interface to query the MethodDef table
-    CComPtr<IMetaDataTables> pTables;
-    hr = _pMetaDataImport->QueryInterface(IID_IMetaDataTables, (void**)&pTables);
-    if (FAILED(hr) || pTables == nullptr)
+    // Iterate through all method tokens based on actual table size
+    // Method tokens start at 0x06000001 (RID 1 in table 0x06)
+    if (cRows == 0)
     {
         cRows = LAST_METHODDEF_TOKEN;
     }
     else
     {
-        // Get the number of rows in the MethodDef table (table index 0x06 = Method)
-        hr = pTables->GetTableInfo(
-            0x06,           // MethodDef table
-            NULL,           // cbRow (not needed)
-            &cRows,         // pcRows (number of methods)
-            NULL,           // pcCols (not needed)
-            NULL,           // piKey (not needed)
-            NULL            // ppName (not needed)
-        );
-
-        if (FAILED(hr))
-        {
-            cRows = LAST_METHODDEF_TOKEN;
-        }
+        _methods.reserve(cRows);
     }
-
-    // Iterate through all method tokens based on actual table size
-    // Method tokens start at 0x06000001 (RID 1 in table 0x06)
     for (uint32_t i = 1; i <= cRows; i++)
     {
         mdMethodDef token = TokenFromRid(i, mdtMethodDef);
@@ -406,19 +465,14 @@ bool SymPdbParser::ComputeMethodsInfo()
             if (SUCCEEDED(hr))
             {
                 // Convert method name to narrow string
-                int len = WideCharToMultiByte(CP_UTF8, 0, methodName, -1, NULL, 0, NULL, NULL);
-                std::string narrowMethodName(len - 1, '\0');
-                WideCharToMultiByte(CP_UTF8, 0, methodName, -1, &narrowMethodName[0], len, NULL, NULL);
-                info.name = narrowMethodName;
+                info.name = ToUtf8(methodName, wcsnlen(methodName, ARRAYSIZE(methodName)));
 
                 _methods.push_back(info);
             }
             else
             {
                 // Fallback to token if we can't get the name
-                std::ostringstream oss;
-                oss << "0x" << std::hex << std::setw(8) << std::setfill('0') << token;
-                info.name = oss.str();
+                info.name = FormatToken("0x", token);
                 _methods.push_back(info);
             }
         }
@@ -542,21 +596,10 @@ bool SymPdbParser::ComputeSourceFiles()
             continue;
         }
 
-        // Get document URL (file path)
-        ULONG32 urlLen = 0;
-        hr = pDoc->GetURL(0, &urlLen, NULL);
-        if (SUCCEEDED(hr) && urlLen > 0)
+        std::string url = GetDocumentUrl(pDoc);
+        if (!url.empty())
         {
-            std::vector<WCHAR> url(urlLen);
-            hr = pDoc->GetURL(urlLen, &urlLen, &url[0]);
-            if (SUCCEEDED(hr))
-            {
-                // Convert wide string to narrow string
-                int len = WideCharToMultiByte(CP_UTF8, 0, &url[0], urlLen, NULL, 0, NULL, NULL);
-                std::string narrowUrl(len, '\0');
-                WideCharToMultiByte(CP_UTF8, 0, &url[0], urlLen, &narrowUrl[0], len, NULL, NULL);
-                _sourceFiles.push_back(narrowUrl);
-            }
+            _sourceFiles.push_back(url);
         }
 
         pDoc->Release();
@@ -578,7 +621,9 @@ bool SymPdbParser::ComputeTokens()
         return false;
     }
 
-    // method tokens are from the 0x06000000 MethodDef table
+    // method tokens are from the 0x06000000 MethodDef table: the methods may not be computed
+    // yet, so the list is sized from the table itself
+    _tokens.reserve(GetMethodDefCount());
     for (ULONG32 token = 0x06000001; token < 0x06010000; token++)
     {
         ISymUnmanagedMethod* pMethod = nullptr;
@@ -593,9 +638,7 @@ bool SymPdbParser::ComputeTokens()
             info.address = 0;
             info.tag = 0;
 
-            std::ostringstream oss;
-            oss << " 0x" << std::hex << std::setw(8) << std::setfill('0') << token;
-            info.name = oss.str();
+            info.name = FormatToken(" 0x", token);
 
             _tokens.push_back(info);
             pMethod->Release();
@@ -605,17 +648,63 @@ bool SymPdbParser::ComputeTokens()
     return true;
 }
 
+bool SymPdbParser::EnsureMethodsComputed()
+{
+    if (_methodsState == ComputeState::NotComputed)
+    {
+        //ComputeMethodsInfoByTypes();
+        _methodsState = ComputeMethodsInfo() ? ComputeState::Computed : ComputeState::Failed;
+    }
+
+    return _methodsState == ComputeState::Computed;
+}
+
+bool SymPdbParser::EnsureSourceFilesComputed()
+{
+    if (_sourceFilesState == ComputeState::NotComputed)
+    {
+        _sourceFilesState = ComputeSourceFiles() ? ComputeState::Computed : ComputeState::Failed;
+    }
+
+    return _sourceFilesState == ComputeState::Computed;
+}
+
+bool SymPdbParser::EnsureTokensComputed()
+{
+    if (_tokensState == ComputeState::NotComputed)
+    {
+        _tokensState = ComputeTokens() ? ComputeState::Computed : ComputeState::Failed;
+    }
+
+    return _tokensState == ComputeState::Computed;
+}
+
 std::vector<MethodInfo> SymPdbParser::GetMethods()
 {
+    EnsureMethodsComputed();
     return _methods;
 }
 
 std::vector<std::string> SymPdbParser::GetSourceFiles()
 {
+    EnsureSourceFilesComputed();
     return _sourceFiles;
 }
 
 std::vector<TokenInfo> SymPdbParser::GetTokens()
 {
+    EnsureTokensComputed();
     return _tokens;
 }
+
+const std::vector<std::string>& SymPdbParser::GetDocuments()
+{
+    EnsureMethodsComputed();
+    return _documents;
+}
+
+std::vector<SequencePoint> SymPdbParser::GetSequencePoints()
+{
+    EnsureMethodsComputed();
+    return _sequencePoints;
+}
@@ -6,9 +6,14 @@
 #include <corsym.h>
 #include <string>
 #include <vector>
+#include <unordered_map>
 #include "PdbCommon.h"
+#include "Arena.h"
 
-// Parser that uses ISymUnmanagedReader COM interface to read PDB files
+// Parser that uses ISymUnmanagedReader COM interface to read PDB files.
+// Threading: an instance must be used by the thread that created it (the COM
+// pointers belong to its apartment) but different instances can load different
+// files on different threads: each instance initializes COM for its thread.
 class SymPdbParser
 {
 public:
@@ -19,15 +24,37 @@ public:
     std::vector<MethodInfo> GetMethods();
     std::vector<std::string> GetSourceFiles();
     std::vector<TokenInfo> GetTokens();
+
+    // Enumerate now what the Get* calls would otherwise enumerate on first use: false if
+    // ISymUnmanagedReader fails to enumerate them (the other backend can then be tried).
+    // The documents and sequence points are collected with the methods.
+    bool EnsureMethodsComputed();
+    bool EnsureSourceFilesComputed();
+    bool EnsureTokensComputed();
+
     std::string GetGuid() const { return _guid; }
     DWORD GetAge() const { return _age; }
 
+    // Documents in the order they are referenced: SequencePoint::document is an index in this list
+    const std::vector<std::string>& GetDocuments();
+
+    // All sequence points sorted by method token
+    std::vector<SequencePoint> GetSequencePoints();
+
 private:
+    SymPdbParser(const SymPdbParser&) = delete;
+    SymPdbParser& operator=(const SymPdbParser&) = delete;
+
+    ULONG GetMethodDefCount();
     bool ComputeMethodsInfo();
     bool ComputeMethodsInfoByTypes();
     bool ComputeSourceFiles();
     bool ComputeTokens();
     bool GetMethodInfoFromSymbol(ISymUnmanagedMethod* pMethod, MethodInfo& info);
+    std::string ToUtf8(const WCHAR* str, size_t length);
+    std::string GetDocumentUrl(ISymUnmanagedDocument* pDoc);
+    static std::string FormatToken(const char* prefix, uint32_t token);
+    uint32_t GetDocumentIndex(ISymUnmanagedDocument* pDoc);
 
 private:
     ISymUnmanagedReader* _pReader;
@@ -35,7 +62,18 @@ private:
     std::vector<MethodInfo> _methods;
     std::vector<std::string> _sourceFiles;
     std::vector<TokenInfo> _tokens;
+    std::vector<std::string> _documents;
+    std::unordered_map<std::string, uint32_t> _documentIndexes;
+    std::vector<SequencePoint> _sequencePoints;
+    ComputeState _methodsState;
+    ComputeState _sourceFilesState;
+    ComputeState _tokensState;
     std::string _guid;
     DWORD _age;
     std::string _pdbFilePath;
+    std::string _conversionBuffer;
+
+    // temporary arrays of the COM calls (released in one step with the parser)
+    Arena _arena;
+    bool _comInitialized;
 };
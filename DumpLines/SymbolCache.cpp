@@ -0,0 +1,51 @@
+#include "SymbolCache.h"
+
+
+SymbolCache::SymbolCache(size_t capacity)
+    :
+    _capacity((capacity == 0) ? 1 : capacity),
+    _hitCount(0),
+    _missCount(0)
+{
+}
+
+std::shared_ptr<const ModuleSnapshot> SymbolCache::Get(const PdbKey& key, const std::string& pdbFilePath)
+{
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        auto entry = _entries.find(key);
+        if (entry != _entries.end())
+        {
+            _lru.splice(_lru.begin(), _lru, entry->second);
+            _hitCount++;
+            return *entry->second;
+        }
+        _missCount++;
+    }
+
+    // parsing is done outside of the lock so that other modules can still be queried;
+    // two threads missing the same module both parse it and the first one wins
+    std::shared_ptr<const ModuleSnapshot> snapshot = ModuleSnapshot::Load(pdbFilePath);
+    if ((snapshot == nullptr) || !(snapshot->GetKey() == key))
+    {
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> guard(_lock);
+    auto entry = _entries.find(key);
+    if (entry != _entries.end())
+    {
+        _lru.splice(_lru.begin(), _lru, entry->second);
+        return *entry->second;
+    }
+
+    _lru.push_front(snapshot);
+    _entries[key] = _lru.begin();
+    while (_lru.size() > _capacity)
+    {
+        _entries.erase(_lru.back()->GetKey());
+        _lru.pop_back();
+    }
+
+    return snapshot;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "ModuleSnapshot.h"
+
+// LRU cache of module snapshots keyed by PDB GUID + age.
+// The lock only protects the LRU list: snapshots are immutable and are used without
+// any lock once returned (an evicted snapshot lives until its last user releases it).
+class SymbolCache
+{
+public:
+    SymbolCache(size_t capacity);
+
+    // Load the snapshot from the given path on a cache miss; return nullptr if the file
+    // can't be loaded or if its identity does not match the key
+    std::shared_ptr<const ModuleSnapshot> Get(const PdbKey& key, const std::string& pdbFilePath);
+
+    uint64_t GetHitCount() const { return _hitCount; }
+    uint64_t GetMissCount() const { return _missCount; }
+
+private:
+    typedef std::list<std::shared_ptr<const ModuleSnapshot>> LruList;
+
+private:
+    size_t _capacity;
+    std::mutex _lock;
+    LruList _lru;   // most recently used first
+    std::unordered_map<PdbKey, LruList::iterator, PdbKeyHash> _entries;
+    std::atomic<uint64_t> _hitCount;
+    std::atomic<uint64_t> _missCount;
+};
@@ -0,0 +1,82 @@
+#include <winsock2.h>
+#include <afunix.h>
+#include "SymbolClient.h"
+
+
+SymbolClient::SymbolClient()
+    :
+    _socket(INVALID_SOCKET),
+    _isWsaStarted(false)
+{
+}
+
+SymbolClient::~SymbolClient()
+{
+    Close();
+}
+
+bool SymbolClient::Connect(const std::string& socketPath)
+{
+    Close();
+
+    sockaddr_un address = { 0 };
+    if (socketPath.size() >= sizeof(address.sun_path))
+    {
+        return false;
+    }
+    address.sun_family = AF_UNIX;
+    memcpy(address.sun_path, socketPath.c_str(), socketPath.size());
+
+    WSADATA wsaData;
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0)
+    {
+        return false;
+    }
+    _isWsaStarted = true;
+
+    SOCKET clientSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (clientSocket == INVALID_SOCKET)
+    {
+        return false;
+    }
+
+    if (connect(clientSocket, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == SOCKET_ERROR)
+    {
+        closesocket(clientSocket);
+        return false;
+    }
+
+    _socket = clientSocket;
+    return true;
+}
+
+void SymbolClient::Close()
+{
+    if (_socket != INVALID_SOCKET)
+    {
+        closesocket(static_cast<SOCKET>(_socket));
+        _socket = INVALID_SOCKET;
+    }
+
+    if (_isWsaStarted)
+    {
+        WSACleanup();
+        _isWsaStarted = false;
+    }
+}
+
+bool SymbolClient::Symbolize(const SymbolRequest& request, SymbolResponse& response)
+{
+    if (_socket == INVALID_SOCKET)
+    {
+        return false;
+    }
+
+    if (!EncodeSymbolRequest(request, _buffer) ||
+        !SendSymbolMessage(_socket, _buffer) || !ReceiveSymbolMessage(_socket, SymbolResponseMagic, _buffer))
+    {
+        return false;
+    }
+
+    return DecodeSymbolResponse(_buffer.data(), _buffer.size(), response);
+}
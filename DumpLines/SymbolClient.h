@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "SymbolProtocol.h"
+
+// Client of the symbol server: one connection can send any number of requests
+class SymbolClient
+{
+public:
+    SymbolClient();
+    ~SymbolClient();
+
+    bool Connect(const std::string& socketPath);
+    void Close();
+
+    bool Symbolize(const SymbolRequest& request, SymbolResponse& response);
+
+private:
+    uintptr_t _socket;
+    bool _isWsaStarted;
+    std::vector<uint8_t> _buffer;
+};
@@ -0,0 +1,409 @@
+#include "SymbolIndex.h"
+#include "ByteWriter.h"
+#include "MappedFile.h"
+#include "CompactMethodTable.h"
+
+#include <algorithm>
+#include <cctype>
+
+const uint32_t SymbolIndexSignature = 0x58494C44;  // DLIX
+const uint32_t SymbolIndexVersion = 2;    // 2 = methods stored in a CompactMethodTable
+
+// record = kind + payload size + payload
+const size_t RecordHeaderSize = 2 * sizeof(uint32_t);
+
+
+SymbolIndex::SymbolIndex()
+    :
+    _hFile(INVALID_HANDLE_VALUE),
+    _fileSize(0)
+{
+}
+
+SymbolIndex::~SymbolIndex()
+{
+    Close();
+}
+
+void SymbolIndex::Close()
+{
+    if (_hFile != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(_hFile);
+        _hFile = INVALID_HANDLE_VALUE;
+    }
+
+    _fileSize = 0;
+    _modules.clear();
+}
+
+std::string SymbolIndex::GetPathKey(const std::string& path)
+{
+    // Windows paths are case insensitive
+    std::string key = path;
+    std::transform(key.begin(), key.end(), key.begin(),
+        [](char c) { return (c == '/') ? '\\' : static_cast<char>(tolower(static_cast<unsigned char>(c))); });
+    return key;
+}
+
+bool SymbolIndex::Open(const std::string& indexFilePath)
+{
+    Close();
+
+    if (!ReadManifest(indexFilePath))
+    {
+        return false;
+    }
+
+    _hFile = CreateFileA(
+        indexFilePath.c_str(),
+        GENERIC_READ | GENERIC_WRITE,
+        FILE_SHARE_READ,
+        NULL,
+        OPEN_ALWAYS,
+        FILE_ATTRIBUTE_NORMAL,
+        NULL
+    );
+    if (_hFile == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    // drop what follows the last complete record
+    LARGE_INTEGER position;
+    position.QuadPart = static_cast<LONGLONG>(_fileSize);
+    if (!SetFilePointerEx(_hFile, position, NULL, FILE_BEGIN) || !SetEndOfFile(_hFile))
+    {
+        Close();
+        return false;
+    }
+
+    if (_fileSize == 0)
+    {
+        uint32_t header[2] = { SymbolIndexSignature, SymbolIndexVersion };
+        if (!WriteAt(0, header, sizeof(header)))
+        {
+            Close();
+            return false;
+        }
+        _fileSize = sizeof(header);
+    }
+
+    return true;
+}
+
+bool SymbolIndex::ReadManifest(const std::string& indexFilePath)
+{
+    // a missing (or empty) file is a new index
+    WIN32_FILE_ATTRIBUTE_DATA attributes;
+    if (!GetFileAttributesExA(indexFilePath.c_str(), GetFileExInfoStandard, &attributes) ||
+        ((attributes.nFileSizeHigh == 0) && (attributes.nFileSizeLow == 0)))
+    {
+        return true;
+    }
+
+    MappedFile file;
+    if (!file.Open(indexFilePath))
+    {
+        return false;
+    }
+
+    ByteReader reader(file.GetData(), file.GetSize());
+    uint32_t signature = 0;
+    uint32_t version = 0;
+    if (!reader.Read(signature) || !reader.Read(version) || (signature != SymbolIndexSignature) || (version != SymbolIndexVersion))
+    {
+        return false;
+    }
+    _fileSize = reader.GetPosition();
+
+    for (;;)
+    {
+        uint64_t recordOffset = reader.GetPosition();
+        uint32_t kind = 0;
+        uint32_t payloadSize = 0;
+        if (!reader.Read(kind) || !reader.Read(payloadSize) || (payloadSize > reader.GetRemaining()))
+        {
+            break;
+        }
+
+        const uint8_t* payload = reader.GetCurrent();
+        reader.Skip(payloadSize);
+        if (!ApplyRecord(kind, payload, payloadSize, recordOffset))
+        {
+            break;
+        }
+
+        _fileSize = reader.GetPosition();
+    }
+
+    return true;
+}
+
+bool SymbolIndex::ReadModuleHeader(ByteReader& reader, IndexedModule& module)
+{
+    return reader.ReadShortString(module.path) &&
+           reader.Read(module.fileSize) &&
+           reader.Read(module.lastWriteTime) &&
+           reader.ReadBytes(module.key.guid, sizeof(module.key.guid)) &&
+           reader.Read(module.key.age) &&
+           reader.Read(module.methodCount);
+}
+
+bool SymbolIndex::ApplyRecord(uint32_t kind, const uint8_t* payload, size_t size, uint64_t recordOffset)
+{
+    ByteReader reader(payload, size);
+    switch (kind)
+    {
+        case RecordModule:
+        {
+            // only the header is read: methods are decoded on demand
+            IndexedModule module;
+            if (!ReadModuleHeader(reader, module))
+            {
+                return false;
+            }
+            module.recordOffset = recordOffset;
+            module.methodsOffset = recordOffset + RecordHeaderSize + reader.GetPosition();
+            _modules[GetPathKey(module.path)] = module;
+            return true;
+        }
+
+        case RecordTouch:
+        {
+            std::string path;
+            uint64_t fileSize = 0;
+            uint64_t lastWriteTime = 0;
+            if (!reader.ReadShortString(path) || !reader.Read(fileSize) || !reader.Read(lastWriteTime))
+            {
+                return false;
+            }
+
+            auto module = _modules.find(GetPathKey(path));
+            if (module != _modules.end())
+            {
+                module->second.fileSize = fileSize;
+                module->second.lastWriteTime = lastWriteTime;
+            }
+            return true;
+        }
+
+        case RecordRemoval:
+        {
+            std::string path;
+            if (!reader.ReadShortString(path))
+            {
+                return false;
+            }
+
+            _modules.erase(GetPathKey(path));
+            return true;
+        }
+
+        default:
+            return false;
+    }
+}
+
+const IndexedModule* SymbolIndex::FindModule(const std::string& path) const
+{
+    auto module = _modules.find(GetPathKey(path));
+    return (module != _modules.end()) ? &module->second : nullptr;
+}
+
+static size_t BeginRecord(ByteWriter& writer, uint32_t kind)
+{
+    writer.Write(kind);
+    size_t sizePosition = writer.GetPosition();
+    writer.Write(static_cast<uint32_t>(0));
+    return sizePosition;
+}
+
+static void EndRecord(ByteWriter& writer, size_t sizePosition)
+{
+    writer.Patch(sizePosition, static_cast<uint32_t>(writer.GetPosition() - sizePosition - sizeof(uint32_t)));
+}
+
+void SymbolIndex::WriteModuleHeader(ByteWriter& writer, const IndexedModule& module, uint32_t methodCount)
+{
+    writer.WriteShortString(module.path.c_str(), module.path.size());
+    writer.Write(module.fileSize);
+    writer.Write(module.lastWriteTime);
+    writer.WriteBytes(module.key.guid, sizeof(module.key.guid));
+    writer.Write(module.key.age);
+    writer.Write(methodCount);
+}
+
+void SymbolIndex::EncodeModuleRecord(const IndexedModule& module, const std::vector<MethodInfo>& methods, std::vector<uint8_t>& record)
+{
+    record.clear();
+    record.reserve(64 + module.path.size() + methods.size() * 16);
+
+    ByteWriter writer(record);
+    size_t sizePosition = BeginRecord(writer, RecordModule);
+    WriteModuleHeader(writer, module, static_cast<uint32_t>(methods.size()));
+
+    std::vector<uint8_t> table;
+    CompactMethodTable::Encode(methods, table);
+    writer.WriteBytes(table.data(), table.size());
+    EndRecord(writer, sizePosition);
+}
+
+bool SymbolIndex::AppendModuleRecord(const std::vector<uint8_t>& record)
+{
+    return AppendRecord(record);
+}
+
+bool SymbolIndex::CopyModuleRecord(const SymbolIndex& source, const IndexedModule& module)
+{
+    uint32_t header[2];     // kind + payload size
+    if (!source.ReadAt(module.recordOffset, header, sizeof(header)) || (header[0] != RecordModule))
+    {
+        return false;
+    }
+
+    uint64_t tableSize = module.recordOffset + sizeof(header) + header[1] - module.methodsOffset;
+    std::vector<uint8_t> table(static_cast<size_t>(tableSize));
+    if (!source.ReadAt(module.methodsOffset, table.data(), table.size()))
+    {
+        return false;
+    }
+
+    // the header is written from the manifest: a touch record may have changed the size and time
+    std::vector<uint8_t> record;
+    record.reserve(64 + module.path.size() + table.size());
+    ByteWriter writer(record);
+    size_t sizePosition = BeginRecord(writer, RecordModule);
+    WriteModuleHeader(writer, module, module.methodCount);
+    writer.WriteBytes(table.data(), table.size());
+    EndRecord(writer, sizePosition);
+
+    return AppendRecord(record);
+}
+
+bool SymbolIndex::AppendTouch(const IndexedModule& module)
+{
+    std::vector<uint8_t> record;
+    ByteWriter writer(record);
+    size_t sizePosition = BeginRecord(writer, RecordTouch);
+    writer.WriteShortString(module.path.c_str(), module.path.size());
+    writer.Write(module.fileSize);
+    writer.Write(module.lastWriteTime);
+    EndRecord(writer, sizePosition);
+
+    return AppendRecord(record);
+}
+
+bool SymbolIndex::AppendRemoval(const std::string& path)
+{
+    std::vector<uint8_t> record;
+    ByteWriter writer(record);
+    size_t sizePosition = BeginRecord(writer, RecordRemoval);
+    writer.WriteShortString(path.c_str(), path.size());
+    EndRecord(writer, sizePosition);
+
+    return AppendRecord(record);
+}
+
+bool SymbolIndex::AppendRecord(const std::vector<uint8_t>& record)
+{
+    if ((_hFile == INVALID_HANDLE_VALUE) || (record.size() < RecordHeaderSize))
+    {
+        return false;
+    }
+
+    uint64_t recordOffset = _fileSize;
+    if (!WriteAt(recordOffset, record.data(), record.size()))
+    {
+        return false;
+    }
+    _fileSize += record.size();
+
+    uint32_t kind = 0;
+    memcpy(&kind, record.data(), sizeof(kind));
+    return ApplyRecord(kind, record.data() + RecordHeaderSize, record.size() - RecordHeaderSize, recordOffset);
+}
+
+bool SymbolIndex::Flush()
+{
+    return (_hFile != INVALID_HANDLE_VALUE) && FlushFileBuffers(_hFile);
+}
+
+bool SymbolIndex::WriteAt(uint64_t offset, const void* buffer, size_t size)
+{
+    OVERLAPPED overlapped = { 0 };
+    overlapped.Offset = static_cast<DWORD>(offset);
+    overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+
+    DWORD written = 0;
+    if (!WriteFile(_hFile, buffer, static_cast<DWORD>(size), &written, &overlapped))
+    {
+        return false;
+    }
+
+    return (written == size);
+}
+
+bool SymbolIndex::ReadAt(uint64_t offset, void* buffer, size_t size) const
+{
+    // positional read: the file pointer is not shared between threads
+    OVERLAPPED overlapped = { 0 };
+    overlapped.Offset = static_cast<DWORD>(offset);
+    overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+
+    DWORD read = 0;
+    if (!ReadFile(_hFile, buffer, static_cast<DWORD>(size), &read, &overlapped))
+    {
+        return false;
+    }
+
+    return (read == size);
+}
+
+bool SymbolIndex::ReadMethods(const IndexedModule& module, std::vector<MethodInfo>& methods) const
+{
+    uint32_t header[2];     // kind + payload size
+    if (!ReadAt(module.recordOffset, header, sizeof(header)) || (header[0] != RecordModule))
+    {
+        return false;
+    }
+
+    uint64_t tableSize = module.recordOffset + sizeof(header) + header[1] - module.methodsOffset;
+    std::vector<uint8_t> table(static_cast<size_t>(tableSize));
+    if (!ReadAt(module.methodsOffset, table.data(), table.size()))
+    {
+        return false;
+    }
+
+    CompactMethodTable reader;
+    return reader.Open(table.data(), table.size()) && reader.DecodeAll(table.data(), table.size(), methods);
+}
+
+bool SymbolIndex::FindMethod(const IndexedModule& module, uint32_t address, MethodInfo& method) const
+{
+    // header -> prefix (skip index + file table) -> one block
+    uint8_t header[CompactMethodTable::HeaderSize];
+    size_t prefixSize = 0;
+    if (!ReadAt(module.methodsOffset, header, sizeof(header)) ||
+        !CompactMethodTable::GetPrefixSize(header, sizeof(header), prefixSize))
+    {
+        return false;
+    }
+
+    std::vector<uint8_t> prefix(prefixSize);
+    CompactMethodTable reader;
+    size_t blockOffset = 0;
+    size_t blockSize = 0;
+    if (!ReadAt(module.methodsOffset, prefix.data(), prefix.size()) ||
+        !reader.Open(prefix.data(), prefix.size()) ||
+        !reader.FindBlock(address, blockOffset, blockSize))
+    {
+        return false;
+    }
+
+    std::vector<uint8_t> block(blockSize);
+    std::vector<MethodInfo> methods;
+    return ReadAt(module.methodsOffset + blockOffset, block.data(), block.size()) &&
+           reader.DecodeBlock(block.data(), block.size(), methods) &&
+           CompactMethodTable::FindInBlock(methods, address, method);
+}
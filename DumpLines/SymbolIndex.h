@@ -0,0 +1,85 @@
+#pragma once
+
+#include <windows.h>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "PdbCommon.h"
+#include "ByteReader.h"
+#include "ByteWriter.h"
+#include "ModuleSnapshot.h"
+
+// Identity of an indexed module as it was when its methods were recorded
+struct IndexedModule
+{
+    std::string path;
+    uint64_t fileSize;
+    uint64_t lastWriteTime;     // FILETIME (100 ns ticks)
+    PdbKey key;
+    uint64_t recordOffset;      // module record holding the methods
+    uint64_t methodsOffset;     // CompactMethodTable in this record
+    uint32_t methodCount;
+};
+
+// Append-only index of the methods of many modules.
+// The file is a list of records (module, touch, removal); existing records are never
+// rewritten: the last record of a path wins so that an updated module is just appended.
+// Opening the index only reads the record headers to rebuild the manifest.
+class SymbolIndex
+{
+public:
+    SymbolIndex();
+    ~SymbolIndex();
+
+    // Create the file if needed; an incomplete record at the end (interrupted append) is dropped
+    bool Open(const std::string& indexFilePath);
+    void Close();
+
+    // Return nullptr if the path is not in the index
+    const IndexedModule* FindModule(const std::string& path) const;
+
+    // lower case path -> module
+    const std::unordered_map<std::string, IndexedModule>& GetModules() const { return _modules; }
+
+    // Records can be encoded in parallel and appended later
+    static void EncodeModuleRecord(const IndexedModule& module, const std::vector<MethodInfo>& methods, std::vector<uint8_t>& record);
+    bool AppendModuleRecord(const std::vector<uint8_t>& record);
+
+    // Append the record of a module of another index: the method table is copied as is
+    bool CopyModuleRecord(const SymbolIndex& source, const IndexedModule& module);
+
+    // Same PDB (GUID + age) but the file was rewritten: only the size and time change
+    bool AppendTouch(const IndexedModule& module);
+    bool AppendRemoval(const std::string& path);
+    bool Flush();
+
+    bool ReadMethods(const IndexedModule& module, std::vector<MethodInfo>& methods) const;
+
+    // Only read the block of the compact method table that contains the address
+    bool FindMethod(const IndexedModule& module, uint32_t address, MethodInfo& method) const;
+
+    static std::string GetPathKey(const std::string& path);
+
+private:
+    enum RecordKind
+    {
+        RecordModule = 1,
+        RecordTouch = 2,
+        RecordRemoval = 3,
+    };
+
+private:
+    bool ReadManifest(const std::string& indexFilePath);
+    bool ApplyRecord(uint32_t kind, const uint8_t* payload, size_t size, uint64_t recordOffset);
+    bool AppendRecord(const std::vector<uint8_t>& record);
+    bool WriteAt(uint64_t offset, const void* buffer, size_t size);
+    bool ReadAt(uint64_t offset, void* buffer, size_t size) const;
+    static bool ReadModuleHeader(ByteReader& reader, IndexedModule& module);
+    static void WriteModuleHeader(ByteWriter& writer, const IndexedModule& module, uint32_t methodCount);
+
+private:
+    HANDLE _hFile;
+    uint64_t _fileSize;
+    std::unordered_map<std::string, IndexedModule> _modules;
+};
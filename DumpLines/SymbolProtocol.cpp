@@ -0,0 +1,178 @@
+#include <winsock2.h>
+#include "SymbolProtocol.h"
+#include "ByteReader.h"
+#include "ByteWriter.h"
+
+#include <algorithm>
+
+// Link with ws2_32.lib
+#pragma comment(lib, "ws2_32.lib")
+
+
+static size_t BeginMessage(ByteWriter& writer, uint32_t magic)
+{
+    writer.Write(magic);
+    size_t sizePosition = writer.GetPosition();
+    writer.Write(static_cast<uint32_t>(0));
+    return sizePosition;
+}
+
+static bool EndMessage(ByteWriter& writer, size_t sizePosition)
+{
+    size_t payloadSize = writer.GetPosition() - sizePosition - sizeof(uint32_t);
+    writer.Patch(sizePosition, static_cast<uint32_t>(payloadSize));
+
+    // the receiver rejects larger messages
+    return payloadSize <= MaxSymbolMessageSize;
+}
+
+static bool WriteString(ByteWriter& writer, const char* str)
+{
+    return writer.WriteShortString(str, (str == nullptr) ? 0 : strlen(str));
+}
+
+bool EncodeSymbolRequest(const SymbolRequest& request, std::vector<uint8_t>& message)
+{
+    message.clear();
+    message.reserve(32 + request.pdbFilePath.size() + request.addresses.size() * sizeof(SymbolAddress));
+
+    ByteWriter writer(message);
+    size_t sizePosition = BeginMessage(writer, SymbolRequestMagic);
+    writer.WriteBytes(request.key.guid, sizeof(request.key.guid));
+    writer.Write(request.key.age);
+    if (!writer.WriteShortString(request.pdbFilePath.c_str(), request.pdbFilePath.size()))
+    {
+        return false;
+    }
+    writer.Write(static_cast<uint32_t>(request.addresses.size()));
+    for (const SymbolAddress& address : request.addresses)
+    {
+        writer.Write(address.address);
+        writer.Write(address.ilOffset);
+    }
+    return EndMessage(writer, sizePosition);
+}
+
+bool DecodeSymbolRequest(const uint8_t* payload, size_t size, SymbolRequest& request)
+{
+    ByteReader reader(payload, size);
+    uint32_t count = 0;
+    if (!reader.ReadBytes(request.key.guid, sizeof(request.key.guid)) ||
+        !reader.Read(request.key.age) ||
+        !reader.ReadShortString(request.pdbFilePath) ||
+        !reader.Read(count) ||
+        (count > reader.GetRemaining() / (2 * sizeof(uint32_t))))
+    {
+        return false;
+    }
+
+    request.addresses.resize(count);
+    for (SymbolAddress& address : request.addresses)
+    {
+        reader.Read(address.address);
+        reader.Read(address.ilOffset);
+    }
+
+    return true;
+}
+
+bool EncodeSymbolResponse(uint32_t status, const std::vector<SymbolizedFrame>& frames, std::vector<uint8_t>& message)
+{
+    message.clear();
+    message.reserve(16 + frames.size() * 64);
+
+    ByteWriter writer(message);
+    size_t sizePosition = BeginMessage(writer, SymbolResponseMagic);
+    writer.Write(status);
+    writer.Write(static_cast<uint32_t>(frames.size()));
+    for (const SymbolizedFrame& frame : frames)
+    {
+        writer.Write(frame.line);
+        writer.Write(frame.displacement);
+
+        // a truncated name would be wrong: the whole response is rejected; stop as soon as the
+        // message is too large (each frame takes at least 12 bytes)
+        if (!WriteString(writer, frame.function) || !WriteString(writer, frame.file) ||
+            (writer.GetPosition() > MaxSymbolMessageSize + 2 * sizeof(uint32_t)))
+        {
+            return false;
+        }
+    }
+    return EndMessage(writer, sizePosition);
+}
+
+bool DecodeSymbolResponse(const uint8_t* payload, size_t size, SymbolResponse& response)
+{
+    ByteReader reader(payload, size);
+    uint32_t count = 0;
+    if (!reader.Read(response.status) || !reader.Read(count))
+    {
+        return false;
+    }
+
+    // each result takes at least 12 bytes
+    if (count > reader.GetRemaining() / 12)
+    {
+        return false;
+    }
+
+    response.results.resize(count);
+    for (SymbolResult& result : response.results)
+    {
+        if (!reader.Read(result.line) ||
+            !reader.Read(result.displacement) ||
+            !reader.ReadShortString(result.function) ||
+            !reader.ReadShortString(result.file))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool SendSymbolMessage(uintptr_t socket, const std::vector<uint8_t>& message)
+{
+    size_t sent = 0;
+    while (sent < message.size())
+    {
+        int chunk = static_cast<int>((std::min)(message.size() - sent, static_cast<size_t>(0x10000000)));
+        int result = send(static_cast<SOCKET>(socket), reinterpret_cast<const char*>(message.data() + sent), chunk, 0);
+        if (result <= 0)
+        {
+            return false;
+        }
+        sent += result;
+    }
+
+    return true;
+}
+
+static bool ReceiveAll(uintptr_t socket, void* buffer, size_t size)
+{
+    char* current = static_cast<char*>(buffer);
+    size_t received = 0;
+    while (received < size)
+    {
+        int result = recv(static_cast<SOCKET>(socket), current + received, static_cast<int>(size - received), 0);
+        if (result <= 0)
+        {
+            return false;
+        }
+        received += result;
+    }
+
+    return true;
+}
+
+bool ReceiveSymbolMessage(uintptr_t socket, uint32_t magic, std::vector<uint8_t>& payload)
+{
+    uint32_t header[2];     // magic + payload size
+    if (!ReceiveAll(socket, header, sizeof(header)) || (header[0] != magic) || (header[1] > MaxSymbolMessageSize))
+    {
+        return false;
+    }
+
+    payload.resize(header[1]);
+    return ReceiveAll(socket, payload.data(), payload.size());
+}
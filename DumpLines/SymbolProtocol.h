@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "ModuleSnapshot.h"
+
+// Binary protocol of the symbol server (little endian).
+// Each message = magic (4 bytes) + payload size (4 bytes) + payload; a connection can
+// send any number of requests and each request is answered by exactly one response.
+//
+// request payload:
+//    GUID (16 bytes) + age (4 bytes)       empty GUID = read the identity from the file
+//    path length (2 bytes) + path          PDB to load on a cache miss
+//    count (4 bytes) + count x (address, IL offset) 4 bytes each
+//
+// response payload:
+//    status (4 bytes) + count (4 bytes) + count x
+//       line (4 bytes) + displacement (4 bytes) +
+//       function length (2 bytes) + function + file length (2 bytes) + file
+// A response that would not fit in MaxSymbolMessageSize (too many addresses with long names)
+// is replaced by a SymbolStatusResponseTooLarge response without results: split the request.
+const uint32_t SymbolRequestMagic = 0x51534C44;     // DLSQ
+const uint32_t SymbolResponseMagic = 0x52534C44;    // DLSR
+const uint32_t MaxSymbolMessageSize = 16 * 1024 * 1024;
+
+enum SymbolStatus
+{
+    SymbolStatusOk = 0,
+    SymbolStatusBadRequest = 1,
+    SymbolStatusModuleNotFound = 2,
+    SymbolStatusResponseTooLarge = 3,
+};
+
+struct SymbolAddress
+{
+    uint32_t address;       // RVA or method token
+    uint32_t ilOffset;      // ignored for native code
+};
+
+struct SymbolRequest
+{
+    PdbKey key;
+    std::string pdbFilePath;
+    std::vector<SymbolAddress> addresses;
+};
+
+struct SymbolResult
+{
+    uint32_t line;          // 0 if unknown
+    uint32_t displacement;
+    std::string function;   // empty if unknown
+    std::string file;
+};
+
+struct SymbolResponse
+{
+    uint32_t status;
+    std::vector<SymbolResult> results;
+};
+
+// Return false if the message would be larger than MaxSymbolMessageSize or a string longer than 64 KB
+bool EncodeSymbolRequest(const SymbolRequest& request, std::vector<uint8_t>& message);
+bool DecodeSymbolRequest(const uint8_t* payload, size_t size, SymbolRequest& request);
+
+// The server encodes the frames pointing to the snapshot to avoid copying the strings
+bool EncodeSymbolResponse(uint32_t status, const std::vector<SymbolizedFrame>& frames, std::vector<uint8_t>& message);
+bool DecodeSymbolResponse(const uint8_t* payload, size_t size, SymbolResponse& response);
+
+// Sockets are passed as uintptr_t so that callers don't depend on winsock2.h
+bool SendSymbolMessage(uintptr_t socket, const std::vector<uint8_t>& message);
+bool ReceiveSymbolMessage(uintptr_t socket, uint32_t magic, std::vector<uint8_t>& payload);
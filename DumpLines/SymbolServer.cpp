@@ -0,0 +1,220 @@
+#include <winsock2.h>
+#include <afunix.h>
+#include "SymbolServer.h"
+#include "SymbolProtocol.h"
+
+#include <algorithm>
+#include <thread>
+
+
+SymbolServer::SymbolServer(size_t cacheCapacity, size_t workerCount)
+    :
+    _cache(cacheCapacity),
+    _workerCount((workerCount == 0) ? 1 : workerCount),
+    _stopping(false),
+    _listenSocket(INVALID_SOCKET)
+{
+}
+
+SymbolServer::~SymbolServer()
+{
+    Stop();
+}
+
+bool SymbolServer::Run(const std::string& socketPath)
+{
+    sockaddr_un address = { 0 };
+    if (socketPath.size() >= sizeof(address.sun_path))
+    {
+        return false;
+    }
+    address.sun_family = AF_UNIX;
+    memcpy(address.sun_path, socketPath.c_str(), socketPath.size());
+
+    WSADATA wsaData;
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0)
+    {
+        return false;
+    }
+
+    SOCKET listenSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenSocket == INVALID_SOCKET)
+    {
+        WSACleanup();
+        return false;
+    }
+
+    // a previous server may have left the socket file behind
+    DeleteFileA(socketPath.c_str());
+    if ((bind(listenSocket, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == SOCKET_ERROR) ||
+        (listen(listenSocket, SOMAXCONN) == SOCKET_ERROR))
+    {
+        closesocket(listenSocket);
+        WSACleanup();
+        return false;
+    }
+
+    // _stopping is not reset here: a Stop() called before (or during) the startup ends the loop
+    // below, and the Stop() after the loop closes the socket if the first one missed it
+    _listenSocket = listenSocket;
+
+    std::vector<std::thread> workers;
+    workers.reserve(_workerCount);
+    for (size_t i = 0; i < _workerCount; i++)
+    {
+        workers.emplace_back([this]() { WorkerLoop(); });
+    }
+
+    bool succeeded = true;
+    while (!_stopping)
+    {
+        SOCKET client = accept(listenSocket, nullptr, nullptr);
+        if (client == INVALID_SOCKET)
+        {
+            // Stop() closes the listening socket to unblock accept()
+            if (_stopping)
+            {
+                break;
+            }
+
+            // a client that went away before being accepted: the next one can still be accepted
+            int error = WSAGetLastError();
+            if ((error == WSAECONNRESET) || (error == WSAEINTR))
+            {
+                continue;
+            }
+
+            succeeded = false;
+            break;
+        }
+
+        {
+            std::lock_guard<std::mutex> guard(_queueLock);
+            _pendingClients.push_back(client);
+        }
+        _queueChanged.notify_one();
+    }
+
+    // also closes the listening socket and wakes up the workers when accept() failed
+    Stop();
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+
+    // connections accepted but never served
+    for (uintptr_t client : _pendingClients)
+    {
+        closesocket(static_cast<SOCKET>(client));
+    }
+    _pendingClients.clear();
+
+    DeleteFileA(socketPath.c_str());
+    WSACleanup();
+    return succeeded;
+}
+
+void SymbolServer::Stop()
+{
+    {
+        std::lock_guard<std::mutex> guard(_queueLock);
+        _stopping = true;
+    }
+    _queueChanged.notify_all();
+
+    uintptr_t listenSocket = _listenSocket.exchange(INVALID_SOCKET);
+    if (listenSocket != INVALID_SOCKET)
+    {
+        closesocket(static_cast<SOCKET>(listenSocket));
+    }
+
+    // wake up the workers blocked in recv() on idle clients: the sockets are closed by their worker
+    std::lock_guard<std::mutex> guard(_queueLock);
+    for (uintptr_t client : _activeClients)
+    {
+        shutdown(static_cast<SOCKET>(client), SD_BOTH);
+    }
+}
+
+void SymbolServer::WorkerLoop()
+{
+    for (;;)
+    {
+        uintptr_t client = INVALID_SOCKET;
+        {
+            std::unique_lock<std::mutex> guard(_queueLock);
+            _queueChanged.wait(guard, [this]() { return _stopping || !_pendingClients.empty(); });
+            if (_stopping)
+            {
+                return;
+            }
+
+            client = _pendingClients.front();
+            _pendingClients.pop_front();
+            _activeClients.push_back(client);
+        }
+
+        ServeClient(client);
+
+        // removed before being closed: Stop() never shuts down a closed (or reused) socket
+        {
+            std::lock_guard<std::mutex> guard(_queueLock);
+            _activeClients.erase(std::find(_activeClients.begin(), _activeClients.end(), client));
+        }
+        closesocket(static_cast<SOCKET>(client));
+    }
+}
+
+void SymbolServer::ServeClient(uintptr_t client)
+{
+    // the client sends requests until it closes the connection
+    std::vector<uint8_t> payload;
+    std::vector<uint8_t> response;
+    while (!_stopping && ReceiveSymbolMessage(client, SymbolRequestMagic, payload))
+    {
+        HandleRequest(payload, response);
+        if (!SendSymbolMessage(client, response))
+        {
+            return;
+        }
+    }
+}
+
+void SymbolServer::HandleRequest(const std::vector<uint8_t>& payload, std::vector<uint8_t>& response)
+{
+    std::vector<SymbolizedFrame> frames;
+
+    SymbolRequest request;
+    if (!DecodeSymbolRequest(payload.data(), payload.size(), request))
+    {
+        EncodeSymbolResponse(SymbolStatusBadRequest, frames, response);
+        return;
+    }
+
+    // clients that don't know the identity of the PDB let the server read it
+    if (request.key.IsEmpty() && !ReadPdbKey(request.pdbFilePath, request.key))
+    {
+        EncodeSymbolResponse(SymbolStatusModuleNotFound, frames, response);
+        return;
+    }
+
+    // the snapshot is immutable: no lock is needed while symbolizing
+    std::shared_ptr<const ModuleSnapshot> snapshot = _cache.Get(request.key, request.pdbFilePath);
+    if (snapshot == nullptr)
+    {
+        EncodeSymbolResponse(SymbolStatusModuleNotFound, frames, response);
+        return;
+    }
+
+    frames.resize(request.addresses.size());
+    for (size_t i = 0; i < request.addresses.size(); i++)
+    {
+        snapshot->Symbolize(request.addresses[i].address, request.addresses[i].ilOffset, frames[i]);
+    }
+
+    if (!EncodeSymbolResponse(SymbolStatusOk, frames, response))
+    {
+        frames.clear();
+        EncodeSymbolResponse(SymbolStatusResponseTooLarge, frames, response);
+    }
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "SymbolCache.h"
+
+// Symbolization server listening on a Unix domain socket (AF_UNIX, Windows 10 1803+).
+// Accepted connections are served by a fixed pool of worker threads (a connection keeps its
+// worker until it is closed); modules are shared between the workers through the snapshot cache.
+// Stop() shuts down the connections being served so that workers waiting for a request return.
+class SymbolServer
+{
+public:
+    SymbolServer(size_t cacheCapacity, size_t workerCount);
+    ~SymbolServer();
+
+    // Block until Stop() is called (from another thread or a console handler): false if the
+    // socket cannot be created or accept() fails. A stopped server cannot be run again.
+    bool Run(const std::string& socketPath);
+    void Stop();
+
+    const SymbolCache& GetCache() const { return _cache; }
+
+private:
+    void WorkerLoop();
+    void ServeClient(uintptr_t client);
+    void HandleRequest(const std::vector<uint8_t>& payload, std::vector<uint8_t>& response);
+
+private:
+    SymbolCache _cache;
+    size_t _workerCount;
+    std::atomic<bool> _stopping;
+    std::atomic<uintptr_t> _listenSocket;
+
+    // accepted connections waiting for a worker
+    std::mutex _queueLock;
+    std::condition_variable _queueChanged;
+    std::deque<uintptr_t> _pendingClients;
+
+    // connections being served by a worker (protected by _queueLock)
+    std::vector<uintptr_t> _activeClients;
+};
@@ -0,0 +1,161 @@
+#include <windows.h>
+#include "Utf16.h"
+
+#if defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define UTF16_SSE2
+#include <emmintrin.h>
+#endif
+
+// MSVC defines __AVX2__ with /arch:AVX2
+#if defined(__AVX2__)
+#define UTF16_AVX2
+#include <immintrin.h>
+#endif
+
+#ifdef _WIN32
+static_assert(sizeof(wchar_t) == sizeof(uint16_t), "wchar_t must be UTF-16");
+#endif
+
+const size_t ScalarRun = 16;    // characters converted one by one after a non ASCII block
+
+
+// Encode the character at src[i] (2 code units for a surrogate pair)
+static inline size_t EncodeUtf8(const uint16_t* src, size_t length, size_t& i, char* dst)
+{
+    uint32_t c = src[i++];
+    if (c < 0x80)
+    {
+        dst[0] = static_cast<char>(c);
+        return 1;
+    }
+
+    if (c < 0x800)
+    {
+        dst[0] = static_cast<char>(0xC0 | (c >> 6));
+        dst[1] = static_cast<char>(0x80 | (c & 0x3F));
+        return 2;
+    }
+
+    if ((c >= 0xD800) && (c <= 0xDFFF))
+    {
+        if ((c <= 0xDBFF) && (i < length) && (src[i] >= 0xDC00) && (src[i] <= 0xDFFF))
+        {
+            c = 0x10000 + ((c - 0xD800) << 10) + (src[i++] - 0xDC00);
+            dst[0] = static_cast<char>(0xF0 | (c >> 18));
+            dst[1] = static_cast<char>(0x80 | ((c >> 12) & 0x3F));
+            dst[2] = static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+            dst[3] = static_cast<char>(0x80 | (c & 0x3F));
+            return 4;
+        }
+
+        c = 0xFFFD;
+    }
+
+    dst[0] = static_cast<char>(0xE0 | (c >> 12));
+    dst[1] = static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+    dst[2] = static_cast<char>(0x80 | (c & 0x3F));
+    return 3;
+}
+
+size_t ConvertUtf16ToUtf8(const uint16_t* src, size_t length, char* dst)
+{
+    char* current = dst;
+    size_t i = 0;
+    while (i < length)
+    {
+#ifdef UTF16_AVX2
+        const __m256i avxMask = _mm256_set1_epi16(static_cast<short>(0xFF80));
+        while (i + 32 <= length)
+        {
+            __m256i low = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+            __m256i high = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i + 16));
+            if (!_mm256_testz_si256(_mm256_or_si256(low, high), avxMask))
+            {
+                break;
+            }
+
+            // the pack works per 128-bit lane: put the 64-bit quarters back in order
+            __m256i packed = _mm256_packus_epi16(low, high);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(current), _mm256_permute4x64_epi64(packed, 0xD8));
+            i += 32;
+            current += 32;
+        }
+#endif
+#ifdef UTF16_SSE2
+        const __m128i mask = _mm_set1_epi16(static_cast<short>(0xFF80));
+        while (i + 16 <= length)
+        {
+            __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+            __m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 8));
+            __m128i nonAscii = _mm_and_si128(_mm_or_si128(low, high), mask);
+            if (_mm_movemask_epi8(_mm_cmpeq_epi16(nonAscii, _mm_setzero_si128())) != 0xFFFF)
+            {
+                break;
+            }
+
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(current), _mm_packus_epi16(low, high));
+            i += 16;
+            current += 16;
+        }
+#endif
+
+        // the tail and the blocks containing non ASCII characters
+        size_t end = (length - i > ScalarRun) ? i + ScalarRun : length;
+        while (i < end)
+        {
+            current += EncodeUtf8(src, length, i, current);
+        }
+    }
+
+    return current - dst;
+}
+
+size_t ConvertAsciiToUtf16(const char* src, size_t length, uint16_t* dst)
+{
+    size_t i = 0;
+#ifdef UTF16_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    while (i + 16 <= length)
+    {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        if (_mm_movemask_epi8(bytes) != 0)
+        {
+            break;
+        }
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_unpacklo_epi8(bytes, zero));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i + 8), _mm_unpackhi_epi8(bytes, zero));
+        i += 16;
+    }
+#endif
+
+    while ((i < length) && (static_cast<uint8_t>(src[i]) < 0x80))
+    {
+        dst[i] = static_cast<uint8_t>(src[i]);
+        i++;
+    }
+
+    return i;
+}
+
+void AppendUtf8(const wchar_t* str, size_t length, std::string& output)
+{
+    size_t size = output.size();
+    output.resize(size + 3 * length);
+    size_t written = ConvertUtf16ToUtf8(reinterpret_cast<const uint16_t*>(str), length, &output[size]);
+    output.resize(size + written);
+}
+
+void AppendWide(const char* str, size_t length, std::wstring& output)
+{
+    size_t size = output.size();
+    output.resize(size + length);
+    if (ConvertAsciiToUtf16(str, length, reinterpret_cast<uint16_t*>(&output[size])) == length)
+    {
+        return;
+    }
+
+    int count = MultiByteToWideChar(CP_ACP, 0, str, static_cast<int>(length), NULL, 0);
+    output.resize(size + count);
+    MultiByteToWideChar(CP_ACP, 0, str, static_cast<int>(length), &output[size], count);
+}
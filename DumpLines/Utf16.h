@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+// UTF-16 <-> UTF-8 conversions used for the names and paths returned by the COM APIs.
+// Almost all .NET identifiers and paths are ASCII: blocks of 16 (SSE2) or 32 (AVX2)
+// ASCII characters are narrowed or widened at once and only the other characters go
+// through the scalar encoder. The output is appended to a caller provided buffer that
+// can be reused between calls so that converting a string does not allocate.
+
+// dst must be able to receive 3 x length bytes; unpaired surrogates become U+FFFD.
+// Return the number of bytes written.
+size_t ConvertUtf16ToUtf8(const uint16_t* src, size_t length, char* dst);
+
+// Convert the leading ASCII characters; return how many were converted
+size_t ConvertAsciiToUtf16(const char* src, size_t length, uint16_t* dst);
+
+// Append the UTF-8 encoding of the UTF-16 string (the size of the buffer is adjusted once)
+void AppendUtf8(const wchar_t* str, size_t length, std::string& output);
+
+// The file paths given on the command line use the ANSI code page: non ASCII paths
+// are still converted by MultiByteToWideChar
+void AppendWide(const char* str, size_t length, std::wstring& output);
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+
+// Match text against a pattern where '*' matches any sequence of characters and '?' a single character
+inline bool MatchWildcard(const char* pattern, const char* text)
+{
+    const char* starPattern = nullptr;
+    const char* starText = nullptr;
+    while (*text != '\0')
+    {
+        if (*pattern == '*')
+        {
+            // remember the position to backtrack if the rest does not match
+            starPattern = pattern++;
+            starText = text;
+        }
+        else
+        if ((*pattern == '?') || (*pattern == *text))
+        {
+            pattern++;
+            text++;
+        }
+        else
+        if (starPattern != nullptr)
+        {
+            pattern = starPattern + 1;
+            text = ++starText;
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    while (*pattern == '*')
+    {
+        pattern++;
+    }
+
+    return (*pattern == '\0');
+}
+
+// Number of characters before the first wildcard: used to narrow lookups in a sorted index
+inline size_t GetWildcardPrefixLength(const char* pattern)
+{
+    size_t length = 0;
+    while ((pattern[length] != '\0') && (pattern[length] != '*') && (pattern[length] != '?'))
+    {
+        length++;
+    }
+
+    return length;
+}
+
+inline bool HasWildcard(const char* pattern)
+{
+    return pattern[GetWildcardPrefixLength(pattern)] != '\0';
+}